@@ -8,6 +8,9 @@
 #
 # Then open the URL "http://localhost:8080" in your favourite browser.
 #
+# For the public station page, use vetero-httpd instead: it serves the
+# compressed reports as they are and supports conditional requests.
+#
 # The MySimpleHTTPRequestHandler is heavily inspired by SimpleHTTPRequestHandler
 # from the Python distribution.
 #
@@ -0,0 +1,639 @@
+/* {{{
+ * (c) 2022, Bernhard Walle <bernhard@bwalle.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>. }}}
+ */
+
+/*
+ * Draws the diagrams of the vetero reports in the browser from the data feeds that
+ * vetero-reportgen writes with report_chart_renderer = "client" (see ChartFeed).
+ *
+ * Every <canvas class="vetero-chart" data-feed="..."> is replaced by the diagram. Move the
+ * mouse over the diagram to see the values, drag to zoom in and double-click to zoom out.
+ */
+
+(function () {
+    'use strict';
+
+    // same layout as the SvgChartRenderer
+    var MARGIN_LEFT = 80, MARGIN_RIGHT = 80, MARGIN_TOP = 20, MARGIN_BOTTOM = 60;
+    var FONT = '12px Arial';
+    var LINE_HEIGHT = 14;
+    var TIC_LENGTH = 6;
+    var BORDER_COLOR = '#000000';
+    var GRID_COLOR = '#a0a0a0';
+
+    // distances of time tics when zoomed in, in seconds
+    var TIME_STEPS = [60, 120, 300, 600, 900, 1800, 3600, 7200, 10800, 21600, 43200,
+                      86400, 172800, 604800, 1209600, 2592000];
+
+    /* Feed decoding {{{ */
+
+    function decompress(buffer) {
+        var bytes = new Uint8Array(buffer);
+
+        // the web server may have decoded it already (Content-Encoding: gzip)
+        if (bytes.length < 2 || bytes[0] !== 0x1f || bytes[1] !== 0x8b)
+            return Promise.resolve(new TextDecoder().decode(bytes));
+
+        if (typeof DecompressionStream === 'undefined')
+            return Promise.reject(new Error('The browser cannot decompress the data'));
+
+        var stream = new Blob([bytes]).stream().pipeThrough(new DecompressionStream('gzip'));
+        return new Response(stream).text();
+    }
+
+    // undoes the delta encoding, null becomes NaN
+    function decodeValues(encoded) {
+        var values = new Array(encoded.values.length);
+        var previous = 0;
+        for (var i = 0; i < encoded.values.length; i++) {
+            var delta = encoded.values[i];
+            if (delta === null) {
+                values[i] = NaN;
+                continue;
+            }
+            previous += delta;
+            values[i] = previous / encoded.scale;
+        }
+        return values;
+    }
+
+    function decimals(encoded) {
+        return Math.round(Math.log10(encoded.scale));
+    }
+
+    function loadFeed(url) {
+        return fetch(url).then(function (response) {
+            if (!response.ok)
+                throw new Error('Unable to load ' + url + ': ' + response.status);
+            return response.arrayBuffer();
+        }).then(decompress).then(function (text) {
+            var feed = JSON.parse(text);
+            if (feed.version !== 1)
+                throw new Error('Unsupported feed version ' + feed.version);
+
+            feed.xValues = decodeValues(feed.x);
+            feed.series.forEach(function (series) {
+                series.yValues = decodeValues(series);
+            });
+            return feed;
+        });
+    }
+
+    /* }}} */
+    /* Tics {{{ */
+
+    function pad(number) {
+        return number < 10 ? '0' + number : String(number);
+    }
+
+    // the times in the feed are local times stored as UTC like in Chart::parseTime()
+    function formatTime(seconds, step, span) {
+        var date = new Date(seconds * 1000);
+        var day = pad(date.getUTCDate()) + '.' + pad(date.getUTCMonth() + 1) + '.';
+        var time = pad(date.getUTCHours()) + ':' + pad(date.getUTCMinutes());
+
+        if (step >= 86400)
+            return day;
+        if (span > 86400)
+            return day + '\n' + time;
+        return time;
+    }
+
+    function niceStep(range, count) {
+        var raw = range / count;
+        var magnitude = Math.pow(10, Math.floor(Math.log10(raw)));
+        var normalized = raw / magnitude;
+
+        if (normalized <= 1)
+            return magnitude;
+        else if (normalized <= 2)
+            return 2 * magnitude;
+        else if (normalized <= 5)
+            return 5 * magnitude;
+        return 10 * magnitude;
+    }
+
+    function formatNumber(value, step) {
+        var decimals = Math.max(0, -Math.floor(Math.log10(step) + 1e-9));
+        if (Math.abs(value) < step / 2)
+            value = 0;
+        return value.toFixed(decimals);
+    }
+
+    function xTics(feed, min, max) {
+        var step, tics = [];
+
+        if (feed.time) {
+            step = TIME_STEPS[TIME_STEPS.length - 1];
+            for (var i = 0; i < TIME_STEPS.length; i++) {
+                if ((max - min) / TIME_STEPS[i] <= 10) {
+                    step = TIME_STEPS[i];
+                    break;
+                }
+            }
+        } else
+            step = niceStep(max - min, 10);
+
+        for (var pos = Math.ceil(min / step - 1e-9) * step; pos <= max + step * 1e-9; pos += step) {
+            tics.push([pos, feed.time ? formatTime(pos, step, max - min)
+                                      : formatNumber(pos, step)]);
+        }
+        return tics;
+    }
+
+    /* }}} */
+    /* Chart {{{ */
+
+    function Chart(canvas, feed) {
+        this.canvas = canvas;
+        this.feed = feed;
+        this.width = canvas.width;
+        this.height = canvas.height;
+        this.left = MARGIN_LEFT;
+        this.right = this.width - MARGIN_RIGHT;
+        this.top = MARGIN_TOP;
+        this.bottom = this.height - MARGIN_BOTTOM;
+        this.hover = -1;
+        this.dragStart = null;
+        this.dragEnd = null;
+
+        // sharp lines on high resolution displays
+        var ratio = window.devicePixelRatio || 1;
+        canvas.style.width = this.width + 'px';
+        canvas.style.height = this.height + 'px';
+        canvas.width = Math.round(this.width * ratio);
+        canvas.height = Math.round(this.height * ratio);
+        this.context = canvas.getContext('2d');
+        this.context.scale(ratio, ratio);
+
+        this.resetZoom();
+        this.installHandlers();
+    }
+
+    Chart.prototype.resetZoom = function () {
+        this.xMin = this.feed.xAxis.min;
+        this.xMax = this.feed.xAxis.max;
+        this.xTics = this.feed.xAxis.tics;
+        this.draw();
+    };
+
+    Chart.prototype.zoom = function (x1, x2) {
+        this.xMin = this.unmapX(Math.min(x1, x2));
+        this.xMax = this.unmapX(Math.max(x1, x2));
+        this.xTics = xTics(this.feed, this.xMin, this.xMax);
+        this.draw();
+    };
+
+    Chart.prototype.mapX = function (x) {
+        return this.left + (x - this.xMin) / (this.xMax - this.xMin) * (this.right - this.left);
+    };
+
+    Chart.prototype.unmapX = function (pixel) {
+        return this.xMin + (pixel - this.left) / (this.right - this.left) * (this.xMax - this.xMin);
+    };
+
+    Chart.prototype.mapY = function (y) {
+        var axis = this.feed.yAxis;
+        return this.bottom - (y - axis.min) / (axis.max - axis.min) * (this.bottom - this.top);
+    };
+
+    Chart.prototype.hasGrid = function (grid) {
+        return this.feed.grid.indexOf(grid) >= 0;
+    };
+
+    Chart.prototype.draw = function () {
+        var ctx = this.context;
+        var feed = this.feed;
+        var self = this;
+
+        ctx.save();
+        ctx.fillStyle = '#ffffff';
+        ctx.fillRect(0, 0, this.width, this.height);
+
+        // grid
+
+        ctx.strokeStyle = GRID_COLOR;
+        ctx.lineWidth = 0.5;
+        ctx.setLineDash([2, 4]);
+        ctx.beginPath();
+        if (this.hasGrid('x')) {
+            this.xTics.forEach(function (tic) {
+                ctx.moveTo(self.mapX(tic[0]), self.bottom);
+                ctx.lineTo(self.mapX(tic[0]), self.top);
+            });
+        }
+        if (this.hasGrid('y') || this.hasGrid('y2')) {
+            var gridTics = this.hasGrid('y2') ? feed.y2Tics : feed.yAxis.tics;
+            gridTics.forEach(function (tic) {
+                if (tic[0] < feed.yAxis.min || tic[0] > feed.yAxis.max)
+                    return;
+                ctx.moveTo(self.left, self.mapY(tic[0]));
+                ctx.lineTo(self.right, self.mapY(tic[0]));
+            });
+        }
+        ctx.stroke();
+        ctx.setLineDash([]);
+
+        // data
+
+        ctx.save();
+        ctx.beginPath();
+        ctx.rect(this.left, this.top, this.right - this.left, this.bottom - this.top);
+        ctx.clip();
+        feed.series.forEach(function (series) {
+            self.drawSeries(series);
+        });
+        ctx.restore();
+
+        // border and tics
+
+        ctx.strokeStyle = BORDER_COLOR;
+        ctx.lineWidth = 1;
+        ctx.strokeRect(this.left, this.top, this.right - this.left, this.bottom - this.top);
+        ctx.beginPath();
+        this.xTics.forEach(function (tic) {
+            var x = self.mapX(tic[0]);
+            ctx.moveTo(x, self.bottom);
+            ctx.lineTo(x, self.bottom - TIC_LENGTH);
+            ctx.moveTo(x, self.top);
+            ctx.lineTo(x, self.top + TIC_LENGTH);
+        });
+        var mirrorYTics = feed.y2Tics.length === 0;
+        feed.yAxis.tics.forEach(function (tic) {
+            var y = self.mapY(tic[0]);
+            ctx.moveTo(self.left, y);
+            ctx.lineTo(self.left + TIC_LENGTH, y);
+            if (mirrorYTics) {
+                ctx.moveTo(self.right, y);
+                ctx.lineTo(self.right - TIC_LENGTH, y);
+            }
+        });
+        feed.y2Tics.forEach(function (tic) {
+            if (tic[0] < feed.yAxis.min || tic[0] > feed.yAxis.max)
+                return;
+            ctx.moveTo(self.right, self.mapY(tic[0]));
+            ctx.lineTo(self.right - TIC_LENGTH, self.mapY(tic[0]));
+        });
+        ctx.stroke();
+
+        // labels
+
+        ctx.font = FONT;
+        ctx.fillStyle = '#000000';
+        this.xTics.forEach(function (tic) {
+            self.drawText(self.mapX(tic[0]), self.bottom + LINE_HEIGHT + 4, 'center', tic[1]);
+        });
+        feed.yAxis.tics.forEach(function (tic) {
+            self.drawText(self.left - 8, self.mapY(tic[0]) + 4, 'right', tic[1]);
+        });
+        feed.y2Tics.forEach(function (tic) {
+            if (tic[0] < feed.yAxis.min || tic[0] > feed.yAxis.max)
+                return;
+            self.drawText(self.right + 8, self.mapY(tic[0]) + 4, 'left', tic[1]);
+        });
+        if (feed.xLabel)
+            this.drawText((this.left + this.right) / 2, this.height - 8, 'center', feed.xLabel);
+        if (feed.yLabel)
+            this.drawText(24, (this.top + this.bottom) / 2, 'center', feed.yLabel, -90);
+        if (feed.y2Label)
+            this.drawText(this.width - 24, (this.top + this.bottom) / 2, 'center', feed.y2Label, 90);
+
+        this.drawKey();
+        this.drawSelection();
+        this.drawHover();
+
+        ctx.restore();
+    };
+
+    Chart.prototype.drawText = function (x, y, align, text, rotate) {
+        var ctx = this.context;
+        var lines = String(text).split('\n');
+
+        ctx.save();
+        ctx.translate(x, y);
+        if (rotate)
+            ctx.rotate(rotate * Math.PI / 180);
+        ctx.textAlign = align;
+        for (var i = 0; i < lines.length; i++)
+            ctx.fillText(lines[i], 0, i * LINE_HEIGHT);
+        ctx.restore();
+    };
+
+    Chart.prototype.drawMarker = function (series, x, y) {
+        var ctx = this.context;
+        var size = 4 * series.pointSize;
+
+        ctx.fillStyle = series.color;
+        ctx.beginPath();
+        if (series.pointType === 'triangle') {
+            ctx.moveTo(x, y - size);
+            ctx.lineTo(x + size, y + size * 0.7);
+            ctx.lineTo(x - size, y + size * 0.7);
+            ctx.closePath();
+        } else
+            ctx.arc(x, y, size * 0.75, 0, 2 * Math.PI);
+        ctx.fill();
+    };
+
+    // like Gnuplot, boxes touch their neighbours if no width is set
+    Chart.prototype.boxWidth = function (series, index) {
+        var xs = this.feed.xValues, ys = series.yValues;
+        var left = NaN, right = NaN, i;
+
+        if (this.feed.boxWidth > 0)
+            return this.feed.boxWidth;
+
+        for (i = index - 1; i >= 0; i--) {
+            if (!isNaN(ys[i])) {
+                left = xs[index] - xs[i];
+                break;
+            }
+        }
+        for (i = index + 1; i < ys.length; i++) {
+            if (!isNaN(ys[i])) {
+                right = xs[i] - xs[index];
+                break;
+            }
+        }
+        if (isNaN(left) && isNaN(right))
+            return (this.feed.xAxis.max - this.feed.xAxis.min) / 20;
+        return isNaN(left) ? right : isNaN(right) ? left : (left + right) / 2;
+    };
+
+    Chart.prototype.drawSeries = function (series) {
+        var ctx = this.context;
+        var xs = this.feed.xValues, ys = series.yValues;
+        var axis = this.feed.yAxis;
+        var base = this.mapY(Math.min(Math.max(0, axis.min), axis.max));
+        var i, connected;
+
+        ctx.strokeStyle = series.color;
+        ctx.fillStyle = series.color;
+        ctx.lineWidth = series.lineWidth;
+        ctx.lineJoin = 'round';
+
+        switch (series.style) {
+            case 'lines':
+            case 'linespoints':
+                ctx.beginPath();
+                connected = false;
+                for (i = 0; i < xs.length; i++) {
+                    if (isNaN(ys[i])) {
+                        connected = false;
+                        continue;
+                    }
+                    if (connected)
+                        ctx.lineTo(this.mapX(xs[i]), this.mapY(ys[i]));
+                    else
+                        ctx.moveTo(this.mapX(xs[i]), this.mapY(ys[i]));
+                    connected = true;
+                }
+                ctx.stroke();
+                if (series.style === 'lines')
+                    break;
+                /* falls through */
+
+            case 'points':
+                for (i = 0; i < xs.length; i++)
+                    if (!isNaN(ys[i]))
+                        this.drawMarker(series, this.mapX(xs[i]), this.mapY(ys[i]));
+                break;
+
+            case 'boxes':
+                for (i = 0; i < xs.length; i++) {
+                    if (isNaN(ys[i]))
+                        continue;
+                    var width = this.boxWidth(series, i);
+                    var x1 = this.mapX(xs[i] - width / 2);
+                    var x2 = this.mapX(xs[i] + width / 2);
+                    var y = this.mapY(ys[i]);
+                    ctx.fillRect(x1, Math.min(y, base), x2 - x1, Math.abs(base - y));
+                    ctx.strokeRect(x1, Math.min(y, base), x2 - x1, Math.abs(base - y));
+                }
+                break;
+
+            case 'impulses':
+                ctx.beginPath();
+                for (i = 0; i < xs.length; i++) {
+                    if (isNaN(ys[i]))
+                        continue;
+                    ctx.moveTo(this.mapX(xs[i]), base);
+                    ctx.lineTo(this.mapX(xs[i]), this.mapY(ys[i]));
+                }
+                ctx.stroke();
+                break;
+        }
+    };
+
+    // at the top right of the plot area like Gnuplot's default key
+    Chart.prototype.drawKey = function () {
+        var ctx = this.context;
+        var y = this.top + LINE_HEIGHT;
+        var sampleLeft = this.right - 60;
+        var sampleRight = this.right - 12;
+        var self = this;
+
+        this.feed.series.forEach(function (series) {
+            if (!series.title)
+                return;
+
+            ctx.fillStyle = '#000000';
+            self.drawText(sampleLeft - 8, y, 'right', series.title);
+
+            var middle = y - 4;
+            switch (series.style) {
+                case 'lines':
+                case 'linespoints':
+                case 'impulses':
+                    ctx.strokeStyle = series.color;
+                    ctx.lineWidth = series.lineWidth;
+                    ctx.beginPath();
+                    ctx.moveTo(sampleLeft, middle);
+                    ctx.lineTo(sampleRight, middle);
+                    ctx.stroke();
+                    if (series.style === 'linespoints')
+                        self.drawMarker(series, (sampleLeft + sampleRight) / 2, middle);
+                    break;
+
+                case 'points':
+                    self.drawMarker(series, (sampleLeft + sampleRight) / 2, middle);
+                    break;
+
+                case 'boxes':
+                    ctx.fillStyle = series.color;
+                    ctx.fillRect(sampleLeft, middle - 4, sampleRight - sampleLeft, 8);
+                    break;
+            }
+
+            y += LINE_HEIGHT;
+        });
+    };
+
+    Chart.prototype.drawSelection = function () {
+        if (this.dragStart === null || this.dragEnd === null)
+            return;
+
+        var ctx = this.context;
+        ctx.fillStyle = 'rgba(0, 0, 255, 0.1)';
+        ctx.fillRect(Math.min(this.dragStart, this.dragEnd), this.top,
+                     Math.abs(this.dragEnd - this.dragStart), this.bottom - this.top);
+    };
+
+    Chart.prototype.drawHover = function () {
+        var index = this.hover;
+        if (index < 0 || this.dragStart !== null)
+            return;
+
+        var ctx = this.context;
+        var feed = this.feed;
+        var x = this.mapX(feed.xValues[index]);
+        var lines = [];
+        var self = this;
+
+        if (feed.time) {
+            var span = feed.xAxis.max - feed.xAxis.min;
+            lines.push(formatTime(feed.xValues[index], 60, span).replace('\n', ' '));
+        } else
+            lines.push(feed.xValues[index].toFixed(decimals(feed.x)));
+        feed.series.forEach(function (series, i) {
+            var value = series.yValues[index];
+            if (isNaN(value))
+                return;
+            lines.push((series.title || ('#' + (i + 1))) + ': ' + value.toFixed(decimals(series)));
+        });
+
+        ctx.strokeStyle = '#606060';
+        ctx.lineWidth = 1;
+        ctx.beginPath();
+        ctx.moveTo(x, this.top);
+        ctx.lineTo(x, this.bottom);
+        ctx.stroke();
+
+        ctx.font = FONT;
+        var width = 0;
+        lines.forEach(function (line) {
+            width = Math.max(width, ctx.measureText(line).width);
+        });
+        width += 12;
+        var height = lines.length * LINE_HEIGHT + 8;
+        var boxX = x + 8 + width > this.right ? x - 8 - width : x + 8;
+        var boxY = this.top + 8;
+
+        ctx.fillStyle = 'rgba(255, 255, 255, 0.9)';
+        ctx.fillRect(boxX, boxY, width, height);
+        ctx.strokeRect(boxX, boxY, width, height);
+        ctx.fillStyle = '#000000';
+        lines.forEach(function (line, i) {
+            self.drawText(boxX + 6, boxY + 4 + (i + 1) * LINE_HEIGHT - 3, 'left', line);
+        });
+    };
+
+    // index of the value with the nearest x inside of the visible range, -1 if there's none
+    Chart.prototype.nearestIndex = function (pixel) {
+        var xs = this.feed.xValues;
+        var x = this.unmapX(pixel);
+        var best = -1;
+
+        for (var i = 0; i < xs.length; i++) {
+            if (xs[i] < this.xMin || xs[i] > this.xMax)
+                continue;
+            if (best < 0 || Math.abs(xs[i] - x) < Math.abs(xs[best] - x))
+                best = i;
+        }
+        return best;
+    };
+
+    Chart.prototype.installHandlers = function () {
+        var self = this;
+        var pending = false;
+
+        function position(event) {
+            var rect = self.canvas.getBoundingClientRect();
+            var x = (event.clientX - rect.left) * self.width / rect.width;
+            return Math.min(Math.max(x, self.left), self.right);
+        }
+
+        function redraw() {
+            if (pending)
+                return;
+            pending = true;
+            window.requestAnimationFrame(function () {
+                pending = false;
+                self.draw();
+            });
+        }
+
+        this.canvas.addEventListener('mousedown', function (event) {
+            self.dragStart = position(event);
+            self.dragEnd = null;
+            event.preventDefault();
+        });
+
+        this.canvas.addEventListener('mousemove', function (event) {
+            if (self.dragStart !== null)
+                self.dragEnd = position(event);
+            else
+                self.hover = self.nearestIndex(position(event));
+            redraw();
+        });
+
+        this.canvas.addEventListener('mouseup', function () {
+            var start = self.dragStart, end = self.dragEnd;
+            self.dragStart = self.dragEnd = null;
+            if (start !== null && end !== null && Math.abs(end - start) > 5)
+                self.zoom(start, end);
+            else
+                redraw();
+        });
+
+        this.canvas.addEventListener('mouseleave', function () {
+            self.hover = -1;
+            self.dragStart = self.dragEnd = null;
+            redraw();
+        });
+
+        this.canvas.addEventListener('dblclick', function () {
+            self.resetZoom();
+        });
+    };
+
+    /* }}} */
+
+    function showError(canvas, message) {
+        var ctx = canvas.getContext('2d');
+        ctx.font = FONT;
+        ctx.fillStyle = '#cc0000';
+        ctx.fillText(message, 10, 20);
+    }
+
+    function init() {
+        var canvases = document.querySelectorAll('canvas.vetero-chart');
+        Array.prototype.forEach.call(canvases, function (canvas) {
+            loadFeed(canvas.getAttribute('data-feed')).then(function (feed) {
+                new Chart(canvas, feed);
+            }).catch(function (error) {
+                showError(canvas, error.message);
+            });
+        });
+    }
+
+    if (document.readyState === 'loading')
+        document.addEventListener('DOMContentLoaded', init);
+    else
+        init();
+})();
+
+// vim: set sw=4 ts=4 et fdm=marker:
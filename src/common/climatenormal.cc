@@ -0,0 +1,125 @@
+/* {{{
+ * (c) 2022, Bernhard Walle <bernhard@bwalle.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>. }}}
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#include <libbw/stringutil.h>
+
+#include "climatenormal.h"
+
+namespace vetero {
+namespace common {
+
+/* ClimateNormal {{{ */
+
+namespace {
+
+std::string rounded(double value)
+{
+    return bw::str(std::llround(value));
+}
+
+} // anonymous namespace
+
+ClimateNormal::ClimateNormal(const Database::Result &result, size_t column)
+    : m_sum(0.0)
+    , m_minimum(NAN)
+    , m_maximum(NAN)
+{
+    for (size_t i = 0; i < result.data.size(); ++i) {
+        const std::vector<std::string> &row = result.data[i];
+        if (column >= row.size() || row[column].empty())
+            continue;
+
+        // the monthly statistics are averages, so the values are not always integers
+        double value = std::strtod(row[column].c_str(), NULL);
+        m_sorted.push_back(value);
+        m_sum += value;
+
+        if (std::isnan(m_minimum) || value < m_minimum) {
+            m_minimum = value;
+            m_minimumKey = row.at(0);
+        }
+        if (std::isnan(m_maximum) || value > m_maximum) {
+            m_maximum = value;
+            m_maximumKey = row.at(0);
+        }
+    }
+
+    std::sort(m_sorted.begin(), m_sorted.end());
+}
+
+size_t ClimateNormal::count() const
+{
+    return m_sorted.size();
+}
+
+std::string ClimateNormal::mean() const
+{
+    if (m_sorted.empty())
+        return "NULL";
+
+    return rounded(m_sum / m_sorted.size());
+}
+
+std::string ClimateNormal::percentile(double p) const
+{
+    if (m_sorted.empty())
+        return "NULL";
+
+    double position = p * (m_sorted.size() - 1);
+    size_t lower = static_cast<size_t>(std::floor(position));
+    size_t upper = std::min(lower + 1, m_sorted.size() - 1);
+    double fraction = position - lower;
+
+    return rounded(m_sorted[lower] + (m_sorted[upper] - m_sorted[lower]) * fraction);
+}
+
+std::string ClimateNormal::minimum() const
+{
+    return std::isnan(m_minimum) ? "NULL" : rounded(m_minimum);
+}
+
+std::string ClimateNormal::minimumKey() const
+{
+    return std::isnan(m_minimum) ? "NULL" : m_minimumKey;
+}
+
+std::string ClimateNormal::maximum() const
+{
+    return std::isnan(m_maximum) ? "NULL" : rounded(m_maximum);
+}
+
+std::string ClimateNormal::maximumKey() const
+{
+    return std::isnan(m_maximum) ? "NULL" : m_maximumKey;
+}
+
+void ClimateNormal::setRecords(const ClimateNormal &other)
+{
+    m_minimum = other.m_minimum;
+    m_maximum = other.m_maximum;
+    m_minimumKey = other.m_minimumKey;
+    m_maximumKey = other.m_maximumKey;
+}
+
+/* }}} */
+
+} // end namespace common
+} // end namespace vetero
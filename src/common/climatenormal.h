@@ -0,0 +1,130 @@
+/* {{{
+ * (c) 2022, Bernhard Walle <bernhard@bwalle.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>. }}}
+ */
+#ifndef VETERO_COMMON_CLIMATENORMAL_H_
+#define VETERO_COMMON_CLIMATENORMAL_H_
+
+#include <string>
+#include <vector>
+
+#include "database.h"
+
+namespace vetero {
+namespace common {
+
+/* ClimateNormal {{{ */
+
+/**
+ * \class ClimateNormal
+ * \brief Mean, percentiles and records of one value over several years
+ *
+ * Used by DbAccess to compute the climate normals. The values are read from one column of a
+ * query result whose first column is the date or month of the row. Empty values (NULL) are
+ * skipped. The results are returned as strings that can be passed to Database::executeSql()
+ * with c_str_null(), <tt>"NULL"</tt> if there are no values.
+ *
+ * \author Bernhard Walle <bernhard@bwalle.de>
+ * \ingroup common
+ */
+class ClimateNormal
+{
+    public:
+        /**
+         * \brief Collects the values
+         *
+         * \param[in] result the query result, ordered by the first column
+         * \param[in] column the column of the values
+         */
+        ClimateNormal(const Database::Result &result, size_t column);
+
+    public:
+        /**
+         * \brief Returns the number of values
+         *
+         * \return the number of rows with a value
+         */
+        size_t count() const;
+
+        /**
+         * \brief Returns the rounded mean
+         *
+         * \return the mean or <tt>"NULL"</tt>
+         */
+        std::string mean() const;
+
+        /**
+         * \brief Returns a rounded percentile, interpolated linearly between the values
+         *
+         * \param[in] p the percentile between 0.0 and 1.0
+         * \return the percentile or <tt>"NULL"</tt>
+         */
+        std::string percentile(double p) const;
+
+        /**
+         * \brief Returns the lowest value
+         *
+         * \return the value or <tt>"NULL"</tt>
+         */
+        std::string minimum() const;
+
+        /**
+         * \brief Returns the first column of the row with the lowest value
+         *
+         * If the record has been reached several times, the first occurrence counts.
+         *
+         * \return the date or month or <tt>"NULL"</tt>
+         */
+        std::string minimumKey() const;
+
+        /**
+         * \brief Returns the highest value
+         *
+         * \return the value or <tt>"NULL"</tt>
+         */
+        std::string maximum() const;
+
+        /**
+         * \brief Returns the first column of the row with the highest value
+         *
+         * \return the date or month or <tt>"NULL"</tt>
+         */
+        std::string maximumKey() const;
+
+        /**
+         * \brief Takes the records from another normal
+         *
+         * The monthly normals are means of monthly values, but the records are the extremes
+         * of single days.
+         *
+         * \param[in] other the normal of the daily values
+         */
+        void setRecords(const ClimateNormal &other);
+
+    private:
+        std::vector<double> m_sorted;
+        double m_sum;
+        double m_minimum;
+        double m_maximum;
+        std::string m_minimumKey;
+        std::string m_maximumKey;
+};
+
+/* }}} */
+
+} // end namespace common
+} // end namespace vetero
+
+#endif // VETERO_COMMON_CLIMATENORMAL_H_
@@ -15,6 +15,7 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>. }}}
  */
 #include <cstdio>
+#include <cstring>
 #include <sstream>
 #include <unistd.h>
 
@@ -94,11 +95,18 @@ void Configuration::read(const std::string &filename)
     long sensor_number = -1;
     char *report_title_color1 = NULL, *report_title_color2 = NULL;
     char *report_directory = NULL, *report_upload_command = NULL;
+    char *report_chart_renderer = NULL, *report_stats_file = NULL;
     char *display_name = NULL, *display_connection = NULL;
     char *location_string = NULL;
+    char *api_socket = NULL, *feed_socket = NULL;
     char *cloud_type = nullptr, *cloud_station_id = nullptr, *cloud_station_password = nullptr;
+    char *cloud_url = nullptr;
     char *locale = NULL;
-    long serial_baud = -1, pressure_height = -1;
+    long serial_baud = -1, pressure_height = -1, report_workers = -1;
+    long report_svg_compression = -1;
+    long api_port = -1, api_samples = -1;
+    long update_postscript_timeout = -1, hooks_max_running = -1;
+    cfg_bool_t report_data_feeds = cfg_false;
 
     cfg_opt_t opts[] = {
         CFG_SIMPLE_STR(const_cast<char *>("serial_device"),             &serial_device),
@@ -112,19 +120,32 @@ void Configuration::read(const std::string &filename)
 
         CFG_SIMPLE_STR(const_cast<char *>("database_path"),             &database_path),
         CFG_SIMPLE_STR(const_cast<char *>("update_postscript"),         &update_postscript),
+        CFG_SIMPLE_INT(const_cast<char *>("update_postscript_timeout"), &update_postscript_timeout),
+        CFG_SIMPLE_INT(const_cast<char *>("hooks_max_running"),         &hooks_max_running),
 
         CFG_SIMPLE_STR(const_cast<char *>("report_directory"),          &report_directory),
         CFG_SIMPLE_STR(const_cast<char *>("report_title_color1"),       &report_title_color1),
         CFG_SIMPLE_STR(const_cast<char *>("report_title_color2"),       &report_title_color2),
         CFG_SIMPLE_STR(const_cast<char *>("report_upload_command"),     &report_upload_command),
+        CFG_SIMPLE_INT(const_cast<char *>("report_workers"),            &report_workers),
+        CFG_SIMPLE_STR(const_cast<char *>("report_chart_renderer"),     &report_chart_renderer),
+        CFG_SIMPLE_INT(const_cast<char *>("report_svg_compression"),    &report_svg_compression),
+        CFG_SIMPLE_BOOL(const_cast<char *>("report_data_feeds"),        &report_data_feeds),
+        CFG_SIMPLE_STR(const_cast<char *>("report_stats_file"),         &report_stats_file),
         CFG_SIMPLE_STR(const_cast<char *>("location_string"),           &location_string),
 
+        CFG_SIMPLE_STR(const_cast<char *>("api_socket"),                &api_socket),
+        CFG_SIMPLE_INT(const_cast<char *>("api_port"),                  &api_port),
+        CFG_SIMPLE_INT(const_cast<char *>("api_samples"),               &api_samples),
+        CFG_SIMPLE_STR(const_cast<char *>("feed_socket"),               &feed_socket),
+
         CFG_SIMPLE_STR(const_cast<char *>("display_name"),              &display_name),
         CFG_SIMPLE_STR(const_cast<char *>("display_connection"),        &display_connection),
 
         CFG_SIMPLE_STR(const_cast<char *>("cloud_type"),                &cloud_type),
         CFG_SIMPLE_STR(const_cast<char *>("cloud_station_id"),          &cloud_station_id),
         CFG_SIMPLE_STR(const_cast<char *>("cloud_station_password"),    &cloud_station_password),
+        CFG_SIMPLE_STR(const_cast<char *>("cloud_url"),                 &cloud_url),
 
         CFG_SIMPLE_STR(const_cast<char *>("locale"),                    &locale),
         CFG_END()
@@ -183,6 +204,13 @@ void Configuration::read(const std::string &filename)
         std::free(update_postscript);
     }
 
+    // 0 disables the timeout
+    if (update_postscript_timeout >= 0)
+        m_updatePostscriptTimeout = update_postscript_timeout;
+
+    if (hooks_max_running > 0)
+        m_hooksMaxRunning = hooks_max_running;
+
     if (report_directory) {
         if (access(report_directory, W_OK) != 0)
             BW_ERROR_ERR("Directory '%s' not accessible writable. Disabling HTML reports.", report_directory);
@@ -209,11 +237,53 @@ void Configuration::read(const std::string &filename)
         std::free(report_upload_command);
     }
 
+    if (report_workers > 0)
+        m_reportWorkers = report_workers;
+
+    if (report_stats_file) {
+        m_reportStatsFile = report_stats_file;
+        std::free(report_stats_file);
+    }
+
+    if (report_chart_renderer) {
+        if (std::strcmp(report_chart_renderer, "native") != 0 &&
+                std::strcmp(report_chart_renderer, "gnuplot") != 0 &&
+                std::strcmp(report_chart_renderer, "client") != 0)
+            BW_ERROR_ERR("Invalid chart renderer '%s'. Default to 'native'.", report_chart_renderer);
+        else
+            m_reportChartRenderer = report_chart_renderer;
+        std::free(report_chart_renderer);
+    }
+
+    if (report_svg_compression >= 0 && report_svg_compression <= 9)
+        m_reportSvgCompression = report_svg_compression;
+    else if (report_svg_compression != -1)
+        BW_ERROR_ERR("Invalid SVG compression level %ld. Default to %d.",
+                     report_svg_compression, m_reportSvgCompression);
+
+    m_reportDataFeeds = report_data_feeds == cfg_true;
+
     if (location_string) {
         m_locationString = location_string;
         std::free(location_string);
     }
 
+    if (api_socket) {
+        m_apiSocket = api_socket;
+        std::free(api_socket);
+    }
+
+    if (api_port > 0 && api_port <= 65535)
+        m_apiPort = api_port;
+
+    if (api_samples > 0)
+        m_apiSamples = api_samples;
+
+    if (feed_socket) {
+        m_feedSocket = feed_socket;
+        std::free(feed_socket);
+    }
+
     if (display_name) {
         m_displayName = display_name;
         std::free(display_name);
@@ -244,6 +314,11 @@ void Configuration::read(const std::string &filename)
         std::free(cloud_station_password);
     }
 
+    if (cloud_url) {
+        m_cloudUrl = cloud_url;
+        std::free(cloud_url);
+    }
+
     m_configurationRead = true;
 
     BW_DEBUG_DBG("Parsing of configuration file '%s' finished: %s",
@@ -290,6 +365,16 @@ std::string Configuration::updatePostscript() const
     return m_updatePostscript;
 }
 
+int Configuration::updatePostscriptTimeout() const
+{
+    return m_updatePostscriptTimeout;
+}
+
+int Configuration::hooksMaxRunning() const
+{
+    return m_hooksMaxRunning;
+}
+
 std::string Configuration::reportDirectory() const
 {
     return m_reportDirectory;
@@ -310,11 +395,57 @@ std::string Configuration::reportUploadCommand() const
     return m_reportUploadCommand;
 }
 
+int Configuration::reportWorkers() const
+{
+    return m_reportWorkers;
+}
+
+std::string Configuration::reportChartRenderer() const
+{
+    return m_reportChartRenderer;
+}
+
+int Configuration::reportSvgCompression() const
+{
+    return m_reportSvgCompression;
+}
+
+bool Configuration::reportDataFeeds() const
+{
+    // the client-side charts are drawn from the feeds
+    return m_reportDataFeeds || m_reportChartRenderer == "client";
+}
+
+std::string Configuration::reportStatsFile() const
+{
+    return m_reportStatsFile;
+}
+
 std::string Configuration::locationString() const
 {
     return m_locationString;
 }
 
+std::string Configuration::apiSocket() const
+{
+    return m_apiSocket;
+}
+
+int Configuration::apiPort() const
+{
+    return m_apiPort;
+}
+
+int Configuration::apiSamples() const
+{
+    return m_apiSamples;
+}
+
+std::string Configuration::feedSocket() const
+{
+    return m_feedSocket;
+}
+
 std::string Configuration::displayName() const
 {
     return m_displayName;
@@ -340,6 +471,11 @@ std::string Configuration::cloudStationPassword() const
     return m_cloudStationPassword;
 }
 
+std::string Configuration::cloudUrl() const
+{
+    return m_cloudUrl;
+}
+
 std::string Configuration::locale() const
 {
     return m_locale;
@@ -354,6 +490,10 @@ std::string Configuration::str() const
        << "sensorType="           << m_sensorType             << ", "
        << "reportDirectory="      << m_reportDirectory        << ", "
        << "reportUploadCommand="  << m_reportUploadCommand    << ", "
+       << "reportWorkers="        << m_reportWorkers          << ", "
+       << "reportChartRenderer="  << m_reportChartRenderer    << ", "
+       << "reportSvgCompression=" << m_reportSvgCompression   << ", "
+       << "reportDataFeeds="      << m_reportDataFeeds        << ", "
        << "locationString="       << m_locationString         << ", "
        << "databasePath="         << m_databasePath           << ", "
        << "displayName="          << m_displayName            << ", "
@@ -54,6 +54,8 @@ class Configuration
 
         std::string databasePath() const;
         std::string updatePostscript() const;
+        int updatePostscriptTimeout() const;
+        int hooksMaxRunning() const;
 
         // Report generation
 
@@ -61,9 +63,21 @@ class Configuration
         std::string reportTitleColor2() const;
         std::string reportDirectory() const;
         std::string reportUploadCommand() const;
+        int reportWorkers() const;
+        std::string reportChartRenderer() const;
+        int reportSvgCompression() const;
+        bool reportDataFeeds() const;
+        std::string reportStatsFile() const;
         std::string locationString() const;
         std::string locale() const;
 
+        // Live API
+
+        std::string apiSocket() const;
+        int apiPort() const;
+        int apiSamples() const;
+        std::string feedSocket() const;
+
         // LCD
 
         std::string displayName() const;
@@ -74,6 +88,7 @@ class Configuration
         std::string cloudType() const;
         std::string cloudStationId() const;
         std::string cloudStationPassword() const;
+        std::string cloudUrl() const;
 
         std::string str() const;
 
@@ -91,9 +106,20 @@ class Configuration
         std::string m_reportTitleColor2 = "#91d007";
         std::string m_reportDirectory;
         std::string m_reportUploadCommand;
+        std::string m_reportStatsFile;
+        int         m_reportWorkers = 1;
+        std::string m_reportChartRenderer = "native";
+        int         m_reportSvgCompression = 6;
+        bool        m_reportDataFeeds = false;
         std::string m_locationString;
+        std::string m_apiSocket;
+        int         m_apiPort = 0;
+        int         m_apiSamples = 1440;
+        std::string m_feedSocket;
         std::string m_databasePath = "vetero.db";
         std::string m_updatePostscript;
+        int         m_updatePostscriptTimeout = 60;
+        int         m_hooksMaxRunning = 4;
         std::string m_displayName;
         std::string m_displayConnection;
         bool        m_configurationRead = false;
@@ -102,6 +128,7 @@ class Configuration
         std::string m_cloudType;
         std::string m_cloudStationId;
         std::string m_cloudStationPassword;
+        std::string m_cloudUrl;
 };
 
 } // end namespace common
@@ -18,12 +18,18 @@
 #include <sstream>
 #include <cassert>
 #include <cmath>
+#include <memory>
 
 #include <libbw/stringutil.h>
+#include <libbw/log/errorlog.h>
+#include <libbw/log/debug.h>
 
 #include <sqlite3.h>
 
+#include "config.h"
 #include "database.h"
+#include "quantilesketch.h"
+#include "stagetimer.h"
 #include "utils.h"
 #include "weather.h"
 
@@ -52,6 +58,110 @@ Database::Result Database::executeSqlQuery(const char *sql, ...)
     return ret;
 }
 
+bool Database::snapshotReads()
+{
+    return false;
+}
+
+bool Database::sharedSnapshots()
+{
+    return false;
+}
+
+void Database::openSnapshot(Database &source)
+{
+    (void)source;
+    throw DatabaseError("Shared snapshots are not supported");
+}
+
+/* }}} */
+/* Transaction {{{ */
+
+Transaction::Transaction(Database &db, bool immediate)
+    : m_db(db)
+    , m_active(false)
+{
+    m_db.executeSql(immediate ? "BEGIN IMMEDIATE" : "BEGIN");
+    m_active = true;
+}
+
+Transaction::~Transaction()
+{
+    if (!m_active)
+        return;
+
+    try {
+        m_db.executeSql("ROLLBACK");
+    } catch (const DatabaseError &err) {
+        BW_ERROR_WARNING("Unable to rollback transaction: %s", err.what());
+    }
+}
+
+void Transaction::commit()
+{
+    m_db.executeSql("COMMIT");
+    m_active = false;
+}
+
+/* }}} */
+/* ReadSession {{{ */
+
+ReadSession::ReadSession(Database &db)
+    : m_db(db)
+    , m_active(false)
+{
+    begin(NULL);
+}
+
+ReadSession::ReadSession(Database &db, const ReadSession &source)
+    : m_db(db)
+    , m_active(false)
+{
+    begin(source.m_active ? &source.m_db : NULL);
+}
+
+ReadSession::~ReadSession()
+{
+    if (!m_active)
+        return;
+
+    try {
+        m_db.executeSql("COMMIT");
+    } catch (const DatabaseError &err) {
+        BW_ERROR_WARNING("Unable to end read transaction: %s", err.what());
+    }
+}
+
+bool ReadSession::snapshot() const
+{
+    return m_active;
+}
+
+void ReadSession::begin(Database *source)
+{
+    if (!m_db.snapshotReads()) {
+        BW_DEBUG_DBG("Database doesn't support snapshot reads, using autocommit");
+        return;
+    }
+
+    // a deferred transaction takes the snapshot with the first read
+    m_db.executeSql("BEGIN");
+    try {
+        if (source)
+            m_db.openSnapshot(*source);
+        m_db.executeSqlQuery("SELECT COUNT(*) FROM sqlite_master");
+    } catch (const DatabaseError &) {
+        // the destructor doesn't run, don't leave the transaction open
+        try {
+            m_db.executeSql("COMMIT");
+        } catch (const DatabaseError &err) {
+            BW_ERROR_WARNING("Unable to end read transaction: %s", err.what());
+        }
+        throw;
+    }
+    m_active = true;
+}
+
 /* }}} */
 /* function for the database {{{ */
 
@@ -67,6 +177,98 @@ static void sqlite3_beaufort(sqlite3_context* ctx, int number, sqlite3_value **v
         sqlite3_result_int(ctx, weather::windSpeedToBft(sqlite3_value_int(values[0])));
 }
 
+// the aggregate context holds a pointer to the sketch, created by the first step
+static QuantileSketch *sqlite3_sketch_context(sqlite3_context *ctx, bool create)
+{
+    QuantileSketch **sketch = static_cast<QuantileSketch **>(
+        sqlite3_aggregate_context(ctx, create ? sizeof(QuantileSketch *) : 0)
+    );
+    if (!sketch)
+        return NULL;
+    if (!*sketch && create)
+        *sketch = new QuantileSketch;
+
+    return *sketch;
+}
+
+static void sqlite3_sketch_step(sqlite3_context *ctx, int number, sqlite3_value **values)
+{
+    assert(number == 1);
+
+    if (sqlite3_value_type(values[0]) == SQLITE_NULL)
+        return;
+
+    try {
+        QuantileSketch *sketch = sqlite3_sketch_context(ctx, true);
+        if (!sketch)
+            sqlite3_result_error_nomem(ctx);
+        else
+            sketch->add(sqlite3_value_double(values[0]));
+    } catch (const std::bad_alloc &) {
+        sqlite3_result_error_nomem(ctx);
+    }
+}
+
+static void sqlite3_sketch_merge_step(sqlite3_context *ctx, int number, sqlite3_value **values)
+{
+    assert(number == 1);
+
+    if (sqlite3_value_type(values[0]) == SQLITE_NULL)
+        return;
+
+    try {
+        const char *text = reinterpret_cast<const char *>(sqlite3_value_text(values[0]));
+        QuantileSketch other;
+        if (!text || !other.parse(text))
+            return;
+
+        QuantileSketch *sketch = sqlite3_sketch_context(ctx, true);
+        if (!sketch)
+            sqlite3_result_error_nomem(ctx);
+        else
+            sketch->merge(other);
+    } catch (const std::bad_alloc &) {
+        sqlite3_result_error_nomem(ctx);
+    }
+}
+
+static void sqlite3_sketch_final(sqlite3_context *ctx)
+{
+    std::unique_ptr<QuantileSketch> sketch(sqlite3_sketch_context(ctx, false));
+    if (!sketch || sketch->count() <= 0.0) {
+        sqlite3_result_null(ctx);
+        return;
+    }
+
+    try {
+        std::string text = sketch->serialize();
+        sqlite3_result_text(ctx, text.c_str(), text.size(), SQLITE_TRANSIENT);
+    } catch (const std::bad_alloc &) {
+        sqlite3_result_error_nomem(ctx);
+    }
+}
+
+static void sqlite3_quantile(sqlite3_context *ctx, int number, sqlite3_value **values)
+{
+    assert(number == 2);
+
+    if (sqlite3_value_type(values[0]) == SQLITE_NULL) {
+        sqlite3_result_null(ctx);
+        return;
+    }
+
+    try {
+        const char *text = reinterpret_cast<const char *>(sqlite3_value_text(values[0]));
+        QuantileSketch sketch;
+        if (!text || !sketch.parse(text))
+            sqlite3_result_null(ctx);
+        else
+            sqlite3_result_double(ctx, sketch.quantile(sqlite3_value_double(values[1])));
+    } catch (const std::bad_alloc &) {
+        sqlite3_result_error_nomem(ctx);
+    }
+}
+
 /* }}} */
 /* Sqlite3Database {{{ */
 
@@ -102,6 +304,9 @@ void Sqlite3Database::open(const std::string &connection, int flags)
                             std::string(sqlite3_errmsg(m_connection)) );
 
     registerCustomFunctions();
+
+    if (flags & FLAG_WAL)
+        executeSql("PRAGMA journal_mode=WAL");
 }
 
 void Sqlite3Database::close()
@@ -112,6 +317,44 @@ void Sqlite3Database::close()
     }
 }
 
+bool Sqlite3Database::snapshotReads()
+{
+    Result result = executeSqlQuery("PRAGMA journal_mode");
+    return !result.data.empty() && !result.data[0].empty() && result.data[0][0] == "wal";
+}
+
+bool Sqlite3Database::sharedSnapshots()
+{
+#ifdef HAVE_SQLITE3_SNAPSHOT
+    return snapshotReads();
+#else
+    return false;
+#endif
+}
+
+void Sqlite3Database::openSnapshot(Database &source)
+{
+#ifdef HAVE_SQLITE3_SNAPSHOT
+    Sqlite3Database *sqliteSource = dynamic_cast<Sqlite3Database *>(&source);
+    if (!sqliteSource)
+        throw DatabaseError("Unable to share the snapshot with a different database type");
+
+    sqlite3_snapshot *snapshot;
+    int err = sqlite3_snapshot_get(sqliteSource->m_connection, "main", &snapshot);
+    if (err != SQLITE_OK)
+        throw DatabaseError("Unable to call sqlite3_snapshot_get(): " +
+                            std::string(sqlite3_errmsg(sqliteSource->m_connection)) );
+
+    err = sqlite3_snapshot_open(m_connection, "main", snapshot);
+    sqlite3_snapshot_free(snapshot);
+    if (err != SQLITE_OK)
+        throw DatabaseError("Unable to call sqlite3_snapshot_open(): " +
+                            std::string(sqlite3_errmsg(m_connection)) );
+#else
+    Database::openSnapshot(source);
+#endif
+}
+
 static int vetero_sqlite3_callback(void *cookie, int columns, char **values, char **columnNames)
 {
     Database::Result *result = static_cast<Database::Result *>(cookie);
@@ -133,6 +376,8 @@ static int vetero_sqlite3_callback(void *cookie, int columns, char **values, cha
 
 Database::Result Sqlite3Database::vexecuteSqlQuery(const char *sql, va_list ap)
 {
+    StageTimer timer(StageTimes::Query);
+
     char *finished_sql = sqlite3_vmprintf(bw::replace_char(sql, '?', "%Q").c_str(), ap);
     if (!finished_sql)
         throw DatabaseError("Unable to call sqlite3_vmprintf('"+ std::string(sql) +"')");
@@ -177,6 +422,23 @@ void Sqlite3Database::registerCustomFunctions()
     if (err != SQLITE_OK)
         throw DatabaseError("Unable to register 'BEAUFORT' function: " +
                             std::string(sqlite3_errmsg(m_connection)) );
+
+    // register the aggregates 'VETERO_SKETCH' and 'VETERO_SKETCH_MERGE'
+    err = sqlite3_create_function(m_connection, "VETERO_SKETCH", 1, SQLITE_UTF8, NULL,
+                                  NULL, sqlite3_sketch_step, sqlite3_sketch_final);
+    if (err == SQLITE_OK)
+        err = sqlite3_create_function(m_connection, "VETERO_SKETCH_MERGE", 1, SQLITE_UTF8, NULL,
+                                      NULL, sqlite3_sketch_merge_step, sqlite3_sketch_final);
+    if (err != SQLITE_OK)
+        throw DatabaseError("Unable to register 'SKETCH' functions: " +
+                            std::string(sqlite3_errmsg(m_connection)) );
+
+    // register 'VETERO_QUANTILE' function
+    err = sqlite3_create_function(m_connection, "VETERO_QUANTILE", 2, SQLITE_UTF8, NULL,
+                                  sqlite3_quantile, NULL, NULL);
+    if (err != SQLITE_OK)
+        throw DatabaseError("Unable to register 'QUANTILE' function: " +
+                            std::string(sqlite3_errmsg(m_connection)) );
 }
 
 /* }}} */
@@ -169,6 +169,39 @@ class Database : private bw::Noncopyable {
          */
         virtual Result executeSqlQuery(const char *sql, ...);
 
+        /**
+         * \brief Checks if read transactions see a snapshot without blocking writers
+         *
+         * If this returns \c true, a long-running read transaction (see ReadSession) doesn't
+         * delay concurrent writers. The default implementation returns \c false.
+         *
+         * \return \c true if snapshot reads are supported, \c false otherwise
+         * \exception DatabaseError if the database cannot be queried
+         */
+        virtual bool snapshotReads();
+
+        /**
+         * \brief Checks if openSnapshot() is supported
+         *
+         * The default implementation returns \c false.
+         *
+         * \return \c true if a read transaction can read the snapshot of another connection
+         * \exception DatabaseError if the database cannot be queried
+         */
+        virtual bool sharedSnapshots();
+
+        /**
+         * \brief Reads the same snapshot as another connection
+         *
+         * Must be called in a read transaction before the first read. \p source must be in a
+         * read transaction as well. The default implementation throws a DatabaseError.
+         *
+         * \param[in] source the connection whose snapshot should be read, must be of the same
+         *            type as this connection
+         * \exception DatabaseError if the snapshot cannot be opened
+         */
+        virtual void openSnapshot(Database &source);
+
     protected:
         /**
          * \brief Varardic variant of vexecuteSqlQuery
@@ -188,6 +221,131 @@ class Database : private bw::Noncopyable {
         virtual Result vexecuteSqlQuery(const char *sql, va_list args) = 0;
 };
 
+/* }}} */
+/* Transaction {{{ */
+
+/**
+ * \class Transaction
+ * \brief Scoped database transaction
+ *
+ * Starts a transaction in the constructor. If commit() has not been called when the object
+ * goes out of scope, the transaction is rolled back. This makes it exception-safe to group
+ * several statements.
+ *
+ * \code
+ * Transaction transaction(db);
+ * db.executeSql("UPDATE ...");
+ * db.executeSql("UPDATE ...");
+ * transaction.commit();
+ * \endcode
+ *
+ * \author Bernhard Walle <bernhard@bwalle.de>
+ * \ingroup common
+ */
+class Transaction : private bw::Noncopyable {
+
+    public:
+        /**
+         * \brief Starts the transaction
+         *
+         * \param[in] db the database on which the transaction is started
+         * \param[in] immediate if \c true, the write lock is acquired at the start of the
+         *            transaction and not with the first write statement
+         * \exception DatabaseError if the transaction cannot be started
+         */
+        Transaction(Database &db, bool immediate=false);
+
+        /**
+         * \brief Destructor
+         *
+         * Rolls back the transaction if it was not committed.
+         */
+        ~Transaction();
+
+    public:
+        /**
+         * \brief Commits the transaction
+         *
+         * \exception DatabaseError if the transaction cannot be committed
+         */
+        void commit();
+
+    private:
+        Database &m_db;
+        bool m_active;
+};
+
+/* }}} */
+/* ReadSession {{{ */
+
+/**
+ * \class ReadSession
+ * \brief Consistent read view on the database
+ *
+ * While the object exists, all queries on the database see the same snapshot of the data,
+ * even if another process inserts data in the meantime. This also avoids acquiring and
+ * releasing the read lock for each query.
+ *
+ * A read transaction is only started if Database::snapshotReads() returns \c true, i.e. if
+ * it doesn't block writers. Otherwise each query runs in its own transaction as before.
+ *
+ * \author Bernhard Walle <bernhard@bwalle.de>
+ * \ingroup common
+ */
+class ReadSession : private bw::Noncopyable {
+
+    public:
+        /**
+         * \brief Starts the session
+         *
+         * \param[in] db the database which should be read
+         * \exception DatabaseError if the read transaction cannot be started
+         */
+        ReadSession(Database &db);
+
+        /**
+         * \brief Starts a session on the snapshot of another session
+         *
+         * All queries on \p db see the same data as the queries on \p source, see
+         * Database::openSnapshot().
+         *
+         * \param[in] db the database which should be read
+         * \param[in] source the session whose snapshot should be read, it must be active
+         *            as long as the constructor runs
+         * \exception DatabaseError if the read transaction cannot be started
+         */
+        ReadSession(Database &db, const ReadSession &source);
+
+        /**
+         * \brief Destructor
+         *
+         * Ends the read transaction.
+         */
+        ~ReadSession();
+
+    public:
+        /**
+         * \brief Checks if the session reads from a snapshot
+         *
+         * \return \c true if a read transaction is active, \c false if the queries run in
+         *         autocommit mode
+         */
+        bool snapshot() const;
+
+    private:
+        /**
+         * \brief Starts the read transaction
+         *
+         * \param[in] source the database whose snapshot should be read or \c NULL
+         * \exception DatabaseError if the read transaction cannot be started
+         */
+        void begin(Database *source);
+
+    private:
+        Database &m_db;
+        bool m_active;
+};
+
 /* }}} */
 /* Sqlite3Database {{{ */
 
@@ -220,7 +378,8 @@ class Sqlite3Database : public Database {
          * Flags for Sqlite3Database::open().
          */
         enum SqliteOpenFlags {
-            FLAG_READONLY = (1<<0)      /**< open the database readonly */
+            FLAG_READONLY = (1<<0),     /**< open the database readonly */
+            FLAG_WAL      = (1<<1)      /**< switch the database to write-ahead logging */
         };
 
         /**
@@ -245,6 +404,25 @@ class Sqlite3Database : public Database {
          */
         virtual void close();
 
+        /**
+         * \brief Checks if the database is in WAL mode
+         *
+         * \copydetails Database::snapshotReads()
+         */
+        virtual bool snapshotReads();
+
+        /**
+         * \brief Checks if the database is in WAL mode and SQLite supports snapshots
+         *
+         * \copydetails Database::sharedSnapshots()
+         */
+        virtual bool sharedSnapshots();
+
+        /**
+         * \copydoc Database::openSnapshot()
+         */
+        virtual void openSnapshot(Database &source);
+
     protected:
         /**
          * \copydoc Database::vexecuteSqlQuery()
@@ -254,6 +432,11 @@ class Sqlite3Database : public Database {
         /**
          * \brief Registers custom database functions
          *
+         * <tt>VETERO_BEAUFORT(speed)</tt> converts a wind speed to Beaufort. The aggregates
+         * <tt>VETERO_SKETCH(value)</tt> and <tt>VETERO_SKETCH_MERGE(sketch)</tt> return a
+         * serialized QuantileSketch of the values or of the merged sketches,
+         * <tt>VETERO_QUANTILE(sketch, q)</tt> reads a quantile from it.
+         *
          * \exception DatabaseError if registering fails
          */
         void registerCustomFunctions();
@@ -14,12 +14,17 @@
  * You should have received a copy of the GNU General Public License
  * along with this program. If not, see <http://www.gnu.org/licenses/>. }}}
  */
+#include <algorithm>
+#include <cinttypes>
+#include <set>
+
 #include <libbw/stringutil.h>
 #include <libbw/log/errorlog.h>
 #include <libbw/log/debug.h>
 
 #include "common/error.h"
 #include "dbaccess.h"
+#include "utils.h"
 #include "weather.h"
 
 namespace vetero {
@@ -38,11 +43,223 @@ namespace {
     DummyProgressNotifier dummyProgressNotifier;
 }
 
+/* }}} */
+/* Schema migration steps {{{ */
+
+namespace {
+
+// the climate normals of revision 9, shared by initTables() and the migration
+
+#define CLIMATE_NORMALS_COLUMNS \
+    "    years                INTEGER," \
+    "    temp_avg             INTEGER," \
+    "    temp_avg_p10         INTEGER," \
+    "    temp_avg_p90         INTEGER," \
+    "    temp_min             INTEGER," \
+    "    temp_max             INTEGER," \
+    "    temp_min_record      INTEGER," \
+    "    temp_min_record_date TEXT," \
+    "    temp_max_record      INTEGER," \
+    "    temp_max_record_date TEXT," \
+    "    rain                 INTEGER," \
+    "    rain_p90             INTEGER," \
+    "    rain_record          INTEGER," \
+    "    rain_record_date     TEXT"
+
+#define CLIMATE_DAY_NORMALS_TABLE \
+    "CREATE TABLE climate_day_normals (" \
+    "    day                  TEXT PRIMARY KEY UNIQUE," \
+    CLIMATE_NORMALS_COLUMNS \
+    ")"
+
+#define CLIMATE_MONTH_NORMALS_TABLE \
+    "CREATE TABLE climate_month_normals (" \
+    "    month                TEXT PRIMARY KEY UNIQUE," \
+    CLIMATE_NORMALS_COLUMNS \
+    ")"
+
+#define CLIMATE_NORMALS_FLOAT_COLUMNS \
+    "    years                            AS years," \
+    "    round(temp_avg/100.0, 1)         AS temp_avg," \
+    "    round(temp_avg_p10/100.0, 1)     AS temp_avg_p10," \
+    "    round(temp_avg_p90/100.0, 1)     AS temp_avg_p90," \
+    "    round(temp_min/100.0, 1)         AS temp_min," \
+    "    round(temp_max/100.0, 1)         AS temp_max," \
+    "    round(temp_min_record/100.0, 1)  AS temp_min_record," \
+    "    temp_min_record_date             AS temp_min_record_date," \
+    "    round(temp_max_record/100.0, 1)  AS temp_max_record," \
+    "    temp_max_record_date             AS temp_max_record_date," \
+    "    round(rain/1000.0, 1)            AS rain," \
+    "    round(rain_p90/1000.0, 1)        AS rain_p90," \
+    "    round(rain_record/1000.0, 1)     AS rain_record," \
+    "    rain_record_date                 AS rain_record_date "
+
+// sketch of a column of weatherdata for the day of the day_statistics row, uses the jdate index
+#define DAY_SKETCH(column) \
+    "SELECT VETERO_SKETCH(" column ") FROM weatherdata " \
+    "WHERE jdate = julianday(day_statistics.date || ' 12:00')"
+
+// merged sketches of the days of the month_statistics row
+#define MONTH_SKETCH(column) \
+    "SELECT VETERO_SKETCH_MERGE(" column ") FROM day_statistics " \
+    "WHERE STRFTIME('%%Y-%%m', date) = month_statistics.month"
+
+// all years of one day of the year with an index lookup
+#define DAY_STATISTICS_DAY_INDEX \
+    "CREATE INDEX IF NOT EXISTS index_day_statistics_day ON day_statistics(SUBSTR(date, 6, 5))"
+
+// One step of the schema history. The statements are cheap DDL that is run atomically
+// together with the revision update. The optional backfill is executed in rowid batches by
+// DbAccess::continueMigration(), its placeholders are the (exclusive) start and the
+// (inclusive) end of the rowid range. It may consist of two statements, each with both
+// placeholders.
+struct MigrationStep {
+    int         revision;
+    const char  *statements[16];
+    const char  *backfill;
+};
+
+const MigrationStep migrationSteps[] = {
+    {
+        2,
+        {
+            "ALTER TABLE weatherdata ADD COLUMN jdate INTEGER",
+            "CREATE INDEX IF NOT EXISTS index_weatherdata_jdate ON weatherdata(jdate)",
+            "CREATE TRIGGER IF NOT EXISTS update_weatherdata_jday "
+            "AFTER INSERT ON weatherdata "
+            "BEGIN "
+            "    UPDATE weatherdata "
+            "    SET    jdate = julianday(strftime('%%Y-%%m-%%d 12:00', timestamp)) "
+            "    WHERE  timestamp = new.timestamp; "
+            "END",
+            NULL
+        },
+        "UPDATE weatherdata "
+        "SET    jdate = julianday(strftime('%%Y-%%m-%%d 12:00', timestamp)) "
+        "WHERE  rowid > CAST(? AS INTEGER) AND rowid <= CAST(? AS INTEGER)"
+    },
+    {
+        3,
+        { "ALTER TABLE weatherdata ADD COLUMN pressure INTEGER", NULL },
+        NULL
+    },
+    {
+        4,  // only the views changed
+        { NULL },
+        NULL
+    },
+    {
+        5,
+        { "ALTER TABLE weatherdata ADD COLUMN wind_dir INTEGER", NULL },
+        NULL
+    },
+    {
+        6,
+        {
+            "ALTER TABLE weatherdata ADD COLUMN wind_gust INTEGER",
+            "ALTER TABLE weatherdata ADD COLUMN wind_gust_bft INTEGER",
+            "ALTER TABLE day_statistics ADD COLUMN wind_gust_min INTEGER",
+            "ALTER TABLE day_statistics ADD COLUMN wind_gust_max INTEGER",
+            "ALTER TABLE day_statistics ADD COLUMN wind_gust_avg INTEGER",
+            "ALTER TABLE day_statistics ADD COLUMN wind_gust_bft_min INTEGER",
+            "ALTER TABLE day_statistics ADD COLUMN wind_gust_bft_max INTEGER",
+            "ALTER TABLE day_statistics ADD COLUMN wind_gust_bft_avg INTEGER",
+            "ALTER TABLE month_statistics ADD COLUMN wind_gust_min INTEGER",
+            "ALTER TABLE month_statistics ADD COLUMN wind_gust_max INTEGER",
+            "ALTER TABLE month_statistics ADD COLUMN wind_gust_avg INTEGER",
+            "ALTER TABLE month_statistics ADD COLUMN wind_gust_bft_min INTEGER",
+            "ALTER TABLE month_statistics ADD COLUMN wind_gust_bft_max INTEGER",
+            "ALTER TABLE month_statistics ADD COLUMN wind_gust_bft_avg INTEGER",
+            NULL
+        },
+        NULL
+    },
+    {
+        7,
+        {
+            "ALTER TABLE weatherdata ADD COLUMN solar_radiation INTEGER",
+            "ALTER TABLE weatherdata ADD COLUMN uv_index INTEGER",
+            NULL
+        },
+        NULL
+    },
+    {
+        8,  // only the views changed
+        { NULL },
+        NULL
+    },
+    {
+        9,  // the normals are computed by veterod on startup, see updateClimateNormals()
+        {
+            CLIMATE_DAY_NORMALS_TABLE,
+            CLIMATE_MONTH_NORMALS_TABLE,
+            DAY_STATISTICS_DAY_INDEX,
+            NULL
+        },
+        NULL
+    },
+    {
+        10,
+        {
+            "ALTER TABLE day_statistics ADD COLUMN temp_sketch TEXT",
+            "ALTER TABLE day_statistics ADD COLUMN wind_sketch TEXT",
+            "ALTER TABLE day_statistics ADD COLUMN wind_gust_sketch TEXT",
+            "ALTER TABLE month_statistics ADD COLUMN temp_sketch TEXT",
+            "ALTER TABLE month_statistics ADD COLUMN wind_sketch TEXT",
+            "ALTER TABLE month_statistics ADD COLUMN wind_gust_sketch TEXT",
+            NULL
+        },
+        // the days and months of the batch, the sketches of a month are merged from its days
+        "UPDATE day_statistics "
+        "SET    temp_sketch = (" DAY_SKETCH("temp") "), "
+        "       wind_sketch = (" DAY_SKETCH("wind") "), "
+        "       wind_gust_sketch = (" DAY_SKETCH("wind_gust") ") "
+        "WHERE  date IN (SELECT DISTINCT DATE(timestamp) FROM weatherdata "
+        "                WHERE  rowid > CAST(? AS INTEGER) AND rowid <= CAST(? AS INTEGER)); "
+        "UPDATE month_statistics "
+        "SET    temp_sketch = (" MONTH_SKETCH("temp_sketch") "), "
+        "       wind_sketch = (" MONTH_SKETCH("wind_sketch") "), "
+        "       wind_gust_sketch = (" MONTH_SKETCH("wind_gust_sketch") ") "
+        "WHERE  month IN (SELECT DISTINCT STRFTIME('%%Y-%%m', timestamp) FROM weatherdata "
+        "                 WHERE  rowid > CAST(? AS INTEGER) AND rowid <= CAST(? AS INTEGER))"
+    }
+};
+
+const size_t migrationStepCount = sizeof(migrationSteps) / sizeof(migrationSteps[0]);
+
+// number of rows that are updated in one backfill transaction
+const long long migrationBatchSize = 5000;
+
+// misc key that holds the resume position of the backfill of the given step
+std::string migrationCursorKey(const MigrationStep &step)
+{
+    return "db_migration_" + bw::str(step.revision);
+}
+
+// hash of all values of a query result including the row and column boundaries
+uint64_t resultHash(const Database::Result &result, uint64_t hash)
+{
+    for (size_t i = 0; i < result.data.size(); ++i) {
+        const std::vector<std::string> &row = result.data[i];
+        for (size_t j = 0; j < row.size(); ++j) {
+            // NUL doesn't occur in the values
+            hash = fnv1a_hash(row[j].c_str(), row[j].size() + 1, hash);
+        }
+        hash = fnv1a_hash("\n", 1, hash);
+    }
+
+    return hash;
+}
+
+} // anonymous namespace
+
 /* }}} */
 /* DbAccess {{{ */
 
 const char *DbAccess::LastRain                  = "last_rain";
 const char *DbAccess::DatabaseSchemaRevision    = "db_revision";
+const char *DbAccess::ClimateNormalsDate        = "climate_normals_date";
+const int DbAccess::CurrentSchemaRevision       = 10;
 
 DbAccess::DbAccess(Database *db)
     : m_db(db),
@@ -114,7 +331,10 @@ void DbAccess::initTables() const
         "    wind_gust_bft_min    INTEGER,"
         "    wind_gust_bft_max    INTEGER,"
         "    wind_gust_bft_avg    INTEGER,"
-        "    rain                 INTEGER"
+        "    rain                 INTEGER,"
+        "    temp_sketch          TEXT,"
+        "    wind_sketch          TEXT,"
+        "    wind_gust_sketch     TEXT"
         ")"
     );
 
@@ -143,10 +363,22 @@ void DbAccess::initTables() const
         "    wind_gust_bft_min INTEGER,"
         "    wind_gust_bft_max INTEGER,"
         "    wind_gust_bft_avg INTEGER,"
-        "    rain              INTEGER"
+        "    rain              INTEGER,"
+        "    temp_sketch       TEXT,"
+        "    wind_sketch       TEXT,"
+        "    wind_gust_sketch  TEXT"
         ")"
     );
 
+    // TABLE climate_day_normals
+    m_db->executeSql(CLIMATE_DAY_NORMALS_TABLE);
+
+    // TABLE climate_month_normals
+    m_db->executeSql(CLIMATE_MONTH_NORMALS_TABLE);
+
+    // INDEX index_day_statistics_day
+    m_db->executeSql(DAY_STATISTICS_DAY_INDEX);
+
     // INDEX index_weatherdata_jdate
     m_db->executeSql(
         "CREATE INDEX index_weatherdata_jdate "
@@ -164,6 +396,13 @@ void DbAccess::initTables() const
         "END"
     );
 
+    initViews();
+
+    writeMiscEntry(DatabaseSchemaRevision, CurrentSchemaRevision);
+}
+
+void DbAccess::initViews() const
+{
     //
     // convencience views with floating point
     //
@@ -246,7 +485,114 @@ void DbAccess::initTables() const
         "FROM month_statistics"
     );
 
-    writeMiscEntry(DatabaseSchemaRevision, 8);
+    // VIEW climate_day_normals_float
+    m_db->executeSql(
+        "CREATE VIEW climate_day_normals_float AS SELECT"
+        "    day                              AS day,"
+        CLIMATE_NORMALS_FLOAT_COLUMNS
+        "FROM climate_day_normals"
+    );
+
+    // VIEW climate_month_normals_float
+    m_db->executeSql(
+        "CREATE VIEW climate_month_normals_float AS SELECT"
+        "    month                            AS month,"
+        CLIMATE_NORMALS_FLOAT_COLUMNS
+        "FROM climate_month_normals"
+    );
+}
+
+void DbAccess::dropViews() const
+{
+    m_db->executeSql("DROP VIEW IF EXISTS weatherdata_float");
+    m_db->executeSql("DROP VIEW IF EXISTS day_statistics_float");
+    m_db->executeSql("DROP VIEW IF EXISTS month_statistics_float");
+    m_db->executeSql("DROP VIEW IF EXISTS climate_day_normals_float");
+    m_db->executeSql("DROP VIEW IF EXISTS climate_month_normals_float");
+}
+
+int DbAccess::schemaRevision() const
+{
+    return readMiscEntry(DatabaseSchemaRevision, 1);
+}
+
+bool DbAccess::upgradeSchema() const
+{
+    int revision = schemaRevision();
+    if (revision > CurrentSchemaRevision)
+        throw DatabaseError("Database schema revision " + bw::str(revision) + " is newer than " +
+                            "the supported revision " + bw::str(CurrentSchemaRevision));
+    if (revision == CurrentSchemaRevision)
+        return false;
+
+    for (size_t i = 0; i < migrationStepCount; ++i) {
+        const MigrationStep &step = migrationSteps[i];
+        if (step.revision <= revision)
+            continue;
+
+        BW_DEBUG_INFO("Migrating database schema to revision %d", step.revision);
+
+        Transaction transaction(*m_db, true);
+        for (const char * const *sql = step.statements; *sql; ++sql)
+            m_db->executeSql(*sql);
+
+        // remember that the backfill starts at the beginning
+        if (step.backfill)
+            writeMiscEntry(migrationCursorKey(step), 0);
+
+        // the views depend on the columns, so recreate them with the last step
+        if (step.revision == CurrentSchemaRevision) {
+            dropViews();
+            initViews();
+        }
+
+        writeMiscEntry(DatabaseSchemaRevision, step.revision);
+        transaction.commit();
+    }
+
+    return true;
+}
+
+bool DbAccess::continueMigration(int maxBatches)
+{
+    int batches = 0;
+
+    for (size_t i = 0; i < migrationStepCount; ++i) {
+        const MigrationStep &step = migrationSteps[i];
+        if (!step.backfill)
+            continue;
+
+        std::string key = migrationCursorKey(step);
+        long long position = readMiscEntry<long long>(key, -1);
+        if (position < 0)
+            continue;
+
+        Database::Result result = m_db->executeSqlQuery("SELECT IFNULL(MAX(rowid), 0) FROM weatherdata");
+        long long end = bw::from_str<long long>(result.data.at(0).at(0));
+
+        while (position < end) {
+            if (maxBatches > 0 && batches++ >= maxBatches)
+                return false;
+
+            long long next = std::min(position + migrationBatchSize, end);
+
+            Transaction transaction(*m_db, true);
+            std::string start = bw::str(position), stop = bw::str(next);
+            m_db->executeSql(step.backfill, start.c_str(), stop.c_str(),
+                             start.c_str(), stop.c_str());
+            writeMiscEntry(key, next);
+            transaction.commit();
+
+            m_progressNotifier->progressed(end, next);
+            position = next;
+        }
+
+        deleteMiscEntry(key);
+        BW_DEBUG_INFO("Data migration for schema revision %d finished", step.revision);
+    }
+
+    m_progressNotifier->finished();
+    return true;
 }
 
 void DbAccess::writeMiscEntry(const std::string &key, const std::string &value) const
@@ -269,6 +615,11 @@ std::string DbAccess::readMiscEntry(const std::string &key) const
     }
 }
 
+void DbAccess::deleteMiscEntry(const std::string &key) const
+{
+    m_db->executeSql("DELETE FROM misc WHERE key = ?", key.c_str());
+}
+
 void DbAccess::insertDataset(const Dataset &dataset, int &rainValue) const
 {
     // rain calculation
@@ -487,10 +838,84 @@ std::vector<std::string> DbAccess::dataYears(bool nocache) const
     return ret;
 }
 
+std::vector<std::string> DbAccess::dataDaysAfter(const std::string &date) const
+{
+    std::vector<std::string> ret;
+
+    common::Database::Result result = m_db->executeSqlQuery(
+        "SELECT     date "
+        "FROM       day_statistics "
+        "WHERE      date > ? "
+        "ORDER BY   date",
+        date.c_str()
+    );
+
+    for (size_t i = 0; i < result.data.size(); ++i)
+        ret.push_back(result.data[i].front());
+
+    return ret;
+}
+
+std::string DbAccess::dataFingerprint(const std::string &firstDay,
+                                      const std::string &lastDay) const
+{
+    // rowids grow with each insert, so the newest rowid and the number of rows per day
+    // change with every insert and delete
+    common::Database::Result result = m_db->executeSqlQuery(
+        "SELECT     jdate, COUNT(*), MAX(rowid) "
+        "FROM       weatherdata "
+        "WHERE      jdate BETWEEN julianday(? || ' 12:00') AND julianday(? || ' 12:00') "
+        "GROUP BY   jdate "
+        "ORDER BY   jdate",
+        firstDay.c_str(), lastDay.c_str()
+    );
+
+    std::string ret;
+    for (size_t i = 0; i < result.data.size(); ++i) {
+        const std::vector<std::string> &row = result.data[i];
+        ret += row.at(0) + ":" + row.at(1) + ":" + row.at(2) + ";";
+    }
+
+    // the statistics change without new weather data with vetero-db --regenerate-metadata
+    // or a backfill, they're hashed since a year has a lot of them
+    uint64_t hash = FNV1A_OFFSET_BASIS;
+    result = m_db->executeSqlQuery(
+        "SELECT     * "
+        "FROM       day_statistics "
+        "WHERE      date BETWEEN ? AND ? "
+        "ORDER BY   date",
+        firstDay.c_str(), lastDay.c_str()
+    );
+    hash = resultHash(result, hash);
+
+    result = m_db->executeSqlQuery(
+        "SELECT     * "
+        "FROM       month_statistics "
+        "WHERE      month BETWEEN substr(?, 1, 7) AND substr(?, 1, 7) "
+        "ORDER BY   month",
+        firstDay.c_str(), lastDay.c_str()
+    );
+    hash = resultHash(result, hash);
+
+    return ret + "statistics:" + str_printf("%016" PRIx64, hash);
+}
+
+std::string DbAccess::climateNormalsFingerprint() const
+{
+    uint64_t hash = FNV1A_OFFSET_BASIS;
+    hash = resultHash(m_db->executeSqlQuery("SELECT * FROM climate_day_normals ORDER BY day"), hash);
+    hash = resultHash(m_db->executeSqlQuery("SELECT * FROM climate_month_normals ORDER BY month"), hash);
+
+    return readMiscEntry(ClimateNormalsDate) + ":" + str_printf("%016" PRIx64, hash);
+}
+
 void DbAccess::deleteStatistics()
 {
     m_db->executeSql("DELETE FROM day_statistics");
     m_db->executeSql("DELETE FROM month_statistics");
+    m_db->executeSql("DELETE FROM climate_day_normals");
+    m_db->executeSql("DELETE FROM climate_month_normals");
+    deleteMiscEntry(ClimateNormalsDate);
 }
 
 void DbAccess::updateDayStatistics(const std::string &date)
@@ -509,7 +934,7 @@ void DbAccess::updateDayStatistics(const std::string &date)
         " wind_bft_min, wind_bft_max, wind_bft_avg, "
         " wind_gust_min, wind_gust_max, wind_gust_avg, "
         " wind_gust_bft_min, wind_gust_bft_max, wind_gust_bft_avg, "
-        " rain) "
+        " rain, temp_sketch, wind_sketch, wind_gust_sketch) "
         " SELECT  ?, MIN(temp), MAX(temp), ROUND(AVG(temp)), "
         "         MIN(humid), MAX(humid), ROUND(AVG(humid)), "
         "         MIN(dewpoint), MAX(dewpoint), ROUND(AVG(dewpoint)), "
@@ -517,7 +942,8 @@ void DbAccess::updateDayStatistics(const std::string &date)
         "         VETERO_BEAUFORT(MIN(wind)), VETERO_BEAUFORT(MAX(wind)), VETERO_BEAUFORT(AVG(wind)), "
         "         MIN(wind_gust), MAX(wind_gust), ROUND(AVG(wind_gust)), "
         "         VETERO_BEAUFORT(MIN(wind_gust)), VETERO_BEAUFORT(MAX(wind_gust)), VETERO_BEAUFORT(AVG(wind_gust)), "
-        "         SUM(rain) "
+        "         SUM(rain), "
+        "         VETERO_SKETCH(temp), VETERO_SKETCH(wind), VETERO_SKETCH(wind_gust) "
         "  FROM   weatherdata "
         "  WHERE  DATE(timestamp) = ?",
         date.c_str(), date.c_str()
@@ -552,7 +978,7 @@ void DbAccess::updateMonthStatistics(const std::string &month)
         " wind_bft_min, wind_bft_max, wind_bft_avg, "
         " wind_gust_min, wind_gust_max, wind_gust_avg, "
         " wind_gust_bft_min, wind_gust_bft_max, wind_gust_bft_avg, "
-        " rain) "
+        " rain, temp_sketch, wind_sketch, wind_gust_sketch) "
         " SELECT  ?, AVG(temp_min), AVG(temp_max), AVG(temp_avg), "
         "         AVG(humid_min), AVG(humid_max), AVG(humid_avg), "
         "         AVG(dewpoint_min), AVG(dewpoint_max), AVG(dewpoint_avg), "
@@ -562,7 +988,9 @@ void DbAccess::updateMonthStatistics(const std::string &month)
         "         AVG(wind_gust_min), AVG(wind_gust_max), AVG(wind_gust_avg), "
         "         VETERO_BEAUFORT(AVG(wind_gust_min)), VETERO_BEAUFORT(AVG(wind_gust_max)), "
         "         VETERO_BEAUFORT(AVG(wind_gust_avg)), "
-        "         SUM(rain) "
+        "         SUM(rain), "
+        "         VETERO_SKETCH_MERGE(temp_sketch), VETERO_SKETCH_MERGE(wind_sketch), "
+        "         VETERO_SKETCH_MERGE(wind_gust_sketch) "
         "  FROM   day_statistics "
         "  WHERE  STRFTIME('%%Y-%%m', date) = ?",
         month.c_str(), month.c_str()
@@ -581,6 +1009,168 @@ void DbAccess::updateMonthStatistics()
     m_progressNotifier->finished();
 }
 
+void DbAccess::updateClimateNormals(const std::string &lastDay)
+{
+    if (lastDay.empty())
+        return updateClimateNormals();
+
+    // days that were completed while veterod wasn't running are added as well
+    std::string normalsDate = readMiscEntry(ClimateNormalsDate);
+    if (normalsDate.empty())
+        return regenerateClimateNormals(lastDay);
+    if (normalsDate >= lastDay)
+        return;
+
+    BW_DEBUG_INFO("Updating climate normals from %s until %s", normalsDate.c_str(), lastDay.c_str());
+
+    Database::Result result = m_db->executeSqlQuery(
+        "WITH RECURSIVE days(date) AS ( "
+        "    SELECT DATE(?, '+1 day') "
+        "    UNION ALL "
+        "    SELECT DATE(date, '+1 day') FROM days WHERE date < ? "
+        ") "
+        "SELECT date FROM days",
+        normalsDate.c_str(), lastDay.c_str()
+    );
+    if (result.data.empty() || result.data[0].at(0).empty()) {
+        BW_ERROR_WARNING("Invalid %s '%s'", ClimateNormalsDate, normalsDate.c_str());
+        return regenerateClimateNormals(lastDay);
+    }
+
+    std::set<std::string> days, months;
+    for (size_t i = 0; i < result.data.size(); ++i) {
+        const std::string &date = result.data[i].at(0);
+        days.insert(date.substr(5));
+        months.insert(date.substr(0, 7));
+    }
+
+    Transaction transaction(*m_db, true);
+    for (std::set<std::string>::const_iterator it = days.begin(); it != days.end(); ++it)
+        updateDayNormals(*it, lastDay);
+    // veterod only updates the month statistics on the day changes it sees
+    std::set<std::string> monthsOfYear;
+    for (std::set<std::string>::const_iterator it = months.begin(); it != months.end(); ++it) {
+        updateMonthStatistics(*it);
+        monthsOfYear.insert(it->substr(5));
+    }
+    for (std::set<std::string>::const_iterator it = monthsOfYear.begin(); it != monthsOfYear.end(); ++it)
+        updateMonthNormals(*it, lastDay);
+    writeMiscEntry(ClimateNormalsDate, lastDay);
+    transaction.commit();
+}
+
+void DbAccess::updateClimateNormals()
+{
+    // today is not complete
+    Database::Result result = m_db->executeSqlQuery("SELECT DATE('now', 'localtime', '-1 day')");
+    regenerateClimateNormals(result.data.at(0).at(0));
+}
+
+void DbAccess::regenerateClimateNormals(const std::string &lastDay)
+{
+    BW_DEBUG_INFO("Regenerating climate normals until %s", lastDay.c_str());
+
+    Database::Result result = m_db->executeSqlQuery(
+        "SELECT   DISTINCT SUBSTR(date, 6, 5) AS d "
+        "FROM     day_statistics "
+        "WHERE    date <= ? "
+        "ORDER BY d",
+        lastDay.c_str()
+    );
+
+    Transaction transaction(*m_db, true);
+    m_db->executeSql("DELETE FROM climate_day_normals");
+    m_db->executeSql("DELETE FROM climate_month_normals");
+
+    size_t total = result.data.size() + 12;
+    for (size_t i = 0; i < result.data.size(); ++i) {
+        m_progressNotifier->progressed(total, i);
+        updateDayNormals(result.data[i].at(0), lastDay);
+    }
+    for (int month = 1; month <= 12; ++month) {
+        m_progressNotifier->progressed(total, result.data.size() + month - 1);
+        updateMonthNormals(str_printf("%02d", month), lastDay);
+    }
+
+    writeMiscEntry(ClimateNormalsDate, lastDay);
+    transaction.commit();
+
+    m_progressNotifier->finished();
+}
+
+void DbAccess::updateDayNormals(const std::string &day, const std::string &lastDay)
+{
+    // one row per year, read with index_day_statistics_day
+    Database::Result days = m_db->executeSqlQuery(
+        "SELECT date, temp_avg, temp_min, temp_max, rain "
+        "FROM   day_statistics "
+        "WHERE  SUBSTR(date, 6, 5) = ? AND date <= ? "
+        "ORDER BY date",
+        day.c_str(), lastDay.c_str()
+    );
+
+    ClimateNormal tempAvg(days, 1), tempMin(days, 2), tempMax(days, 3), rain(days, 4);
+    writeClimateNormal("climate_day_normals", "day", day, tempAvg, tempMin, tempMax, rain);
+}
+
+void DbAccess::updateMonthNormals(const std::string &month, const std::string &lastDay)
+{
+    // only complete months count, i.e. the month of lastDay only if lastDay is its last day
+    Database::Result months = m_db->executeSqlQuery(
+        "SELECT month, temp_avg, temp_min, temp_max, rain "
+        "FROM   month_statistics "
+        "WHERE  SUBSTR(month, 6, 2) = ? AND month < STRFTIME('%%Y-%%m', ?, '+1 day') "
+        "ORDER BY month",
+        month.c_str(), lastDay.c_str()
+    );
+
+    // the records are the extremes of the days, not of the monthly averages
+    Database::Result days = m_db->executeSqlQuery(
+        "SELECT date, temp_avg, temp_min, temp_max, rain "
+        "FROM   day_statistics "
+        "WHERE  SUBSTR(date, 6, 5) BETWEEN ? AND ? AND date <= ? "
+        "ORDER BY date",
+        (month + "-01").c_str(), (month + "-31").c_str(), lastDay.c_str()
+    );
+
+    ClimateNormal tempAvg(months, 1), tempMin(months, 2), tempMax(months, 3), rain(months, 4);
+    ClimateNormal dayMin(days, 2), dayMax(days, 3);
+    tempMin.setRecords(dayMin);
+    tempMax.setRecords(dayMax);
+
+    writeClimateNormal("climate_month_normals", "month", month, tempAvg, tempMin, tempMax, rain);
+}
+
+void DbAccess::writeClimateNormal(const char *table, const char *keyColumn, const std::string &key,
+                                  const ClimateNormal &tempAvg, const ClimateNormal &tempMin,
+                                  const ClimateNormal &tempMax, const ClimateNormal &rain)
+{
+    if (tempAvg.count() == 0) {
+        m_db->executeSql(str_printf("DELETE FROM %s WHERE %s = ?", table, keyColumn).c_str(),
+                         key.c_str());
+        return;
+    }
+
+    std::string sql = str_printf(
+        "INSERT OR REPLACE INTO %s "
+        "(%s, years, temp_avg, temp_avg_p10, temp_avg_p90, temp_min, temp_max, "
+        " temp_min_record, temp_min_record_date, temp_max_record, temp_max_record_date, "
+        " rain, rain_p90, rain_record, rain_record_date) "
+        "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)",
+        table, keyColumn
+    );
+
+    m_db->executeSql(sql.c_str(),
+                     key.c_str(), bw::str(tempAvg.count()).c_str(),
+                     c_str_null(tempAvg.mean()),
+                     c_str_null(tempAvg.percentile(0.1)), c_str_null(tempAvg.percentile(0.9)),
+                     c_str_null(tempMin.mean()), c_str_null(tempMax.mean()),
+                     c_str_null(tempMin.minimum()), c_str_null(tempMin.minimumKey()),
+                     c_str_null(tempMax.maximum()), c_str_null(tempMax.maximumKey()),
+                     c_str_null(rain.mean()), c_str_null(rain.percentile(0.9)),
+                     c_str_null(rain.maximum()), c_str_null(rain.maximumKey()));
+}
+
 void DbAccess::setProgressNotifier(ProgressNotifier *progress)
 {
     if (progress)
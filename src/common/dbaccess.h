@@ -23,6 +23,7 @@
 #include <libbw/noncopyable.h>
 
 #include "database.h"
+#include "climatenormal.h"
 #include "common/error.h"
 #include "progressnotifier.h"
 
@@ -43,6 +44,12 @@ class DbAccess : private bw::Noncopyable
         /// Constant to query or set the database schema revision
         static const char *DatabaseSchemaRevision;
 
+        /// Constant to query the last complete day that is part of the climate normals
+        static const char *ClimateNormalsDate;
+
+        /// The schema revision that initTables() creates and upgradeSchema() migrates to
+        static const int CurrentSchemaRevision;
+
         DbAccess(Database *db);
 
     public:
@@ -51,6 +58,24 @@ class DbAccess : private bw::Noncopyable
 
         void initTables() const;
         void initViews() const;
+        void dropViews() const;
+
+        // Returns the schema revision of the opened database. Databases without revision
+        // entry have revision 1.
+        int schemaRevision() const;
+
+        // Migrates the schema to CurrentSchemaRevision. Each step only consists of cheap DDL
+        // and runs in its own transaction together with the revision update, so an interrupted
+        // upgrade continues with the next step on the next call. Data backfills are only
+        // registered and need to be run with continueMigration().
+        // Returns true if the schema has been changed and throws a DatabaseError if the database
+        // has been created with a newer program version.
+        bool upgradeSchema() const;
+
+        // Runs at most maxBatches batches of the pending data backfills (0 means all of them).
+        // Each batch is committed together with its resume position, so the migration can
+        // be interrupted at any time. Returns true if no backfill is pending any more.
+        bool continueMigration(int maxBatches=0);
 
         void writeMiscEntry(const std::string &key, const std::string &value) const;
 
@@ -62,6 +87,8 @@ class DbAccess : private bw::Noncopyable
         template <typename T>
         T readMiscEntry(const std::string &key, const T &defaultValue=T()) const;
 
+        void deleteMiscEntry(const std::string &key) const;
+
         void insertDataset(const Dataset &dataset, int &rainValue) const;
 
         CurrentWeather queryCurrentWeather() const;
@@ -70,19 +97,51 @@ class DbAccess : private bw::Noncopyable
         std::vector<std::string> dataMonths(bool nocache=false) const;
         std::vector<std::string> dataYears(bool nocache=false) const;
 
+        // Returns the days with statistics that are later than date (YYYY-MM-DD), sorted
+        std::vector<std::string> dataDaysAfter(const std::string &date) const;
+
+        // Returns a string that changes whenever weather data between firstDay and lastDay
+        // (YYYY-MM-DD, inclusive) is inserted or deleted or the day or month statistics of that
+        // range change.
+        std::string dataFingerprint(const std::string &firstDay, const std::string &lastDay) const;
+
+        // Returns a string that changes whenever the climate normals change
+        std::string climateNormalsFingerprint() const;
+
         void deleteStatistics();
 
+        // Besides min/max/avg, the day statistics contain a QuantileSketch of the temperature,
+        // the wind and the wind gust. The month statistics merge the sketches of their days.
         void updateDayStatistics(const std::string &date);
         void updateDayStatistics();
 
         void updateMonthStatistics(const std::string &month);
         void updateMonthStatistics();
 
-        // Allows to set a progress notifier. Used in updateDayStatistics() and updateMonthStatistics().
+        // Adds all days after ClimateNormalsDate up to lastDay (YYYY-MM-DD), which must be
+        // complete, to the climate normals. Only the normals of their days of the year and their
+        // months are computed again, from the statistics of the same day and month in all years.
+        // The month statistics of these months are refreshed first. If there are no normals yet
+        // or lastDay is empty, all normals are regenerated.
+        void updateClimateNormals(const std::string &lastDay);
+
+        // Regenerates all climate normals until yesterday.
+        void updateClimateNormals();
+
+        // Allows to set a progress notifier. Used in updateDayStatistics(), updateMonthStatistics(),
+        // updateClimateNormals() and continueMigration().
         // NULL means no notifier. Ownership is not transferred to the DbAccess object, so you have to
         // manually delete it.
         void setProgressNotifier(ProgressNotifier *progress);
 
+    private:
+        void regenerateClimateNormals(const std::string &lastDay);
+        void updateDayNormals(const std::string &day, const std::string &lastDay);
+        void updateMonthNormals(const std::string &month, const std::string &lastDay);
+        void writeClimateNormal(const char *table, const char *keyColumn, const std::string &key,
+                                const ClimateNormal &tempAvg, const ClimateNormal &tempMin,
+                                const ClimateNormal &tempMax, const ClimateNormal &rain);
+
     private:
         Database *m_db;
         ProgressNotifier *m_progressNotifier;
@@ -18,19 +18,40 @@
 #define CURL_STRICTER
 #include <curl/curl.h>
 
+#include <algorithm>
 #include <stdexcept>
 
 #include "httprequest.h"
 
 namespace vetero::common {
 
-HttpRequest::HttpRequest(const std::string &url)
+namespace {
+
+// keep DNS lookups for periodic requests
+const long DnsCacheTimeout = 600;
+
+} // anonymous namespace
+
+const size_t HttpRequest::MaxResponseSize;
+
+HttpRequest::HttpRequest()
 {
     m_curl = curl_easy_init();
     if (!m_curl)
         throw std::bad_alloc();
 
-    curl_easy_setopt(m_curl, CURLOPT_URL, url.c_str());
+    // signals can't be used for the timeouts in threads
+    curl_easy_setopt(m_curl, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(m_curl, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(m_curl, CURLOPT_DNS_CACHE_TIMEOUT, DnsCacheTimeout);
+    curl_easy_setopt(m_curl, CURLOPT_WRITEFUNCTION, &HttpRequest::write);
+    curl_easy_setopt(m_curl, CURLOPT_WRITEDATA, this);
+}
+
+HttpRequest::HttpRequest(const std::string &url)
+    : HttpRequest()
+{
+    setUrl(url);
 }
 
 HttpRequest::~HttpRequest()
@@ -38,11 +59,44 @@ HttpRequest::~HttpRequest()
     curl_easy_cleanup(m_curl);
 }
 
-void HttpRequest::perform()
+void HttpRequest::setUrl(const std::string &url)
+{
+    curl_easy_setopt(m_curl, CURLOPT_URL, url.c_str());
+}
+
+void HttpRequest::setTimeout(int seconds)
 {
+    curl_easy_setopt(m_curl, CURLOPT_TIMEOUT, long(seconds));
+}
+
+long HttpRequest::perform()
+{
+    m_response.clear();
+
     CURLcode res = curl_easy_perform(m_curl);
     if (res != CURLE_OK)
         throw HttpError( curl_easy_strerror(res) );
+
+    long status = 0;
+    curl_easy_getinfo(m_curl, CURLINFO_RESPONSE_CODE, &status);
+
+    return status;
+}
+
+const std::string &HttpRequest::response() const
+{
+    return m_response;
+}
+
+size_t HttpRequest::write(char *data, size_t size, size_t nmemb, void *userdata)
+{
+    HttpRequest *request = static_cast<HttpRequest *>(userdata);
+
+    size_t length = size * nmemb;
+    if (request->m_response.size() < MaxResponseSize)
+        request->m_response.append(data, std::min(length, MaxResponseSize - request->m_response.size()));
+
+    return length;
 }
 
 /* }}} */
@@ -27,16 +27,75 @@ namespace vetero::common {
 
 /* HttpRequest {{{ */
 
+/**
+ * \brief HTTP GET request with libcurl
+ *
+ * The object can be used for several requests: libcurl keeps the connection alive and caches
+ * the DNS lookups between calls of perform() on the same object.
+ *
+ * \author Bernhard Walle <bernhard@bwalle.de>
+ * \ingroup common
+ */
 class HttpRequest {
 
 public:
+    /**
+     * \brief Creates a request without URL, see setUrl()
+     */
+    HttpRequest();
+
+    /**
+     * \brief Creates a request
+     *
+     * \param[in] url the URL
+     */
     HttpRequest(const std::string &url);
+
     ~HttpRequest();
 
-    void perform();
+    HttpRequest(const HttpRequest &) = delete;
+    HttpRequest &operator=(const HttpRequest &) = delete;
+
+public:
+    /**
+     * \brief Sets the URL of the next perform()
+     *
+     * \param[in] url the URL
+     */
+    void setUrl(const std::string &url);
+
+    /**
+     * \brief Sets the maximum time of a request including the connection setup
+     *
+     * \param[in] seconds the time, 0 waits forever (the default)
+     */
+    void setTimeout(int seconds);
+
+    /**
+     * \brief Performs the request
+     *
+     * \return the HTTP status code, the body is available with response()
+     * \exception HttpError if the request could not be sent or no answer has been received
+     */
+    long perform();
+
+    /**
+     * \brief Returns the body of the answer of the last perform()
+     *
+     * \return the body, truncated to MaxResponseSize bytes
+     */
+    const std::string &response() const;
+
+public:
+    /// Bytes of the answer that are kept
+    static const size_t MaxResponseSize = 4096;
+
+private:
+    static size_t write(char *data, size_t size, size_t nmemb, void *userdata);
 
 private:
     CURL *m_curl = nullptr;
+    std::string m_response;
 };
 
 /* }}} */
@@ -45,4 +104,4 @@ private:
 } // vetero::common
 
 
-#endif // VETERO_HTTPREQUEST_H_
\ No newline at end of file
+#endif // VETERO_HTTPREQUEST_H_
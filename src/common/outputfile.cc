@@ -0,0 +1,283 @@
+/* {{{
+ * (c) 2022, Bernhard Walle <bernhard@bwalle.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>. }}}
+ */
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <libbw/stringutil.h>
+#include <libbw/log/errorlog.h>
+#include <libbw/log/debug.h>
+
+#include "outputfile.h"
+#include "stagetimer.h"
+#include "utils.h"
+
+namespace vetero {
+namespace common {
+
+namespace {
+
+std::mutex changedFilesMutex;
+std::unordered_set<std::string> changedFiles;
+
+mode_t currentUmask()
+{
+    // umask() can only be read by setting it, so do that before any thread runs
+    mode_t mask = umask(0);
+    umask(mask);
+    return mask;
+}
+
+// the mode that std::ofstream or gzopen() would use
+const mode_t fileMode = 0666 & ~currentUmask();
+
+} // anonymous namespace
+
+/* OutputFile::StreamBuffer {{{ */
+
+OutputFile::StreamBuffer::StreamBuffer(OutputFile &file)
+    : m_file(file)
+{
+    setp(m_buffer, m_buffer + sizeof(m_buffer));
+}
+
+int OutputFile::StreamBuffer::overflow(int c)
+{
+    if (sync() != 0)
+        return traits_type::eof();
+
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+        *pptr() = traits_type::to_char_type(c);
+        pbump(1);
+    }
+
+    return traits_type::not_eof(c);
+}
+
+int OutputFile::StreamBuffer::sync()
+{
+    if (pptr() == pbase())
+        return 0;
+
+    m_file.writeRaw(pbase(), pptr() - pbase());
+    setp(m_buffer, m_buffer + sizeof(m_buffer));
+
+    return 0;
+}
+
+/* }}} */
+/* OutputFile {{{ */
+
+OutputFile::OutputFile(const std::string &filename, int compressionLevel)
+    : m_filename(filename)
+    , m_compressionLevel(compressionLevel)
+    , m_tracked(true)
+{
+    m_streamBuffer.reset(new StreamBuffer(*this));
+    m_stream.reset(new std::ostream(m_streamBuffer.get()));
+}
+
+std::string OutputFile::filename() const
+{
+    return m_filename;
+}
+
+std::ostream &OutputFile::stream()
+{
+    return *m_stream;
+}
+
+void OutputFile::write(const char *data, size_t size)
+{
+    // keep the order of data written to stream()
+    m_stream->flush();
+    writeRaw(data, size);
+}
+
+void OutputFile::write(const std::string &data)
+{
+    write(data.data(), data.size());
+}
+
+void OutputFile::writeRaw(const char *data, size_t size)
+{
+    m_contents.append(data, size);
+}
+
+void OutputFile::excludeFromChangedFiles()
+{
+    m_tracked = false;
+}
+
+bool OutputFile::commit()
+{
+    StageTimer timer(StageTimes::Write);
+
+    m_stream->flush();
+    if (!*m_stream)
+        throw ApplicationError("Unable to write to '" + m_filename + "'");
+
+    if (unchanged()) {
+        BW_DEBUG_TRACE("'%s' is unchanged", m_filename.c_str());
+        return false;
+    }
+
+    std::string tempFilename = writeTempFile();
+    if (rename(tempFilename.c_str(), m_filename.c_str()) != 0) {
+        int err = errno;
+        unlink(tempFilename.c_str());
+        throw SystemError("Unable to rename '" + tempFilename + "' to '" + m_filename + "'", err);
+    }
+
+    if (!m_tracked)
+        return true;
+
+    std::lock_guard<std::mutex> lock(changedFilesMutex);
+    changedFiles.insert(m_filename);
+
+    return true;
+}
+
+std::vector<std::string> OutputFile::takeChangedFiles()
+{
+    std::lock_guard<std::mutex> lock(changedFilesMutex);
+
+    std::vector<std::string> result(changedFiles.begin(), changedFiles.end());
+    changedFiles.clear();
+    return result;
+}
+
+bool OutputFile::unchanged() const
+{
+    // gzread() reads uncompressed files transparently
+    gzFile old = gzopen(m_filename.c_str(), "rb");
+    if (!old)
+        return false;
+
+    // gzread() only returns less than requested at the end of the file
+    size_t offset = 0;
+    char buffer[8192];
+    bool same;
+    while (true) {
+        int len = gzread(old, buffer, sizeof(buffer));
+        same = len >= 0 && size_t(len) <= m_contents.size() - offset &&
+               m_contents.compare(offset, len, buffer, len) == 0;
+        if (!same || len == 0)
+            break;
+        offset += len;
+    }
+    bool compressed = !gzdirect(old);
+    gzclose(old);
+
+    return same && offset == m_contents.size() &&
+           compressed == (m_compressionLevel != Uncompressed);
+}
+
+std::string OutputFile::writeTempFile() const
+{
+    // the temporary file must be in the same file system for rename(), and it's hidden
+    std::string::size_type slash = m_filename.rfind('/');
+    std::string dir = slash == std::string::npos ? std::string() : m_filename.substr(0, slash + 1);
+    std::string base = slash == std::string::npos ? m_filename : m_filename.substr(slash + 1);
+    std::string tempFilename = dir + "." + base + ".XXXXXX";
+
+    std::vector<char> name(tempFilename.begin(), tempFilename.end());
+    name.push_back('\0');
+    int fd = mkostemp(&name[0], O_CLOEXEC);
+    if (fd < 0)
+        throw SystemError("Unable to create temporary file for '" + m_filename + "'", errno);
+    tempFilename = &name[0];
+
+    // mkstemp() creates the file only readable for the owner
+    fchmod(fd, fileMode);
+
+    try {
+        writeContents(fd);
+    } catch (const ApplicationError &) {
+        unlink(tempFilename.c_str());
+        throw;
+    }
+
+    return tempFilename;
+}
+
+void OutputFile::writeContents(int fd) const
+{
+    const char *data = m_contents.data();
+    size_t size = m_contents.size();
+
+    if (m_compressionLevel == Uncompressed) {
+        while (size > 0) {
+            ssize_t ret = ::write(fd, data, size);
+            if (ret < 0 && errno == EINTR)
+                continue;
+            if (ret < 0) {
+                int err = errno;
+                ::close(fd);
+                throw SystemError("Unable to write to '" + m_filename + "'", err);
+            }
+            data += ret;
+            size -= ret;
+        }
+        if (::close(fd) != 0)
+            throw SystemError("Unable to close '" + m_filename + "'", errno);
+        return;
+    }
+
+    StageTimer timer(StageTimes::Compress);
+
+    std::string mode = "wb" + bw::str(std::min(std::max(m_compressionLevel, 0), 9));
+    gzFile file = gzdopen(fd, mode.c_str());
+    if (!file) {
+        ::close(fd);
+        throw ApplicationError("Unable to initialize compression for '" + m_filename + "'");
+    }
+
+    while (size > 0) {
+        unsigned chunk = std::min<size_t>(size, 1 << 30);
+        int ret = gzwrite(file, data, chunk);
+        if (ret <= 0) {
+            int errnum;
+            std::string message = gzerror(file, &errnum);
+            if (errnum == Z_ERRNO)
+                message = std::strerror(errno);
+            gzclose(file);
+            throw ApplicationError("Unable to write to '" + m_filename + "': " + message);
+        }
+        data += ret;
+        size -= ret;
+    }
+
+    // flushes the compressor
+    if (gzclose(file) != Z_OK)
+        throw SystemError("Unable to close '" + m_filename + "'", errno);
+}
+
+/* }}} */
+
+} // end namespace common
+} // end namespace vetero
@@ -0,0 +1,199 @@
+/* {{{
+ * (c) 2022, Bernhard Walle <bernhard@bwalle.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>. }}}
+ */
+#ifndef VETERO_COMMON_OUTPUTFILE_H_
+#define VETERO_COMMON_OUTPUTFILE_H_
+
+#include <memory>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include <libbw/noncopyable.h>
+
+#include "error.h"
+
+namespace vetero {
+namespace common {
+
+/* OutputFile {{{ */
+
+/**
+ * \class OutputFile
+ * \brief File that is written completely or not at all, optionally gzip-compressed
+ *
+ * The contents is collected in memory. commit() compares it with the existing file, byte by
+ * byte after decompression. If it's the same, nothing is written and the old file keeps its
+ * modification time, so regenerating an unchanged report neither wears the flash nor triggers
+ * an upload. Otherwise the contents is written to a temporary file in the same directory,
+ * compressed if a compression level is given, which is then renamed to the final name. Readers
+ * (the web server, the upload command) either see the old or the new file but never a partially
+ * written one. If the object is destroyed without commit(), the old file stays untouched.
+ *
+ * The names of the files that really changed are collected process-wide, see
+ * takeChangedFiles().
+ *
+ * \code
+ * OutputFile file("temperature.svgz", 6);
+ * file.stream() << "<svg ...";
+ * file.commit();
+ * \endcode
+ *
+ * \author Bernhard Walle <bernhard@bwalle.de>
+ * \ingroup common
+ */
+class OutputFile : private bw::Noncopyable {
+
+    public:
+        /**
+         * \brief Compression level that writes the data as it is
+         */
+        static const int Uncompressed = -1;
+
+        /**
+         * \brief Constructor
+         *
+         * Doesn't touch the file system, that's done by commit().
+         *
+         * \param[in] filename the final name of the file
+         * \param[in] compressionLevel Uncompressed or the gzip level from 0 to 9
+         */
+        OutputFile(const std::string &filename, int compressionLevel=Uncompressed);
+
+    public:
+        /**
+         * \brief Returns the final name of the file
+         *
+         * \return the name passed to the constructor
+         */
+        std::string filename() const;
+
+        /**
+         * \brief Returns a stream that writes to the file
+         *
+         * Errors are reported by commit().
+         *
+         * \return the stream
+         */
+        std::ostream &stream();
+
+        /**
+         * \brief Writes data to the file
+         *
+         * \param[in] data the data
+         * \param[in] size the number of bytes in \p data
+         */
+        void write(const char *data, size_t size);
+
+        /**
+         * \brief Writes data to the file
+         *
+         * \param[in] data the data
+         */
+        void write(const std::string &data);
+
+        /**
+         * \brief Doesn't report the file in takeChangedFiles()
+         *
+         * For internal files of vetero that are not uploaded.
+         */
+        void excludeFromChangedFiles();
+
+        /**
+         * \brief Writes the file and replaces the old one unless it has the same contents
+         *
+         * \return \c true if the file has been replaced, \c false if the old file had the same
+         *         contents and has been kept
+         * \exception common::ApplicationError if creating, writing, closing or renaming the
+         *            temporary file fails
+         */
+        bool commit();
+
+        /**
+         * \brief Returns and forgets the files replaced by commit()
+         *
+         * Thread-safe, the files committed by all threads are collected.
+         *
+         * \return the final names of the files in no particular order, each name once
+         */
+        static std::vector<std::string> takeChangedFiles();
+
+    protected:
+        /**
+         * \brief Appends data to the contents bypassing the buffer of stream()
+         *
+         * \param[in] data the data
+         * \param[in] size the number of bytes in \p data
+         */
+        void writeRaw(const char *data, size_t size);
+
+        /**
+         * \brief Checks if the existing file has the contents that has been written
+         *
+         * Compressed files are compared by their uncompressed contents but only with files
+         * that are compressed as well.
+         *
+         * \return \c true if the file exists and has the same contents
+         */
+        bool unchanged() const;
+
+        /**
+         * \brief Writes the contents to a new temporary file in the directory of the file
+         *
+         * \return the name of the temporary file
+         * \exception common::ApplicationError if the file cannot be created or written, it's
+         *            removed in that case
+         */
+        std::string writeTempFile() const;
+
+        /**
+         * \brief Writes the contents to the temporary file, compressed if requested
+         *
+         * \param[in] fd the file descriptor of the temporary file, closed in any case
+         * \exception common::ApplicationError if the data cannot be written or the file
+         *            cannot be closed
+         */
+        void writeContents(int fd) const;
+
+    private:
+        class StreamBuffer : public std::streambuf {
+            public:
+                StreamBuffer(OutputFile &file);
+
+            protected:
+                int overflow(int c);
+                int sync();
+
+            private:
+                OutputFile &m_file;
+                char m_buffer[8192];
+        };
+
+        std::string m_filename;
+        int m_compressionLevel;
+        std::string m_contents;
+        std::unique_ptr<StreamBuffer> m_streamBuffer;
+        std::unique_ptr<std::ostream> m_stream;
+        bool m_tracked;
+};
+
+/* }}} */
+
+} // end namespace common
+} // end namespace vetero
+
+#endif // VETERO_COMMON_OUTPUTFILE_H_
@@ -0,0 +1,249 @@
+/* {{{
+ * (c) 2022, Bernhard Walle <bernhard@bwalle.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>. }}}
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <locale>
+#include <sstream>
+
+#include "quantilesketch.h"
+
+namespace vetero {
+namespace common {
+
+/* QuantileSketch {{{ */
+
+// about 100 centroids per day and value, enough for P5 and P95 within a few 1/100 °C
+const double QuantileSketch::DefaultCompression = 50.0;
+
+QuantileSketch::QuantileSketch(double compression)
+    : m_compression(compression)
+    , m_count(0.0)
+    , m_minimum(NAN)
+    , m_maximum(NAN)
+{}
+
+void QuantileSketch::add(double value, double weight)
+{
+    if (std::isnan(value) || !(weight > 0.0))
+        return;
+
+    Centroid centroid = { value, weight };
+    m_buffer.push_back(centroid);
+    m_count += weight;
+
+    if (std::isnan(m_minimum) || value < m_minimum)
+        m_minimum = value;
+    if (std::isnan(m_maximum) || value > m_maximum)
+        m_maximum = value;
+
+    // sorting a batch is much cheaper than inserting each value
+    if (m_buffer.size() >= 5 * m_compression)
+        compress();
+}
+
+void QuantileSketch::merge(const QuantileSketch &other)
+{
+    if (other.m_count <= 0.0)
+        return;
+
+    other.compress();
+    m_buffer.insert(m_buffer.end(), other.m_centroids.begin(), other.m_centroids.end());
+    m_count += other.m_count;
+
+    if (std::isnan(m_minimum) || other.m_minimum < m_minimum)
+        m_minimum = other.m_minimum;
+    if (std::isnan(m_maximum) || other.m_maximum > m_maximum)
+        m_maximum = other.m_maximum;
+
+    if (m_buffer.size() >= 5 * m_compression)
+        compress();
+}
+
+double QuantileSketch::count() const
+{
+    return m_count;
+}
+
+double QuantileSketch::quantile(double q) const
+{
+    if (m_count <= 0.0)
+        return NAN;
+
+    compress();
+
+    q = std::min(std::max(q, 0.0), 1.0);
+    double target = q * m_count;
+
+    // the values of a centroid are assumed to be spread around its mean, so interpolate
+    // between the centers of the neighbouring centroids
+    const Centroid &first = m_centroids.front();
+    if (target <= first.weight / 2.0) {
+        double fraction = first.weight > 0.0 ? target / (first.weight / 2.0) : 1.0;
+        return m_minimum + (first.mean - m_minimum) * fraction;
+    }
+
+    double before = 0.0;
+    for (size_t i = 0; i + 1 < m_centroids.size(); ++i) {
+        const Centroid &left = m_centroids[i];
+        const Centroid &right = m_centroids[i + 1];
+        double leftCenter = before + left.weight / 2.0;
+        double rightCenter = before + left.weight + right.weight / 2.0;
+
+        if (target <= rightCenter) {
+            double fraction = (target - leftCenter) / (rightCenter - leftCenter);
+            return left.mean + (right.mean - left.mean) * fraction;
+        }
+
+        before += left.weight;
+    }
+
+    const Centroid &last = m_centroids.back();
+    double lastCenter = m_count - last.weight / 2.0;
+    double fraction = last.weight > 0.0 ? (target - lastCenter) / (last.weight / 2.0) : 1.0;
+    return last.mean + (m_maximum - last.mean) * std::min(fraction, 1.0);
+}
+
+double QuantileSketch::minimum() const
+{
+    return m_minimum;
+}
+
+double QuantileSketch::maximum() const
+{
+    return m_maximum;
+}
+
+std::string QuantileSketch::serialize() const
+{
+    if (m_count <= 0.0)
+        return std::string();
+
+    compress();
+
+    std::ostringstream oss;
+    oss.imbue(std::locale::classic());
+    oss.precision(10);
+
+    oss << m_minimum << ' ' << m_maximum;
+    for (size_t i = 0; i < m_centroids.size(); ++i) {
+        oss << ' ' << m_centroids[i].mean;
+        if (m_centroids[i].weight != 1.0)
+            oss << '*' << m_centroids[i].weight;
+    }
+
+    return oss.str();
+}
+
+bool QuantileSketch::parse(const std::string &text)
+{
+    m_centroids.clear();
+    m_buffer.clear();
+    m_count = 0.0;
+    m_minimum = m_maximum = NAN;
+
+    std::istringstream iss(text);
+    iss.imbue(std::locale::classic());
+
+    double minimum, maximum;
+    if (!(iss >> minimum >> maximum))
+        return false;
+
+    std::vector<Centroid> centroids;
+    double count = 0.0;
+    Centroid centroid;
+    while (iss >> centroid.mean) {
+        centroid.weight = 1.0;
+        if (iss.peek() == '*' && !(iss.ignore() >> centroid.weight))
+            return false;
+        if (!(centroid.weight > 0.0) || centroid.mean < minimum || centroid.mean > maximum)
+            return false;
+
+        centroids.push_back(centroid);
+        count += centroid.weight;
+    }
+
+    if (!iss.eof() || centroids.empty())
+        return false;
+
+    m_centroids.swap(centroids);
+    m_count = count;
+    m_minimum = minimum;
+    m_maximum = maximum;
+
+    // serialize() writes them sorted, but the sketch may come from somewhere else
+    std::sort(m_centroids.begin(), m_centroids.end(),
+              [](const Centroid &a, const Centroid &b) { return a.mean < b.mean; });
+
+    return true;
+}
+
+void QuantileSketch::compress() const
+{
+    if (m_buffer.empty())
+        return;
+
+    std::vector<Centroid> all;
+    all.reserve(m_centroids.size() + m_buffer.size());
+    all.insert(all.end(), m_centroids.begin(), m_centroids.end());
+    all.insert(all.end(), m_buffer.begin(), m_buffer.end());
+    m_buffer.clear();
+
+    std::sort(all.begin(), all.end(),
+              [](const Centroid &a, const Centroid &b) { return a.mean < b.mean; });
+
+    std::vector<Centroid> result;
+    Centroid current = all.front();
+    double before = 0.0;
+    double limit = maxQuantile(0.0);
+
+    for (size_t i = 1; i < all.size(); ++i) {
+        const Centroid &next = all[i];
+        double weight = current.weight + next.weight;
+
+        // equal values lose nothing when merged, that keeps calm days small
+        if (next.mean == current.mean || (before + weight) / m_count <= limit) {
+            current.mean += (next.mean - current.mean) * next.weight / weight;
+            current.weight = weight;
+        } else {
+            result.push_back(current);
+            before += current.weight;
+            limit = maxQuantile(before / m_count);
+            current = next;
+        }
+    }
+    result.push_back(current);
+
+    m_centroids.swap(result);
+}
+
+double QuantileSketch::maxQuantile(double q) const
+{
+    // the scale function k(q) = compression / (2 pi) * asin(2q - 1) allows centroids that
+    // span one unit of k, which keeps the centroids at the tails small
+    double k = m_compression / (2.0 * M_PI) * std::asin(2.0 * q - 1.0) + 1.0;
+    double angle = k * 2.0 * M_PI / m_compression;
+    if (angle >= M_PI / 2.0)
+        return 1.0;
+
+    return (std::sin(angle) + 1.0) / 2.0;
+}
+
+/* }}} */
+
+} // end namespace common
+} // end namespace vetero
@@ -0,0 +1,144 @@
+/* {{{
+ * (c) 2022, Bernhard Walle <bernhard@bwalle.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>. }}}
+ */
+#ifndef VETERO_COMMON_QUANTILESKETCH_H_
+#define VETERO_COMMON_QUANTILESKETCH_H_
+
+#include <string>
+#include <vector>
+
+namespace vetero {
+namespace common {
+
+/* QuantileSketch {{{ */
+
+/**
+ * \class QuantileSketch
+ * \brief Approximate quantiles of a stream of values (t-digest)
+ *
+ * The values are clustered into centroids that are small near the ends of the distribution
+ * and larger near the median, so that P5 or P95 remain precise. The number of centroids is
+ * bounded by the compression, independent of the number of values. Two sketches can be merged,
+ * so the quantiles of a month can be computed from the sketches of its days.
+ *
+ * The sketches are stored as text in the statistics tables, see serialize(). In SQL, they're
+ * used with the functions <tt>VETERO_SKETCH()</tt>, <tt>VETERO_SKETCH_MERGE()</tt> and
+ * <tt>VETERO_QUANTILE()</tt>, see Sqlite3Database.
+ *
+ * \author Bernhard Walle <bernhard@bwalle.de>
+ * \ingroup common
+ */
+class QuantileSketch
+{
+    public:
+        /**
+         * \brief Creates an empty sketch
+         *
+         * \param[in] compression the maximum number of centroids is about twice this value
+         */
+        QuantileSketch(double compression=DefaultCompression);
+
+    public:
+        /// Compression of the sketches in the statistics tables
+        static const double DefaultCompression;
+
+    public:
+        /**
+         * \brief Adds a value
+         *
+         * \param[in] value the value
+         * \param[in] weight the number of times the value has been measured
+         */
+        void add(double value, double weight=1.0);
+
+        /**
+         * \brief Adds all values of another sketch
+         *
+         * \param[in] other the other sketch
+         */
+        void merge(const QuantileSketch &other);
+
+        /**
+         * \brief Returns the number of values
+         *
+         * \return the sum of the weights
+         */
+        double count() const;
+
+        /**
+         * \brief Returns a quantile
+         *
+         * \param[in] q the quantile between 0.0 and 1.0, 0.5 is the median
+         * \return the approximate value or NAN if the sketch is empty
+         */
+        double quantile(double q) const;
+
+        /**
+         * \brief Returns the smallest value
+         *
+         * \return the value or NAN if the sketch is empty
+         */
+        double minimum() const;
+
+        /**
+         * \brief Returns the largest value
+         *
+         * \return the value or NAN if the sketch is empty
+         */
+        double maximum() const;
+
+        /**
+         * \brief Converts the sketch into text
+         *
+         * The format is <tt>"min max mean[*weight] ..."</tt>, the weight is omitted if it's 1.
+         * Numbers are always formatted with the C locale.
+         *
+         * \return the text, empty if the sketch is empty
+         */
+        std::string serialize() const;
+
+        /**
+         * \brief Reads a sketch created by serialize()
+         *
+         * \param[in] text the text
+         * \return \c true on success, \c false if \p text is no sketch. The sketch is empty then.
+         */
+        bool parse(const std::string &text);
+
+    private:
+        struct Centroid {
+            double mean;
+            double weight;
+        };
+
+        void compress() const;
+        double maxQuantile(double q) const;
+
+    private:
+        double m_compression;
+        double m_count;
+        double m_minimum;
+        double m_maximum;
+        mutable std::vector<Centroid> m_centroids;
+        mutable std::vector<Centroid> m_buffer;
+};
+
+/* }}} */
+
+} // end namespace common
+} // end namespace vetero
+
+#endif // VETERO_COMMON_QUANTILESKETCH_H_
@@ -0,0 +1,120 @@
+/* {{{
+ * (c) 2022, Bernhard Walle <bernhard@bwalle.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>. }}}
+ */
+
+#include "stagetimer.h"
+
+namespace vetero {
+namespace common {
+
+namespace {
+
+thread_local StageTimes *currentTimes = NULL;
+thread_local StageTimer *activeTimer = NULL;
+
+} // anonymous namespace
+
+/* StageTimes::Scope {{{ */
+
+StageTimes::Scope::Scope(StageTimes *times)
+    : m_previousTimes(currentTimes)
+    , m_previousTimer(activeTimer)
+{
+    currentTimes = times;
+    activeTimer = NULL;
+}
+
+StageTimes::Scope::~Scope()
+{
+    currentTimes = m_previousTimes;
+    activeTimer = m_previousTimer;
+}
+
+/* }}} */
+/* StageTimes {{{ */
+
+StageTimes::StageTimes()
+{
+    for (int i = 0; i < StageCount; ++i) {
+        m_nanoseconds[i] = 0;
+        m_counts[i] = 0;
+    }
+}
+
+const char *StageTimes::stageName(Stage stage)
+{
+    static const char *names[StageCount] = {
+        "query", "transform", "plot", "compress", "write", "upload"
+    };
+
+    return names[stage];
+}
+
+StageTimes *StageTimes::current()
+{
+    return currentTimes;
+}
+
+void StageTimes::add(Stage stage, std::chrono::steady_clock::duration duration)
+{
+    m_nanoseconds[stage] += std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+    m_counts[stage]++;
+}
+
+double StageTimes::milliseconds(Stage stage) const
+{
+    return m_nanoseconds[stage] / 1e6;
+}
+
+unsigned long StageTimes::count(Stage stage) const
+{
+    return m_counts[stage];
+}
+
+/* }}} */
+/* StageTimer {{{ */
+
+StageTimer::StageTimer(StageTimes::Stage stage)
+    : m_times(currentTimes)
+    , m_stage(stage)
+    , m_parent(NULL)
+    , m_children(Clock::duration::zero())
+{
+    if (!m_times)
+        return;
+
+    m_parent = activeTimer;
+    activeTimer = this;
+    m_start = Clock::now();
+}
+
+StageTimer::~StageTimer()
+{
+    if (!m_times)
+        return;
+
+    Clock::duration elapsed = Clock::now() - m_start;
+    m_times->add(m_stage, elapsed - m_children);
+
+    if (m_parent)
+        m_parent->m_children += elapsed;
+    activeTimer = m_parent;
+}
+
+/* }}} */
+
+} // end namespace common
+} // end namespace vetero
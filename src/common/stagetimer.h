@@ -0,0 +1,195 @@
+/* {{{
+ * (c) 2022, Bernhard Walle <bernhard@bwalle.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>. }}}
+ */
+#ifndef VETERO_COMMON_STAGETIMER_H_
+#define VETERO_COMMON_STAGETIMER_H_
+
+#include <atomic>
+#include <chrono>
+
+#include <libbw/noncopyable.h>
+
+namespace vetero {
+namespace common {
+
+class StageTimer;
+
+/* StageTimes {{{ */
+
+/**
+ * \class StageTimes
+ * \brief Time spent in the stages of a job
+ *
+ * A StageTimes object collects the durations measured by the StageTimer objects of the threads
+ * in which it's current, see Scope. Without a current object, StageTimer does nothing, so
+ * the timers in common code such as Sqlite3Database or OutputFile cost almost nothing in
+ * programs that don't collect timings.
+ *
+ * The durations are summed up over all threads, so with parallel diagrams the sum of the
+ * stages can be larger than the wall clock time of the job.
+ *
+ * \author Bernhard Walle <bernhard@bwalle.de>
+ * \ingroup common
+ */
+class StageTimes : private bw::Noncopyable
+{
+    public:
+        /**
+         * \brief The stages
+         */
+        enum Stage {
+            Query,          ///< SQL queries
+            Transform,      ///< preparing the data of diagrams
+            Plot,           ///< drawing diagrams
+            Compress,       ///< compressing output files
+            Write,          ///< writing output files
+            Upload,         ///< running the upload command
+            StageCount
+        };
+
+        /**
+         * \brief Makes a StageTimes object current in the calling thread
+         *
+         * The previous one is restored in the destructor. Timers that were running in the
+         * calling thread before are not affected by the timers inside of the scope.
+         */
+        class Scope : private bw::Noncopyable
+        {
+            public:
+                /**
+                 * \brief C'tor
+                 *
+                 * \param[in] times the object that gets the durations, may be \c NULL
+                 */
+                explicit Scope(StageTimes *times);
+
+                /**
+                 * \brief D'tor
+                 */
+                ~Scope();
+
+            private:
+                StageTimes *m_previousTimes;
+                StageTimer *m_previousTimer;
+        };
+
+    public:
+        /**
+         * \brief C'tor
+         */
+        StageTimes();
+
+    public:
+        /**
+         * \brief Returns the name of a stage like <tt>"query"</tt>
+         *
+         * \param[in] stage the stage
+         * \return the name
+         */
+        static const char *stageName(Stage stage);
+
+        /**
+         * \brief Returns the object that is current in the calling thread
+         *
+         * \return the object or \c NULL
+         */
+        static StageTimes *current();
+
+        /**
+         * \brief Adds a duration to a stage
+         *
+         * Thread-safe.
+         *
+         * \param[in] stage the stage
+         * \param[in] duration the duration
+         */
+        void add(Stage stage, std::chrono::steady_clock::duration duration);
+
+        /**
+         * \brief Returns the time spent in a stage
+         *
+         * \param[in] stage the stage
+         * \return the time in milliseconds
+         */
+        double milliseconds(Stage stage) const;
+
+        /**
+         * \brief Returns how often a stage has been entered
+         *
+         * \param[in] stage the stage
+         * \return the count
+         */
+        unsigned long count(Stage stage) const;
+
+    private:
+        std::atomic<long long> m_nanoseconds[StageCount];
+        std::atomic<unsigned long> m_counts[StageCount];
+};
+
+/* }}} */
+/* StageTimer {{{ */
+
+/**
+ * \class StageTimer
+ * \brief Measures the time of a stage in the current scope
+ *
+ * The time from the construction to the destruction is added to the current StageTimes of
+ * the thread. Timers may be nested: the time of the inner timer is subtracted from the outer
+ * one, so a query inside of a Transform timer only counts as Query.
+ *
+ * \code
+ * {
+ *     StageTimer timer(StageTimes::Plot);
+ *     renderer.render(chart, data);
+ * }
+ * \endcode
+ *
+ * \author Bernhard Walle <bernhard@bwalle.de>
+ * \ingroup common
+ */
+class StageTimer : private bw::Noncopyable
+{
+    friend class StageTimes::Scope;
+
+    public:
+        /**
+         * \brief Starts the timer
+         *
+         * \param[in] stage the stage
+         */
+        explicit StageTimer(StageTimes::Stage stage);
+
+        /**
+         * \brief Stops the timer and adds the time
+         */
+        ~StageTimer();
+
+    private:
+        typedef std::chrono::steady_clock Clock;
+
+        StageTimes *m_times;
+        StageTimes::Stage m_stage;
+        StageTimer *m_parent;
+        Clock::time_point m_start;
+        Clock::duration m_children;
+};
+
+/* }}} */
+
+} // end namespace common
+} // end namespace vetero
+
+#endif // VETERO_COMMON_STAGETIMER_H_
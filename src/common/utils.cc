@@ -23,10 +23,14 @@
 #include <cmath>
 #include <cstdlib>
 #include <cerrno>
+#include <csignal>
 #include <locale.h>
+#include <cstring>
+#include <sys/socket.h>
 #include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
 
-#include <zlib.h>
 
 #include <libbw/log/errorlog.h>
 #include <libbw/stringutil.h>
@@ -132,10 +136,19 @@ std::string str_vprintf_l(const char *format, const char *locale, va_list ap)
     return ret;
 }
 
-pid_t start_background(const std::string &process, const std::vector<std::string> &args)
+pid_t start_background(const std::string &process, const std::vector<std::string> &args,
+                       int stdinFd)
 {
     pid_t childpid = fork();
     if (childpid == 0) {
+        if (stdinFd >= 0 && dup2(stdinFd, STDIN_FILENO) < 0)
+            std::exit(-1);
+
+        // the calling thread may block SIGCHLD, the process shouldn't inherit that
+        sigset_t signals;
+        sigemptyset(&signals);
+        sigprocmask(SIG_SETMASK, &signals, NULL);
+
         const char *argVector[args.size() + 2];
 
         argVector[0] = process.c_str();
@@ -152,41 +165,60 @@ pid_t start_background(const std::string &process, const std::vector<std::string
     throw SystemError("Unable to fork()", errno);
 }
 
-void compress_file(const std::string &filename)
+namespace {
+
+struct sockaddr_un unixAddress(const std::string &path)
 {
-    // use the C file I/O since it's equivalent with zlib I/O
+    struct sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path))
+        throw ApplicationError("Socket path '" + path + "' too long");
+    std::strcpy(address.sun_path, path.c_str());
+
+    return address;
+}
 
-    std::FILE *fp = std::fopen(filename.c_str(), "r");
-    if (!fp)
-        throw common::SystemError("Unable to open '" + filename + "' for reading", errno);
+} // anonymous namespace
 
-    // get the size of the file
-    int ret = std::fseek(fp, 0, SEEK_END);
-    if (ret < 0) {
-        std::fclose(fp);
-        throw common::SystemError("Unable to seek '" + filename + "' to the end", errno);
+int listen_unix(const std::string &path)
+{
+    struct sockaddr_un address = unixAddress(path);
+
+    // a socket left over from a previous run
+    struct stat st;
+    if (lstat(path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode))
+        unlink(path.c_str());
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        throw SystemError("Unable to create socket", errno);
+
+    if (bind(fd, reinterpret_cast<struct sockaddr *>(&address), sizeof(address)) < 0 ||
+            listen(fd, SOMAXCONN) < 0) {
+        int err = errno;
+        close(fd);
+        throw SystemError("Unable to listen on '" + path + "'", err);
     }
 
-    off_t size = ftello(fp);
-    std::rewind(fp);
+    return fd;
+}
 
-    char *buffer = new char[size];
-    ret = std::fread(buffer, 1, size, fp);
-    std::fclose(fp);
-    if (ret != size) {
-        delete[] buffer;
-        throw common::SystemError("Unable to read " + bw::str(size) + " bytes from " + filename, errno);
-    }
+int connect_unix(const std::string &path)
+{
+    struct sockaddr_un address = unixAddress(path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        throw SystemError("Unable to create socket", errno);
 
-    gzFile outfp = gzopen(filename.c_str(), "w");
-    if (!outfp)
-        throw common::ApplicationError("Unable to open '" + filename + "' for writing: ");
+    if (connect(fd, reinterpret_cast<struct sockaddr *>(&address), sizeof(address)) < 0) {
+        int err = errno;
+        close(fd);
+        throw SystemError("Unable to connect to '" + path + "'", err);
+    }
 
-    ret = gzwrite(outfp, buffer, size);
-    delete[] buffer;
-    gzclose(outfp);
-    if (ret != size)
-        throw common::ApplicationError("Unable to write to '" + filename + "'");
+    return fd;
 }
 
 std::string realpath(const std::string &filename)
@@ -201,5 +233,15 @@ std::string realpath(const std::string &filename)
     return ret;
 }
 
+uint64_t fnv1a_hash(const void *data, size_t size, uint64_t hash)
+{
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
 } // end namespace common
 } // end namespace vetero
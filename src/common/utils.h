@@ -21,6 +21,7 @@
 #include <stdexcept>
 #include <string>
 #include <cstdarg>
+#include <stdint.h>
 #include <sys/types.h>
 
 #include <libbw/compiler.h>
@@ -133,25 +134,40 @@ std::string str_vprintf_l(const char *format, const char *locale, va_list ap)
  *
  * \param[in] process the name of the process (can be in <tt>PATH</tt>)
  * \param[in] args the process' argument
+ * \param[in] stdinFd if not negative, the file descriptor that becomes the standard input
+ *            of the process
+ * The process starts with no blocked signals.
+ *
  * \return the PID of the started process (the caller has to handle <tt>SIGCHLD</tt>)
  * \exception common::ApplicationError if the process cannot be started
  * \ingroup common
  */
-pid_t start_background(const std::string &process, const std::vector<std::string> &args);
+pid_t start_background(const std::string &process, const std::vector<std::string> &args,
+                       int stdinFd=-1);
+
 
 /**
- * \brief Compresses \p filename with gzip
+ * \brief Creates a listening Unix domain socket
  *
- * The function replaces the file contents. The extension doesn't matter.
+ * A socket file left over from a previous run is replaced. The socket is non-blocking
+ * and closed on exec.
  *
- * \warning Use the function only for small files since the whole contents of the source
- *          file will be read into memory.
+ * \param[in] path the path of the socket
+ * \return the file descriptor
+ * \exception common::SystemError if the socket cannot be created
+ * \ingroup common
+ */
+int listen_unix(const std::string &path);
+
+/**
+ * \brief Connects to a Unix domain socket
  *
- * \param[in] filename the name of the file
- * \exception common::ApplicationError if reading the file or writing the file fails.
+ * \param[in] path the path of the socket
+ * \return the file descriptor (blocking, closed on exec)
+ * \exception common::SystemError if the connection cannot be established
  * \ingroup common
  */
-void compress_file(const std::string &filename);
+int connect_unix(const std::string &path);
 
 /**
  * \brief Wrapper around POSIX realpath()
@@ -163,6 +179,25 @@ void compress_file(const std::string &filename);
  */
 std::string realpath(const std::string &filename);
 
+/**
+ * \brief Start value for fnv1a_hash()
+ */
+const uint64_t FNV1A_OFFSET_BASIS = 14695981039346656037ULL;
+
+/**
+ * \brief Computes the 64 bit FNV-1a hash of \p data
+ *
+ * Fast but no cryptographic hash, used to detect changes of data we produce ourselves.
+ *
+ * \param[in] data the data
+ * \param[in] size the number of bytes in \p data
+ * \param[in] hash the result of a previous call to continue the hash, FNV1A_OFFSET_BASIS
+ *            for a new hash
+ * \return the hash
+ * \ingroup common
+ */
+uint64_t fnv1a_hash(const void *data, size_t size, uint64_t hash=FNV1A_OFFSET_BASIS);
+
 } // end namespace common
 } // end namespace vetero
 
@@ -0,0 +1,192 @@
+/* {{{
+ * (c) 2022, Bernhard Walle <bernhard@bwalle.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>. }}}
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include <libbw/datetime.h>
+
+#include "syntheticweather.h"
+
+namespace vetero {
+namespace bench {
+
+namespace {
+
+const double Pi = 3.14159265358979323846;
+
+// Munich
+const double Latitude = 48.1;
+
+double clamp(double value, double min, double max)
+{
+    return std::max(min, std::min(max, value));
+}
+
+} // anonymous namespace
+
+/* SyntheticWeather {{{ */
+
+SyntheticWeather::SyntheticWeather(const common::SensorType &sensorType, unsigned long seed)
+    : m_sensorType(sensorType)
+    , m_random(seed)
+    , m_normal(0.0, 1.0)
+    , m_uniform(0.0, 1.0)
+    , m_lastTime(0)
+    , m_dayOfYear(-1)
+    , m_anomaly(0.0)
+    , m_cloudiness(0.5)
+    , m_windMean(8.0)
+    , m_windDirection(250.0)
+    , m_pressure(1015.0)
+    , m_noise(0.0)
+    , m_rainSeconds(0.0)
+    , m_rainIntensity(0.0)
+    , m_rainTicks(0.0)
+    , m_rainGauge(0)
+{}
+
+common::Dataset SyntheticWeather::next(time_t time)
+{
+    struct tm tm;
+    localtime_r(&time, &tm);
+
+    if (tm.tm_yday != m_dayOfYear)
+        startDay(tm.tm_yday);
+
+    double seconds = m_lastTime == 0 ? 0.0 : std::difftime(time, m_lastTime);
+    m_lastTime = time;
+
+    int day = tm.tm_yday;
+    double hour = tm.tm_hour + tm.tm_min/60.0 + tm.tm_sec/3600.0;
+    double season = std::cos(2*Pi * (day - 15) / 365.25);     // 1 in winter, -1 in summer
+
+    double rain = advanceRain(seconds, day);
+    bool raining = m_rainSeconds > 0.0;
+
+    // temperature: coldest around 6:00, warmest around 15:00
+    m_noise = 0.95*m_noise + 0.1*m_normal(m_random);
+    double amplitude = (4.5 - 2.0*season) * (1.0 - 0.6*m_cloudiness) * (raining ? 0.5 : 1.0);
+    double diurnal = std::cos(2*Pi * (hour - 15.0) / 24.0) + 0.3*std::cos(4*Pi * (hour - 15.0) / 24.0);
+    double temperature = 9.0 - 9.5*season + m_anomaly + amplitude*diurnal + m_noise;
+
+    // relative humidity: low in the afternoon, saturated during rain
+    double humidity = 75.0 + 8.0*season + 10.0*m_cloudiness - 2.5*amplitude*diurnal +
+                      2.0*m_normal(m_random);
+    if (raining)
+        humidity = 93.0 + 6.0*m_uniform(m_random);
+    humidity = clamp(humidity, 15.0, 99.0);
+
+    // wind: calm at night, gusty during the day
+    double daytime = std::max(0.0, std::sin(Pi * (hour - 8.0) / 12.0));
+    double wind = m_windMean * (0.6 + 0.7*daytime) * std::exp(0.3*m_normal(m_random));
+    if (raining)
+        wind *= 1.3;
+    double gust = wind * (1.3 + 0.5*m_uniform(m_random)) + 3.0*m_uniform(m_random);
+    m_windDirection = std::fmod(m_windDirection + 10.0*m_normal(m_random) + 360.0, 360.0);
+
+    // pressure: random walk that falls before and during rain
+    double hours = seconds / 3600.0;
+    m_pressure += 0.05*(1015.0 - m_pressure)*hours + 0.4*std::sqrt(hours)*m_normal(m_random);
+    if (raining)
+        m_pressure -= 0.3*hours;
+
+    // solar radiation
+    double elevation = sunElevation(day, hour);
+    double radiation = 0.0;
+    if (elevation > 0.0) {
+        radiation = 1050.0 * std::pow(std::sin(elevation*Pi/180.0), 1.15) *
+                    (1.0 - 0.75*m_cloudiness) * (raining ? 0.3 : 1.0);
+        radiation = std::max(0.0, radiation * (1.0 + 0.05*m_normal(m_random)));
+    }
+
+    // rain gauge: counts ticks of the rain gauge factor, in 1/1000 mm, and wraps
+    common::Dataset dataset;
+    dataset.setSensorType(m_sensorType);
+    m_rainTicks += rain * 1000.0 / dataset.rainGaugeFactor();
+    int ticks = static_cast<int>(m_rainTicks);
+    m_rainTicks -= ticks;
+    m_rainGauge = (m_rainGauge + ticks) % (4096 + 1);
+
+    dataset.setTimestamp(bw::Datetime(time));
+    dataset.setTemperature(static_cast<int>(std::lround(temperature * 100)));
+    dataset.setHumidity(static_cast<int>(std::lround(humidity)) * 100);
+    dataset.setWindSpeed(static_cast<int>(std::lround(wind * 100)));
+    dataset.setWindGust(static_cast<int>(std::lround(gust * 100)));
+    dataset.setWindDirection(static_cast<int>(std::lround(m_windDirection)) % 360);
+    dataset.setPressure(static_cast<int>(std::lround(m_pressure * 100)));
+    dataset.setSolarRadiation(static_cast<int>(std::lround(radiation * 10)));
+    dataset.setUvIndex(static_cast<int>(std::lround(radiation * 0.008)));
+    dataset.setRainGauge(m_rainGauge);
+    dataset.setIsRain(raining);
+
+    return dataset;
+}
+
+void SyntheticWeather::startDay(int dayOfYear)
+{
+    m_dayOfYear = dayOfYear;
+
+    // weather situations last a few days
+    m_anomaly = 0.7*m_anomaly + 1.8*m_normal(m_random);
+    m_cloudiness = clamp(0.6*m_cloudiness + 0.4*m_uniform(m_random) + 0.1*m_normal(m_random), 0.0, 1.0);
+
+    // Weibull distribution with k = 2, stronger in winter
+    double scale = 7.0 + 3.0*std::cos(2*Pi * (dayOfYear - 15) / 365.25);
+    m_windMean = scale * std::sqrt(-std::log(1.0 - 0.999*m_uniform(m_random)));
+    m_windDirection = std::fmod(250.0 + 60.0*m_normal(m_random) + 360.0, 360.0);
+}
+
+double SyntheticWeather::advanceRain(double seconds, int dayOfYear)
+{
+    if (seconds <= 0.0)
+        return 0.0;
+
+    if (m_rainSeconds <= 0.0) {
+        // more events on cloudy days, heavier showers in summer
+        double eventsPerHour = 0.01 + 0.08*m_cloudiness*m_cloudiness;
+        if (m_uniform(m_random) >= eventsPerHour * seconds / 3600.0)
+            return 0.0;
+
+        double summer = 1.0 - std::cos(2*Pi * (dayOfYear - 15) / 365.25);
+        m_rainSeconds = -7200.0 * std::log(1.0 - 0.999*m_uniform(m_random));
+        m_rainIntensity = -(0.6 + 1.2*summer) * std::log(1.0 - 0.999*m_uniform(m_random));
+    }
+
+    double duration = std::min(seconds, m_rainSeconds);
+    m_rainSeconds -= duration;
+
+    return m_rainIntensity * duration / 3600.0;
+}
+
+double SyntheticWeather::sunElevation(int dayOfYear, double hour)
+{
+    double declination = -23.44 * std::cos(2*Pi * (dayOfYear + 10) / 365.0);
+    double hourAngle = 15.0 * (hour - 12.0);
+
+    double lat = Latitude * Pi/180.0;
+    double decl = declination * Pi/180.0;
+    double sinElevation = std::sin(lat)*std::sin(decl) +
+                          std::cos(lat)*std::cos(decl)*std::cos(hourAngle * Pi/180.0);
+
+    return std::asin(sinElevation) * 180.0/Pi;
+}
+
+/* }}} */
+
+} // end namespace bench
+} // end namespace vetero
@@ -0,0 +1,119 @@
+/* {{{
+ * (c) 2022, Bernhard Walle <bernhard@bwalle.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>. }}}
+ */
+#ifndef VETERO_BENCH_SYNTHETICWEATHER_H_
+#define VETERO_BENCH_SYNTHETICWEATHER_H_
+
+#include <ctime>
+#include <random>
+
+#include "common/dataset.h"
+
+namespace vetero {
+namespace bench {
+
+/* SyntheticWeather {{{ */
+
+/**
+ * \class SyntheticWeather
+ * \brief Generates plausible weather data of a central European station
+ *
+ * The temperature follows an annual and a diurnal cycle with a day-to-day anomaly, the
+ * humidity is high at night and during rain, the wind is stronger during the day and gusty,
+ * rain falls in events of random duration and intensity, and the solar radiation follows the
+ * elevation of the sun, reduced by the cloudiness of the day. The pressure does a random walk
+ * around 1015 hPa.
+ *
+ * The data only depends on the seed, so two runs with the same parameters produce the same
+ * database. The values are returned in the units of the sensor, i.e. like they're received by
+ * veterod, including the rain gauge counter.
+ *
+ * \author Bernhard Walle <bernhard@bwalle.de>
+ * \ingroup bench
+ */
+class SyntheticWeather
+{
+    public:
+        /**
+         * \brief C'tor
+         *
+         * \param[in] sensorType the sensor type, only the values it supports are set
+         * \param[in] seed the seed of the random numbers
+         */
+        SyntheticWeather(const common::SensorType &sensorType, unsigned long seed);
+
+    public:
+        /**
+         * \brief Returns the data set of the next measurement
+         *
+         * \param[in] time the time of the measurement, must be later than the time of the
+         *            previous call
+         * \return the data set
+         */
+        common::Dataset next(time_t time);
+
+    protected:
+        /**
+         * \brief Chooses the cloudiness, the wind and the temperature anomaly of a new day
+         *
+         * \param[in] dayOfYear the day of the year, starting with 0
+         */
+        void startDay(int dayOfYear);
+
+        /**
+         * \brief Advances the rain event
+         *
+         * \param[in] seconds the time since the previous measurement
+         * \param[in] dayOfYear the day of the year, starting with 0
+         * \return the amount of rain in mm since the previous measurement
+         */
+        double advanceRain(double seconds, int dayOfYear);
+
+        /**
+         * \brief Computes the elevation of the sun
+         *
+         * \param[in] dayOfYear the day of the year, starting with 0
+         * \param[in] hour the local solar time in hours
+         * \return the elevation in degrees, negative at night
+         */
+        static double sunElevation(int dayOfYear, double hour);
+
+    private:
+        common::SensorType m_sensorType;
+        std::mt19937 m_random;
+        std::normal_distribution<double> m_normal;
+        std::uniform_real_distribution<double> m_uniform;
+
+        time_t m_lastTime;
+        int m_dayOfYear;
+        double m_anomaly;
+        double m_cloudiness;
+        double m_windMean;
+        double m_windDirection;
+        double m_pressure;
+        double m_noise;
+        double m_rainSeconds;
+        double m_rainIntensity;
+        double m_rainTicks;
+        int m_rainGauge;
+};
+
+/* }}} */
+
+} // end namespace bench
+} // end namespace vetero
+
+#endif // VETERO_BENCH_SYNTHETICWEATHER_H_
@@ -0,0 +1,561 @@
+/* {{{
+ * (c) 2022, Bernhard Walle <bernhard@bwalle.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>. }}}
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <memory>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <libbw/optionparser.h>
+#include <libbw/datetime.h>
+#include <libbw/log/errorlog.h>
+#include <libbw/log/debug.h>
+
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/prettywriter.h>
+
+#include "common/consoleprogress.h"
+#include "common/dbaccess.h"
+#include "common/outputfile.h"
+#include "common/stagetimer.h"
+#include "config.h"
+#include "vetero-reportgen/currentreportgenerator.h"
+#include "vetero-reportgen/dayreportgenerator.h"
+#include "vetero-reportgen/monthreportgenerator.h"
+#include "vetero-reportgen/yearreportgenerator.h"
+#include "vetero-reportgen/climatereportgenerator.h"
+#include "vetero-reportgen/indexgenerator.h"
+#include "syntheticweather.h"
+#include "veterobench.h"
+
+namespace vetero {
+namespace bench {
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+double millisecondsSince(const Clock::time_point &start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// fixed end of the synthetic data, so that the database doesn't depend on the date of the run
+const char DefaultEndDate[] = "2024-06-15";
+
+// parses a date in YYYY-MM-DD format, rejects dates like 2023-02-30
+bool parseDate(const std::string &date, struct tm *tm)
+{
+    struct tm parsed;
+    std::memset(&parsed, 0, sizeof(parsed));
+    const char *end = strptime(date.c_str(), "%Y-%m-%d", &parsed);
+    if (!end || *end != '\0')
+        return false;
+
+    struct tm normalized = parsed;
+    normalized.tm_isdst = -1;
+    if (std::mktime(&normalized) == -1 || normalized.tm_mday != parsed.tm_mday)
+        return false;
+
+    *tm = parsed;
+    return true;
+}
+
+// the element before the last one, i.e. the last complete day, month or year
+std::string lastComplete(const std::vector<std::string> &values)
+{
+    if (values.empty())
+        return std::string();
+
+    return values.size() > 1 ? values[values.size() - 2] : values.back();
+}
+
+} // anonymous namespace
+
+VeteroBench::VeteroBench()
+    : m_directory("vetero-bench")
+    , m_years(2)
+    , m_resolution(300)
+    , m_sensorTypeName("ws980")
+    , m_sensorType(common::SensorType::Ws980)
+    , m_seed(1)
+    , m_endDate(DefaultEndDate)
+    , m_renderer("native")
+    , m_concurrency(1)
+    , m_repeat(3)
+    , m_reuse(false)
+    , m_allReports(false)
+    , m_generated(false)
+    , m_rows(0)
+    , m_generateTime(0.0)
+    , m_statisticsTime(0.0)
+{}
+
+bool VeteroBench::parseCommandLine(int argc, char *argv[])
+{
+    bw::OptionGroup generalGroup("General Options");
+    generalGroup.addOption("help", 'h', bw::OT_FLAG,
+                           "Prints a help message and exits.");
+    generalGroup.addOption("version", 'v', bw::OT_FLAG,
+                           "Prints the version and exits.");
+
+    bw::OptionGroup loggingGroup("Logging Options");
+    loggingGroup.addOption("debug-logfile", 'D', bw::OT_STRING,
+                           "Don't log to the console, log in FILE instead");
+    loggingGroup.addOption("debug-loglevel", 'd', bw::OT_STRING,
+                           "Specify the loglevel ('none'*, 'info', 'debug', trace')");
+    loggingGroup.addOption("error-logfile", 'L', bw::OT_STRING,
+                            "Use the specified file for error logging. The special values "
+                            "'stderr', 'stdout' and 'syslog' are accepted.");
+
+    bw::OptionGroup databaseGroup("Database Options");
+    databaseGroup.addOption("directory", 'C', bw::OT_STRING,
+                            "Working directory for the database and the reports "
+                            "(default: vetero-bench).");
+    databaseGroup.addOption("years", 'y', bw::OT_INTEGER,
+                            "Generate data of the last N years (default: 2).");
+    databaseGroup.addOption("resolution", 'r', bw::OT_INTEGER,
+                            "Seconds between two data sets (default: 300).");
+    databaseGroup.addOption("sensor-type", 's', bw::OT_STRING,
+                            "Sensor type whose values are generated (default: ws980).");
+    databaseGroup.addOption("seed", 'S', bw::OT_INTEGER,
+                            "Seed of the random numbers (default: 1).");
+    databaseGroup.addOption("end-date", 'E', bw::OT_STRING,
+                            "Last day of the data, YYYY-MM-DD (default: " +
+                            std::string(DefaultEndDate) + ").");
+    databaseGroup.addOption("reuse", 'R', bw::OT_FLAG,
+                            "Use the database of the working directory if it exists.");
+
+    bw::OptionGroup benchmarkGroup("Benchmark Options");
+    benchmarkGroup.addOption("renderer", 'g', bw::OT_STRING,
+                             "Chart renderer: 'native'*, 'gnuplot' or 'client'.");
+    benchmarkGroup.addOption("jobs", 'j', bw::OT_INTEGER,
+                             "Generate up to N reports and diagrams in parallel (default: 1).");
+    benchmarkGroup.addOption("repeat", 'n', bw::OT_INTEGER,
+                             "Run each stage N times (default: 3).");
+    benchmarkGroup.addOption("all", 'a', bw::OT_FLAG,
+                             "Also generate the reports of all days, months and years.");
+    benchmarkGroup.addOption("output", 'o', bw::OT_STRING,
+                             "Write the results to FILE instead of stdout.");
+
+    bw::OptionParser op;
+    op.addOptions(generalGroup);
+    op.addOptions(loggingGroup);
+    op.addOptions(databaseGroup);
+    op.addOptions(benchmarkGroup);
+
+    // do the parsing
+    if (!op.parse(argc, argv))
+        return false;
+
+    // evaluate options
+    if (op.getValue("help").getFlag()) {
+        op.printHelp(std::cerr, "vetero-bench " GIT_VERSION);
+        return false;
+    } else if (op.getValue("version").getFlag()) {
+        std::cerr << "vetero-bench " << GIT_VERSION << std::endl;
+        return false;
+    }
+
+    // debug logging
+    std::string debugLoglevel("none");
+    std::string debugLogfile;
+    if (op.getValue("debug-loglevel"))
+        debugLoglevel = op.getValue("debug-loglevel").getString();
+    if (op.getValue("debug-logfile"))
+        debugLogfile = op.getValue("debug-logfile").getString();
+    setupDebugLogging(debugLoglevel, debugLogfile);
+
+    // error logging
+    std::string errorLogfile("stderr");
+    if (op.getValue("error-logfile"))
+        errorLogfile = op.getValue("error-logfile").getString();
+    setupErrorLogging(errorLogfile);
+
+    // database
+    if (op.getValue("directory"))
+        m_directory = op.getValue("directory").getString();
+    if (op.getValue("years")) {
+        m_years = op.getValue("years").getInteger();
+        if (m_years < 1)
+            throw common::ApplicationError("The number of years must be at least 1.");
+    }
+    if (op.getValue("resolution")) {
+        m_resolution = op.getValue("resolution").getInteger();
+        if (m_resolution < 1)
+            throw common::ApplicationError("The resolution must be at least 1 second.");
+    }
+    if (op.getValue("sensor-type")) {
+        m_sensorTypeName = op.getValue("sensor-type").getString();
+        m_sensorType = common::SensorType::fromString(m_sensorTypeName);
+        if (m_sensorType == common::SensorType::Invalid)
+            throw common::ApplicationError("Invalid sensor type '" + m_sensorTypeName + "'.");
+    }
+    if (op.getValue("seed"))
+        m_seed = op.getValue("seed").getInteger();
+    if (op.getValue("end-date")) {
+        m_endDate = op.getValue("end-date").getString();
+        struct tm tm;
+        if (!parseDate(m_endDate, &tm))
+            throw common::ApplicationError("Invalid end date '" + m_endDate + "'.");
+    }
+    if (op.getValue("reuse"))
+        m_reuse = op.getValue("reuse").getFlag();
+
+    // benchmark
+    if (op.getValue("renderer"))
+        m_renderer = op.getValue("renderer").getString();
+    if (op.getValue("jobs")) {
+        m_concurrency = op.getValue("jobs").getInteger();
+        if (m_concurrency < 1)
+            throw common::ApplicationError("The number of jobs must be at least 1.");
+    }
+    if (op.getValue("repeat")) {
+        m_repeat = op.getValue("repeat").getInteger();
+        if (m_repeat < 1)
+            throw common::ApplicationError("The number of runs must be at least 1.");
+    }
+    if (op.getValue("all"))
+        m_allReports = op.getValue("all").getFlag();
+    if (op.getValue("output"))
+        m_output = op.getValue("output").getString();
+
+    return true;
+}
+
+bool VeteroBench::exec()
+{
+    if (mkdir(m_directory.c_str(), 0755) != 0 && errno != EEXIST)
+        throw common::SystemError("Unable to create '" + m_directory + "'", errno);
+    if (mkdir((m_directory + "/reports").c_str(), 0755) != 0 && errno != EEXIST)
+        throw common::SystemError("Unable to create '" + m_directory + "/reports'", errno);
+
+    writeConfiguration();
+    setConfigfile(m_directory + "/vetero.conf");
+    setForce(true);
+    setConcurrency(m_concurrency);
+    readConfiguration();
+
+    if (!m_reuse || access(configuration().databasePath().c_str(), F_OK) != 0)
+        generateDatabase();
+
+    openDatabase();
+    initWatermarks();
+    runStages();
+
+    std::string json = results();
+    if (m_output.empty())
+        std::cout << json << std::endl;
+    else {
+        common::OutputFile output(m_output);
+        output.stream() << json << std::endl;
+        output.commit();
+    }
+
+    for (const Stage &stage : m_stages) {
+        if (!stage.error.empty())
+            return false;
+    }
+
+    return true;
+}
+
+void VeteroBench::writeConfiguration()
+{
+    common::OutputFile output(m_directory + "/vetero.conf");
+    output.stream() << "# generated by vetero-bench\n"
+                    << "sensor_type = \"" << m_sensorTypeName << "\"\n"
+                    << "database_path = \"" << m_directory << "/vetero.db\"\n"
+                    << "report_directory = \"" << m_directory << "/reports\"\n"
+                    << "report_chart_renderer = \"" << m_renderer << "\"\n"
+                    << "location_string = \"vetero-bench\"\n";
+    output.commit();
+}
+
+void VeteroBench::generateDatabase()
+{
+    std::string dbPath = configuration().databasePath();
+    const char *suffixes[] = { "", "-wal", "-shm" };
+    for (const char *suffix : suffixes)
+        std::remove((dbPath + suffix).c_str());
+
+    // from midnight m_years before the end date up to noon of the end date, so that the
+    // last day is incomplete like in a running installation
+    struct tm tm;
+    if (!parseDate(m_endDate, &tm))
+        throw common::ApplicationError("Invalid end date '" + m_endDate + "'.");
+    struct tm endTm = tm;
+    endTm.tm_hour = 12;
+    endTm.tm_isdst = -1;
+    time_t end = std::mktime(&endTm);
+    tm.tm_year -= m_years;
+    tm.tm_hour = tm.tm_min = tm.tm_sec = 0;
+    tm.tm_isdst = -1;
+    time_t start = std::mktime(&tm);
+
+    BW_DEBUG_INFO("Generating %d years of data up to %s with a resolution of %d s in '%s'",
+                  m_years, m_endDate.c_str(), m_resolution, dbPath.c_str());
+
+    common::Sqlite3Database db;
+    try {
+        db.open(dbPath, common::Sqlite3Database::FLAG_WAL);
+    } catch (const common::DatabaseError &err) {
+        throw common::ApplicationError("Unable to create DB: " + std::string(err.what()) );
+    }
+
+    std::unique_ptr<common::ConsoleProgress> progressNotifier;
+    if (isatty(STDOUT_FILENO))
+        progressNotifier.reset(new common::ConsoleProgress("Weather data"));
+
+    try {
+        common::DbAccess dbAccess(&db);
+        dbAccess.initTables();
+
+        SyntheticWeather weather(m_sensorType, m_seed);
+        std::unique_ptr<common::Transaction> transaction;
+        std::string currentDay;
+        int rainValue;
+        m_rows = 0;
+
+        Clock::time_point begin = Clock::now();
+        for (time_t time = start; time <= end; time += m_resolution) {
+            common::Dataset dataset = weather.next(time);
+            std::string day = dataset.timestamp().strftime("%Y-%m-%d");
+
+            // one transaction and one update of the statistics per day
+            if (day != currentDay) {
+                if (transaction) {
+                    dbAccess.updateDayStatistics(currentDay);
+                    transaction->commit();
+                }
+                if (progressNotifier)
+                    progressNotifier->progressed(end - start, time - start);
+
+                transaction.reset(new common::Transaction(db));
+                currentDay = day;
+            }
+
+            dbAccess.insertDataset(dataset, rainValue);
+            m_rows++;
+        }
+        if (transaction) {
+            dbAccess.updateDayStatistics(currentDay);
+            transaction->commit();
+        }
+        m_generateTime = millisecondsSince(begin);
+
+        if (progressNotifier) {
+            progressNotifier->reset("Statistics");
+            dbAccess.setProgressNotifier(progressNotifier.get());
+        }
+
+        begin = Clock::now();
+        dbAccess.updateMonthStatistics();
+        dbAccess.updateClimateNormals();
+        m_statisticsTime = millisecondsSince(begin);
+    } catch (const common::DatabaseError &err) {
+        throw common::ApplicationError("Unable to fill DB: " + std::string(err.what()) );
+    }
+
+    m_generated = true;
+}
+
+void VeteroBench::runStage(const std::string &name, const std::string &argument,
+                           const std::function<void ()> &generate)
+{
+    Stage stage;
+    stage.name = name;
+    stage.argument = argument;
+    stage.stages.assign(common::StageTimes::StageCount, 0.0);
+
+    BW_DEBUG_INFO("Running stage '%s' %s", name.c_str(), argument.c_str());
+
+    for (int i = 0; i < m_repeat; i++) {
+        common::StageTimes times;
+        common::StageTimes::Scope scope(&times);
+
+        Clock::time_point begin = Clock::now();
+        try {
+            generate();
+        } catch (const common::ApplicationError &err) {
+            BW_ERROR_ERR("Stage '%s' failed: %s", name.c_str(), err.what());
+            stage.error = err.what();
+            break;
+        }
+        stage.runs.push_back(millisecondsSince(begin));
+
+        for (int s = 0; s < common::StageTimes::StageCount; ++s)
+            stage.stages[s] += times.milliseconds(static_cast<common::StageTimes::Stage>(s)) / m_repeat;
+    }
+
+    m_stages.push_back(stage);
+}
+
+void VeteroBench::runStages()
+{
+    common::DbAccess dbAccess(&database());
+    std::string day = lastComplete(dbAccess.dataDays());
+    std::string month = lastComplete(dbAccess.dataMonths());
+    std::string year = lastComplete(dbAccess.dataYears());
+
+    startJobs();
+
+    runStage("current", "", [this]() {
+        reportgen::CurrentReportGenerator(this).generateReports();
+    });
+    runStage("day", day, [this, day]() {
+        reportgen::DayReportGenerator(this, day).generateReports();
+    });
+    runStage("month", month, [this, month]() {
+        reportgen::MonthReportGenerator(this, month).generateReports();
+    });
+    runStage("year", year, [this, year]() {
+        reportgen::YearReportGenerator(this, year).generateReports();
+    });
+    runStage("climate", "", [this]() {
+        reportgen::ClimateReportGenerator(this).generateReports();
+    });
+    runStage("index", "", [this]() {
+        reportgen::IndexGenerator(this).generateReports();
+    });
+
+    if (m_allReports) {
+        runStage("all-days", "", [this]() {
+            reportgen::DayReportGenerator(this, "").generateReports();
+        });
+        runStage("all-months", "", [this]() {
+            reportgen::MonthReportGenerator(this, "").generateReports();
+        });
+        runStage("all-years", "", [this]() {
+            reportgen::YearReportGenerator(this, "").generateReports();
+        });
+    }
+
+    finishJobs();
+}
+
+std::string VeteroBench::results() const
+{
+    namespace json = rapidjson;
+
+    json::StringBuffer s;
+    json::PrettyWriter<json::StringBuffer> writer(s);
+
+    writer.StartObject();
+
+    writer.Key("version");
+    writer.String(GIT_VERSION);
+    writer.Key("date");
+    writer.String(bw::Datetime::now().strftime("%Y-%m-%d %H:%M:%S").c_str());
+
+    writer.Key("parameters");
+    writer.StartObject();
+    writer.Key("years");
+    writer.Int(m_years);
+    writer.Key("resolution");
+    writer.Int(m_resolution);
+    writer.Key("sensor_type");
+    writer.String(m_sensorTypeName.c_str());
+    writer.Key("seed");
+    writer.Uint64(m_seed);
+    writer.Key("end_date");
+    writer.String(m_endDate.c_str());
+    writer.Key("renderer");
+    writer.String(m_renderer.c_str());
+    writer.Key("jobs");
+    writer.Int(m_concurrency);
+    writer.Key("repeat");
+    writer.Int(m_repeat);
+    writer.EndObject();
+
+    writer.Key("database");
+    writer.StartObject();
+    writer.Key("generated");
+    writer.Bool(m_generated);
+    if (m_generated) {
+        writer.Key("rows");
+        writer.Int64(m_rows);
+        writer.Key("generate_ms");
+        writer.Double(m_generateTime);
+        writer.Key("statistics_ms");
+        writer.Double(m_statisticsTime);
+    }
+    struct stat st;
+    if (stat(configuration().databasePath().c_str(), &st) == 0) {
+        writer.Key("size");
+        writer.Int64(st.st_size);
+    }
+    writer.EndObject();
+
+    writer.Key("stages");
+    writer.StartArray();
+    for (const Stage &stage : m_stages) {
+        writer.StartObject();
+        writer.Key("name");
+        writer.String(stage.name.c_str());
+        if (!stage.argument.empty()) {
+            writer.Key("argument");
+            writer.String(stage.argument.c_str());
+        }
+
+        writer.Key("runs_ms");
+        writer.StartArray();
+        for (double run : stage.runs)
+            writer.Double(run);
+        writer.EndArray();
+
+        if (!stage.runs.empty()) {
+            std::vector<double> sorted(stage.runs);
+            std::sort(sorted.begin(), sorted.end());
+            writer.Key("min_ms");
+            writer.Double(sorted.front());
+            writer.Key("median_ms");
+            writer.Double(sorted[sorted.size() / 2]);
+            writer.Key("max_ms");
+            writer.Double(sorted.back());
+        }
+
+        writer.Key("stages_ms");
+        writer.StartObject();
+        for (int s = 0; s < common::StageTimes::StageCount; ++s) {
+            writer.Key(common::StageTimes::stageName(static_cast<common::StageTimes::Stage>(s)));
+            writer.Double(stage.stages[s]);
+        }
+        writer.EndObject();
+
+        if (!stage.error.empty()) {
+            writer.Key("error");
+            writer.String(stage.error.c_str());
+        }
+        writer.EndObject();
+    }
+    writer.EndArray();
+
+    writer.EndObject();
+
+    return s.GetString();
+}
+
+} // end namespace bench
+} // end namespace vetero
@@ -0,0 +1,158 @@
+/* {{{
+ * (c) 2022, Bernhard Walle <bernhard@bwalle.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>. }}}
+ */
+#ifndef VETERO_BENCH_VETEROBENCH_H_
+#define VETERO_BENCH_VETEROBENCH_H_
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "common/dataset.h"
+#include "vetero-reportgen/vetero_reportgen.h"
+
+namespace vetero {
+namespace bench {
+
+/**
+ * \class VeteroBench
+ * \brief Benchmark of the report generation
+ *
+ * Creates a database with synthetic data of a configurable number of years, resolution and
+ * sensor type (see SyntheticWeather) and measures the time of each report generator on it.
+ * The results are written as JSON, so that runs of different versions can be compared.
+ *
+ * The database, the configuration file and the reports are written to a working directory.
+ * With the same parameters, the database is identical in each run.
+ *
+ * \author Bernhard Walle <bernhard@bwalle.de>
+ * \ingroup bench
+ */
+class VeteroBench : public reportgen::VeteroReportgen
+{
+    public:
+        /**
+         * \brief Constructor
+         */
+        VeteroBench();
+
+    public:
+        /**
+         * \brief Parse the command line
+         *
+         * \param[in] argc the number of arguments
+         * \param[in] argv the arguments
+         * \return \c true if the application should be continued,
+         *         \c false if the application should be quit
+         * \exception ApplicationError if parsing the command line failed.
+         */
+        bool parseCommandLine(int argc, char *argv[]);
+
+        /**
+         * \brief Runs the benchmark
+         *
+         * Creates the working directory, the configuration and the database (unless it
+         * is reused), runs all stages and writes the results.
+         *
+         * \return \c true if all stages succeeded
+         * \exception common::ApplicationError if the database cannot be created or the results
+         *            cannot be written
+         */
+        bool exec();
+
+    protected:
+        /**
+         * \brief Result of a stage
+         */
+        struct Stage {
+            std::string name;               ///< the name like <tt>"day"</tt>
+            std::string argument;           ///< the day, month or year of the report
+            std::vector<double> runs;       ///< the duration of each run in milliseconds
+            std::vector<double> stages;     ///< the mean time of each common::StageTimes::Stage
+            std::string error;              ///< the error message if the stage failed
+        };
+
+        /**
+         * \brief Writes the configuration file of the working directory
+         *
+         * \exception common::ApplicationError if the file cannot be written
+         */
+        void writeConfiguration();
+
+        /**
+         * \brief Creates the database with synthetic data
+         *
+         * Inserts the data of <tt>--years</tt> up to noon of <tt>--end-date</tt> like veterod,
+         * one transaction per day, and computes the statistics and the climate normals
+         * afterwards.
+         *
+         * \exception common::ApplicationError if the database cannot be created
+         */
+        void generateDatabase();
+
+        /**
+         * \brief Measures a stage
+         *
+         * Runs \p generate as often as specified with <tt>--repeat</tt>. If it throws an
+         * common::ApplicationError, the stage is aborted and the error is recorded. Besides
+         * the total time, the time spent in queries, plotting etc. is recorded, see
+         * common::StageTimes.
+         *
+         * \param[in] name the name of the stage
+         * \param[in] argument the day, month or year of the report, may be empty
+         * \param[in] generate function that runs the generator
+         */
+        void runStage(const std::string &name, const std::string &argument,
+                      const std::function<void ()> &generate);
+
+        /**
+         * \brief Runs all stages
+         */
+        void runStages();
+
+        /**
+         * \brief Returns the JSON document with the results
+         *
+         * \return the document
+         */
+        std::string results() const;
+
+    private:
+        std::string m_directory;
+        std::string m_output;
+        int m_years;
+        int m_resolution;
+        std::string m_sensorTypeName;
+        common::SensorType m_sensorType;
+        unsigned long m_seed;
+        std::string m_endDate;
+        std::string m_renderer;
+        int m_concurrency;
+        int m_repeat;
+        bool m_reuse;
+        bool m_allReports;
+
+        bool m_generated;
+        long m_rows;
+        double m_generateTime;
+        double m_statisticsTime;
+        std::vector<Stage> m_stages;
+};
+
+} // end namespace bench
+} // end namespace vetero
+
+#endif // VETERO_BENCH_VETEROBENCH_H_
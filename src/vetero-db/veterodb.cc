@@ -65,6 +65,11 @@ bool VeteroDb::parseCommandLine(int argc, char *argv[])
                  "Print the output machine-readable.");
     op.addOption("regenerate-metadata", 'M', bw::OT_FLAG,
                  "Regenerate all cached values in the database. This may take some time.");
+    op.addOption("upgrade-schema", 'U', bw::OT_FLAG,
+                 "Upgrade the database schema to the current revision including all data migrations.");
+    op.addOption("percentiles", 'p', bw::OT_STRING,
+                 "Print the percentiles of temperature and wind of a day (YYYY-MM-DD), "
+                 "month (YYYY-MM) or year (YYYY).");
 
     // do the parsing
     if (!op.parse(argc, argv))
@@ -90,6 +95,12 @@ bool VeteroDb::parseCommandLine(int argc, char *argv[])
     // actions
     if (op.getValue("regenerate-metadata"))
         m_action = RegenerateMetadata;
+    else if (op.getValue("upgrade-schema"))
+        m_action = UpgradeSchema;
+    else if (op.getValue("percentiles")) {
+        m_action = ShowPercentiles;
+        m_period = op.getValue("percentiles").getString();
+    }
 
     // database path
     if (op.getValue("database"))
@@ -136,6 +147,68 @@ void VeteroDb::execRegenerateMetadata()
     if (showProgress)
         progressNotifier->reset("Month statistics");
     dbAccess.updateMonthStatistics();
+
+    if (showProgress)
+        progressNotifier->reset("Climate normals");
+    dbAccess.updateClimateNormals();
+}
+
+void VeteroDb::execUpgradeSchema()
+{
+    common::DbAccess dbAccess(&m_database);
+
+    int revision = dbAccess.schemaRevision();
+    if (dbAccess.upgradeSchema())
+        BW_DEBUG_INFO("Upgraded database schema from revision %d to %d.",
+                      revision, common::DbAccess::CurrentSchemaRevision);
+
+    std::unique_ptr<common::ConsoleProgress> progressNotifier;
+    if (isatty(STDIN_FILENO)) {
+        progressNotifier.reset(new common::ConsoleProgress("Data migration"));
+        dbAccess.setProgressNotifier(progressNotifier.get());
+    }
+
+    dbAccess.continueMigration();
+}
+
+void VeteroDb::execPercentiles()
+{
+    // days have their own sketches, the sketches of months and years are merged
+    std::string source;
+    if (m_period.size() == 10)
+        source = "day_statistics WHERE date = ?";
+    else if (m_period.size() == 7)
+        source = "month_statistics WHERE month = ?";
+    else if (m_period.size() == 4)
+        source = "month_statistics WHERE SUBSTR(month, 1, 4) = ?";
+    else
+        throw common::ApplicationError("Invalid period '" + m_period + "', use YYYY-MM-DD, YYYY-MM or YYYY.");
+
+    std::string sql;
+    const char *values[][2] = {
+        { "temperature", "temp_sketch" },
+        { "wind",        "wind_sketch" },
+        { "wind_gust",   "wind_gust_sketch" }
+    };
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); ++i) {
+        if (!sql.empty())
+            sql += " UNION ALL ";
+        sql += std::string() +
+            "SELECT '" + values[i][0] + "' AS value, "
+            "       ROUND(VETERO_QUANTILE(sketch, 0.05)/100.0, 1) AS p5, "
+            "       ROUND(VETERO_QUANTILE(sketch, 0.10)/100.0, 1) AS p10, "
+            "       ROUND(VETERO_QUANTILE(sketch, 0.50)/100.0, 1) AS median, "
+            "       ROUND(VETERO_QUANTILE(sketch, 0.90)/100.0, 1) AS p90, "
+            "       ROUND(VETERO_QUANTILE(sketch, 0.95)/100.0, 1) AS p95 "
+            "FROM   (SELECT VETERO_SKETCH_MERGE(" + values[i][1] + ") AS sketch "
+            "        FROM   " + source + ")";
+    }
+
+    // each part of the UNION has its own placeholder
+    common::Database::Result result = m_database.executeSqlQuery(
+        sql.c_str(), m_period.c_str(), m_period.c_str(), m_period.c_str()
+    );
+    printResult(result);
 }
 
 void VeteroDb::execSql()
@@ -229,7 +302,11 @@ void VeteroDb::printResultMachineReadable(const common::Database::Result &result
 void VeteroDb::runSqlStatement(const std::string &stmt)
 {
     common::Database::Result result = m_database.executeSqlQuery("%s", stmt.c_str());
+    printResult(result);
+}
 
+void VeteroDb::printResult(const common::Database::Result &result)
+{
     if (result.data.empty())
         return;
 
@@ -260,6 +337,10 @@ void VeteroDb::exec()
             execRegenerateMetadata();
             break;
 
+        case UpgradeSchema:
+            execUpgradeSchema();
+            break;
+
         case InteractiveSql:
             execInteractiveSql();
             break;
@@ -268,6 +349,10 @@ void VeteroDb::exec()
             execSql();
             break;
 
+        case ShowPercentiles:
+            execPercentiles();
+            break;
+
         default:
             throw common::ApplicationError("No action specified.");
     }
@@ -30,6 +30,8 @@ public:
         NoAction,
         ExecuteSql,
         RegenerateMetadata,
+        UpgradeSchema,
+        ShowPercentiles,
         InteractiveSql
     };
 
@@ -40,14 +42,18 @@ public:
 
 private:
     void execRegenerateMetadata();
+    void execUpgradeSchema();
+    void execPercentiles();
     void execSql();
     void execInteractiveSql();
     void runSqlStatement(const std::string &stmt);
+    void printResult(const common::Database::Result &result);
     void printResultPretty(const common::Database::Result &result);
     void printResultMachineReadable(const common::Database::Result &result);
 
 private:
     std::string m_sql;
+    std::string m_period;
     Action m_action;
     std::string m_dbPath;
     bool m_machineReadable;
@@ -19,16 +19,24 @@
 #include <sstream>
 #include <csignal>
 #include <cstdio>
+#include <cmath>
+#include <cstring>
+
+#include <poll.h>
+#include <unistd.h>
 
 #include <libbw/optionparser.h>
 #include <libbw/log/errorlog.h>
 #include <libbw/log/debug.h>
 #include <libbw/os.h>
 
+#include <rapidjson/document.h>
+
 #include "common/dbaccess.h"
 #include "common/error.h"
 #include "common/dataset.h"
 #include "common/translation.h"
+#include "common/utils.h"
 #include "vetero_displayd.h"
 #include "config.h"
 
@@ -48,6 +56,60 @@ static void veterodisplayd_sighandler(int signal)
 static void veterodisplayd_sigusr1_sighandler(int signal)
 {}
 
+/* }}} */
+/* Live feed {{{ */
+
+namespace {
+
+// the values of the live feed are real numbers, CurrentWeather stores them as integers
+bool feedValue(const rapidjson::Value &object, const char *name, double factor, int &value)
+{
+    rapidjson::Value::ConstMemberIterator it = object.FindMember(name);
+    if (it == object.MemberEnd() || !it->value.IsNumber())
+        return false;
+
+    value = static_cast<int>(std::lround(it->value.GetDouble() * factor));
+    return true;
+}
+
+bool parseFeedMessage(const std::string &line, common::CurrentWeather &weather)
+{
+    rapidjson::Document document;
+    document.Parse(line.c_str());
+    if (document.HasParseError() || !document.IsObject())
+        return false;
+
+    rapidjson::Value::ConstMemberIterator current = document.FindMember("current");
+    if (current == document.MemberEnd() || !current->value.IsObject())
+        return false;
+
+    const rapidjson::Value &object = current->value;
+    int value;
+
+    if (feedValue(object, "temperature", 100, value))
+        weather.setTemperature(value);
+    if (feedValue(object, "temperature_min", 100, value))
+        weather.setMinTemperature(value);
+    if (feedValue(object, "temperature_max", 100, value))
+        weather.setMaxTemperature(value);
+    if (feedValue(object, "humidity", 100, value))
+        weather.setHumidity(value);
+    if (feedValue(object, "dewpoint", 100, value))
+        weather.setDewpoint(value);
+    if (feedValue(object, "wind_speed", 100, value))
+        weather.setWindSpeed(value);
+    if (feedValue(object, "wind_speed_max", 100, value))
+        weather.setMaxWindSpeed(value);
+    if (feedValue(object, "rain", 1000, value))
+        weather.setRain(value);
+    if (feedValue(object, "pressure", 100, value))
+        weather.setPressure(value);
+
+    return true;
+}
+
+} // anonymous namespace
+
 /* }}} */
 /* VeteroDisplayd {{{ */
 
@@ -145,6 +207,10 @@ void VeteroDisplayd::readConfiguration()
 
 void VeteroDisplayd::openDatabase()
 {
+    // the data comes from veterod then
+    if (!m_configuration->feedSocket().empty())
+        return;
+
     try {
         m_database.open(m_configuration->databasePath(), common::Sqlite3Database::FLAG_READONLY);
     } catch (const vetero::common::DatabaseError &err) {
@@ -214,6 +280,16 @@ void VeteroDisplayd::updateDisplay(const common::CurrentWeather &weather)
 }
 
 void VeteroDisplayd::exec()
+{
+    if (!m_configuration->feedSocket().empty())
+        execSubscriber();
+    else
+        execPolling();
+
+    BW_DEBUG_INFO("Shutting down vetero-displayd");
+}
+
+void VeteroDisplayd::execPolling()
 {
     common::DbAccess dbAccess(&m_database);
 
@@ -250,8 +326,63 @@ void VeteroDisplayd::exec()
 
         new_data = true;
     }
+}
 
-    BW_DEBUG_INFO("Shutting down vetero-displayd");
+void VeteroDisplayd::execSubscriber()
+{
+    const std::string path = m_configuration->feedSocket();
+    const int timeout = 2000; // ms
+
+    while (!s_quit) {
+        int fd;
+        try {
+            fd = common::connect_unix(path);
+        } catch (const common::ApplicationError &err) {
+            // veterod is not running yet or has been restarted
+            BW_DEBUG_DBG("Unable to subscribe to the live feed: %s", err.what());
+            sleep(timeout / 1000);
+            continue;
+        }
+
+        BW_DEBUG_INFO("Subscribed to the live feed '%s'", path.c_str());
+
+        std::string buffer;
+        while (!s_quit) {
+            struct pollfd pfd = { fd, POLLIN, 0 };
+            int ret = poll(&pfd, 1, timeout);
+            if (ret < 0 && errno != EINTR)
+                throw common::SystemError("Problem when waiting for the live feed", errno);
+            if (ret <= 0)
+                continue;
+
+            char data[4096];
+            ssize_t len = read(fd, data, sizeof(data));
+            if (len < 0 && errno == EINTR)
+                continue;
+            if (len <= 0) {
+                BW_ERROR_WARNING("Live feed '%s' closed by veterod", path.c_str());
+                break;
+            }
+            buffer.append(data, len);
+
+            // only the newest complete message matters
+            std::string::size_type end = buffer.rfind('\n');
+            if (end == std::string::npos)
+                continue;
+            std::string::size_type begin = end == 0 ? std::string::npos : buffer.rfind('\n', end - 1);
+            begin = (begin == std::string::npos) ? 0 : begin + 1;
+
+            common::CurrentWeather weather;
+            if (parseFeedMessage(buffer.substr(begin, end - begin), weather))
+                updateDisplay(weather);
+            else
+                BW_ERROR_WARNING("Invalid message from the live feed");
+
+            buffer.erase(0, end + 1);
+        }
+
+        close(fd);
+    }
 }
 
 /* }}} */
@@ -88,7 +88,8 @@ class VeteroDisplayd : public common::VeteroApplication
          * \brief Opens the database connection
          *
          * Opens the database as specified on the command line. If it doesn't exist, the database
-         * will be created.
+         * will be created. Does nothing if <tt>feed_socket</tt> is set since the data comes
+         * from veterod then.
          *
          * \exception common::ApplicationError if it's not possible to create the database.
          */
@@ -106,11 +107,30 @@ class VeteroDisplayd : public common::VeteroApplication
         /**
          * \brief Main loop of the application
          *
-         * This is the main part of the application.
+         * This is the main part of the application. Subscribes to the live feed of veterod
+         * if <tt>feed_socket</tt> is set, else reads the database each time veterod sends
+         * \c SIGUSR1.
          */
         void exec();
 
     protected:
+        /**
+         * \brief Reads the current weather from the database on each \c SIGUSR1
+         *
+         * \exception common::SystemError if waiting for the signal fails
+         */
+        void execPolling();
+
+        /**
+         * \brief Displays the current weather of each message of the live feed
+         *
+         * Reconnects if veterod closes the connection. Only the newest message of the
+         * received data is displayed.
+         *
+         * \exception common::SystemError if waiting for the data fails
+         */
+        void execSubscriber();
+
         /**
          * \brief Updates the contents of the display
          *
@@ -0,0 +1,867 @@
+/* {{{
+ * (c) 2022, Bernhard Walle <bernhard@bwalle.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>. }}}
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <vector>
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <libbw/stringutil.h>
+#include <libbw/log/debug.h>
+#include <libbw/log/errorlog.h>
+
+#include "common/utils.h"
+#include "config.h"
+#include "httpserver.h"
+
+namespace vetero {
+namespace httpd {
+
+/* Helper functions {{{ */
+
+namespace {
+
+const char *statusText(int status)
+{
+    switch (status) {
+        case 200: return "OK";
+        case 301: return "Moved Permanently";
+        case 304: return "Not Modified";
+        case 400: return "Bad Request";
+        case 403: return "Forbidden";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        case 431: return "Request Header Fields Too Large";
+        default:  return "Internal Server Error";
+    }
+}
+
+std::string lower(std::string str)
+{
+    std::transform(str.begin(), str.end(), str.begin(), ::tolower);
+    return str;
+}
+
+bool endsWith(const std::string &str, const std::string &suffix)
+{
+    return str.size() >= suffix.size() &&
+           str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+std::string trim(const std::string &str)
+{
+    size_t begin = str.find_first_not_of(" \t");
+    if (begin == std::string::npos)
+        return std::string();
+    size_t end = str.find_last_not_of(" \t");
+    return str.substr(begin, end - begin + 1);
+}
+
+// splits a comma-separated header value like "gzip;q=1.0, identity"
+std::vector<std::string> headerTokens(const std::string &value)
+{
+    std::vector<std::string> tokens;
+    size_t begin = 0;
+    while (begin <= value.size()) {
+        size_t end = value.find(',', begin);
+        if (end == std::string::npos)
+            end = value.size();
+        std::string token = trim(value.substr(begin, end - begin));
+        if (!token.empty())
+            tokens.push_back(token);
+        begin = end + 1;
+    }
+    return tokens;
+}
+
+bool headerContains(const std::string &value, const std::string &token)
+{
+    for (const std::string &t : headerTokens(value))
+        if (lower(t) == token)
+            return true;
+    return false;
+}
+
+// true if Accept-Encoding allows gzip, "gzip;q=0" forbids it
+bool acceptsGzip(const std::string &acceptEncoding)
+{
+    for (const std::string &token : headerTokens(acceptEncoding)) {
+        std::string coding = lower(trim(token.substr(0, token.find(';'))));
+        if (coding != "gzip" && coding != "x-gzip" && coding != "*")
+            continue;
+
+        size_t q = token.find("q=");
+        if (q != std::string::npos && std::strtod(token.c_str() + q + 2, NULL) <= 0.0)
+            return false;
+        return true;
+    }
+    return false;
+}
+
+bool etagMatches(const std::string &ifNoneMatch, const std::string &etag)
+{
+    for (std::string tag : headerTokens(ifNoneMatch)) {
+        if (tag == "*")
+            return true;
+        // the weak comparison is sufficient for a conditional GET
+        if (bw::startsWith(tag, "W/"))
+            tag.erase(0, 2);
+        if (tag == etag)
+            return true;
+    }
+    return false;
+}
+
+bool isGzip(int fd)
+{
+    unsigned char magic[2];
+    return pread(fd, magic, sizeof(magic), 0) == sizeof(magic) &&
+           magic[0] == 0x1f && magic[1] == 0x8b;
+}
+
+int hexDigit(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    c = ::tolower(c);
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    return -1;
+}
+
+} // anonymous namespace
+
+/* }}} */
+/* HttpServer {{{ */
+
+const size_t HttpServer::MaxRequestSize;
+const size_t HttpServer::MaxConnections;
+const int HttpServer::IdleTimeout;
+
+HttpServer::HttpServer(const std::string &documentRoot)
+    : m_documentRoot(documentRoot)
+    , m_listenFd(-1)
+    , m_epollFd(-1)
+{
+    while (m_documentRoot.size() > 1 && endsWith(m_documentRoot, "/"))
+        m_documentRoot.erase(m_documentRoot.size() - 1);
+
+    m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (m_epollFd < 0)
+        throw common::SystemError("Unable to create the epoll instance", errno);
+}
+
+HttpServer::~HttpServer()
+{
+    while (!m_connections.empty())
+        closeConnection(m_connections.begin()->first);
+
+    if (m_listenFd >= 0)
+        close(m_listenFd);
+    close(m_epollFd);
+}
+
+void HttpServer::listen(const std::string &address, int port)
+{
+    struct addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+
+    struct addrinfo *result;
+    std::string service = bw::str(port);
+    int err = getaddrinfo(address.empty() ? NULL : address.c_str(), service.c_str(), &hints, &result);
+    if (err != 0)
+        throw common::ApplicationError("Unable to resolve '" + address + "': " + gai_strerror(err));
+
+    // prefer IPv6 for the wildcard address, it accepts IPv4 connections as well
+    std::vector<struct addrinfo *> candidates;
+    for (struct addrinfo *ai = result; ai; ai = ai->ai_next)
+        if (ai->ai_family == AF_INET6)
+            candidates.push_back(ai);
+    for (struct addrinfo *ai = result; ai; ai = ai->ai_next)
+        if (ai->ai_family != AF_INET6)
+            candidates.push_back(ai);
+
+    int lastError = EADDRNOTAVAIL;
+    for (struct addrinfo *ai : candidates) {
+        int fd = socket(ai->ai_family, ai->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, ai->ai_protocol);
+        if (fd < 0) {
+            lastError = errno;
+            continue;
+        }
+
+        int on = 1, off = 0;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        if (ai->ai_family == AF_INET6)
+            setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &off, sizeof(off));
+
+        if (bind(fd, ai->ai_addr, ai->ai_addrlen) == 0 && ::listen(fd, SOMAXCONN) == 0) {
+            m_listenFd = fd;
+            break;
+        }
+
+        lastError = errno;
+        close(fd);
+    }
+    freeaddrinfo(result);
+
+    if (m_listenFd < 0)
+        throw common::SystemError("Unable to listen on port " + service, lastError);
+
+    struct epoll_event event;
+    std::memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.fd = m_listenFd;
+    if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_listenFd, &event) < 0)
+        throw common::SystemError("Unable to add the listening socket to epoll", errno);
+
+    BW_DEBUG_INFO("Serving '%s' on port %d", m_documentRoot.c_str(), port);
+}
+
+void HttpServer::run()
+{
+    const int maxEvents = 64;
+    struct epoll_event events[maxEvents];
+    Clock::time_point lastExpiry = Clock::now();
+
+    while (true) {
+        int count = epoll_wait(m_epollFd, events, maxEvents, 1000);
+        if (count < 0) {
+            if (errno == EINTR)
+                continue;
+            throw common::SystemError("epoll_wait() failed", errno);
+        }
+
+        for (int i = 0; i < count; i++) {
+            int fd = events[i].data.fd;
+            if (fd == m_listenFd) {
+                acceptConnections();
+                continue;
+            }
+
+            // the connection may have been closed by a previous event
+            auto it = m_connections.find(fd);
+            if (it == m_connections.end())
+                continue;
+            Connection &connection = *it->second;
+
+            if (events[i].events & (EPOLLERR | EPOLLHUP))
+                closeConnection(fd);
+            else if (events[i].events & EPOLLOUT)
+                processRequests(connection);
+            else if (events[i].events & EPOLLIN)
+                handleInput(connection);
+        }
+
+        Clock::time_point now = Clock::now();
+        if (now - lastExpiry >= std::chrono::seconds(1)) {
+            expireConnections();
+            lastExpiry = now;
+        }
+    }
+}
+
+void HttpServer::acceptConnections()
+{
+    while (true) {
+        int fd = accept4(m_listenFd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                BW_ERROR_WARNING("Unable to accept connection: %s", std::strerror(errno));
+            return;
+        }
+
+        if (m_connections.size() >= MaxConnections) {
+            BW_DEBUG_DBG("Too many connections, refusing a connection");
+            close(fd);
+            continue;
+        }
+
+        struct epoll_event event;
+        std::memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, fd, &event) < 0) {
+            BW_ERROR_WARNING("Unable to add connection to epoll: %s", std::strerror(errno));
+            close(fd);
+            continue;
+        }
+
+        std::unique_ptr<Connection> connection(new Connection);
+        connection->fd = fd;
+        connection->outputOffset = 0;
+        connection->fileFd = -1;
+        connection->fileOffset = 0;
+        connection->fileSize = 0;
+        connection->keepAlive = true;
+        connection->head = false;
+        connection->writing = false;
+        connection->lastActivity = Clock::now();
+        m_connections[fd] = std::move(connection);
+    }
+}
+
+bool HttpServer::handleInput(Connection &connection)
+{
+    // level-triggered: if more data is pending, epoll reports the socket again
+    char buffer[16384];
+    ssize_t len = recv(connection.fd, buffer, sizeof(buffer), 0);
+    if (len < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+            return true;
+        closeConnection(connection.fd);
+        return false;
+    } else if (len == 0) {
+        closeConnection(connection.fd);
+        return false;
+    }
+
+    connection.input.append(buffer, len);
+    connection.lastActivity = Clock::now();
+
+    return processRequests(connection);
+}
+
+bool HttpServer::processRequests(Connection &connection)
+{
+    while (true) {
+        if (!flush(connection))
+            return false;
+
+        // continued when the socket is writable again, see flush()
+        if (connection.writing)
+            return true;
+
+        size_t end = connection.input.find("\r\n\r\n");
+        if (end == std::string::npos && connection.input.size() <= MaxRequestSize)
+            return true;
+
+        if (end == std::string::npos || end > MaxRequestSize) {
+            connection.keepAlive = false;
+            connection.head = false;
+            respondStatus(connection, 431);
+            continue;
+        }
+
+        std::string header = connection.input.substr(0, end);
+        connection.input.erase(0, end + 4);
+
+        Request request;
+        if (!parseRequest(header, request)) {
+            connection.keepAlive = false;
+            connection.head = false;
+            respondStatus(connection, 400);
+            continue;
+        }
+
+        respond(connection, request);
+    }
+}
+
+bool HttpServer::flush(Connection &connection)
+{
+    while (connection.outputOffset < connection.output.size()) {
+        // MSG_MORE puts the headers and the beginning of the file into one segment
+        int flags = MSG_NOSIGNAL;
+        if (connection.fileFd >= 0)
+            flags |= MSG_MORE;
+
+        ssize_t len = send(connection.fd, connection.output.data() + connection.outputOffset,
+                           connection.output.size() - connection.outputOffset, flags);
+        if (len < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                setWritable(connection, true);
+                return true;
+            }
+            closeConnection(connection.fd);
+            return false;
+        }
+
+        connection.outputOffset += len;
+        connection.lastActivity = Clock::now();
+    }
+    connection.output.clear();
+    connection.outputOffset = 0;
+
+    while (connection.fileFd >= 0 && connection.fileOffset < connection.fileSize) {
+        ssize_t len = sendfile(connection.fd, connection.fileFd, &connection.fileOffset,
+                               connection.fileSize - connection.fileOffset);
+        if (len < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                setWritable(connection, true);
+                return true;
+            }
+        }
+
+        // the file has been truncated, the announced Content-Length cannot be kept
+        if (len <= 0) {
+            closeConnection(connection.fd);
+            return false;
+        }
+
+        connection.lastActivity = Clock::now();
+    }
+
+    if (connection.fileFd >= 0) {
+        close(connection.fileFd);
+        connection.fileFd = -1;
+    }
+
+    if (!connection.keepAlive) {
+        closeConnection(connection.fd);
+        return false;
+    }
+
+    setWritable(connection, false);
+    return true;
+}
+
+bool HttpServer::parseRequest(const std::string &header, Request &request)
+{
+    // tolerate empty lines before the request line (RFC 7230, 3.5)
+    size_t begin = header.find_first_not_of("\r\n");
+    if (begin == std::string::npos)
+        return false;
+
+    size_t lineEnd = header.find("\r\n", begin);
+    std::string requestLine = header.substr(begin, lineEnd - begin);
+
+    size_t firstSpace = requestLine.find(' ');
+    size_t lastSpace = requestLine.rfind(' ');
+    if (firstSpace == std::string::npos || firstSpace == lastSpace)
+        return false;
+
+    request.method = requestLine.substr(0, firstSpace);
+    request.target = requestLine.substr(firstSpace + 1, lastSpace - firstSpace - 1);
+    request.version = requestLine.substr(lastSpace + 1);
+    if (request.method.empty() || request.target.empty() || request.target.find(' ') != std::string::npos)
+        return false;
+    if (request.version != "HTTP/1.0" && request.version != "HTTP/1.1")
+        return false;
+
+    while (lineEnd != std::string::npos) {
+        begin = lineEnd + 2;
+        lineEnd = header.find("\r\n", begin);
+        std::string line = header.substr(begin, lineEnd == std::string::npos ? std::string::npos
+                                                                             : lineEnd - begin);
+
+        // obsolete line folding is not supported
+        size_t colon = line.find(':');
+        if (line.empty() || line[0] == ' ' || line[0] == '\t' || colon == 0 ||
+                colon == std::string::npos)
+            return false;
+
+        std::string name = lower(line.substr(0, colon));
+        if (name.find_first_of(" \t") != std::string::npos)
+            return false;
+
+        std::string value = trim(line.substr(colon + 1));
+        std::string &existing = request.headers[name];
+        existing = existing.empty() ? value : existing + ", " + value;
+    }
+
+    // HTTP/1.1 requires the Host header (RFC 7230, 5.4)
+    if (request.version == "HTTP/1.1" && request.headers.find("host") == request.headers.end())
+        return false;
+
+    return true;
+}
+
+void HttpServer::respond(Connection &connection, const Request &request)
+{
+    auto header = [&request](const char *name) -> std::string {
+        auto it = request.headers.find(name);
+        return it != request.headers.end() ? it->second : std::string();
+    };
+
+    std::string connectionHeader = header("connection");
+    if (request.version == "HTTP/1.0")
+        connection.keepAlive = headerContains(connectionHeader, "keep-alive");
+    else
+        connection.keepAlive = !headerContains(connectionHeader, "close");
+    connection.head = request.method == "HEAD";
+
+    // GET and HEAD have no body, the end of an unexpected body cannot be found reliably
+    std::string contentLength = header("content-length");
+    if ((!contentLength.empty() && contentLength != "0") || !header("transfer-encoding").empty()) {
+        connection.keepAlive = false;
+        respondStatus(connection, 400);
+        return;
+    }
+
+    if (request.method != "GET" && request.method != "HEAD") {
+        respondStatus(connection, 405, "Allow: GET, HEAD\r\n");
+        return;
+    }
+
+    std::string path;
+    if (!translatePath(request.target, path)) {
+        respondStatus(connection, 400);
+        return;
+    }
+
+    struct stat st;
+    if (stat(path.c_str(), &st) < 0) {
+        respondStatus(connection, errno == EACCES ? 403 : 404);
+        return;
+    }
+
+    if (S_ISDIR(st.st_mode)) {
+        // relative links of the index must resolve in the directory
+        if (!endsWith(path, "/")) {
+            std::string location = request.target.substr(0, request.target.find_first_of("?#"));
+            respondStatus(connection, 301, "Location: " + location + "/\r\n");
+            return;
+        }
+
+        path += "index.xhtml";
+        if (stat(path.c_str(), &st) < 0) {
+            respondStatus(connection, errno == EACCES ? 403 : 404);
+            return;
+        }
+    }
+
+    if (!S_ISREG(st.st_mode)) {
+        respondStatus(connection, 404);
+        return;
+    }
+
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        respondStatus(connection, errno == EACCES ? 403 : 404);
+        return;
+    }
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        respondStatus(connection, 500);
+        return;
+    }
+
+    // name that determines the content type
+    std::string typeName = path;
+    bool gzipped = false;
+    bool gzipAccepted = acceptsGzip(header("accept-encoding"));
+
+    if ((endsWith(path, ".svgz") || endsWith(path, ".gz")) && isGzip(fd)) {
+        gzipped = true;
+        if (endsWith(typeName, ".gz"))
+            typeName.erase(typeName.size() - 3);
+    } else if (gzipAccepted) {
+        // a precompressed file that is older than the file is stale
+        int gzFd = open((path + ".gz").c_str(), O_RDONLY | O_CLOEXEC);
+        struct stat gzSt;
+        if (gzFd >= 0 && fstat(gzFd, &gzSt) == 0 && S_ISREG(gzSt.st_mode) &&
+                gzSt.st_mtime >= st.st_mtime && isGzip(gzFd)) {
+            close(fd);
+            fd = gzFd;
+            st = gzSt;
+            gzipped = true;
+        } else if (gzFd >= 0)
+            close(gzFd);
+    }
+
+    std::string body;
+    bool inflate = gzipped && !gzipAccepted;
+    if (inflate) {
+        bool ok = gunzip(fd, body);
+        close(fd);
+        if (!ok) {
+            respondStatus(connection, 500);
+            return;
+        }
+    }
+
+    std::string entityTag = etag(st, inflate ? "identity" : "");
+    std::string lastModified = httpDate(st.st_mtime);
+
+    bool notModified;
+    std::string ifNoneMatch = header("if-none-match");
+    if (!ifNoneMatch.empty())
+        notModified = etagMatches(ifNoneMatch, entityTag);
+    else {
+        std::string ifModifiedSince = header("if-modified-since");
+        struct tm tm;
+        std::memset(&tm, 0, sizeof(tm));
+        notModified = !ifModifiedSince.empty() &&
+                      strptime(ifModifiedSince.c_str(), "%a, %d %b %Y %H:%M:%S GMT", &tm) &&
+                      st.st_mtime <= timegm(&tm);
+    }
+
+    std::string response = responseHeader(connection, notModified ? 304 : 200);
+    response += "Last-Modified: " + lastModified + "\r\n";
+    response += "ETag: " + entityTag + "\r\n";
+    response += "Cache-Control: no-cache\r\n";
+    response += "Vary: Accept-Encoding\r\n";
+
+    if (notModified) {
+        if (!inflate)
+            close(fd);
+        connection.output += response + "\r\n";
+        return;
+    }
+
+    response += "Content-Type: " + contentType(typeName) + "\r\n";
+    if (gzipped && !inflate)
+        response += "Content-Encoding: gzip\r\n";
+    response += "Content-Length: " +
+                bw::str(inflate ? static_cast<long long>(body.size())
+                                : static_cast<long long>(st.st_size)) + "\r\n\r\n";
+    connection.output += response;
+
+    if (connection.head) {
+        if (!inflate)
+            close(fd);
+    } else if (inflate)
+        connection.output += body;
+    else {
+        connection.fileFd = fd;
+        connection.fileOffset = 0;
+        connection.fileSize = st.st_size;
+    }
+}
+
+void HttpServer::respondStatus(Connection &connection, int status, const std::string &extraHeaders)
+{
+    std::string title = bw::str(status) + " " + statusText(status);
+    std::string body = "<!DOCTYPE html>\n<html><head><title>" + title + "</title></head>"
+                       "<body><h1>" + title + "</h1></body></html>\n";
+
+    std::string response = responseHeader(connection, status);
+    response += extraHeaders;
+    response += "Content-Type: text/html; charset=utf-8\r\n";
+    response += "Content-Length: " + bw::str(body.size()) + "\r\n\r\n";
+    if (!connection.head)
+        response += body;
+
+    connection.output += response;
+}
+
+std::string HttpServer::responseHeader(const Connection &connection, int status) const
+{
+    std::string header = "HTTP/1.1 " + bw::str(status) + " " + statusText(status) + "\r\n";
+    header += "Server: vetero-httpd/" GIT_VERSION "\r\n";
+    header += "Date: " + httpDate(std::time(NULL)) + "\r\n";
+    header += connection.keepAlive ? "Connection: keep-alive\r\n" : "Connection: close\r\n";
+
+    return header;
+}
+
+bool HttpServer::translatePath(const std::string &target, std::string &path) const
+{
+    std::string rawPath = target.substr(0, target.find_first_of("?#"));
+
+    // absolute form like "http://host/index.xhtml" as sent to proxies
+    if (!bw::startsWith(rawPath, "/")) {
+        size_t scheme = rawPath.find("://");
+        if (scheme == std::string::npos)
+            return false;
+        size_t slash = rawPath.find('/', scheme + 3);
+        rawPath = slash == std::string::npos ? "/" : rawPath.substr(slash);
+    }
+
+    std::string decoded;
+    for (size_t i = 0; i < rawPath.size(); i++) {
+        char c = rawPath[i];
+        if (c == '%') {
+            if (i + 2 >= rawPath.size())
+                return false;
+            int high = hexDigit(rawPath[i+1]);
+            int low = hexDigit(rawPath[i+2]);
+            if (high < 0 || low < 0)
+                return false;
+            c = static_cast<char>(high * 16 + low);
+            i += 2;
+        }
+        if (c == '\0')
+            return false;
+        decoded += c;
+    }
+
+    // no path segment may leave the document root
+    size_t begin = 0;
+    while (begin < decoded.size()) {
+        size_t end = decoded.find('/', begin);
+        if (end == std::string::npos)
+            end = decoded.size();
+        if (decoded.compare(begin, end - begin, "..") == 0)
+            return false;
+        begin = end + 1;
+    }
+
+    path = m_documentRoot + decoded;
+    return true;
+}
+
+bool HttpServer::gunzip(int fd, std::string &contents)
+{
+    z_stream stream;
+    std::memset(&stream, 0, sizeof(stream));
+    // 16 selects the gzip format
+    if (inflateInit2(&stream, 16 + MAX_WBITS) != Z_OK)
+        return false;
+
+    unsigned char input[16384];
+    char output[65536];
+    off_t offset = 0;
+    int ret = Z_OK;
+
+    contents.clear();
+    while (ret != Z_STREAM_END) {
+        ssize_t len = pread(fd, input, sizeof(input), offset);
+        if (len <= 0)
+            break;
+        offset += len;
+
+        stream.next_in = input;
+        stream.avail_in = len;
+        do {
+            stream.next_out = reinterpret_cast<Bytef *>(output);
+            stream.avail_out = sizeof(output);
+            ret = inflate(&stream, Z_NO_FLUSH);
+            if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR) {
+                inflateEnd(&stream);
+                return false;
+            }
+            contents.append(output, sizeof(output) - stream.avail_out);
+        } while (stream.avail_out == 0 && ret != Z_STREAM_END);
+    }
+
+    inflateEnd(&stream);
+    return ret == Z_STREAM_END;
+}
+
+void HttpServer::setWritable(Connection &connection, bool writable)
+{
+    if (connection.writing == writable)
+        return;
+
+    // while a response is pending, no further requests are read
+    struct epoll_event event;
+    std::memset(&event, 0, sizeof(event));
+    event.events = writable ? EPOLLOUT : EPOLLIN;
+    event.data.fd = connection.fd;
+    if (epoll_ctl(m_epollFd, EPOLL_CTL_MOD, connection.fd, &event) < 0)
+        BW_ERROR_WARNING("Unable to modify epoll events: %s", std::strerror(errno));
+
+    connection.writing = writable;
+}
+
+void HttpServer::closeConnection(int fd)
+{
+    auto it = m_connections.find(fd);
+    if (it == m_connections.end())
+        return;
+
+    if (it->second->fileFd >= 0)
+        close(it->second->fileFd);
+
+    epoll_ctl(m_epollFd, EPOLL_CTL_DEL, fd, NULL);
+    close(fd);
+    m_connections.erase(it);
+}
+
+void HttpServer::expireConnections()
+{
+    Clock::time_point limit = Clock::now() - std::chrono::seconds(IdleTimeout);
+
+    std::vector<int> expired;
+    for (const auto &connection : m_connections)
+        if (connection.second->lastActivity < limit)
+            expired.push_back(connection.first);
+
+    for (int fd : expired) {
+        BW_DEBUG_TRACE("Closing idle connection %d", fd);
+        closeConnection(fd);
+    }
+}
+
+std::string HttpServer::contentType(const std::string &path)
+{
+    static const struct {
+        const char *suffix;
+        const char *type;
+    } types[] = {
+        { ".xhtml", "text/html; charset=utf-8" },
+        { ".html",  "text/html; charset=utf-8" },
+        { ".svg",   "image/svg+xml" },
+        { ".svgz",  "image/svg+xml" },
+        { ".js",    "application/javascript" },
+        { ".json",  "application/json" },
+        { ".css",   "text/css" },
+        { ".png",   "image/png" },
+        { ".ico",   "image/x-icon" },
+        { ".txt",   "text/plain; charset=utf-8" },
+        { ".xml",   "application/xml" },
+    };
+
+    for (const auto &type : types)
+        if (endsWith(path, type.suffix))
+            return type.type;
+
+    return "application/octet-stream";
+}
+
+std::string HttpServer::etag(const struct stat &st, const std::string &variant)
+{
+    long long mtime = static_cast<long long>(st.st_mtim.tv_sec) * 1000000000LL + st.st_mtim.tv_nsec;
+    std::string tag = common::str_printf("\"%llx-%llx-%llx",
+                                         static_cast<unsigned long long>(st.st_ino),
+                                         static_cast<unsigned long long>(st.st_size),
+                                         static_cast<unsigned long long>(mtime));
+    if (!variant.empty())
+        tag += "-" + variant;
+
+    return tag + "\"";
+}
+
+std::string HttpServer::httpDate(time_t time)
+{
+    // independent of the locale
+    static const char *days[] = { "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat" };
+    static const char *months[] = { "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                                    "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+
+    struct tm tm;
+    gmtime_r(&time, &tm);
+
+    return common::str_printf("%s, %02d %s %04d %02d:%02d:%02d GMT",
+                              days[tm.tm_wday], tm.tm_mday, months[tm.tm_mon], tm.tm_year + 1900,
+                              tm.tm_hour, tm.tm_min, tm.tm_sec);
+}
+
+/* }}} */
+
+} // end namespace httpd
+} // end namespace vetero
@@ -0,0 +1,279 @@
+/* {{{
+ * (c) 2022, Bernhard Walle <bernhard@bwalle.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>. }}}
+ */
+#ifndef VETERO_HTTPD_HTTPSERVER_H_
+#define VETERO_HTTPD_HTTPSERVER_H_
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <string>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <libbw/noncopyable.h>
+
+#include "common/error.h"
+
+namespace vetero {
+namespace httpd {
+
+/* HttpServer {{{ */
+
+/**
+ * \class HttpServer
+ * \brief Serves the files of a directory via HTTP
+ *
+ * A single-threaded HTTP/1.1 server for the reports: all connections are handled by one epoll
+ * event loop and files are sent with sendfile(), so the contents is never copied into the
+ * process. Only \c GET and \c HEAD are supported.
+ *
+ * Gzip-compressed files (<tt>.svgz</tt>, <tt>.json.gz</tt>) are sent unmodified with
+ * <tt>Content-Encoding: gzip</tt>. For other files, a precompressed <tt>NAME.gz</tt> next to
+ * the file is used if it's not older than the file. Clients that don't accept gzip get the
+ * uncompressed contents.
+ *
+ * Each response has a strong ETag made of the inode, the size and the modification time.
+ * Since common::OutputFile replaces files by renaming, a new report always has a new ETag.
+ * The responses must be revalidated (<tt>Cache-Control: no-cache</tt>) and
+ * <tt>If-None-Match</tt> is answered with <tt>304 Not Modified</tt>, so a reload of an
+ * unchanged report costs only the headers.
+ *
+ * Connections are kept alive (also with pipelined requests) until the client closes them or
+ * they're idle for IdleTimeout seconds.
+ *
+ * \author Bernhard Walle <bernhard@bwalle.de>
+ * \ingroup httpd
+ */
+class HttpServer : private bw::Noncopyable
+{
+    public:
+        /// Maximum size of the request line and the headers in bytes
+        static const size_t MaxRequestSize = 8192;
+
+        /// Maximum number of open connections, further connections are closed immediately
+        static const size_t MaxConnections = 512;
+
+        /// Seconds after which idle connections are closed
+        static const int IdleTimeout = 15;
+
+    public:
+        /**
+         * \brief C'tor
+         *
+         * \param[in] documentRoot the directory that is served
+         * \exception common::SystemError if the epoll instance cannot be created
+         */
+        HttpServer(const std::string &documentRoot);
+
+        /**
+         * \brief D'tor
+         *
+         * Closes all connections and the listening socket.
+         */
+        ~HttpServer();
+
+    public:
+        /**
+         * \brief Opens the listening socket
+         *
+         * \param[in] address the address to bind to, an empty string binds to all addresses
+         * \param[in] port the TCP port
+         * \exception common::SystemError if the socket cannot be created or bound
+         */
+        void listen(const std::string &address, int port);
+
+        /**
+         * \brief Runs the event loop
+         *
+         * Never returns.
+         *
+         * \exception common::SystemError if epoll_wait() fails
+         */
+        void run();
+
+    protected:
+        typedef std::chrono::steady_clock Clock;
+
+        /**
+         * \brief Parsed request
+         */
+        struct Request {
+            std::string method;             ///< the method like <tt>"GET"</tt>
+            std::string target;             ///< the request target like <tt>"/index.xhtml"</tt>
+            std::string version;            ///< <tt>"HTTP/1.1"</tt> or <tt>"HTTP/1.0"</tt>
+            std::map<std::string, std::string> headers; ///< headers with lower-case names
+        };
+
+        /**
+         * \brief State of a client connection
+         */
+        struct Connection {
+            int fd;                         ///< the socket
+            std::string input;              ///< received data that hasn't been processed yet
+            std::string output;             ///< headers or generated body not yet sent
+            size_t outputOffset;            ///< bytes of \c output already sent
+            int fileFd;                     ///< file sent after \c output, or -1
+            off_t fileOffset;               ///< next byte of the file to send
+            off_t fileSize;                 ///< size of the file
+            bool keepAlive;                 ///< keep the connection after the response
+            bool head;                      ///< the response has no body (\c HEAD request)
+            bool writing;                   ///< \c EPOLLOUT is enabled
+            Clock::time_point lastActivity; ///< time of the last read or write
+        };
+
+        /**
+         * \brief Accepts all pending connections
+         */
+        void acceptConnections();
+
+        /**
+         * \brief Reads from a connection and processes the complete requests
+         *
+         * \param[in] connection the connection
+         * \return \c false if the connection has been closed
+         */
+        bool handleInput(Connection &connection);
+
+        /**
+         * \brief Processes the received requests until a response cannot be sent completely
+         *
+         * \param[in] connection the connection
+         * \return \c false if the connection has been closed
+         */
+        bool processRequests(Connection &connection);
+
+        /**
+         * \brief Sends as much of the pending response as possible
+         *
+         * \param[in] connection the connection
+         * \return \c false if the connection has been closed
+         */
+        bool flush(Connection &connection);
+
+        /**
+         * \brief Parses the request line and the headers
+         *
+         * \param[in] header the request up to (excluding) the empty line
+         * \param[out] request the parsed request
+         * \return \c true on success, \c false if the request is malformed
+         */
+        static bool parseRequest(const std::string &header, Request &request);
+
+        /**
+         * \brief Creates the response of a request
+         *
+         * \param[in] connection the connection that gets the response
+         * \param[in] request the request
+         */
+        void respond(Connection &connection, const Request &request);
+
+        /**
+         * \brief Creates a response with a small HTML body
+         *
+         * \param[in] connection the connection that gets the response
+         * \param[in] status the status code like 404
+         * \param[in] extraHeaders additional headers, each terminated by <tt>"\r\n"</tt>
+         */
+        void respondStatus(Connection &connection, int status,
+                           const std::string &extraHeaders=std::string());
+
+        /**
+         * \brief Returns the common headers of a response
+         *
+         * \param[in] connection the connection
+         * \param[in] status the status code
+         * \return the status line and the headers without the final empty line
+         */
+        std::string responseHeader(const Connection &connection, int status) const;
+
+        /**
+         * \brief Maps a request target to a file below the document root
+         *
+         * \param[in] target the request target
+         * \param[out] path the file name
+         * \return \c false if the target is invalid or leaves the document root
+         */
+        bool translatePath(const std::string &target, std::string &path) const;
+
+        /**
+         * \brief Reads and decompresses a gzip-compressed file
+         *
+         * \param[in] fd the file, read from the beginning with pread()
+         * \param[out] contents the uncompressed contents
+         * \return \c true on success
+         */
+        static bool gunzip(int fd, std::string &contents);
+
+        /**
+         * \brief Enables or disables \c EPOLLOUT for a connection
+         *
+         * \param[in] connection the connection
+         * \param[in] writable \c true if the connection waits until the socket is writable
+         */
+        void setWritable(Connection &connection, bool writable);
+
+        /**
+         * \brief Closes a connection
+         *
+         * \param[in] fd the socket of the connection
+         */
+        void closeConnection(int fd);
+
+        /**
+         * \brief Closes the connections that have been idle for IdleTimeout seconds
+         */
+        void expireConnections();
+
+        /**
+         * \brief Returns the content type of a file
+         *
+         * \param[in] path the file name without the <tt>.gz</tt> suffix
+         * \return the MIME type
+         */
+        static std::string contentType(const std::string &path);
+
+        /**
+         * \brief Returns the strong ETag of a file
+         *
+         * \param[in] st the status of the file
+         * \param[in] variant distinguishes the representations of the same file, may be empty
+         * \return the ETag including the quotes
+         */
+        static std::string etag(const struct stat &st, const std::string &variant);
+
+        /**
+         * \brief Formats a time as HTTP date
+         *
+         * \param[in] time the time
+         * \return the date like <tt>"Sun, 06 Nov 1994 08:49:37 GMT"</tt>
+         */
+        static std::string httpDate(time_t time);
+
+    private:
+        std::string m_documentRoot;
+        int m_listenFd;
+        int m_epollFd;
+        std::map<int, std::unique_ptr<Connection> > m_connections;
+};
+
+/* }}} */
+
+} // end namespace httpd
+} // end namespace vetero
+
+#endif // VETERO_HTTPD_HTTPSERVER_H_
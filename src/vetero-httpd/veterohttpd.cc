@@ -0,0 +1,161 @@
+/* {{{
+ * (c) 2022, Bernhard Walle <bernhard@bwalle.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>. }}}
+ */
+
+#include <iostream>
+#include <cerrno>
+#include <csignal>
+
+#include <libbw/optionparser.h>
+#include <libbw/stringutil.h>
+#include <libbw/log/debug.h>
+#include <libbw/log/errorlog.h>
+#include <libbw/os.h>
+
+#include "veterohttpd.h"
+#include "httpserver.h"
+#include "config.h"
+
+namespace vetero {
+namespace httpd {
+
+/* VeteroHttpd {{{ */
+
+VeteroHttpd::VeteroHttpd()
+    : common::VeteroApplication("vetero-httpd")
+{}
+
+bool VeteroHttpd::parseCommandLine(int argc, char *argv[])
+{
+    bw::OptionGroup generalGroup("General Options");
+    generalGroup.addOption("help", 'h', bw::OT_FLAG,
+                           "Prints a help message and exits.");
+    generalGroup.addOption("version", 'v', bw::OT_FLAG,
+                           "Prints the version and exits.");
+    generalGroup.addOption("foreground", 'f', bw::OT_FLAG,
+                           "Don't fork (run in foreground)");
+
+    bw::OptionGroup serverGroup("Server Options");
+    serverGroup.addOption("port", 'p', bw::OT_INTEGER,
+                          "The TCP port (default: " + bw::str(m_port) + ")");
+    serverGroup.addOption("bind", 'b', bw::OT_STRING,
+                          "Only listen on the address ADDRESS (default: all addresses)");
+    serverGroup.addOption("directory", 'C', bw::OT_STRING,
+                          "Serve DIRECTORY instead of 'report_directory' of the configuration");
+
+    bw::OptionGroup loggingGroup("Logging Options");
+    loggingGroup.addOption("debug-logfile", 'D', bw::OT_STRING,
+                           "Don't log to the console, log in FILE instead");
+    loggingGroup.addOption("debug-loglevel", 'd', bw::OT_STRING,
+                           "Specify the loglevel ('none'*, 'info', 'debug', trace')");
+    loggingGroup.addOption("error-logfile", 'L', bw::OT_STRING,
+                           "Use the specified file for error logging. The special values "
+                           "'stderr', 'stdout' and 'syslog' are accepted.");
+
+    bw::OptionGroup configurationGroup("Configuration Options");
+    configurationGroup.addOption("configfile", 'c', bw::OT_STRING,
+                                 "Use the provided configuration file rather than '" + m_configfile + "'");
+
+    bw::OptionParser op;
+    op.addOptions(generalGroup);
+    op.addOptions(serverGroup);
+    op.addOptions(loggingGroup);
+    op.addOptions(configurationGroup);
+
+    // do the parsing
+    if (!op.parse(argc, argv))
+        return false;
+
+    // evaluate options
+    if (op.getValue("help").getFlag()) {
+        op.printHelp(std::cerr, "vetero-httpd " GIT_VERSION);
+        return false;
+    } else if (op.getValue("version").getFlag()) {
+        std::cerr << "vetero-httpd " << GIT_VERSION << std::endl;
+        return false;
+    }
+
+    // debug logging
+    std::string debugLoglevel("none");
+    std::string debugLogfile;
+    if (op.getValue("debug-loglevel"))
+        debugLoglevel = op.getValue("debug-loglevel").getString();
+    if (op.getValue("debug-logfile"))
+        debugLogfile = op.getValue("debug-logfile").getString();
+    setupDebugLogging(debugLoglevel, debugLogfile);
+
+    // error logging
+    std::string errorLogfile("stderr");
+    if (op.getValue("error-logfile"))
+        errorLogfile = op.getValue("error-logfile").getString();
+    setupErrorLogging(errorLogfile);
+
+    // configuration
+    if (op.getValue("configfile")) {
+        m_configfile = op.getValue("configfile").getString();
+        m_noConfigFatal = true;
+    }
+
+    if (op.getValue("foreground").getFlag())
+        m_daemonize = false;
+
+    if (op.getValue("port")) {
+        m_port = op.getValue("port").getInteger();
+        if (m_port <= 0 || m_port > 65535)
+            throw common::ApplicationError("Invalid port: " + bw::str(m_port));
+    }
+    if (op.getValue("bind"))
+        m_bindAddress = op.getValue("bind").getString();
+    if (op.getValue("directory"))
+        m_directory = op.getValue("directory").getString();
+
+    return true;
+}
+
+void VeteroHttpd::readConfiguration()
+{
+    m_configuration.reset(new common::Configuration(m_configfile));
+    if (!m_configuration->configurationRead() && m_noConfigFatal)
+        throw common::ApplicationError(m_configuration->error());
+}
+
+void VeteroHttpd::exec()
+{
+    std::string directory = m_directory;
+    if (directory.empty())
+        directory = m_configuration->reportDirectory();
+    if (directory.empty())
+        throw common::ApplicationError("'report_directory' not set and no --directory given");
+
+    // a client that closes the connection must not terminate the server, see sendfile()
+    if (std::signal(SIGPIPE, SIG_IGN) == SIG_ERR)
+        throw common::SystemError("Unable to ignore SIGPIPE", errno);
+
+    // open the socket before forking so that errors are reported on the console
+    HttpServer server(directory);
+    server.listen(m_bindAddress, m_port);
+
+    if (m_daemonize)
+        bw::daemonize(bw::DAEMONIZE_NOCLOSE);
+
+    BW_DEBUG_INFO("Starting application.");
+    server.run();
+}
+
+/* }}} */
+
+} // end namespace httpd
+} // end namespace vetero
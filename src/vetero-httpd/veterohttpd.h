@@ -0,0 +1,100 @@
+/* {{{
+ * (c) 2022, Bernhard Walle <bernhard@bwalle.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>. }}}
+ */
+#ifndef VETERO_HTTPD_VETEROHTTPD_H_
+#define VETERO_HTTPD_VETEROHTTPD_H_
+
+#include <memory>
+#include <string>
+
+#include "common/error.h"
+#include "common/configuration.h"
+#include "common/veteroapplication.h"
+
+namespace vetero {
+namespace httpd {
+
+/* VeteroHttpd {{{ */
+
+/**
+ * \class VeteroHttpd
+ * \brief Main class of the web server for the reports
+ *
+ * Serves the <tt>report_directory</tt> of the configuration with HttpServer. Replaces
+ * <tt>scripts/serve_reports.py</tt>.
+ *
+ * \author Bernhard Walle <bernhard@bwalle.de>
+ * \ingroup httpd
+ */
+class VeteroHttpd : public common::VeteroApplication
+{
+    public:
+        /**
+         * \brief Constructor
+         */
+        VeteroHttpd();
+
+        /**
+         * \brief Parse the command line
+         *
+         * \param[in] argc the number of arguments
+         * \param[in] argv the arguments
+         * \return \c true if the application should be continued,
+         *         \c false if the application should be quit
+         * \exception common::ApplicationError if parsing the command line failed.
+         */
+        bool parseCommandLine(int argc, char *argv[]);
+
+        /**
+         * \brief Reads the configuration file
+         *
+         * If a configuration file has been specified on the command line, read the
+         * configuration file and throw an exception if the configuration file cannot be
+         * read. If no configuration file has been specified, check if the default configuration
+         * file exists and if yes, read it. Only if the file exists and cannot be parsed, an
+         * \c common::ApplicationError is thrown.
+         *
+         * \exception common::ApplicationError if the configuration file cannot be read or parsed, see
+         *            above for more information.
+         */
+        void readConfiguration();
+
+        /**
+         * \brief Main loop of the application
+         *
+         * Opens the listening socket, daemonizes and serves the reports. Never returns.
+         *
+         * \exception common::ApplicationError if there's no directory to serve or if the
+         *            socket cannot be opened
+         */
+        void exec();
+
+    private:
+        bool m_daemonize = true;
+        std::string m_configfile;
+        bool m_noConfigFatal = false;
+        std::string m_directory;
+        std::string m_bindAddress;
+        int m_port = 8080;
+        std::unique_ptr<vetero::common::Configuration> m_configuration;
+};
+
+/* }}} */
+
+} // end namespace httpd
+} // end namespace vetero
+
+#endif // VETERO_HTTPD_VETEROHTTPD_H_
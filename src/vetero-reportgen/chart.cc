@@ -0,0 +1,425 @@
+/* {{{
+ * (c) 2022, Bernhard Walle <bernhard@bwalle.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>. }}}
+ */
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+#include <libbw/log/errorlog.h>
+
+#include "common/stagetimer.h"
+#include "common/translation.h"
+#include "chart.h"
+#include "chartfeed.h"
+#include "downsampler.h"
+#include "gnuplot.h"
+#include "svgchartrenderer.h"
+
+namespace vetero {
+namespace reportgen {
+
+/* Chart {{{ */
+
+namespace {
+
+// days since 1970-01-01 of a date in the proleptic Gregorian calendar
+long daysFromCivil(long year, long month, long day)
+{
+    year -= month <= 2;
+    long era = (year >= 0 ? year : year - 399) / 400;
+    long yoe = year - era * 400;
+    long doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    long doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+} // anonymous namespace
+
+Chart::Chart(const common::Configuration &config)
+    : m_config(config)
+    , m_width(1000)
+    , m_height(400)
+    , m_xTicInterval(0.0)
+    , m_yMin(NAN)
+    , m_yMax(NAN)
+    , m_grid(0)
+    , m_boxWidth(0.0)
+{}
+
+Chart::~Chart()
+{}
+
+const common::Configuration &Chart::configuration() const
+{
+    return m_config;
+}
+
+void Chart::setSize(int width, int height)
+{
+    m_width = width;
+    m_height = height;
+}
+
+int Chart::width() const
+{
+    return m_width;
+}
+
+int Chart::height() const
+{
+    return m_height;
+}
+
+void Chart::setOutputFile(const std::string &output)
+{
+    m_outputFile = output;
+}
+
+std::string Chart::outputFile() const
+{
+    return m_outputFile;
+}
+
+void Chart::setXLabel(const std::string &label)
+{
+    m_xLabel = label;
+}
+
+std::string Chart::xLabel() const
+{
+    return m_xLabel;
+}
+
+void Chart::setYLabel(const std::string &label)
+{
+    m_yLabel = label;
+}
+
+std::string Chart::yLabel() const
+{
+    return m_yLabel;
+}
+
+void Chart::setY2Label(const std::string &label)
+{
+    m_y2Label = label;
+}
+
+std::string Chart::y2Label() const
+{
+    return m_y2Label;
+}
+
+void Chart::setTimeAxis(const std::string &timeFormat)
+{
+    m_timeFormat = timeFormat;
+}
+
+bool Chart::timeAxis() const
+{
+    return !m_timeFormat.empty();
+}
+
+std::string Chart::timeFormat() const
+{
+    return m_timeFormat;
+}
+
+void Chart::setXRange(const std::string &min, const std::string &max)
+{
+    m_xMin = min;
+    m_xMax = max;
+}
+
+std::string Chart::xMin() const
+{
+    return m_xMin;
+}
+
+std::string Chart::xMax() const
+{
+    return m_xMax;
+}
+
+void Chart::setXTicInterval(double interval, const std::string &format)
+{
+    m_xTicInterval = interval;
+    m_xTicFormat = format;
+}
+
+double Chart::xTicInterval() const
+{
+    return m_xTicInterval;
+}
+
+std::string Chart::xTicFormat() const
+{
+    return m_xTicFormat;
+}
+
+void Chart::setXTics(const std::vector<Tic> &tics)
+{
+    m_xTics = tics;
+}
+
+const std::vector<Chart::Tic> &Chart::xTics() const
+{
+    return m_xTics;
+}
+
+void Chart::setYRange(double min, double max)
+{
+    m_yMin = min;
+    m_yMax = max;
+}
+
+double Chart::yMin() const
+{
+    return m_yMin;
+}
+
+double Chart::yMax() const
+{
+    return m_yMax;
+}
+
+void Chart::setY2Tics(const std::vector<Tic> &tics)
+{
+    m_y2Tics = tics;
+}
+
+const std::vector<Chart::Tic> &Chart::y2Tics() const
+{
+    return m_y2Tics;
+}
+
+void Chart::setGrid(int grid)
+{
+    m_grid = grid;
+}
+
+int Chart::grid() const
+{
+    return m_grid;
+}
+
+void Chart::setBoxWidth(double width)
+{
+    m_boxWidth = width;
+}
+
+double Chart::boxWidth() const
+{
+    return m_boxWidth;
+}
+
+void Chart::addSeries(int column, Style style, const std::string &color, double lineWidth,
+                      const std::string &title, PointType pointType, double pointSize)
+{
+    Downsampling downsampling = (style == Boxes || style == Impulses)
+        ? DownsampleEnvelope : DownsampleLttb;
+    Series series = { column, style, title, color, lineWidth, pointType, pointSize, downsampling };
+    m_series.push_back(series);
+}
+
+void Chart::setDownsampling(int column, Downsampling downsampling)
+{
+    for (size_t i = 0; i < m_series.size(); ++i)
+        if (m_series[i].column == column)
+            m_series[i].downsampling = downsampling;
+}
+
+const std::vector<Chart::Series> &Chart::series() const
+{
+    return m_series;
+}
+
+int Chart::maxColumn() const
+{
+    int column = 1;
+    for (size_t i = 0; i < m_series.size(); ++i)
+        column = std::max(column, m_series[i].column);
+
+    return column;
+}
+
+double Chart::parseX(const std::string &value, bool &ok) const
+{
+    if (timeAxis())
+        return parseTime(value, m_timeFormat, ok);
+
+    char *end;
+    double result = std::strtod(value.c_str(), &end);
+    ok = !value.empty() && *end == '\0';
+    return result;
+}
+
+void Chart::plot(const StringStringVector &data)
+{
+    if (data.empty() || data[0].empty()) {
+        BW_ERROR_WARNING("Chart: No data to plot for '%s'", m_outputFile.c_str());
+        return;
+    }
+
+    // more values than pixels only cost time and bytes
+    StringStringVector reduced;
+    bool downsampled;
+    {
+        common::StageTimer timer(common::StageTimes::Transform);
+        downsampled = Downsampler(*this).downsample(data, m_width, reduced);
+    }
+    const StringStringVector &plotData = downsampled ? reduced : data;
+
+    if (m_config.reportDataFeeds()) {
+        common::StageTimer timer(common::StageTimes::Transform);
+        ChartFeed feed;
+        feed.write(*this, plotData);
+    }
+
+    common::StageTimer timer(common::StageTimes::Plot);
+    if (m_config.reportChartRenderer() == "gnuplot") {
+        Gnuplot gnuplot(m_config);
+        gnuplot.plot(*this, plotData);
+    } else if (m_config.reportChartRenderer() == "native") {
+        SvgChartRenderer renderer(m_width, m_height);
+        renderer.render(*this, plotData);
+    }
+}
+
+std::string Chart::dataFeedName(const std::string &diagram)
+{
+    std::string::size_type dot = diagram.rfind('.');
+    std::string::size_type slash = diagram.rfind('/');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+        return diagram + ".json.gz";
+
+    return diagram.substr(0, dot) + ".json.gz";
+}
+
+double Chart::parseTime(const std::string &value, const std::string &format, bool &ok)
+{
+    long fields[6] = { 1970, 1, 1, 0, 0, 0 };
+    const char *conversions = "YmdHMS";
+
+    ok = false;
+    const char *p = value.c_str();
+    for (size_t i = 0; i < format.size(); ++i) {
+        if (format[i] != '%' || i + 1 == format.size()) {
+            if (*p++ != format[i])
+                return 0.0;
+            continue;
+        }
+
+        const char *field = std::strchr(conversions, format[++i]);
+        if (!field || !std::isdigit(static_cast<unsigned char>(*p)))
+            return 0.0;
+
+        char *end;
+        fields[field - conversions] = std::strtol(p, &end, 10);
+        p = end;
+    }
+    if (*p != '\0')
+        return 0.0;
+
+    ok = true;
+    return daysFromCivil(fields[0], fields[1], fields[2]) * 86400.0 +
+           fields[3] * 3600.0 + fields[4] * 60.0 + fields[5];
+}
+
+std::string Chart::formatTime(double seconds, const std::string &format)
+{
+    time_t time = static_cast<time_t>(std::floor(seconds));
+    struct tm tm;
+    gmtime_r(&time, &tm);
+
+    std::string result;
+    for (size_t i = 0; i < format.size(); ++i) {
+        if (format[i] != '%' || i + 1 == format.size()) {
+            result += format[i];
+            continue;
+        }
+
+        // gnuplot allows a field width, strftime() doesn't
+        size_t width = 0;
+        while (i + 1 < format.size() && std::isdigit(static_cast<unsigned char>(format[i+1])))
+            width = width * 10 + (format[++i] - '0');
+        if (i + 1 == format.size())
+            break;
+
+        char conversion[3] = { '%', format[++i], '\0' };
+        char buffer[64];
+        size_t len = std::strftime(buffer, sizeof(buffer), conversion, &tm);
+        std::string field(buffer, len);
+
+        if (width > 0) {
+            while (field.size() > 1 && field[0] == '0')
+                field.erase(0, 1);
+            if (field.size() < width)
+                field.insert(0, width - field.size(), ' ');
+        }
+        result += field;
+    }
+
+    return result;
+}
+
+/* }}} */
+/* WeatherChart {{{ */
+
+WeatherChart::WeatherChart(const common::Configuration &config)
+    : Chart(config)
+{}
+
+void WeatherChart::addWindY()
+{
+    static const struct {
+        double speed;
+        const char *beaufort;
+    } beaufortScale[] = {
+        {   0,  "0" },
+        {   2,  "1" },
+        {   6,  "2" },
+        {  12,  "3" },
+        {  20,  "4" },
+        {  29,  "5" },
+        {  39,  "6" },
+        {  50,  "7" },
+        {  62,  "8" },
+        {  75,  "9" },
+        {  89, "10" },
+        { 103, "11" },
+        { 117, "12" }
+    };
+
+    std::vector<Tic> tics;
+    for (size_t i = 0; i < sizeof(beaufortScale)/sizeof(beaufortScale[0]); ++i) {
+        Tic tic = { beaufortScale[i].speed, beaufortScale[i].beaufort };
+        tics.push_back(tic);
+    }
+
+    setYLabel(_("Wind speed [km/h])"));
+    setY2Label(_("Wind strength [Beaufort]"));
+    setY2Tics(tics);
+    setGrid(GridX | GridY2);
+}
+
+/* }}} */
+
+} // end namespace reportgen
+} // end namespace vetero
@@ -0,0 +1,535 @@
+/* {{{
+ * (c) 2022, Bernhard Walle <bernhard@bwalle.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>. }}}
+ */
+#ifndef VETERO_REPORTGEN_CHART_H_
+#define VETERO_REPORTGEN_CHART_H_
+
+#include <string>
+#include <vector>
+
+#include "common/error.h"
+#include "common/configuration.h"
+
+namespace vetero {
+namespace reportgen {
+
+/* Chart {{{ */
+
+/**
+ * \class Chart
+ * \brief Description of a diagram
+ *
+ * Describes the axes and data series of a diagram independent of the program that draws it.
+ * The data is passed as two-dimensional vector (the one you get from the Database) to the
+ * plot() function. The first column contains the x values, the series refer to the other
+ * columns.
+ *
+ * \code
+ * Chart chart(configuration);
+ * chart.setOutputFile("temperature.svgz");
+ * chart.setYLabel("Temperature [°C]");
+ * chart.setGrid(Chart::GridX | Chart::GridY);
+ * chart.addSeries(2, Chart::Lines, "#CC0000", 2, "Temperature");
+ * chart.plot(result.data);
+ * \endcode
+ *
+ * Series with more values than the diagram is wide are reduced before drawing, see
+ * Downsampler.
+ *
+ * Depending on the <tt>report_chart_renderer</tt> configuration the diagram is drawn with
+ * SvgChartRenderer (<tt>"native"</tt>, default) or with Gnuplot (<tt>"gnuplot"</tt>). With
+ * <tt>"client"</tt> no SVG is drawn at all, the browser draws the diagram from the data feed
+ * (see ChartFeed) instead. The data feed is also written if <tt>report_data_feeds</tt> is set.
+ *
+ * \author Bernhard Walle <bernhard@bwalle.de>
+ * \ingroup report
+ */
+class Chart
+{
+    public:
+        /**
+         * \brief Convenience typedef
+         */
+        typedef std::vector<std::string> StringVector;
+
+        /**
+         * \brief Convenience typedef
+         */
+        typedef std::vector<StringVector> StringStringVector;
+
+        /**
+         * \brief How a series is drawn
+         */
+        enum Style {
+            Lines,          /**< connected lines */
+            LinesPoints,    /**< connected lines with a point at each value */
+            Points,         /**< only points */
+            Boxes,          /**< filled boxes from zero to the value */
+            Impulses        /**< vertical lines from zero to the value */
+        };
+
+        /**
+         * \brief Shape of points, the values are the point types of gnuplot
+         */
+        enum PointType {
+            Circle = 7,     /**< filled circle */
+            Triangle = 9    /**< filled triangle */
+        };
+
+        /**
+         * \brief Grid lines
+         */
+        enum Grid {
+            GridX  = (1<<0),    /**< vertical lines at the x tics */
+            GridY  = (1<<1),    /**< horizontal lines at the y tics */
+            GridY2 = (1<<2)     /**< horizontal lines at the y2 tics */
+        };
+
+        /**
+         * \brief How a series is reduced if it has more values than the diagram has pixels
+         */
+        enum Downsampling {
+            DownsampleLttb,         /**< Largest-Triangle-Three-Buckets, keeps the shape of lines */
+            DownsampleEnvelope,     /**< minimum and maximum of each bucket, keeps the peaks */
+            DownsampleNone          /**< all values are kept */
+        };
+
+        /**
+         * \brief A data series
+         */
+        struct Series {
+            int column;             ///< column of the y value, 1-based like in gnuplot's "using 1:n"
+            Style style;            ///< how the series is drawn
+            std::string title;      ///< title in the key, empty means no entry
+            std::string color;      ///< color in the form <tt>"#RRGGBB"</tt>
+            double lineWidth;       ///< line width
+            PointType pointType;    ///< shape of the points
+            double pointSize;       ///< size of the points
+            Downsampling downsampling;  ///< how the series is reduced, see Downsampler
+        };
+
+        /**
+         * \brief A labeled tic
+         */
+        struct Tic {
+            double position;        ///< position in axis coordinates
+            std::string label;      ///< label, may contain line breaks
+        };
+
+    public:
+        /**
+         * \brief C'tor
+         *
+         * \param[in] config the application's configuration
+         */
+        Chart(const common::Configuration &config);
+
+        /**
+         * \brief Virtual D'tor
+         */
+        virtual ~Chart();
+
+    public:
+        /**
+         * \brief Returns the configuration
+         *
+         * \return the configuration passed in the constructor
+         */
+        const common::Configuration &configuration() const;
+
+        /**
+         * \brief Sets the output file
+         *
+         * The file will be written as compressed SVG.
+         *
+         * \param[in] output the name of the output file
+         */
+        void setOutputFile(const std::string &output);
+
+        /**
+         * \brief Returns the output file
+         *
+         * \return the name of the output file set with setOutputFile()
+         */
+        std::string outputFile() const;
+
+        /**
+         * \brief Sets the size of the diagram
+         *
+         * The default is 1000x400 pixels. The width also limits the number of values per
+         * series, see Downsampler.
+         *
+         * \param[in] width the width in pixels
+         * \param[in] height the height in pixels
+         */
+        void setSize(int width, int height);
+
+        /**
+         * \brief Returns the width of the diagram
+         *
+         * \return the width in pixels
+         */
+        int width() const;
+
+        /**
+         * \brief Returns the height of the diagram
+         *
+         * \return the height in pixels
+         */
+        int height() const;
+
+        /**
+         * \brief Sets the label of the x axis
+         *
+         * \param[in] label the label
+         */
+        void setXLabel(const std::string &label);
+
+        /**
+         * \brief Returns the label of the x axis
+         *
+         * \return the label
+         */
+        std::string xLabel() const;
+
+        /**
+         * \brief Sets the label of the y axis
+         *
+         * \param[in] label the label
+         */
+        void setYLabel(const std::string &label);
+
+        /**
+         * \brief Returns the label of the y axis
+         *
+         * \return the label
+         */
+        std::string yLabel() const;
+
+        /**
+         * \brief Sets the label of the second y axis on the right side
+         *
+         * \param[in] label the label
+         */
+        void setY2Label(const std::string &label);
+
+        /**
+         * \brief Returns the label of the second y axis
+         *
+         * \return the label
+         */
+        std::string y2Label() const;
+
+        /**
+         * \brief Makes the x axis a time axis
+         *
+         * The x values in the data are parsed with \p timeFormat, see parseTime().
+         *
+         * \param[in] timeFormat the format of the x values like <tt>"%H:%M:%S"</tt>
+         */
+        void setTimeAxis(const std::string &timeFormat);
+
+        /**
+         * \brief Checks if the x axis is a time axis
+         *
+         * \return \c true if setTimeAxis() has been called
+         */
+        bool timeAxis() const;
+
+        /**
+         * \brief Returns the format of the x values of a time axis
+         *
+         * \return the format
+         */
+        std::string timeFormat() const;
+
+        /**
+         * \brief Sets the range of the x axis
+         *
+         * \param[in] min the minimum in the format of the x values
+         * \param[in] max the maximum in the format of the x values
+         */
+        void setXRange(const std::string &min, const std::string &max);
+
+        /**
+         * \brief Returns the minimum of the x range
+         *
+         * \return the minimum as set with setXRange(), empty for autoscaling
+         */
+        std::string xMin() const;
+
+        /**
+         * \brief Returns the maximum of the x range
+         *
+         * \return the maximum as set with setXRange(), empty for autoscaling
+         */
+        std::string xMax() const;
+
+        /**
+         * \brief Sets equidistant x tics
+         *
+         * \param[in] interval the distance of the tics in axis units (seconds for time axes)
+         * \param[in] format the format of the labels. For time axes that's a strftime() format
+         *            which may contain a field width (<tt>"%2d"</tt>), otherwise a printf()
+         *            format for a double.
+         */
+        void setXTicInterval(double interval, const std::string &format);
+
+        /**
+         * \brief Returns the interval of the x tics
+         *
+         * \return the interval, 0 if not set
+         */
+        double xTicInterval() const;
+
+        /**
+         * \brief Returns the format of the x tic labels
+         *
+         * \return the format, empty if not set
+         */
+        std::string xTicFormat() const;
+
+        /**
+         * \brief Sets explicit x tics
+         *
+         * \param[in] tics the tics
+         */
+        void setXTics(const std::vector<Tic> &tics);
+
+        /**
+         * \brief Returns the explicit x tics
+         *
+         * \return the tics set with setXTics()
+         */
+        const std::vector<Tic> &xTics() const;
+
+        /**
+         * \brief Sets the range of the y axis
+         *
+         * \param[in] min the minimum, NaN for autoscaling
+         * \param[in] max the maximum, NaN for autoscaling
+         */
+        void setYRange(double min, double max);
+
+        /**
+         * \brief Returns the minimum of the y axis
+         *
+         * \return the minimum, NaN for autoscaling
+         */
+        double yMin() const;
+
+        /**
+         * \brief Returns the maximum of the y axis
+         *
+         * \return the maximum, NaN for autoscaling
+         */
+        double yMax() const;
+
+        /**
+         * \brief Sets tics on the second y axis
+         *
+         * The second y axis uses the scale of the first one and only adds other labels.
+         * The tics of the first y axis are only drawn on the left side then.
+         *
+         * \param[in] tics the tics
+         */
+        void setY2Tics(const std::vector<Tic> &tics);
+
+        /**
+         * \brief Returns the tics of the second y axis
+         *
+         * \return the tics
+         */
+        const std::vector<Tic> &y2Tics() const;
+
+        /**
+         * \brief Sets the grid lines
+         *
+         * \param[in] grid a bitwise-or combination of Grid values
+         */
+        void setGrid(int grid);
+
+        /**
+         * \brief Returns the grid lines
+         *
+         * \return the bitwise-or combination of Grid values
+         */
+        int grid() const;
+
+        /**
+         * \brief Sets the width of boxes
+         *
+         * \param[in] width the width in x axis units, 0 means boxes touch each other
+         */
+        void setBoxWidth(double width);
+
+        /**
+         * \brief Returns the width of boxes
+         *
+         * \return the width, 0 means automatic
+         */
+        double boxWidth() const;
+
+        /**
+         * \brief Adds a data series
+         *
+         * \param[in] column the column of the y values, 1-based like in gnuplot's
+         *            <tt>"using 1:column"</tt>
+         * \param[in] style how the series is drawn
+         * \param[in] color the color as <tt>"#RRGGBB"</tt>
+         * \param[in] lineWidth the line width
+         * \param[in] title the entry in the key, empty means no entry
+         * \param[in] pointType the shape of the points for Points and LinesPoints
+         * \param[in] pointSize the size of the points
+         */
+        void addSeries(int column, Style style, const std::string &color, double lineWidth,
+                       const std::string &title=std::string(), PointType pointType=Circle,
+                       double pointSize=1.0);
+
+        /**
+         * \brief Changes how the series of a column are reduced
+         *
+         * By default lines and points use DownsampleLttb, boxes and impulses
+         * DownsampleEnvelope.
+         *
+         * \param[in] column the column of the series, 1-based
+         * \param[in] downsampling the new method
+         */
+        void setDownsampling(int column, Downsampling downsampling);
+
+        /**
+         * \brief Returns the series
+         *
+         * \return all series in the order they were added
+         */
+        const std::vector<Series> &series() const;
+
+        /**
+         * \brief Returns the highest column referenced by a series
+         *
+         * \return the column, 1-based
+         */
+        int maxColumn() const;
+
+        /**
+         * \brief Converts a x value of the data to a number
+         *
+         * \param[in] value the value in the data
+         * \param[out] ok set to \c false if \p value cannot be converted
+         * \return the number (seconds for time axes)
+         */
+        double parseX(const std::string &value, bool &ok) const;
+
+        /**
+         * \brief Draws the diagram
+         *
+         * \param[in] data the data with the x values in the first column
+         * \exception common::ApplicationError if the diagram cannot be drawn
+         */
+        virtual void plot(const StringStringVector &data);
+
+    public:
+        /**
+         * \brief Returns the name of the data feed of a diagram
+         *
+         * \param[in] diagram the file name or link of the diagram like
+         *            <tt>"/2012/04/01/temperature.svgz"</tt>
+         * \return the name of the feed like <tt>"/2012/04/01/temperature.json.gz"</tt>
+         */
+        static std::string dataFeedName(const std::string &diagram);
+
+        /**
+         * \brief Parses a time
+         *
+         * Only the conversions <tt>%Y</tt>, <tt>%m</tt>, <tt>%d</tt>, <tt>%H</tt>, <tt>%M</tt>
+         * and <tt>%S</tt> are supported. The fields are not range-checked, so
+         * <tt>"24:00:00"</tt> is the end of the day. Missing date fields default to
+         * 1970-01-01.
+         *
+         * \param[in] value the string
+         * \param[in] format the format
+         * \param[out] ok set to \c false if \p value doesn't match \p format
+         * \return the seconds since 1970-01-01 00:00 (without time zone)
+         */
+        static double parseTime(const std::string &value, const std::string &format, bool &ok);
+
+        /**
+         * \brief Formats a time
+         *
+         * \param[in] seconds the seconds as returned by parseTime()
+         * \param[in] format the strftime() format. Field widths like <tt>"%2d"</tt> pad
+         *            the value with spaces.
+         * \return the formatted string
+         */
+        static std::string formatTime(double seconds, const std::string &format);
+
+    private:
+        const common::Configuration &m_config;
+        std::string m_outputFile;
+        int m_width;
+        int m_height;
+        std::string m_xLabel;
+        std::string m_yLabel;
+        std::string m_y2Label;
+        std::string m_timeFormat;
+        std::string m_xMin;
+        std::string m_xMax;
+        double m_xTicInterval;
+        std::string m_xTicFormat;
+        std::vector<Tic> m_xTics;
+        double m_yMin;
+        double m_yMax;
+        std::vector<Tic> m_y2Tics;
+        int m_grid;
+        double m_boxWidth;
+        std::vector<Series> m_series;
+};
+
+/* }}} */
+/* WeatherChart {{{ */
+
+/**
+ * \class WeatherChart
+ * \brief Chart with weather specific helper functions
+ *
+ * \author Bernhard Walle <bernhard@bwalle.de>
+ * \ingroup report
+ */
+class WeatherChart : public Chart
+{
+    public:
+        /**
+         * \brief C'tor
+         *
+         * \param[in] config the application's configuration
+         */
+        WeatherChart(const common::Configuration &config);
+
+    public:
+        /**
+         * \brief Adds a wind Y axis (km/h) and a Beaufort Y2 axis.
+         *
+         * Also sets the grid to the x tics and the Beaufort tics.
+         */
+        void addWindY();
+};
+
+/* }}} */
+
+} // end namespace reportgen
+} // end namespace vetero
+
+#endif // VETERO_REPORTGEN_CHART_H_
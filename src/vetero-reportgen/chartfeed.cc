@@ -0,0 +1,247 @@
+/* {{{
+ * (c) 2022, Bernhard Walle <bernhard@bwalle.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>. }}}
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+
+#include <libbw/log/debug.h>
+
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+
+#include "common/outputfile.h"
+#include "chartfeed.h"
+
+namespace vetero {
+namespace reportgen {
+
+/* ChartFeed {{{ */
+
+namespace {
+
+typedef rapidjson::Writer<rapidjson::StringBuffer> JsonWriter;
+
+// more decimals than the sensors deliver, keeps the integers far away from overflows
+const int MAX_DECIMALS = 6;
+
+// the feeds are small and written rarely compared to how often they are downloaded
+const int FEED_COMPRESSION = 9;
+
+// number of decimals of a value in the data like "12.25"
+int decimals(const std::string &value)
+{
+    if (value.find_first_of("eE") != std::string::npos)
+        return MAX_DECIMALS;
+
+    std::string::size_type dot = value.find('.');
+    if (dot == std::string::npos)
+        return 0;
+
+    int count = 0;
+    for (size_t i = dot + 1; i < value.size(); ++i) {
+        if (!std::isdigit(static_cast<unsigned char>(value[i])))
+            break;
+        count++;
+    }
+
+    return std::min(count, MAX_DECIMALS);
+}
+
+const char *styleName(Chart::Style style)
+{
+    switch (style) {
+        case Chart::Lines:          return "lines";
+        case Chart::LinesPoints:    return "linespoints";
+        case Chart::Points:         return "points";
+        case Chart::Boxes:          return "boxes";
+        case Chart::Impulses:       return "impulses";
+    }
+    return "lines";
+}
+
+const char *pointTypeName(Chart::PointType pointType)
+{
+    return pointType == Chart::Triangle ? "triangle" : "circle";
+}
+
+void writeTics(JsonWriter &writer, const std::vector<Chart::Tic> &tics)
+{
+    writer.StartArray();
+    for (size_t i = 0; i < tics.size(); ++i) {
+        writer.StartArray();
+        writer.Double(tics[i].position);
+        writer.String(tics[i].label.c_str());
+        writer.EndArray();
+    }
+    writer.EndArray();
+}
+
+// "scale" and the delta-encoded "values", NaN is a missing value
+void writeValues(JsonWriter &writer, const std::vector<double> &values, int decimals)
+{
+    double scale = std::pow(10.0, decimals);
+
+    writer.Key("scale");
+    writer.Int64(static_cast<int64_t>(scale));
+    writer.Key("values");
+    writer.StartArray();
+    int64_t previous = 0;
+    for (size_t i = 0; i < values.size(); ++i) {
+        if (std::isnan(values[i])) {
+            writer.Null();
+            continue;
+        }
+        int64_t value = std::llround(values[i] * scale);
+        writer.Int64(value - previous);
+        previous = value;
+    }
+    writer.EndArray();
+}
+
+} // anonymous namespace
+
+void ChartFeed::write(const Chart &chart, const Chart::StringStringVector &data)
+{
+    std::string feedName = Chart::dataFeedName(chart.outputFile());
+    BW_DEBUG_DBG("Writing data feed '%s'", feedName.c_str());
+
+    common::OutputFile file(feedName, FEED_COMPRESSION);
+    file.write(json(chart, data));
+    file.commit();
+}
+
+std::string ChartFeed::json(const Chart &chart, const Chart::StringStringVector &data)
+{
+    const std::vector<Chart::Series> &series = chart.series();
+    std::vector< std::vector<Point> > points = layout(chart, data);
+
+    // only rows with a valid x value are part of the feed
+    std::vector<double> xValues;
+    std::vector< std::vector<double> > yValues(series.size());
+    int xDecimals = 0;
+    std::vector<int> yDecimals(series.size(), 0);
+
+    for (size_t i = 0; i < data.size(); ++i) {
+        if (data[i].empty())
+            continue;
+
+        bool ok;
+        double x = chart.parseX(data[i][0], ok);
+        if (!ok)
+            continue;
+
+        xValues.push_back(x);
+        if (!chart.timeAxis())
+            xDecimals = std::max(xDecimals, decimals(data[i][0]));
+
+        for (size_t j = 0; j < series.size(); ++j) {
+            const Point &point = points[j][i];
+            yValues[j].push_back(point.valid ? point.y : NAN);
+            if (point.valid)
+                yDecimals[j] = std::max(yDecimals[j], decimals(data[i][series[j].column - 1]));
+        }
+    }
+
+    rapidjson::StringBuffer buffer;
+    JsonWriter writer(buffer);
+
+    writer.StartObject();
+
+    writer.Key("version");
+    writer.Int(1);
+    writer.Key("time");
+    writer.Bool(chart.timeAxis());
+    writer.Key("xLabel");
+    writer.String(chart.xLabel().c_str());
+    writer.Key("yLabel");
+    writer.String(chart.yLabel().c_str());
+    writer.Key("y2Label");
+    writer.String(chart.y2Label().c_str());
+
+    writer.Key("xAxis");
+    writer.StartObject();
+    writer.Key("min");
+    writer.Double(currentXAxis().min);
+    writer.Key("max");
+    writer.Double(currentXAxis().max);
+    writer.Key("tics");
+    writeTics(writer, currentXAxis().tics);
+    writer.EndObject();
+
+    writer.Key("yAxis");
+    writer.StartObject();
+    writer.Key("min");
+    writer.Double(currentYAxis().min);
+    writer.Key("max");
+    writer.Double(currentYAxis().max);
+    writer.Key("tics");
+    writeTics(writer, currentYAxis().tics);
+    writer.EndObject();
+
+    writer.Key("y2Tics");
+    writeTics(writer, chart.y2Tics());
+
+    writer.Key("grid");
+    writer.StartArray();
+    if (chart.grid() & Chart::GridX)
+        writer.String("x");
+    if (chart.grid() & Chart::GridY)
+        writer.String("y");
+    if (chart.grid() & Chart::GridY2)
+        writer.String("y2");
+    writer.EndArray();
+
+    writer.Key("boxWidth");
+    writer.Double(chart.boxWidth());
+
+    writer.Key("x");
+    writer.StartObject();
+    writeValues(writer, xValues, xDecimals);
+    writer.EndObject();
+
+    writer.Key("series");
+    writer.StartArray();
+    for (size_t i = 0; i < series.size(); ++i) {
+        writer.StartObject();
+        writer.Key("style");
+        writer.String(styleName(series[i].style));
+        writer.Key("title");
+        writer.String(series[i].title.c_str());
+        writer.Key("color");
+        writer.String(series[i].color.c_str());
+        writer.Key("lineWidth");
+        writer.Double(series[i].lineWidth);
+        writer.Key("pointType");
+        writer.String(pointTypeName(series[i].pointType));
+        writer.Key("pointSize");
+        writer.Double(series[i].pointSize);
+        writeValues(writer, yValues[i], yDecimals[i]);
+        writer.EndObject();
+    }
+    writer.EndArray();
+
+    writer.EndObject();
+
+    return std::string(buffer.GetString(), buffer.GetSize());
+}
+
+/* }}} */
+
+} // end namespace reportgen
+} // end namespace vetero
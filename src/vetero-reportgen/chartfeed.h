@@ -0,0 +1,93 @@
+/* {{{
+ * (c) 2022, Bernhard Walle <bernhard@bwalle.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>. }}}
+ */
+#ifndef VETERO_REPORTGEN_CHARTFEED_H_
+#define VETERO_REPORTGEN_CHARTFEED_H_
+
+#include <string>
+#include <vector>
+
+#include "common/error.h"
+#include "chart.h"
+#include "svgchartrenderer.h"
+
+namespace vetero {
+namespace reportgen {
+
+/* ChartFeed {{{ */
+
+/**
+ * \class ChartFeed
+ * \brief Writes the data of a Chart as compact JSON feed for client-side rendering
+ *
+ * The feed is written gzip'd next to the diagram, see Chart::dataFeedName(). It contains the
+ * description of the chart and the axes as SvgChartRenderer computes them, so that the browser
+ * (<tt>share/vetero-chart.js</tt>) draws the same diagram before the user zooms in:
+ *
+ * \code
+ * {
+ *   "version": 1,
+ *   "time": true,
+ *   "xLabel": "", "yLabel": "Temperature [°C]", "y2Label": "",
+ *   "xAxis": { "min": 0, "max": 86400, "tics": [[0, "00:00"], ...] },
+ *   "yAxis": { "min": -5, "max": 10, "tics": [[-5, "-5"], ...] },
+ *   "y2Tics": [], "grid": ["x", "y"], "boxWidth": 0,
+ *   "x": { "scale": 1, "values": [300, 300, 300, ...] },
+ *   "series": [
+ *     { "style": "lines", "title": "Temperature", "color": "#CC0000", "lineWidth": 2,
+ *       "pointType": "circle", "pointSize": 1,
+ *       "scale": 10, "values": [-23, 1, null, -2, ...] }
+ *   ]
+ * }
+ * \endcode
+ *
+ * The values are delta-encoded integers: the first value is absolute, each following one is
+ * the difference to the previous valid value. Dividing by \c scale gives the real value. The
+ * scale is chosen from the number of decimals in the data, so no precision is lost. Missing
+ * values are \c null, the x values of a time axis are seconds.
+ *
+ * \author Bernhard Walle <bernhard@bwalle.de>
+ * \ingroup report
+ */
+class ChartFeed : private SvgChartRenderer
+{
+    public:
+        /**
+         * \brief Writes the feed of \p chart to Chart::dataFeedName() of its output file
+         *
+         * \param[in] chart the description of the diagram
+         * \param[in] data the data with the x values in the first column
+         * \exception common::ApplicationError if the file cannot be written, the old file
+         *            is kept then
+         */
+        void write(const Chart &chart, const Chart::StringStringVector &data);
+
+        /**
+         * \brief Creates the feed of \p chart
+         *
+         * \param[in] chart the description of the diagram
+         * \param[in] data the data with the x values in the first column
+         * \return the JSON document
+         */
+        std::string json(const Chart &chart, const Chart::StringStringVector &data);
+};
+
+/* }}} */
+
+} // end namespace reportgen
+} // end namespace vetero
+
+#endif // VETERO_REPORTGEN_CHARTFEED_H_
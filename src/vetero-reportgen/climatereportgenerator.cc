@@ -0,0 +1,324 @@
+/* {{{
+ * (c) 2022, Bernhard Walle <bernhard@bwalle.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>. }}}
+ */
+
+#include <libbw/log/debug.h>
+#include <libbw/stringutil.h>
+#include <libbw/fileutils.h>
+
+#include "common/translation.h"
+#include "common/dbaccess.h"
+#include "common/utils.h"
+#include "climatereportgenerator.h"
+#include "chart.h"
+#include "calendar.h"
+
+namespace vetero {
+namespace reportgen {
+
+namespace {
+
+// day of the year of the first day of each month in a leap year, the x axis of the
+// temperature diagram has room for February 29th
+const int monthStartDays[] = { 1, 32, 61, 92, 122, 153, 183, 214, 245, 275, 306, 336 };
+
+} // anonymous namespace
+
+ClimateReportGenerator::ClimateReportGenerator(VeteroReportgen *reportGenerator)
+    : ReportGenerator(reportGenerator)
+{}
+
+void ClimateReportGenerator::generateReports()
+{
+    BW_DEBUG_INFO("Generating climate report");
+
+    std::string fingerprint;
+    try {
+        common::DbAccess dbAccess(&reportgen()->database());
+        m_lastDayStr = dbAccess.readMiscEntry(common::DbAccess::ClimateNormalsDate);
+        fingerprint = dbAccess.climateNormalsFingerprint();
+    } catch (const common::DatabaseError &err) {
+        throw common::ApplicationError("DB error: " + std::string(err.what()));
+    }
+
+    if (m_lastDayStr.size() != 10) {
+        BW_DEBUG_DBG("No climate normals available");
+        return;
+    }
+    m_yearString = m_lastDayStr.substr(0, 4);
+
+    // the normals change when veterod adds a day or vetero-db recomputes them
+    std::string report = "climate";
+    if (upToDate(report, fingerprint, nameProvider().climateIndex())) {
+        BW_DEBUG_DBG("Climate report for %s is up to date", m_lastDayStr.c_str());
+        return;
+    }
+
+    try {
+        bw::FileUtils::mkdir(nameProvider().climateDir(), true);
+    } catch (const bw::Error &err) {
+        throw common::ApplicationError(err.what());
+    }
+
+    try {
+        ThreadPool &threadPool = reportgen()->threadPool();
+        TaskGroup diagrams;
+
+        threadPool.run(diagrams, [this]() { createTemperatureDiagram(); });
+        threadPool.run(diagrams, [this]() { createRainDiagram(); });
+
+        threadPool.wait(diagrams);
+
+        createHtml();
+    } catch (const common::DatabaseError &err) {
+        throw common::ApplicationError("DB error: " + std::string(err.what()));
+    }
+
+    markGenerated(report, fingerprint);
+}
+
+void ClimateReportGenerator::createTemperatureDiagram()
+{
+    common::Database::Result result = reportgen()->database().executeSqlQuery(
+        "SELECT    CAST(strftime('%%j', '2000-' || n.day) AS INTEGER), "
+        "          n.temp_avg_p10, n.temp_avg_p90, n.temp_avg, "
+        "          n.temp_max_record, n.temp_min_record, c.temp_avg "
+        "FROM      climate_day_normals_float n "
+        "LEFT JOIN day_statistics_float c "
+        "          ON c.date = ? || '-' || n.day AND c.date <= ? "
+        "ORDER BY  n.day",
+        m_yearString.c_str(), m_lastDayStr.c_str()
+    );
+
+    Chart chart(reportgen()->configuration());
+    chart.setOutputFile(nameProvider().climateDiagram("temperature"));
+    chart.setXLabel(_("Month"));
+    chart.setYLabel(_("Temperature [°C]"));
+    chart.setGrid(Chart::GridX | Chart::GridY);
+    chart.setXRange("0.5", "366.5");
+    chart.setXTics(buildxticksDays());
+    chart.addSeries(2, Chart::Lines, "#AAAAAA", 1, "P10");
+    chart.addSeries(3, Chart::Lines, "#AAAAAA", 1, "P90");
+    chart.addSeries(4, Chart::Lines, "#555555", 2, _("Normal"));
+    chart.addSeries(5, Chart::Points, "#FF0000", 1, _("Record max"), Chart::Triangle, 0.5);
+    chart.addSeries(6, Chart::Points, "#0022FF", 1, _("Record min"), Chart::Triangle, 0.5);
+    chart.addSeries(7, Chart::Lines, "#00AA00", 2, m_yearString);
+    chart.plot(result.data);
+}
+
+void ClimateReportGenerator::createRainDiagram()
+{
+    common::Database::Result result = reportgen()->database().executeSqlQuery(
+        "SELECT    CAST(n.month AS INTEGER), n.rain, c.rain, n.rain_p90 "
+        "FROM      climate_month_normals_float n "
+        "LEFT JOIN month_statistics_float c "
+        "          ON c.month = ? || '-' || n.month AND c.month <= substr(?, 1, 7) "
+        "ORDER BY  n.month",
+        m_yearString.c_str(), m_lastDayStr.c_str()
+    );
+
+    Chart chart(reportgen()->configuration());
+    chart.setOutputFile(nameProvider().climateDiagram("rain"));
+    chart.setXLabel(_("Month"));
+    chart.setYLabel(_("Rain [l/m²]"));
+    chart.setGrid(Chart::GridX | Chart::GridY);
+    chart.setXRange("0.5", "12.5");
+    chart.setXTics(buildxticksMonths());
+    chart.setBoxWidth(0.8);
+    chart.addSeries(2, Chart::Boxes, "#ADD0FF", 1, _("Normal"));
+    chart.addSeries(3, Chart::Impulses, "#0000FF", 4, m_yearString);
+    chart.addSeries(4, Chart::Points, "#555555", 1, "P90", Chart::Circle, 1);
+    chart.plot(result.data);
+}
+
+void ClimateReportGenerator::createHtml()
+{
+    std::string filename(nameProvider().climateIndex());
+    HtmlDocument html(reportgen());
+
+    html.setTitle(_("Climate"));
+    html.setUpNavigation("", "");
+
+    bw::Datetime lastDay = bw::Datetime::strptime(m_lastDayStr, "%Y-%m-%d");
+    html << "<p>" << common::str_printf(_("Normals of all years until %s."),
+                                        lastDay.strftime(_("%Y-%m-%d")).c_str())
+         << "</p>\n";
+
+    html.addSection(_("Temperature compared to the normals"), _("Temperature"), "temperature");
+    html.chart(nameProvider().climateDiagramLink("temperature"));
+    html.addTopLink();
+
+    html.addSection(_("Rain compared to the normals"), _("Rain"), "rain");
+    html.chart(nameProvider().climateDiagramLink("rain"));
+    html.addTopLink();
+
+    html.addSection(_("Monthly normals"), _("Values"), "numeric");
+    createTable(html);
+    html.addTopLink();
+
+    if (!html.write(filename))
+        throw common::ApplicationError("Unable to write HTML documentation to '"+ filename +"'");
+}
+
+void ClimateReportGenerator::createTable(HtmlDocument &html)
+{
+    enum Column {
+        ColMonth, ColYears, ColTempAvg, ColTempP10, ColTempP90, ColTempMin, ColTempMax,
+        ColTempMinRecord, ColTempMinRecordDate, ColTempMaxRecord, ColTempMaxRecordDate,
+        ColRain, ColRainP90, ColRainRecord, ColRainRecordDate,
+        ColCurrentTemp, ColCurrentTempDiff, ColCurrentRain, ColCurrentRainPercent
+    };
+
+    // the current year only for complete months
+    common::Database::Result result = reportgen()->database().executeSqlQuery(
+        "SELECT    n.month, n.years, "
+        "          n.temp_avg, n.temp_avg_p10, n.temp_avg_p90, n.temp_min, n.temp_max, "
+        "          n.temp_min_record, n.temp_min_record_date, "
+        "          n.temp_max_record, n.temp_max_record_date, "
+        "          n.rain, n.rain_p90, n.rain_record, n.rain_record_date || '-01', "
+        "          c.temp_avg, ROUND(c.temp_avg - n.temp_avg, 1), "
+        "          c.rain, CAST(ROUND(100.0 * c.rain / NULLIF(n.rain, 0)) AS INTEGER) "
+        "FROM      climate_month_normals_float n "
+        "LEFT JOIN month_statistics_float c "
+        "          ON c.month = ? || '-' || n.month "
+        "          AND c.month < strftime('%%Y-%%m', ?, '+1 day') "
+        "ORDER BY  n.month",
+        m_yearString.c_str(), m_lastDayStr.c_str()
+    );
+
+    html << "<table border='0' bgcolor='#000000' cellspacing='1' cellpadding='0' >\n"
+         << "<tr bgcolor='#FFFFFF'>\n"
+         << "  <th style='padding: 5px' colspan=\"2\"><b></b></th>\n"
+         << "  <th style='padding: 5px' colspan=\"5\"><b>" << _("temperature") << "</b></th>\n"
+         << "  <th style='padding: 5px' colspan=\"3\"><b>" << _("rain") << "</b></th>\n"
+         << "  <th style='padding: 5px' colspan=\"4\"><b>" << m_yearString << "</b></th>\n"
+         << "</tr>\n"
+         << "<tr bgcolor='#FFFFFF'>\n"
+         << "  <th style='padding: 5px'><b>" << _("month") << "</b></th>\n"
+         << "  <th style='padding: 5px'><b>" << _("years") << "</b></th>\n"
+         << "  <th style='padding: 5px'><b>⌀</b></th>\n"
+         << "  <th style='padding: 5px'><b>P10 – P90</b></th>\n"
+         << "  <th style='padding: 5px'><b>⌀ min / max</b></th>\n"
+         << "  <th style='padding: 5px'><b>" << _("record min") << "</b></th>\n"
+         << "  <th style='padding: 5px'><b>" << _("record max") << "</b></th>\n"
+         << "  <th style='padding: 5px'><b>⌀</b></th>\n"
+         << "  <th style='padding: 5px'><b>P90</b></th>\n"
+         << "  <th style='padding: 5px'><b>" << _("record") << "</b></th>\n"
+         << "  <th style='padding: 5px'><b>⌀</b></th>\n"
+         << "  <th style='padding: 5px'><b>Δ</b></th>\n"
+         << "  <th style='padding: 5px'><b>" << _("rain") << "</b></th>\n"
+         << "  <th style='padding: 5px'><b>%</b></th>\n"
+         << "</tr>\n";
+
+    for (size_t i = 0; i < result.data.size(); i++) {
+        const std::vector<std::string> &row = result.data[i];
+        int month = bw::from_str<int>(row.at(ColMonth));
+
+        html << "<tr bgcolor='#FFFFFF'>\n"
+             << "<td style='padding: 5px'>" << Calendar::monthAbbreviation(month) << "</td>\n"
+             << "<td align='right' style='padding: 5px'>" << row[ColYears] << "</td>\n"
+             << "<td align='right' style='padding: 5px'>"
+             << formatValue(row[ColTempAvg], "°C") << "</td>\n"
+             << "<td align='right' style='padding: 5px'>"
+             << formatValue(row[ColTempP10], NULL) << " – " << formatValue(row[ColTempP90], "°C")
+             << "</td>\n"
+             << "<td align='right' style='padding: 5px'>"
+             << formatValue(row[ColTempMin], NULL) << " / " << formatValue(row[ColTempMax], "°C")
+             << "</td>\n"
+             << "<td align='right' style='padding: 5px'>"
+             << formatRecord(row[ColTempMinRecord], row[ColTempMinRecordDate], "°C") << "</td>\n"
+             << "<td align='right' style='padding: 5px'>"
+             << formatRecord(row[ColTempMaxRecord], row[ColTempMaxRecordDate], "°C") << "</td>\n"
+             << "<td align='right' style='padding: 5px'>"
+             << formatValue(row[ColRain], "l/m²") << "</td>\n"
+             << "<td align='right' style='padding: 5px'>"
+             << formatValue(row[ColRainP90], "l/m²") << "</td>\n"
+             << "<td align='right' style='padding: 5px'>"
+             << formatRecord(row[ColRainRecord], row[ColRainRecordDate], "l/m²", true) << "</td>\n"
+             << "<td align='right' style='padding: 5px'>"
+             << formatValue(row[ColCurrentTemp], "°C") << "</td>\n"
+             << "<td align='right' style='padding: 5px'>"
+             << formatValue(row[ColCurrentTempDiff], "K", true) << "</td>\n"
+             << "<td align='right' style='padding: 5px'>"
+             << formatValue(row[ColCurrentRain], "l/m²") << "</td>\n"
+             << "<td align='right' style='padding: 5px'>"
+             << (row[ColCurrentRainPercent].empty() ? "–" : row[ColCurrentRainPercent])
+             << "</td>\n"
+             << "</tr>\n";
+    }
+
+    html << "</table>\n";
+}
+
+std::string ClimateReportGenerator::formatValue(const std::string &value, const char *unit,
+                                                bool sign) const
+{
+    if (value.empty())
+        return "–";
+
+    std::string localeStr = reportgen()->configuration().locale();
+    double numericValue = bw::from_str<double>(value, std::locale::classic());
+    std::string result = common::str_printf_l(sign ? "%+.1lf" : "%.1lf", localeStr.c_str(),
+                                              numericValue);
+    if (unit)
+        result += " " + std::string(unit);
+
+    return result;
+}
+
+std::string ClimateReportGenerator::formatRecord(const std::string &value,
+                                                 const std::string &date,
+                                                 const char *unit, bool monthly) const
+{
+    std::string result = formatValue(value, unit);
+    if (value.empty() || date.empty())
+        return result;
+
+    // the rain records are the sums of months, the temperature records single days
+    bw::Datetime recordDate = bw::Datetime::strptime(date, "%Y-%m-%d");
+    std::string link = monthly
+        ? nameProvider().monthlyDirLink(recordDate)
+        : nameProvider().dailyDirLink(recordDate);
+    std::string dateStr = recordDate.strftime(monthly ? _("%B %Y") : _("%Y-%m-%d"));
+
+    return result + "<br/><small><a href='" + link + "'>" + dateStr + "</a></small>";
+}
+
+std::vector<Chart::Tic> ClimateReportGenerator::buildxticksDays() const
+{
+    std::vector<Chart::Tic> tics;
+    for (int month = bw::Datetime::January; month <= bw::Datetime::December; month++) {
+        Chart::Tic tic = {
+            static_cast<double>(monthStartDays[month - bw::Datetime::January]),
+            Calendar::monthAbbreviation(month)
+        };
+        tics.push_back(tic);
+    }
+    return tics;
+}
+
+std::vector<Chart::Tic> ClimateReportGenerator::buildxticksMonths() const
+{
+    std::vector<Chart::Tic> tics;
+    for (int month = bw::Datetime::January; month <= bw::Datetime::December; month++) {
+        Chart::Tic tic = { static_cast<double>(month), Calendar::monthAbbreviation(month) };
+        tics.push_back(tic);
+    }
+    return tics;
+}
+
+} // end namespace reportgen
+} // end namespace vetero
@@ -0,0 +1,79 @@
+/* {{{
+ * (c) 2022, Bernhard Walle <bernhard@bwalle.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>. }}}
+ */
+#ifndef VETERO_REPORTGEN_CLIMATEREPORTGENERATOR_H_
+#define VETERO_REPORTGEN_CLIMATEREPORTGENERATOR_H_
+
+#include <libbw/datetime.h>
+
+#include "reportgenerator.h"
+#include "chart.h"
+#include "htmldocument.h"
+
+namespace vetero {
+namespace reportgen {
+
+/**
+ * \brief Creates the climate page that compares the current year with all years
+ *
+ * Shows the normals of each day of the year with the 10 % and 90 % percentiles and the
+ * records, the monthly normals as table and the rain of the months. The values of the
+ * current year are drawn into the diagrams. The normals are computed by veterod when a
+ * day is complete, see common::DbAccess::updateClimateNormals().
+ *
+ * \author Bernhard Walle <bernhard@bwalle.de>
+ * \ingroup report
+ */
+class ClimateReportGenerator : public ReportGenerator
+{
+    public:
+        /**
+         * \brief Creates a new instance
+         *
+         * \param[in] reportGenerator the appliation's main class
+         */
+        ClimateReportGenerator(VeteroReportgen *reportGenerator);
+
+        /**
+         * \brief Does the work.
+         *
+         * \exception common::ApplicationError if something failed
+         */
+        virtual void generateReports();
+
+    protected:
+        void createTemperatureDiagram();
+        void createRainDiagram();
+        void createHtml();
+        void createTable(HtmlDocument &html);
+        std::string formatValue(const std::string &value, const char *unit,
+                                bool sign=false) const;
+        std::string formatRecord(const std::string &value, const std::string &date,
+                                 const char *unit, bool monthly=false) const;
+
+        std::vector<Chart::Tic> buildxticksDays() const;
+        std::vector<Chart::Tic> buildxticksMonths() const;
+
+    private:
+        // last day that is part of the normals (YYYY-MM-DD)
+        std::string m_lastDayStr;
+        std::string m_yearString;
+};
+
+} // end namespace reportgen
+} // end namespace vetero
+
+#endif // VETERO_REPORTGEN_CLIMATEREPORTGENERATOR_H_
@@ -16,8 +16,6 @@
  */
 
 #include <iostream>
-#include <fstream>
-#include <unistd.h>
 
 #include <libbw/log/errorlog.h>
 #include <libbw/log/debug.h>
@@ -29,11 +27,12 @@
 
 #include "common/translation.h"
 #include "common/dbaccess.h"
+#include "common/outputfile.h"
 #include "common/utils.h"
 #include "htmldocument.h"
+#include "svgtemplate.h"
 #include "vetero_reportgen.h"
 #include "currentreportgenerator.h"
-#include "config.h"
 
 namespace vetero {
 namespace reportgen {
@@ -64,6 +63,46 @@ std::string translateWind(const std::string &englishDirection)
     return gettext(englishDirection.c_str());
 }
 
+namespace {
+
+// the order of the placeholders matters, see SvgTemplate
+enum TemplateSlot {
+    SlotTemperature,
+    SlotDewpoint,
+    SlotTimestamp,
+    SlotHumidity,
+    SlotWindSpeed,
+    SlotWindBeaufort,
+    SlotWindGust,
+    SlotWindGustBeaufort,
+    SlotWindDirectionDegrees,
+    SlotWindDirection,
+    SlotRain,
+    SlotPressure,
+    SlotSolarRadiation,
+    SlotUvIndex,
+    SlotCount
+};
+
+const char *templatePlaceholders[SlotCount] = {
+    "TT.T",
+    "DD.D",
+    "UUUU-UU-UU UU:UU",
+    "HH",
+    "WW.W",
+    "WB",
+    "GG.G",
+    "WG",
+    "WDD",
+    "WD",
+    "RR.R",
+    "PPPP",
+    "SSSS",
+    "UUU"
+};
+
+} // anonymous namespace
+
 CurrentReportGenerator::CurrentReportGenerator(VeteroReportgen *reportGenerator)
     : ReportGenerator(reportGenerator)
 {}
@@ -87,150 +126,78 @@ void CurrentReportGenerator::createSVG(const common::CurrentWeather &currentWeat
 {
     BW_DEBUG_INFO("Updating current_weather.svgz");
 
-    std::string templateFile = findTemplate();
+    std::string templateFile = reportgen()->findShareFile("current_weather.svg");
     if (templateFile.empty())
         throw common::ApplicationError("Unable to find SVG template");
 
-    std::ifstream input(templateFile.c_str());
-    std::string reportDir(reportgen()->configuration().reportDirectory());
-    std::string outputfilename = reportDir + "/current_weather.svgz";
-
-    std::ofstream output(outputfilename.c_str());
-    if (!input.is_open() || !output.is_open())
-        throw common::ApplicationError("Unable to open input/output file when generating SVG");
-
-    std::string line;
-    while (std::getline(input, line)) {
-        std::string::size_type pos;
-
-        std::string loc = reportgen()->configuration().locale();
-        std::string value;
-
-        pos = line.find("TT.T");
-        if (pos != std::string::npos) {
-            value = common::str_printf_l("%.1lf", loc.c_str(), currentWeather.temperatureReal());
-            line.replace(pos, 4, value);
-        }
-
-        pos = line.find("DD.D");
-        if (pos != std::string::npos) {
-            if (currentWeather.hasHumidity())
-                value = common::str_printf_l("%.1lf", loc.c_str(), currentWeather.dewpointReal());
-            else
-                value = common::dashDecimalValue(loc, 2, 1);
-            line.replace(pos, 4, value);
-        }
-
-        pos = line.find("UUUU-UU-UU UU:UU");
-        if (pos != std::string::npos) {
-            value = currentWeather.timestamp().strftime(_("%Y-%m-%d %H:%M"));
-            line.replace(pos, 16, value);
-        }
-
-        pos = line.find("HH");
-        if (pos != std::string::npos) {
-            if (currentWeather.hasHumidity())
-                value = common::str_printf_l("%.0lf", loc.c_str(), currentWeather.humidityReal());
-            else
-                value = common::dashDecimalValue(loc, 2);
-            line.replace(pos, 2, value);
-        }
-
-        pos = line.find("WW.W");
-        if (pos != std::string::npos) {
-            if (currentWeather.hasWindSpeed())
-                value = common::str_printf_l("%.1lf", loc.c_str(), currentWeather.windSpeedReal());
-            else
-                value = common::dashDecimalValue(loc, 2, 1);
-            line.replace(pos, 4, value);
-        }
-
-        pos = line.find("WB");
-        if (pos != std::string::npos) {
-            if (currentWeather.hasWindSpeed())
-                value = common::str_printf_l("%d", loc.c_str(), currentWeather.windBeaufort());
-            else
-                value = common::dashDecimalValue(loc, 2);
-            line.replace(pos, 2, value);
-        }
-
-        pos = line.find("GG.G");
-        if (pos != std::string::npos) {
-            if (currentWeather.hasWindGust())
-                value = common::str_printf_l("%.1lf", loc.c_str(), currentWeather.windGustReal());
-            else
-                value = common::dashDecimalValue(loc, 2, 1);
-            line.replace(pos, 4, value);
-        }
-
-        pos = line.find("WG");
-        if (pos != std::string::npos) {
-            if (currentWeather.hasWindGust())
-                value = common::str_printf_l("%d", loc.c_str(), currentWeather.windGustBeaufort());
-            else
-                value = common::dashDecimalValue(loc, 2);
-            line.replace(pos, 2, value);
-        }
-
-        pos = line.find("WDD");
-        if (pos != std::string::npos) {
-            if (currentWeather.hasWindDirection())
-                value = std::to_string( (180 + currentWeather.windDirection()) % 360 );
-            else
-                value = "0";
-            line.replace(pos, 3, value);
-        }
-
-        pos = line.find("WD");
-        if (pos != std::string::npos) {
-            if (currentWeather.hasWindDirection())
-                value = translateWind( currentWeather.windDirectionStr() );
-            else
-                value = "---";
-            line.replace(pos, 2, value);
-        }
-
-        pos = line.find("RR.R");
-        if (pos != std::string::npos) {
-            if (currentWeather.hasRain())
-                value = common::str_printf_l("%.1lf", loc.c_str(), currentWeather.rainReal());
-            else
-                value = common::dashDecimalValue(loc, 2, 1);
-            line.replace(pos, 4, value);
-        }
-
-        pos = line.find("PPPP");
-        if (pos != std::string::npos) {
-            if (currentWeather.hasPressure())
-                value = common::str_printf_l("%4.0lf", loc.c_str(), currentWeather.pressureReal());
-            else
-                value = common::dashDecimalValue(loc, 4);
-            line.replace(pos, 4, value);
-        }
-
-        pos = line.find("SSSS");
-        if (pos != std::string::npos) {
-            if (currentWeather.hasSolarRadiation())
-                value = common::str_printf_l("%4.1lf", loc.c_str(), currentWeather.solarRadiationReal());
-            else
-                value = "----";
-            line.replace(pos, 4, value);
-        }
-
-        pos = line.find("UUU");
-        if (pos != std::string::npos) {
-            if (currentWeather.hasSolarRadiation())
-                value = std::to_string(currentWeather.uvIndex());
-            else
-                value = "---";
-            line.replace(pos, 3, value);
-        }
-
-        output << line;
+    std::vector<std::string> placeholders(templatePlaceholders,
+                                          templatePlaceholders + SlotCount);
+    std::shared_ptr<const SvgTemplate> svgTemplate = SvgTemplate::cached(templateFile, placeholders);
+
+    std::string loc = reportgen()->configuration().locale();
+    std::vector<std::string> values(SlotCount);
+
+    values[SlotTemperature] = common::str_printf_l("%.1lf", loc.c_str(), currentWeather.temperatureReal());
+
+    if (currentWeather.hasHumidity())
+        values[SlotDewpoint] = common::str_printf_l("%.1lf", loc.c_str(), currentWeather.dewpointReal());
+    else
+        values[SlotDewpoint] = common::dashDecimalValue(loc, 2, 1);
+
+    values[SlotTimestamp] = currentWeather.timestamp().strftime(_("%Y-%m-%d %H:%M"));
+
+    if (currentWeather.hasHumidity())
+        values[SlotHumidity] = common::str_printf_l("%.0lf", loc.c_str(), currentWeather.humidityReal());
+    else
+        values[SlotHumidity] = common::dashDecimalValue(loc, 2);
+
+    if (currentWeather.hasWindSpeed()) {
+        values[SlotWindSpeed] = common::str_printf_l("%.1lf", loc.c_str(), currentWeather.windSpeedReal());
+        values[SlotWindBeaufort] = common::str_printf_l("%d", loc.c_str(), currentWeather.windBeaufort());
+    } else {
+        values[SlotWindSpeed] = common::dashDecimalValue(loc, 2, 1);
+        values[SlotWindBeaufort] = common::dashDecimalValue(loc, 2);
+    }
+
+    if (currentWeather.hasWindGust()) {
+        values[SlotWindGust] = common::str_printf_l("%.1lf", loc.c_str(), currentWeather.windGustReal());
+        values[SlotWindGustBeaufort] = common::str_printf_l("%d", loc.c_str(), currentWeather.windGustBeaufort());
+    } else {
+        values[SlotWindGust] = common::dashDecimalValue(loc, 2, 1);
+        values[SlotWindGustBeaufort] = common::dashDecimalValue(loc, 2);
     }
 
-    output.close();
-    common::compress_file(outputfilename);
+    if (currentWeather.hasWindDirection()) {
+        values[SlotWindDirectionDegrees] = std::to_string( (180 + currentWeather.windDirection()) % 360 );
+        values[SlotWindDirection] = translateWind( currentWeather.windDirectionStr() );
+    } else {
+        values[SlotWindDirectionDegrees] = "0";
+        values[SlotWindDirection] = "---";
+    }
+
+    if (currentWeather.hasRain())
+        values[SlotRain] = common::str_printf_l("%.1lf", loc.c_str(), currentWeather.rainReal());
+    else
+        values[SlotRain] = common::dashDecimalValue(loc, 2, 1);
+
+    if (currentWeather.hasPressure())
+        values[SlotPressure] = common::str_printf_l("%4.0lf", loc.c_str(), currentWeather.pressureReal());
+    else
+        values[SlotPressure] = common::dashDecimalValue(loc, 4);
+
+    if (currentWeather.hasSolarRadiation()) {
+        values[SlotSolarRadiation] = common::str_printf_l("%4.1lf", loc.c_str(), currentWeather.solarRadiationReal());
+        values[SlotUvIndex] = std::to_string(currentWeather.uvIndex());
+    } else {
+        values[SlotSolarRadiation] = "----";
+        values[SlotUvIndex] = "---";
+    }
+
+    std::string reportDir(reportgen()->configuration().reportDirectory());
+    common::OutputFile output(reportDir + "/current_weather.svgz",
+                              reportgen()->configuration().reportSvgCompression());
+    output.write(svgTemplate->render(values));
+    output.commit();
 }
 
 void CurrentReportGenerator::createJSON(const common::CurrentWeather &weather)
@@ -277,31 +244,11 @@ void CurrentReportGenerator::createJSON(const common::CurrentWeather &weather)
     std::string reportDir(reportgen()->configuration().reportDirectory());
     std::string outputfilename = reportDir + "/current_weather.json";
 
-    std::ofstream output(outputfilename);
-    if (!output.is_open())
-        throw common::ApplicationError("Unable to open output file when generating SVG: " + outputfilename);
-
-    output << s.GetString() << std::endl;
-}
-
-std::string CurrentReportGenerator::findTemplate() const
-{
-    const char *templateFiles[] = {
-            "share/current_weather.svg",
-            INSTALL_PREFIX "/share/current_weather.svg"
-    };
-
-    for (size_t i = 0; i < sizeof(templateFiles)/sizeof(templateFiles[0]); i++) {
-        const char *file = templateFiles[i];
-
-        if (access(file, R_OK) == 0)
-            return std::string(file);
-    }
-
-    return std::string();
+    common::OutputFile output(outputfilename);
+    output.stream() << s.GetString() << std::endl;
+    output.commit();
 }
 
-
 /* }}} */
 
 } // end namespace vetero
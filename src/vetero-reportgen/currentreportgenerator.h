@@ -68,13 +68,6 @@ class CurrentReportGenerator : public ReportGenerator {
          * \return the text
          */
         std::string renderText(const common::CurrentWeather &currentWeather) const;
-
-        /**
-         * \brief Finds the template file on disk
-         *
-         * \return the path to the template or an empty string if the template could not be found
-         */
-        std::string findTemplate() const;
 };
 
 } // end namespace vetero
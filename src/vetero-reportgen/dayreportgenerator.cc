@@ -15,6 +15,8 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>. }}}
  */
 
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 
 #include <libbw/log/debug.h>
@@ -25,7 +27,7 @@
 #include "common/utils.h"
 #include "common/dbaccess.h"
 #include "dayreportgenerator.h"
-#include "gnuplot.h"
+#include "chart.h"
 #include "htmldocument.h"
 
 namespace vetero {
@@ -44,9 +46,17 @@ void DayReportGenerator::generateReports()
             common::DbAccess dbAccess(&reportgen()->database());
             std::vector<std::string> dates = dbAccess.dataDays();
 
+            // each report gets its own generator so that they can run in parallel
+            VeteroReportgen *reportgen = this->reportgen();
+            TaskGroup reports;
             std::vector<std::string>::const_iterator it;
-            for (it = dates.begin(); it != dates.end(); ++it)
-                generateOneReport(*it);
+            for (it = dates.begin(); it != dates.end(); ++it) {
+                std::string date = *it;
+                reportgen->threadPool().run(reports, [reportgen, date]() {
+                    DayReportGenerator(reportgen, date).generateReports();
+                });
+            }
+            reportgen->threadPool().wait(reports);
         } else
             generateOneReport(m_dateString);
     } catch (const common::DatabaseError &err) {
@@ -57,7 +67,6 @@ void DayReportGenerator::generateReports()
 void DayReportGenerator::generateOneReport(const std::string &date)
 {
     BW_DEBUG_INFO("Generating daily report for %s", date.c_str());
-    reset();
     m_dateString = date;
 
     if (m_dateString.size() != 10)
@@ -69,245 +78,196 @@ void DayReportGenerator::generateOneReport(const std::string &date)
 
     m_date = bw::Datetime(year, month, day, 0, 0, 0, false);
 
+    bw::Datetime yesterday(m_date);
+    yesterday.addDays(-1);
+    bw::Datetime tomorrow(m_date);
+    tomorrow.addDays(1);
+
+    const ValidDataCache &validDataCache = reportgen()->validDataCache();
+    std::string report = "day:" + m_dateString;
+    std::string fingerprint = dataFingerprint(m_dateString, m_dateString,
+                                              validDataCache.dataAtDay(yesterday),
+                                              validDataCache.dataAtDay(tomorrow));
+    if (upToDate(report, fingerprint, nameProvider().dailyIndex(m_date))) {
+        BW_DEBUG_DBG("Daily report for %s is up to date", m_dateString.c_str());
+        return;
+    }
+
+    m_series.load(reportgen()->database(), m_dateString);
+
     try {
         bw::FileUtils::mkdir(nameProvider().dailyDir(m_date), true);
     } catch (const bw::Error &err) {
         throw common::ApplicationError(err.what());
     }
 
-    createTemperatureDiagram();
+    // the diagrams are independent of each other
+    ThreadPool &threadPool = reportgen()->threadPool();
+    TaskGroup diagrams;
+
+    threadPool.run(diagrams, [this]() { createTemperatureDiagram(); });
     if (haveHumidityData())
-        createHumidityDiagram();
+        threadPool.run(diagrams, [this]() { createHumidityDiagram(); });
     if (haveWindData())
-        createWindDiagram();
+        threadPool.run(diagrams, [this]() { createWindDiagram(); });
     if (haveRainData())
-        createRainDiagram();
+        threadPool.run(diagrams, [this]() { createRainDiagram(); });
     if (haveSolarRadiationData())
-        createSolarRadiationDiagram();
+        threadPool.run(diagrams, [this]() { createSolarRadiationDiagram(); });
     if (havePressureData())
-        createPressureDiagram();
+        threadPool.run(diagrams, [this]() { createPressureDiagram(); });
+
+    threadPool.wait(diagrams);
 
     createHtml();
+    markGenerated(report, fingerprint);
 }
 
 void DayReportGenerator::createTemperatureDiagram()
 {
     BW_DEBUG_DBG("Generating temperature diagrams for %s", m_dateString.c_str());
 
-    common::Database::Result result = reportgen()->database().executeSqlQuery(
-        "SELECT   time(timestamp), temp, dewpoint "
-        "FROM     weatherdata_float "
-        "WHERE    jdate = julianday(?) "
-        "ORDER BY timestamp",
-        m_date.strftime("%Y-%m-%d 12:00").c_str()
-    );
-
-    Gnuplot plot(reportgen()->configuration());
-    plot.setWorkingDirectory(reportgen()->configuration().reportDirectory());
-    plot.setOutputFile(nameProvider().dailyDiagram(m_date, "temperature"));
-    plot << "set xlabel '"<< _("Time [HH:MM]") << "'\n";
-    plot << "set ylabel '" << _("Temperature [°C]") << "'\n";
-    plot << "set format x '%H:%M'\n";
-    plot << "set grid\n";
-    plot << "set timefmt '%H:%M:%S'\n";
-    plot << "set xdata time\n";
-    plot << "set xrange ['00:00:00' : '24:00:00']\n";
-    plot << "set xtics format '%H:%M'\n";
-    plot << "set xtics '02:00'\n";
-    plot << "plot '" << Gnuplot::PLACEHOLDER
-         << "' using 1:2 with lines title 'Temperatur' linecolor rgb '#CC0000' lw 2, "
-         << "'" << Gnuplot::PLACEHOLDER
-         << "' using 1:3 with lines title 'Taupunkt' linecolor rgb '#FF8500' lw 2\n";
-
-    plot.plot(result.data);
+    Chart chart(reportgen()->configuration());
+    chart.setOutputFile(nameProvider().dailyDiagram(m_date, "temperature"));
+    chart.setXLabel(_("Time [HH:MM]"));
+    chart.setTimeAxis("%H:%M:%S");
+    chart.setXRange("00:00:00", "24:00:00");
+    chart.setXTicInterval(2*3600, "%H:%M");
+    chart.setYLabel(_("Temperature [°C]"));
+    chart.setGrid(Chart::GridX | Chart::GridY);
+    chart.addSeries(2, Chart::Lines, "#CC0000", 2, "Temperatur");
+    chart.addSeries(3, Chart::Lines, "#FF8500", 2, "Taupunkt");
+
+    chart.plot(m_series.table({ DaySeries::Temperature, DaySeries::Dewpoint }));
 }
 
 void DayReportGenerator::createHumidityDiagram()
 {
     BW_DEBUG_DBG("Generating humidity diagrams for %s", m_dateString.c_str());
 
-    common::Database::Result result = reportgen()->database().executeSqlQuery(
-        "SELECT   time(timestamp), humid "
-        "FROM     weatherdata_float "
-        "WHERE    jdate = julianday(?)"
-        "ORDER BY timestamp",
-        m_date.strftime("%Y-%m-%d 12:00").c_str()
-    );
-
-    Gnuplot plot(reportgen()->configuration());
-    plot.setWorkingDirectory(reportgen()->configuration().reportDirectory());
-    plot.setOutputFile(nameProvider().dailyDiagram(m_date, "humidity"));
-    plot << "set xlabel '"<< _("Time [HH:MM]") << "'\n";
-    plot << "set ylabel '" << _("Humidity [%]") << "'\n";
-    plot << "set format x '%H:%M'\n";
-    plot << "set grid\n";
-    plot << "set timefmt '%H:%M:%S'\n";
-    plot << "set xdata time\n";
-    plot << "set xrange ['00:00:00' : '24:00:00']\n";
-    plot << "set xtics format '%H:%M'\n";
-    plot << "set xtics '02:00'\n";
-    plot << "plot '" << Gnuplot::PLACEHOLDER
-         << "' using 1:2 with lines notitle linecolor rgb '#3C8EFF' lw 2\n";
-
-    plot.plot(result.data);
+    Chart chart(reportgen()->configuration());
+    chart.setOutputFile(nameProvider().dailyDiagram(m_date, "humidity"));
+    chart.setXLabel(_("Time [HH:MM]"));
+    chart.setTimeAxis("%H:%M:%S");
+    chart.setXRange("00:00:00", "24:00:00");
+    chart.setXTicInterval(2*3600, "%H:%M");
+    chart.setYLabel(_("Humidity [%]"));
+    chart.setGrid(Chart::GridX | Chart::GridY);
+    chart.addSeries(2, Chart::Lines, "#3C8EFF", 2);
+
+    chart.plot(m_series.table({ DaySeries::Humidity }));
 }
 
 void DayReportGenerator::createWindDiagram()
 {
     BW_DEBUG_DBG("Generating wind diagrams for %s", m_dateString.c_str());
 
-    common::Database::Result result = reportgen()->database().executeSqlQuery(
-        "SELECT   time(timestamp), wind, IFNULL(wind_gust, -1.0) "
-        "FROM     weatherdata_float "
-        "WHERE    jdate = julianday(?) "
-        "ORDER BY timestamp",
-        m_date.strftime("%Y-%m-%d 12:00").c_str()
-    );
-    common::Database::Result maxResult = reportgen()->database().executeSqlQuery(
-        "SELECT ROUND(MAX(wind_max, wind_gust_max)) + 1, MAX(wind_gust_max) "
-        "FROM   day_statistics_float "
-        "WHERE  date = ?", m_dateString.c_str()
-    );
-
-    std::string max = "0.0";
-    if (maxResult.data.size() > 0 && maxResult.data.front().size() > 0)
-        max = maxResult.data.front()[0];
-    bool haveGust = !maxResult.data.front()[1].empty();
+    // leave some space above the highest gust, autoscale without gusts
+    bool haveGust = m_series.have(DaySeries::WindGust);
+    double max = NAN;
+    if (haveGust)
+        max = std::round(std::max(m_series.max(DaySeries::Wind), m_series.max(DaySeries::WindGust))) + 1;
 
     BW_DEBUG_TRACE("haveGust=%d", !!haveGust);
 
-    WeatherGnuplot plot(reportgen()->configuration());
-    plot.setWorkingDirectory(reportgen()->configuration().reportDirectory());
-    plot.setOutputFile(nameProvider().dailyDiagram(m_date, "wind"));
-    plot << "set xlabel '"<< _("Time [HH:MM]") << "'\n";
-    plot << "set format x '%H:%M'\n";
-    plot << "set grid\n";
-    plot << "set timefmt '%H:%M:%S'\n";
-    plot << "set xdata time\n";
-    plot << "set xrange ['00:00:00' : '24:00:00']\n";
-    plot << "set xtics format '%H:%M'\n";
-    plot << "set xtics '02:00'\n";
-    plot.addWindY();
-    plot << "set yrange [0 : " << max << "]\n";
-    plot << "plot '" << Gnuplot::PLACEHOLDER << "' using 1:2 notitle with lines  "
-            "linecolor rgb '#3C8EFF' lw 2";
+    WeatherChart chart(reportgen()->configuration());
+    chart.setOutputFile(nameProvider().dailyDiagram(m_date, "wind"));
+    chart.setXLabel(_("Time [HH:MM]"));
+    chart.setTimeAxis("%H:%M:%S");
+    chart.setXRange("00:00:00", "24:00:00");
+    chart.setXTicInterval(2*3600, "%H:%M");
+    chart.addWindY();
+    chart.setYRange(0, max);
+    chart.addSeries(2, Chart::Lines, "#3C8EFF", 2);
     if (haveGust)
-        plot << ", '" << Gnuplot::PLACEHOLDER << "' using 1:3 with points title 'Böen' "
-            "pt 9 ps 1 linecolor rgb '#180076' lw 2";
-    plot << "\n";
+        chart.addSeries(3, Chart::Points, "#180076", 2, "Böen", Chart::Triangle, 1);
+
+    // the peaks are more interesting than the shape
+    chart.setDownsampling(2, Chart::DownsampleEnvelope);
+    chart.setDownsampling(3, Chart::DownsampleEnvelope);
 
-    plot.plot(result.data, haveGust ? 2 : 1);
+    chart.plot(m_series.table({ DaySeries::Wind, DaySeries::WindGust }));
 }
 
 void DayReportGenerator::createRainDiagram()
 {
     BW_DEBUG_DBG("Generating rain diagrams for %s", m_dateString.c_str());
 
-    common::Database::Result result = reportgen()->database().executeSqlQuery(
-        "SELECT   time(timestamp), rain "
-        "FROM     weatherdata_float "
-        "WHERE    jdate = julianday(?)"
-        "ORDER BY timestamp",
-        m_date.strftime("%Y-%m-%d 12:00").c_str()
-    );
-
-    // accumulate the rain
+    // accumulate the rain, missing values count as no rain
+    Chart::StringStringVector data(m_series.size());
     double sum = 0.0;
-    for (int i = 0; i < result.data.size(); ++i) {
-        sum += bw::from_str<double>( result.data[i].at(1) );
-        result.data[i].at(1) = bw::str(sum);
+    for (size_t i = 0; i < m_series.size(); ++i) {
+        sum += m_series.value(DaySeries::Rain, i);
+        data[i].push_back(m_series.time(i));
+        data[i].push_back(bw::str(sum));
     }
 
-    Gnuplot plot(reportgen()->configuration());
-    plot.setWorkingDirectory(reportgen()->configuration().reportDirectory());
-    plot.setOutputFile(nameProvider().dailyDiagram(m_date, "rain"));
-    plot << "set xlabel '"<< _("Time [HH:MM]") << "'\n";
-    plot << "set ylabel '" << _("Rain [l/m²]") << "'\n";
-    plot << "set format x '%H:%M'\n";
-    plot << "set grid\n";
-    plot << "set timefmt '%H:%M:%S'\n";
-    plot << "set xdata time\n";
-    plot << "set xtics format '%H:%M'\n";
-    plot << "set xtics '02:00'\n";
+    Chart chart(reportgen()->configuration());
+    chart.setOutputFile(nameProvider().dailyDiagram(m_date, "rain"));
+    chart.setXLabel(_("Time [HH:MM]"));
+    chart.setTimeAxis("%H:%M:%S");
+    chart.setXRange("00:00:00", "24:00:00");
+    chart.setXTicInterval(2*3600, "%H:%M");
+    chart.setYLabel(_("Rain [l/m²]"));
+    chart.setGrid(Chart::GridX | Chart::GridY);
 
     // there might be days with no rain :-)
     if (sum < 0.001)
-        plot << "set yrange [0:1]\n";
+        chart.setYRange(0, 1);
     else
-        plot << "set yrange [0:]\n";
+        chart.setYRange(0, NAN);
 
-    plot << "set xrange ['00:00:00' : '24:00:00']\n";
-    plot << "set style fill solid 1.0 border\n";
-    plot << "plot '" << Gnuplot::PLACEHOLDER
-         << "' using 1:2 with boxes notitle linecolor rgb '#ADD0FF' lw 2\n";
+    chart.addSeries(2, Chart::Boxes, "#ADD0FF", 2);
 
-    plot.plot(result.data);
+    chart.plot(data);
 }
 
 void DayReportGenerator::createSolarRadiationDiagram()
 {
     BW_DEBUG_DBG("Solar radiation diagram for %s", m_dateString.c_str());
 
-    common::Database::Result result = reportgen()->database().executeSqlQuery(
-        "SELECT   time(timestamp), solar_radiation "
-        "FROM     weatherdata_float "
-        "WHERE    jdate = julianday(?) "
-        "ORDER BY timestamp",
-        m_date.strftime("%Y-%m-%d 12:00").c_str()
-    );
-
-    WeatherGnuplot plot(reportgen()->configuration());
-    plot.setWorkingDirectory(reportgen()->configuration().reportDirectory());
-    plot.setOutputFile(nameProvider().dailyDiagram(m_date, "solar"));
-    plot << "set xlabel '"<< _("Time [HH:MM]") << "'\n";
-    plot << "set format x '%H:%M'\n";
-    plot << "set grid\n";
-    plot << "set timefmt '%H:%M:%S'\n";
-    plot << "set xdata time\n";
-    plot << "set xrange ['00:00:00' : '24:00:00']\n";
-    plot << "set xtics format '%H:%M'\n";
-    plot << "set xtics '02:00'\n";
-    plot << "set ylabel '" << _("Solar radiation [W/m²]") << "'\n";
-    plot << "set grid xtics\n";
-    plot << "set ytics nomirror\n";
-    plot << "set yrange [0 : 1200]\n";
-    plot << "plot '" << Gnuplot::PLACEHOLDER << "' using 1:2 with lines notitle "
-            "linecolor rgb '#ff9900' lw 2";
-    plot << "\n";
-
-    plot.plot(result.data);
+    Chart chart(reportgen()->configuration());
+    chart.setOutputFile(nameProvider().dailyDiagram(m_date, "solar"));
+    chart.setXLabel(_("Time [HH:MM]"));
+    chart.setTimeAxis("%H:%M:%S");
+    chart.setXRange("00:00:00", "24:00:00");
+    chart.setXTicInterval(2*3600, "%H:%M");
+    chart.setYLabel(_("Solar radiation [W/m²]"));
+    chart.setGrid(Chart::GridX);
+    chart.setYRange(0, 1200);
+    chart.addSeries(2, Chart::Lines, "#ff9900", 2);
+
+    chart.plot(m_series.table({ DaySeries::SolarRadiation }));
 }
 
 void DayReportGenerator::createPressureDiagram()
 {
     BW_DEBUG_DBG("Generating pressure diagrams for %s", m_dateString.c_str());
 
-    common::Database::Result result = reportgen()->database().executeSqlQuery(
-        "SELECT   time(timestamp), pressure "
-        "FROM     weatherdata_float "
-        "WHERE    jdate = julianday(?)"
-        "         AND pressure > 0 "
-        "ORDER BY timestamp",
-        m_date.strftime("%Y-%m-%d 12:00").c_str()
-    );
+    // the line connects the valid values
+    Chart::StringStringVector data;
+    for (size_t i = 0; i < m_series.size(); ++i) {
+        if (!m_series.valid(DaySeries::Pressure, i) || m_series.value(DaySeries::Pressure, i) <= 0)
+            continue;
 
-    Gnuplot plot(reportgen()->configuration());
-    plot.setWorkingDirectory(reportgen()->configuration().reportDirectory());
-    plot.setOutputFile(nameProvider().dailyDiagram(m_date, "pressure"));
-    plot << "set xlabel '"<< _("Time [HH:MM]") << "'\n";
-    plot << "set ylabel '" << _("Air pressure [hPa]") << "'\n";
-    plot << "set format x '%H:%M'\n";
-    plot << "set grid\n";
-    plot << "set timefmt '%H:%M:%S'\n";
-    plot << "set xdata time\n";
-    plot << "set xrange ['00:00:00' : '24:00:00']\n";
-    plot << "set xtics format '%H:%M'\n";
-    plot << "set xtics '02:00'\n";
-    plot << "set yrange [960 : 1050]\n";
-    plot << "plot '" << Gnuplot::PLACEHOLDER
-         << "' using 1:2 with lines notitle linecolor rgb '#ff0000' lw 2\n";
-
-    plot.plot(result.data);
+        Chart::StringVector line;
+        line.push_back(m_series.time(i));
+        line.push_back(m_series.format(DaySeries::Pressure, i));
+        data.push_back(line);
+    }
+
+    Chart chart(reportgen()->configuration());
+    chart.setOutputFile(nameProvider().dailyDiagram(m_date, "pressure"));
+    chart.setXLabel(_("Time [HH:MM]"));
+    chart.setTimeAxis("%H:%M:%S");
+    chart.setXRange("00:00:00", "24:00:00");
+    chart.setXTicInterval(2*3600, "%H:%M");
+    chart.setYLabel(_("Air pressure [hPa]"));
+    chart.setGrid(Chart::GridX | Chart::GridY);
+    chart.setYRange(960, 1050);
+    chart.addSeries(2, Chart::Lines, "#ff0000", 2);
+
+    chart.plot(data);
 }
 
 void DayReportGenerator::createHtml()
@@ -345,36 +305,36 @@ void DayReportGenerator::createHtml()
     );
 
     html.addSection(_("Temperature profile"), _("Temperature"), "temperature");
-    html.img(nameProvider().dailyDiagramLink(m_date, "temperature"));
+    html.chart(nameProvider().dailyDiagramLink(m_date, "temperature"));
     html.addTopLink();
 
     if (haveHumidityData()) {
         html.addSection(_("Humidity profile"), _("Humidity"), "humidity");
-        html.img(nameProvider().dailyDiagramLink(m_date, "humidity"));
+        html.chart(nameProvider().dailyDiagramLink(m_date, "humidity"));
         html.addTopLink();
     }
 
     if (haveWindData()) {
         html.addSection(_("Wind speed profile"), _("Wind"), "wind");
-        html.img(nameProvider().dailyDiagramLink(m_date, "wind"));
+        html.chart(nameProvider().dailyDiagramLink(m_date, "wind"));
         html.addTopLink();
     }
 
     if (haveRainData()) {
         html.addSection(_("Rain profile"), _("Rain"), "rain");
-        html.img(nameProvider().dailyDiagramLink(m_date, "rain"));
+        html.chart(nameProvider().dailyDiagramLink(m_date, "rain"));
         html.addTopLink();
     }
 
     if (haveSolarRadiationData()) {
         html.addSection(_("Solar radiation profile"), _("Solar radiation"), "solar");
-        html.img(nameProvider().dailyDiagramLink(m_date, "solar"));
+        html.chart(nameProvider().dailyDiagramLink(m_date, "solar"));
         html.addTopLink();
     }
 
     if (havePressureData()) {
         html.addSection(_("Air pressure profile"), _("Air pressure"), "pressure");
-        html.img(nameProvider().dailyDiagramLink(m_date, "pressure"));
+        html.chart(nameProvider().dailyDiagramLink(m_date, "pressure"));
         html.addTopLink();
     }
 
@@ -384,66 +344,27 @@ void DayReportGenerator::createHtml()
 
 bool DayReportGenerator::havePressureData() const
 {
-    if (m_havePressure == -1)
-        m_havePressure = haveWeatherData("pressure");
-
-    return m_havePressure;
+    return m_series.have(DaySeries::Pressure);
 }
 
 bool DayReportGenerator::haveSolarRadiationData() const
 {
-    if (m_haveSolarRadiation == -1)
-        m_haveSolarRadiation = haveWeatherData("solar_radiation");
-
-    return m_haveSolarRadiation;
+    return m_series.have(DaySeries::SolarRadiation);
 }
 
 bool DayReportGenerator::haveHumidityData() const
 {
-    if (m_haveHumidity == -1)
-        m_haveHumidity = haveWeatherData("humid");
-
-    return m_haveHumidity;
+    return m_series.have(DaySeries::Humidity);
 }
 
 bool DayReportGenerator::haveRainData() const
 {
-    if (m_haveRain == -1)
-        m_haveRain = haveWeatherData("rain");
-
-    return m_haveRain;
+    return m_series.have(DaySeries::Rain);
 }
 
 bool DayReportGenerator::haveWindData() const
 {
-    if (m_haveWind == -1)
-        m_haveWind = haveWeatherData("wind");
-
-    return m_haveWind;
-}
-
-bool DayReportGenerator::haveWeatherData(const std::string &data) const
-{
-    common::Database::Result result = reportgen()->database().executeSqlQuery(
-        "SELECT   count(*) "
-        "FROM     weatherdata "
-        "WHERE    jdate = julianday(?) "
-        "         AND %s IS NOT NULL "
-        "ORDER BY timestamp",
-        m_date.strftime("%Y-%m-%d 12:00").c_str(),
-        data.c_str()
-    );
-
-    return (bw::from_str<int>(result.data.front().front()) > 0);
-}
-
-void DayReportGenerator::reset()
-{
-    m_havePressure = -1;
-    m_haveHumidity = -1;
-    m_haveWind = -1;
-    m_haveRain = -1;
-    m_haveSolarRadiation = -1;
+    return m_series.have(DaySeries::Wind);
 }
 
 } // end namespace reportgen
@@ -21,6 +21,7 @@
 #include "common/database.h"
 #include "reportgenerator.h"
 #include "nameprovider.h"
+#include "dayseries.h"
 
 namespace vetero {
 namespace reportgen {
@@ -71,20 +72,12 @@ class DayReportGenerator : public ReportGenerator
         bool havePressureData() const;
         bool haveSolarRadiationData() const;
 
-        bool haveWeatherData(const std::string &name) const;
-
-        void reset();
-
     private:
         std::string m_dateString;
         bw::Datetime m_date;
 
-        // 0=false, 1=true, -1=not set
-        mutable int m_havePressure = -1;
-        mutable int m_haveRain = -1;
-        mutable int m_haveWind = -1;
-        mutable int m_haveHumidity = -1;
-        mutable int m_haveSolarRadiation = -1;
+        // all diagrams are drawn from the same data
+        DaySeries m_series;
 };
 
 } // end namespace reportgen
@@ -0,0 +1,164 @@
+/* {{{
+ * (c) 2022, Bernhard Walle <bernhard@bwalle.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>. }}}
+ */
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include "common/stagetimer.h"
+#include "dayseries.h"
+
+namespace vetero {
+namespace reportgen {
+
+/* DaySeries {{{ */
+
+namespace {
+
+// column in weatherdata, divisor and decimals of the weatherdata_float view
+struct MetricInfo {
+    const char *column;
+    double divisor;
+    int decimals;
+};
+
+const MetricInfo metricInfo[DaySeries::MetricCount] = {
+    { "temp",               100.0,  1 },
+    { "dewpoint",           100.0,  1 },
+    { "humid",              100.0,  0 },
+    { "wind",               100.0,  1 },
+    { "wind_gust",          100.0,  1 },
+    { "rain",               1000.0, 3 },
+    { "solar_radiation",    10.0,   1 },
+    { "pressure",           100.0,  0 }
+};
+
+} // anonymous namespace
+
+DaySeries::DaySeries()
+{
+    for (int metric = 0; metric < MetricCount; ++metric) {
+        m_validCount[metric] = 0;
+        m_max[metric] = NAN;
+    }
+}
+
+void DaySeries::load(common::Database &db, const std::string &date)
+{
+    std::string columns;
+    for (int metric = 0; metric < MetricCount; ++metric)
+        columns += std::string(", ") + metricInfo[metric].column;
+
+    // the raw table, the conversion is cheaper in C++ than in the view
+    common::Database::Result result = db.executeSqlQuery(
+        ("SELECT   time(timestamp)" + columns + " "
+         "FROM     weatherdata "
+         "WHERE    jdate = julianday(?) "
+         "ORDER BY timestamp").c_str(),
+        (date + " 12:00").c_str()
+    );
+
+    common::StageTimer timer(common::StageTimes::Transform);
+
+    size_t rows = result.data.size();
+    m_times.clear();
+    m_times.reserve(rows);
+    for (int metric = 0; metric < MetricCount; ++metric) {
+        m_values[metric].assign(rows, 0.0);
+        m_valid[metric].assign(rows, false);
+        m_validCount[metric] = 0;
+        m_max[metric] = NAN;
+    }
+
+    for (size_t row = 0; row < rows; ++row) {
+        const std::vector<std::string> &line = result.data[row];
+        m_times.push_back(line.at(0));
+
+        for (int metric = 0; metric < MetricCount; ++metric) {
+            const std::string &field = line.at(metric + 1);
+            if (field.empty())
+                continue;
+
+            const MetricInfo &info = metricInfo[metric];
+            double factor = std::pow(10.0, info.decimals);
+            double value = std::round(std::strtod(field.c_str(), NULL) / info.divisor * factor) / factor;
+
+            m_values[metric][row] = value;
+            m_valid[metric][row] = true;
+            m_validCount[metric]++;
+            if (std::isnan(m_max[metric]) || value > m_max[metric])
+                m_max[metric] = value;
+        }
+    }
+}
+
+size_t DaySeries::size() const
+{
+    return m_times.size();
+}
+
+const std::string &DaySeries::time(size_t row) const
+{
+    return m_times[row];
+}
+
+bool DaySeries::valid(Metric metric, size_t row) const
+{
+    return m_valid[metric][row];
+}
+
+double DaySeries::value(Metric metric, size_t row) const
+{
+    return m_values[metric][row];
+}
+
+bool DaySeries::have(Metric metric) const
+{
+    return m_validCount[metric] > 0;
+}
+
+double DaySeries::max(Metric metric) const
+{
+    return m_max[metric];
+}
+
+std::string DaySeries::format(Metric metric, size_t row) const
+{
+    if (!m_valid[metric][row])
+        return std::string();
+
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.*f", metricInfo[metric].decimals, m_values[metric][row]);
+    return buffer;
+}
+
+Chart::StringStringVector DaySeries::table(const std::vector<Metric> &metrics) const
+{
+    Chart::StringStringVector data(size());
+    for (size_t row = 0; row < size(); ++row) {
+        Chart::StringVector &line = data[row];
+        line.reserve(metrics.size() + 1);
+        line.push_back(m_times[row]);
+        for (size_t i = 0; i < metrics.size(); ++i)
+            line.push_back(format(metrics[i], row));
+    }
+    return data;
+}
+
+/* }}} */
+
+} // end namespace reportgen
+} // end namespace vetero
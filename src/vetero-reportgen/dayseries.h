@@ -0,0 +1,156 @@
+/* {{{
+ * (c) 2022, Bernhard Walle <bernhard@bwalle.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>. }}}
+ */
+#ifndef VETERO_REPORTGEN_DAYSERIES_H_
+#define VETERO_REPORTGEN_DAYSERIES_H_
+
+#include <string>
+#include <vector>
+
+#include "common/database.h"
+#include "chart.h"
+
+namespace vetero {
+namespace reportgen {
+
+/* DaySeries {{{ */
+
+/**
+ * \class DaySeries
+ * \brief The weather data of one day in columns
+ *
+ * Loads all values of a day with one query. The diagrams, maximum values and availability
+ * checks of the day report are derived from it instead of querying the database again.
+ *
+ * Values are converted to their units and rounded like the <tt>weatherdata_float</tt> view
+ * does. Missing values (NULL in the database) are marked invalid.
+ *
+ * \author Bernhard Walle <bernhard@bwalle.de>
+ * \ingroup report
+ */
+class DaySeries
+{
+    public:
+        /**
+         * \brief The columns
+         */
+        enum Metric {
+            Temperature,        ///< temperature in °C
+            Dewpoint,           ///< dew point in °C
+            Humidity,           ///< humidity in percent
+            Wind,               ///< wind speed in km/h
+            WindGust,           ///< wind gust speed in km/h
+            Rain,               ///< rain in l/m² since the previous value
+            SolarRadiation,     ///< solar radiation in W/m²
+            Pressure,           ///< air pressure in hPa
+            MetricCount
+        };
+
+    public:
+        /**
+         * \brief Creates an empty series
+         */
+        DaySeries();
+
+        /**
+         * \brief Loads the values of one day
+         *
+         * \param[in] db the database
+         * \param[in] date the day (<tt>YYYY-MM-DD</tt>)
+         * \exception common::DatabaseError if the database cannot be queried
+         */
+        void load(common::Database &db, const std::string &date);
+
+        /**
+         * \brief Returns the number of rows
+         *
+         * \return the number of rows
+         */
+        size_t size() const;
+
+        /**
+         * \brief Returns the time of a row
+         *
+         * \param[in] row the row
+         * \return the time as <tt>HH:MM:SS</tt>
+         */
+        const std::string &time(size_t row) const;
+
+        /**
+         * \brief Checks if a value is present
+         *
+         * \param[in] metric the column
+         * \param[in] row the row
+         * \return \c false if the value is missing
+         */
+        bool valid(Metric metric, size_t row) const;
+
+        /**
+         * \brief Returns a value
+         *
+         * \param[in] metric the column
+         * \param[in] row the row
+         * \return the value, 0 if the value is missing
+         */
+        double value(Metric metric, size_t row) const;
+
+        /**
+         * \brief Checks if a column has any values
+         *
+         * \param[in] metric the column
+         * \return \c true if at least one value is present
+         */
+        bool have(Metric metric) const;
+
+        /**
+         * \brief Returns the maximum of a column
+         *
+         * \param[in] metric the column
+         * \return the maximum, \c NAN if there are no values
+         */
+        double max(Metric metric) const;
+
+        /**
+         * \brief Formats a value like the database does
+         *
+         * \param[in] metric the column
+         * \param[in] row the row
+         * \return the formatted value, an empty string if the value is missing
+         */
+        std::string format(Metric metric, size_t row) const;
+
+        /**
+         * \brief Returns the data for a Chart
+         *
+         * \param[in] metrics the columns after the time column
+         * \return one line per row, the first column is the time
+         */
+        Chart::StringStringVector table(const std::vector<Metric> &metrics) const;
+
+    private:
+        std::vector<std::string> m_times;
+        std::vector<double> m_values[MetricCount];
+        std::vector<bool> m_valid[MetricCount];
+        size_t m_validCount[MetricCount];
+        double m_max[MetricCount];
+};
+
+/* }}} */
+
+} // end namespace reportgen
+} // end namespace vetero
+
+#endif // VETERO_REPORTGEN_DAYSERIES_H_
@@ -0,0 +1,216 @@
+/* {{{
+ * (c) 2022, Bernhard Walle <bernhard@bwalle.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>. }}}
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#include <libbw/log/debug.h>
+
+#include "downsampler.h"
+
+namespace vetero {
+namespace reportgen {
+
+/* Downsampler {{{ */
+
+Downsampler::Downsampler(const Chart &chart)
+    : m_chart(chart)
+{}
+
+bool Downsampler::downsample(const Chart::StringStringVector &data, size_t maxValues,
+                             Chart::StringStringVector &result) const
+{
+    if (data.size() <= maxValues)
+        return false;
+
+    // rows without a valid x value cannot be drawn anyway
+    std::vector<size_t> rows;
+    std::vector<double> xValues;
+    for (size_t i = 0; i < data.size(); ++i) {
+        bool ok;
+        double x = data[i].empty() ? 0.0 : m_chart.parseX(data[i][0], ok);
+        if (data[i].empty() || !ok)
+            continue;
+        rows.push_back(i);
+        xValues.push_back(x);
+    }
+
+    std::vector<bool> keep(data.size(), false);
+    const std::vector<Chart::Series> &series = m_chart.series();
+
+    for (size_t i = 0; i < series.size(); ++i) {
+        size_t column = series[i].column - 1;
+
+        std::vector<size_t> validRows;
+        std::vector<double> x, y;
+        bool inGap = false;
+        for (size_t j = 0; j < rows.size(); ++j) {
+            const Chart::StringVector &row = data[rows[j]];
+
+            char *end = NULL;
+            double value = NAN;
+            if (column < row.size() && !row[column].empty())
+                value = std::strtod(row[column].c_str(), &end);
+
+            if (!end || *end != '\0' || !std::isfinite(value)) {
+                // one row with a missing value is enough to interrupt the line
+                if (!inGap && !validRows.empty())
+                    keep[rows[j]] = true;
+                inGap = true;
+                continue;
+            }
+
+            inGap = false;
+            validRows.push_back(rows[j]);
+            x.push_back(xValues[j]);
+            y.push_back(value);
+        }
+
+        std::vector<size_t> selected;
+        switch (series[i].downsampling) {
+            case Chart::DownsampleLttb:
+                selected = lttb(x, y, maxValues);
+                break;
+
+            case Chart::DownsampleEnvelope:
+                selected = envelope(y, maxValues);
+                break;
+
+            case Chart::DownsampleNone:
+                for (size_t j = 0; j < validRows.size(); ++j)
+                    selected.push_back(j);
+                break;
+        }
+
+        for (size_t j = 0; j < selected.size(); ++j)
+            keep[validRows[selected[j]]] = true;
+    }
+
+    size_t kept = std::count(keep.begin(), keep.end(), true);
+    if (kept == data.size())
+        return false;
+
+    result.clear();
+    result.reserve(kept);
+    for (size_t i = 0; i < data.size(); ++i)
+        if (keep[i])
+            result.push_back(data[i]);
+
+    BW_DEBUG_DBG("Reduced the data of '%s' from %zu to %zu rows",
+                 m_chart.outputFile().c_str(), data.size(), result.size());
+
+    return true;
+}
+
+std::vector<size_t> Downsampler::lttb(const std::vector<double> &x, const std::vector<double> &y,
+                                      size_t threshold)
+{
+    size_t count = x.size();
+    std::vector<size_t> selected;
+
+    if (threshold >= count || threshold < 3) {
+        for (size_t i = 0; i < count; ++i)
+            selected.push_back(i);
+        return selected;
+    }
+
+    selected.reserve(threshold);
+
+    // the first and the last value are always part of the result, the others are
+    // distributed over threshold - 2 buckets
+    double every = static_cast<double>(count - 2) / (threshold - 2);
+    size_t a = 0;
+    selected.push_back(a);
+
+    for (size_t i = 0; i < threshold - 2; ++i) {
+        // average of the next bucket, the last value for the last bucket
+        size_t nextStart = static_cast<size_t>(std::floor((i + 1) * every)) + 1;
+        size_t nextEnd = std::min(static_cast<size_t>(std::floor((i + 2) * every)) + 1, count);
+        nextStart = std::min(nextStart, count - 1);
+        nextEnd = std::max(nextEnd, nextStart + 1);
+
+        double avgX = 0.0, avgY = 0.0;
+        for (size_t j = nextStart; j < nextEnd; ++j) {
+            avgX += x[j];
+            avgY += y[j];
+        }
+        avgX /= (nextEnd - nextStart);
+        avgY /= (nextEnd - nextStart);
+
+        // the value of this bucket with the largest triangle
+        size_t start = static_cast<size_t>(std::floor(i * every)) + 1;
+        size_t end = std::min(static_cast<size_t>(std::floor((i + 1) * every)) + 1, count - 1);
+        size_t best = start;
+        double maxArea = -1.0;
+        for (size_t j = start; j < end; ++j) {
+            double area = std::fabs((x[a] - avgX) * (y[j] - y[a]) -
+                                    (x[a] - x[j]) * (avgY - y[a]));
+            if (area > maxArea) {
+                maxArea = area;
+                best = j;
+            }
+        }
+
+        selected.push_back(best);
+        a = best;
+    }
+
+    selected.push_back(count - 1);
+    return selected;
+}
+
+std::vector<size_t> Downsampler::envelope(const std::vector<double> &y, size_t threshold)
+{
+    size_t count = y.size();
+    std::vector<size_t> selected;
+
+    if (threshold >= count || threshold < 2) {
+        for (size_t i = 0; i < count; ++i)
+            selected.push_back(i);
+        return selected;
+    }
+
+    size_t buckets = threshold / 2;
+    selected.reserve(buckets * 2);
+
+    for (size_t i = 0; i < buckets; ++i) {
+        size_t start = i * count / buckets;
+        size_t end = (i + 1) * count / buckets;
+        if (start == end)
+            continue;
+
+        size_t min = start, max = start;
+        for (size_t j = start + 1; j < end; ++j) {
+            if (y[j] < y[min])
+                min = j;
+            if (y[j] > y[max])
+                max = j;
+        }
+
+        selected.push_back(std::min(min, max));
+        if (min != max)
+            selected.push_back(std::max(min, max));
+    }
+
+    return selected;
+}
+
+/* }}} */
+
+} // end namespace reportgen
+} // end namespace vetero
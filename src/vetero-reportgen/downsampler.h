@@ -0,0 +1,104 @@
+/* {{{
+ * (c) 2022, Bernhard Walle <bernhard@bwalle.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>. }}}
+ */
+#ifndef VETERO_REPORTGEN_DOWNSAMPLER_H_
+#define VETERO_REPORTGEN_DOWNSAMPLER_H_
+
+#include <vector>
+
+#include "chart.h"
+
+namespace vetero {
+namespace reportgen {
+
+/* Downsampler {{{ */
+
+/**
+ * \class Downsampler
+ * \brief Reduces the data of a Chart to about one value per pixel
+ *
+ * A diagram that is 1000 pixels wide cannot show more than 1000 values per series, but with a
+ * high sampling rate a day has many more. The Downsampler selects the rows that are needed to
+ * draw each series according to Chart::Series::downsampling:
+ *
+ *  - Chart::DownsampleLttb: Largest-Triangle-Three-Buckets. Each bucket contributes the value
+ *    that spans the largest triangle with the values selected for the neighbour buckets, so
+ *    the shape of a line is kept.
+ *  - Chart::DownsampleEnvelope: the minimum and the maximum of each bucket, so peaks like
+ *    wind gusts don't get lost.
+ *  - Chart::DownsampleNone: all rows.
+ *
+ * The result contains all rows selected by one of the series, unchanged and in the original
+ * order, so the data can be passed to every chart backend. Rows with missing values that
+ * interrupt a line are kept, too.
+ *
+ * \author Bernhard Walle <bernhard@bwalle.de>
+ * \ingroup report
+ */
+class Downsampler
+{
+    public:
+        /**
+         * \brief C'tor
+         *
+         * \param[in] chart the chart that describes the series
+         */
+        Downsampler(const Chart &chart);
+
+    public:
+        /**
+         * \brief Reduces \p data
+         *
+         * \param[in] data the data with the x values in the first column
+         * \param[in] maxValues the number of values each series is reduced to, usually the
+         *            width of the diagram
+         * \param[out] result the reduced data
+         * \return \c true if rows have been removed, \c false if \p data can be used as it is,
+         *         \p result is not touched then
+         */
+        bool downsample(const Chart::StringStringVector &data, size_t maxValues,
+                        Chart::StringStringVector &result) const;
+
+        /**
+         * \brief Largest-Triangle-Three-Buckets
+         *
+         * \param[in] x the x values, ascending
+         * \param[in] y the y values
+         * \param[in] threshold the number of values to select
+         * \return the indexes of the selected values in ascending order
+         */
+        static std::vector<size_t> lttb(const std::vector<double> &x, const std::vector<double> &y,
+                                        size_t threshold);
+
+        /**
+         * \brief Minimum and maximum of each bucket
+         *
+         * \param[in] y the y values
+         * \param[in] threshold the number of values to select, two per bucket
+         * \return the indexes of the selected values in ascending order
+         */
+        static std::vector<size_t> envelope(const std::vector<double> &y, size_t threshold);
+
+    private:
+        const Chart &m_chart;
+};
+
+/* }}} */
+
+} // end namespace reportgen
+} // end namespace vetero
+
+#endif // VETERO_REPORTGEN_DOWNSAMPLER_H_
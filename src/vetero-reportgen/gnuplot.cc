@@ -15,207 +15,244 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>. }}}
  */
 
-#include <iostream>
-#include <cstdlib>
-#include <vector>
 #include <cerrno>
+#include <cmath>
 #include <cstdio>
-#include <limits.h>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <vector>
+
 #include <unistd.h>
 
 #include <libbw/stringutil.h>
-#include <libbw/io/tempfile.h>
 #include <libbw/log/errorlog.h>
 #include <libbw/log/debug.h>
 
-#include "common/translation.h"
-#include "common/utils.h"
+#include "common/outputfile.h"
 #include "gnuplot.h"
+#include "gnuplotsession.h"
 
 namespace vetero {
 namespace reportgen {
 
 /* Gnuplot {{{ */
 
-std::string Gnuplot::PLACEHOLDER = "-";
+namespace {
 
-Gnuplot::Gnuplot(const common::Configuration &config)
-    : m_config(config),
-      m_writeToFile(false)
-{
-    *this << "set locale '" << m_config.locale() << "'\n";
-    *this << "set terminal svg size 1000 400 font 'Arial,9'\n";
-    *this << "set lmargin 10\n";
-    *this << "set rmargin 10\n";
+// all series of a diagram refer to the same inline data
+const char *DATABLOCK = "$data";
 
-    if (getenv("VETERO_GNUPLOT_FILE"))
-        m_writeToFile = true;
+// quotes a string for Gnuplot, single quotes are escaped by doubling them
+std::string quote(const std::string &str)
+{
+    return "'" + bw::replace_char(str, '\'', "''") + "'";
 }
 
-Gnuplot::~Gnuplot()
-{}
-
-std::string Gnuplot::workingDirectory() const
+// double-quoted strings interpret "\n" like C
+std::string quoteEscaped(const std::string &str)
 {
-    return m_workingDirectory;
+    return "\"" + bw::replace_char(str, '\n', "\\n") + "\"";
 }
 
-void Gnuplot::setWorkingDirectory(const std::string &workingdir)
+std::string range(double value)
 {
-    m_workingDirectory = workingdir;
+    return std::isnan(value) ? "*" : bw::str(value);
 }
 
-std::string Gnuplot::outputFile() const
+std::string tics(const std::vector<Chart::Tic> &tics)
 {
-    return m_outputFile;
+    std::ostringstream stream;
+    stream << "(";
+    for (size_t i = 0; i < tics.size(); ++i) {
+        if (i != 0)
+            stream << ", ";
+        stream << quoteEscaped(tics[i].label) << " " << tics[i].position;
+    }
+    stream << ")";
+    return stream.str();
 }
 
-void Gnuplot::setOutputFile(const std::string &output)
+const char *styleName(Chart::Style style)
 {
-    m_outputFile = output;
+    switch (style) {
+        case Chart::LinesPoints:    return "linespoints";
+        case Chart::Points:         return "points";
+        case Chart::Boxes:          return "boxes";
+        case Chart::Impulses:       return "impulses";
+        case Chart::Lines:
+        default:                    return "lines";
+    }
+}
+
+} // anonymous namespace
 
-    *this << "set output '" << m_outputFile << "'\n";
+Gnuplot::Gnuplot(const common::Configuration &config)
+    : m_config(config),
+      m_writeToFile(false)
+{
+    if (getenv("VETERO_GNUPLOT_FILE"))
+        m_writeToFile = true;
 }
 
-void Gnuplot::plot(const StringStringVector &data, int columns)
+Gnuplot::~Gnuplot()
+{}
+
+void Gnuplot::plot(const Chart &chart, const Chart::StringStringVector &data)
 {
-    if (data.empty() || data[0].empty()) {
-        BW_ERROR_WARNING("Gnuplot: No data to plot for '%s'", m_outputFile.c_str());
+    if (m_writeToFile) {
+        std::string gnuplotCommands = datablock(chart, data) + commands(chart, chart.outputFile());
+
+        std::string plotname = chart.outputFile();
+        plotname = bw::replace_char(plotname, '/', "_");
+        plotname = bw::replace_char(plotname, '.', "_");
+
+        std::string filename = "/tmp/vetero_" + plotname + ".plot";
+        BW_DEBUG_INFO("Writing output to '%s'", filename.c_str());
+
+        FILE *fp = fopen(filename.c_str(), "w");
+        if (!fp)
+            throw common::SystemError("Unable to open '" + filename + "'", errno);
+        int ret = fputs(gnuplotCommands.c_str(), fp);
+        fclose(fp);
+        if (ret == EOF)
+            throw common::SystemError("Unable to write to '" + filename + "'", errno);
         return;
     }
 
-    try {
-        std::string gnuplotCommands = m_stream.str();
-
-        bw::io::TempFile errorTempfile("vetero-plot-error", bw::io::TempFile::DeleteOnExit);
-        std::string gnuplotCommand("gnuplot");
-        gnuplotCommand += " 2>" + errorTempfile.name();
-
-        int (*fileCloseFunction)(FILE *fp);
-        FILE *gnuplotFp;
-        if (m_writeToFile) {
-            std::string plotname = m_outputFile;
-            plotname = bw::replace_char(plotname, '/', "_");
-            plotname = bw::replace_char(plotname, '.', "_");
-
-            std::string filename = "/tmp/vetero_" + plotname + ".plot";
-            BW_DEBUG_INFO("Writing output to '%s'", filename.c_str());
-
-            gnuplotFp = fopen(filename.c_str(), "w");
-            fileCloseFunction = fclose;
-        } else {
-            gnuplotFp = popen(gnuplotCommand.c_str(), "w");
-            fileCloseFunction = pclose;
-        }
+    // Gnuplot can't compress, so its output is copied to the real output file
+    std::string svgFile = chart.outputFile() + ".gnuplot";
+    GnuplotSession::threadInstance().execute(datablock(chart, data) + commands(chart, svgFile));
 
-        if (!gnuplotFp)
-            throw common::SystemError("Unable to execute 'gnuplot'", errno);
+    FILE *fp = fopen(svgFile.c_str(), "rb");
+    if (!fp)
+        throw common::SystemError("Unable to open '" + svgFile + "'", errno);
 
-        if (fputs(gnuplotCommands.c_str(), gnuplotFp) == EOF)
-            throw common::SystemError("Unable to write to gnuplot", errno);
-
-        storeData(gnuplotFp, data, columns);
-
-        int ret = fileCloseFunction(gnuplotFp);
-        if (ret != 0) {
-            dumpError(errorTempfile.nativeHandle());
-            throw common::ApplicationError("Unable to generate diagram, Gnuplot terminated with " +
-                                           bw::str(WEXITSTATUS(ret)));
-        }
-    } catch (const bw::IOError &err) {
-        throw common::ApplicationError(err.what());
+    try {
+        common::OutputFile output(chart.outputFile(), m_config.reportSvgCompression());
+
+        char buffer[BUFSIZ];
+        size_t len;
+        while ((len = fread(buffer, 1, sizeof(buffer), fp)) > 0)
+            output.write(buffer, len);
+        if (ferror(fp))
+            throw common::SystemError("Unable to read '" + svgFile + "'", errno);
+
+        output.commit();
+    } catch (...) {
+        fclose(fp);
+        unlink(svgFile.c_str());
+        throw;
     }
-    std::string outputfile = common::realpath(m_outputFile);
 
-    common::compress_file(outputfile);
+    fclose(fp);
+    if (unlink(svgFile.c_str()) != 0)
+        BW_ERROR_WARNING("Unable to remove '%s': %s", svgFile.c_str(), std::strerror(errno));
 }
 
-void Gnuplot::storeData(FILE *fp, const StringStringVector &data, int columns)
+std::string Gnuplot::commands(const Chart &chart, const std::string &svgFile) const
 {
-    if (data.empty()) {
-        BW_ERROR_ERR("Attempting to plot empty data");
-        return;
+    std::ostringstream stream;
+
+    stream << "set locale " << quote(m_config.locale()) << "\n";
+    stream << "set terminal svg size " << chart.width() << " " << chart.height()
+           << " font 'Arial,9'\n";
+    stream << "set lmargin 10\n";
+    stream << "set rmargin 10\n";
+    stream << "set output " << quote(svgFile) << "\n";
+
+    if (!chart.xLabel().empty())
+        stream << "set xlabel " << quote(chart.xLabel()) << "\n";
+    if (!chart.yLabel().empty())
+        stream << "set ylabel " << quote(chart.yLabel()) << "\n";
+    if (!chart.y2Label().empty())
+        stream << "set y2label " << quote(chart.y2Label()) << "\n";
+
+    // empty fields are missing values
+    stream << "set datafile separator \"\\t\"\n";
+
+    if (chart.timeAxis()) {
+        stream << "set xdata time\n";
+        stream << "set timefmt " << quote(chart.timeFormat()) << "\n";
     }
 
-    // since gnuplot cannot seek in stdin, we need to provide the data multiple times
-    if (columns == 0)
-        columns = data.front().size()-1;
-
-    for (int i = 0; i < columns; i++) {
-
-        StringStringVector::const_iterator lineIter;
-        for (lineIter = data.begin(); lineIter != data.end(); ++lineIter) {
-            const StringVector &line = *lineIter;
+    if (!chart.xMin().empty() && !chart.xMax().empty()) {
+        if (chart.timeAxis())
+            stream << "set xrange [" << quote(chart.xMin()) << " : " << quote(chart.xMax()) << "]\n";
+        else
+            stream << "set xrange [" << chart.xMin() << " : " << chart.xMax() << "]\n";
+    }
 
-            for (int col = 0; col <= columns; col++) {
-                if (col != 0) {
-                    if (fputs("\t", fp) == EOF)
-                        throw common::SystemError("Unable to write to the Gnuplot process", errno);
-                }
+    if (!chart.xTics().empty()) {
+        stream << "set mxtics 0\n";
+        stream << "set xtics " << tics(chart.xTics()) << "\n";
+    } else if (chart.xTicInterval() > 0) {
+        stream << "set xtics format " << quoteEscaped(chart.xTicFormat()) << "\n";
+        stream << "set xtics " << chart.xTicInterval() << "\n";
+    }
 
-                if (fputs(line[col].c_str(), fp) == EOF)
-                    throw common::SystemError("Unable to write to the Gnuplot process", errno);
-            }
+    if (!std::isnan(chart.yMin()) || !std::isnan(chart.yMax()))
+        stream << "set yrange [" << range(chart.yMin()) << " : " << range(chart.yMax()) << "]\n";
 
-            fputs("\n", fp);
-        }
-        // "e\n" is the separator for Gnuplot
-        fputs("e\n", fp);
+    if (!chart.y2Tics().empty()) {
+        stream << "set ytics nomirror\n";
+        stream << "set y2tics " << tics(chart.y2Tics()) << "\n";
     }
-}
 
-void Gnuplot::dumpError(int fd)
-{
-    off_t ret = lseek(fd, 0, SEEK_SET);
-    if (ret == (off_t)-1) {
-        BW_ERROR_WARNING("%s: Unable to seek fd %d: %s", __func__, fd, std::strerror(errno));
-        return;
+    if (chart.grid() != 0) {
+        stream << "set grid "
+               << ((chart.grid() & Chart::GridX) ? "xtics " : "noxtics ")
+               << ((chart.grid() & Chart::GridY) ? "ytics" : "noytics")
+               << ((chart.grid() & Chart::GridY2) ? " y2tics" : "") << "\n";
     }
 
-    std::string errors;
-    char buffer[BUFSIZ];
-    ssize_t nbytes;
-    while ((nbytes = read(fd, buffer, BUFSIZ-1)) > 0) {
-        buffer[nbytes] = '\0';
-        errors += buffer;
+    if (chart.boxWidth() > 0)
+        stream << "set boxwidth " << chart.boxWidth() << "\n";
+    stream << "set style fill solid 1.0 border\n";
+
+    const std::vector<Chart::Series> &series = chart.series();
+    stream << "plot ";
+    for (size_t i = 0; i < series.size(); ++i) {
+        const Chart::Series &s = series[i];
+        if (i != 0)
+            stream << ", ";
+
+        stream << DATABLOCK << " using 1:" << s.column << " with " << styleName(s.style) << " ";
+        if (s.title.empty())
+            stream << "notitle";
+        else
+            stream << "title " << quote(s.title);
+        stream << " linecolor rgb " << quote(s.color) << " lw " << s.lineWidth;
+        if (s.style == Chart::Points || s.style == Chart::LinesPoints)
+            stream << " pt " << s.pointType << " ps " << s.pointSize;
     }
+    stream << "\n";
 
-    std::vector<std::string> lines = bw::stringsplit(errors, "\n");
-    std::vector<std::string>::const_iterator lineIter;
-    for (lineIter = lines.begin(); lineIter != lines.end(); ++lineIter) {
-        std::string stripped = bw::strip(*lineIter);
-        if (stripped.empty() || stripped == "^")
-            continue;
-        BW_ERROR_WARNING("Error output of gnuplot: %s", lineIter->c_str());
-    }
+    // the session keeps variables across diagrams
+    stream << "undefine " << DATABLOCK << "\n";
+
+    return stream.str();
 }
 
-/* }}} */
-/* WeatherGnuplot {{{ */
+std::string Gnuplot::datablock(const Chart &chart, const Chart::StringStringVector &data) const
+{
+    size_t columns = chart.maxColumn();
 
-WeatherGnuplot::WeatherGnuplot(const common::Configuration &config)
-    : Gnuplot(config)
-{}
+    std::string result = std::string(DATABLOCK) + " << EOD\n";
+    Chart::StringStringVector::const_iterator lineIter;
+    for (lineIter = data.begin(); lineIter != data.end(); ++lineIter) {
+        const Chart::StringVector &line = *lineIter;
 
-void WeatherGnuplot::addWindY()
-{
-    *this << "set ylabel '" << _("Wind speed [km/h])") << "'\n";
-    *this << "set y2label '" << _("Wind strength [Beaufort]") << "'\n";
-    *this << "set ytics nomirror\n";
-    *this << "set y2tics ( '0'   0, "
-                         " '1'   2, "
-                         " '2'   6, "
-                         " '3'  12, "
-                         " '4'  20, "
-                         " '5'  29, "
-                         " '6'  39, "
-                         " '7'  50, "
-                         " '8'  62, "
-                         " '9'  75, "
-                         "'10'  89, "
-                         "'11' 103, "
-                         "'12' 117)\n";
-    *this << "set grid xtics noytics y2tics\n";
+        for (size_t col = 0; col < columns && col < line.size(); col++) {
+            if (col != 0)
+                result += '\t';
+            result += line[col];
+        }
+        result += '\n';
+    }
+    result += "EOD\n";
+
+    return result;
 }
 
 /* }}} */
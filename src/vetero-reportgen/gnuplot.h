@@ -18,12 +18,11 @@
 #ifndef VETERO_REPORTGEN_GNUPLOT_H_
 #define VETERO_REPORTGEN_GNUPLOT_H_
 
-#include <sstream>
 #include <string>
-#include <vector>
 
 #include "common/error.h"
 #include "common/configuration.h"
+#include "chart.h"
 
 namespace vetero {
 namespace reportgen {
@@ -31,42 +30,18 @@ namespace reportgen {
 /**
  * \brief Generating diagrams with Gnuplot
  *
- * This class helps to create diagrams using Gnuplot. It doesn't abstract from Gnuplot, doesn't
- * create a API between C++ and Gnuplot, just provides an interface to plot simple diagrams
- * with Gnuplot.
+ * Draws a Chart by translating it to Gnuplot commands that are executed by the
+ * GnuplotSession of the current thread. This is the renderer for the <tt>report_chart_renderer = "gnuplot"</tt>
+ * configuration, the default is SvgChartRenderer.
  *
- * You have to set all Gnuplot commands using the operator<< syntax:
- *
- * \code
- * Gnuplot gp;
- * gp << "set bla 'fasel'\n";
- * \endcode
- *
- * This includes also the output format and output file. The data itself are passed as two-dimensional
- * vector (the one you get from the Database) to the plot() function. Since the file name must be used
- * in the commands, the placeholder Gnuplot::PLACEHOLDER must be used for this.
+ * If the environment variable <tt>VETERO_GNUPLOT_FILE</tt> is set, the commands are written
+ * to <tt>/tmp/vetero_<i>name</i>.plot</tt> instead of executing Gnuplot.
  *
  * \author Bernhard Walle <bernhard@bwalle.de>
  * \ingroup report
  */
 class Gnuplot
 {
-    public:
-        /**
-         * \brief This is the placeholder used in Gnuplot commands which stands for the data file.
-         */
-        static std::string PLACEHOLDER;
-
-        /**
-         * \brief Convenience typedef
-         */
-        typedef std::vector<std::string> StringVector;
-
-        /**
-         * \brief Convenience typedef
-         */
-        typedef std::vector<StringVector> StringStringVector;
-
     public:
         /**
          * \brief C'tor
@@ -82,126 +57,47 @@ class Gnuplot
 
     public:
         /**
-         * \brief Returns the working directory set with setWorkingDirectory()
-         *
-         * \return the working directory
-         */
-        std::string workingDirectory() const;
-
-        /**
-         * \brief Sets the working directory for the Gnuplot call in plot()
-         *
-         * \note This is not thread safe as the working directory of the current process
-         *       is modified and restored in plot().
-         *
-         * \param[in] workingdir the working directory. An empty string means the working
-         *            directory remains unchanged.
-         */
-        void setWorkingDirectory(const std::string &workingdir);
-
-        /**
-         * \brief Returns the output file
+         * \brief Plots \p chart with \p data
          *
-         * \return the name of the output file set with setOutputFile()
-         */
-        std::string outputFile() const;
-
-        /**
-         * \brief Sets the output file
-         *
-         * This function must be called before the <tt>plot</tt> command is written
-         * to the Gnuplot stream.
-         *
-         * The output file must be SVG and will be automatically compressed in the
-         * plot() function.
-         *
-         * \param[in] output the name of the output file
-         */
-        void setOutputFile(const std::string &output);
-
-        /**
-         * \brief Prints something to Gnuplot
-         *
-         * See the description of the class how to use that operator properly.
-         *
-         * \param[in] t the data element which should be appended to the Gnuplot command stream
-         * \return a self reference
-         */
-        template<typename T>
-        Gnuplot &operator<<(const T &t);
-
-        /**
-         * \brief Plots a diagram to \p filename with \p data
-         *
-         * The only Gnuplot command which is appended in this command is the output command which
-         * is redirected to \p filename. The placeholder Gnuplot::PLACEHOLDER is replaced with the
-         * name of the temporary file in which \p data is stored. You have to use Gnuplot::PLACEHOLDER
-         * exactly once in the commands.
+         * Gnuplot writes the SVG to a temporary file which is then copied to the output file of
+         * \p chart with common::OutputFile, so the compression of
+         * <tt>report_svg_compression</tt> is applied and the old file is replaced atomically.
          *
+         * \param[in] chart the description of the diagram
          * \param[in] data the data which should be plot
-         * \param[in] columns if non-zero, then only the first \p columns columns are written
          * \exception common::ApplicationError on error
          */
-        void plot(const StringStringVector &data, int columns=0);
+        void plot(const Chart &chart, const Chart::StringStringVector &data);
 
     protected:
         /**
-         * \brief Stores the data \p data at \p fd
+         * \brief Translates \p chart to Gnuplot commands
          *
-         * The function just formats the data separated by tabs and newlines. The temporary file
-         * is deleted automatically.
-         *
-         * \param[in] data a two-dimensional string array
-         * \param[in] fp the file object
-         * \param[in] columns if non zero, then only \p columns columns are written
-         * \exception common::ApplicationError is writing failed
+         * \param[in] chart the description of the diagram
+         * \param[in] svgFile the file Gnuplot writes the SVG to
+         * \return the commands including the <tt>plot</tt> command that reads the data
+         *         from the datablock created by datablock()
          */
-        void storeData(FILE *fp, const StringStringVector &data, int columns=0);
+        std::string commands(const Chart &chart, const std::string &svgFile) const;
 
         /**
-         * \brief Dumps the error information from the given file descriptor to the logging system
+         * \brief Formats \p data as Gnuplot datablock
          *
-         * \param[in] fd the file descriptor
+         * The data is separated by tabs and newlines and stored in the datablock
+         * <tt>$data</tt>, which all series of the <tt>plot</tt> command refer to. So the data
+         * is transferred and parsed only once regardless of the number of series.
+         *
+         * \param[in] chart the description of the diagram
+         * \param[in] data a two-dimensional string array
+         * \return the commands that define the datablock
          */
-        void dumpError(int fd);
+        std::string datablock(const Chart &chart, const Chart::StringStringVector &data) const;
 
     private:
         const common::Configuration &m_config;
-        std::stringstream m_stream;
-        std::string m_workingDirectory;
-        std::string m_outputFile;
         bool m_writeToFile;
 };
 
-template<typename T>
-Gnuplot &Gnuplot::operator<<(const T &t)
-{
-    m_stream << t;
-    return *this;
-}
-
-/**
- * \brief Adds some weather-specific functions to the Gnuplot class
- *
- * \author Bernhard Walle <bernhard@bwalle.de>
- */
-class WeatherGnuplot : public Gnuplot
-{
-    public:
-        /**
-         * \brief C'tor
-         *
-         * \param[in] config the application's configuration
-         */
-        WeatherGnuplot(const common::Configuration &config);
-
-    public:
-        /**
-         * \brief Adds the y axis descriptions for a wind diagram
-         */
-        void addWindY();
-};
-
 } // namespace reportgen
 } // namespace vetero
 
@@ -0,0 +1,236 @@
+/* {{{
+ * (c) 2022, Bernhard Walle <bernhard@bwalle.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>. }}}
+ */
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <vector>
+
+#include <poll.h>
+#include <spawn.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <libbw/stringutil.h>
+#include <libbw/log/errorlog.h>
+#include <libbw/log/debug.h>
+
+#include "gnuplotsession.h"
+
+extern char **environ;
+
+namespace vetero {
+namespace reportgen {
+
+/* GnuplotSession {{{ */
+
+namespace {
+
+const char *DONE_MARKER = "vetero:plot-done";
+
+// milliseconds between SIGTERM and SIGKILL for a gnuplot that doesn't respond
+const int KILL_DELAY = 2000;
+
+} // anonymous namespace
+
+GnuplotSession::GnuplotSession()
+    : m_pid(-1)
+    , m_fd(-1)
+{}
+
+GnuplotSession::~GnuplotSession()
+{
+    if (running())
+        stop();
+}
+
+GnuplotSession &GnuplotSession::threadInstance()
+{
+    thread_local GnuplotSession session;
+    return session;
+}
+
+void GnuplotSession::execute(const std::string &commands, int timeout)
+{
+    if (!running())
+        start();
+
+    std::string script = "reset\n" + commands;
+    script += "set output\n";
+    script += "print '" + std::string(DONE_MARKER) + "'\n";
+
+    std::string output;
+    bool done;
+    try {
+        done = communicate(script, timeout, output);
+    } catch (const common::ApplicationError &) {
+        logOutput(output, true);
+        // gnuplot may hang, so closing the socket isn't enough
+        stop(true);
+        throw;
+    }
+
+    logOutput(output, !done);
+    if (!done) {
+        int status = stop();
+        throw common::ApplicationError("Unable to generate diagram, Gnuplot terminated with " +
+                                       bw::str(WIFEXITED(status) ? WEXITSTATUS(status) : -1));
+    }
+}
+
+bool GnuplotSession::running() const
+{
+    return m_pid > 0;
+}
+
+void GnuplotSession::start()
+{
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) < 0)
+        throw common::SystemError("Unable to create socket pair for gnuplot", errno);
+
+    // dup2() clears the close-on-exec flag of the copies
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, fds[1], STDIN_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, fds[1], STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, fds[1], STDERR_FILENO);
+
+    char *const argv[] = { const_cast<char *>("gnuplot"), NULL };
+    pid_t pid;
+    int err = posix_spawnp(&pid, "gnuplot", &actions, NULL, argv, environ);
+    posix_spawn_file_actions_destroy(&actions);
+    close(fds[1]);
+
+    if (err != 0) {
+        close(fds[0]);
+        throw common::SystemError("Unable to execute 'gnuplot'", err);
+    }
+
+    m_pid = pid;
+    m_fd = fds[0];
+    BW_DEBUG_DBG("Started gnuplot session, PID %d", m_pid);
+}
+
+int GnuplotSession::stop(bool terminate)
+{
+    // gnuplot terminates at the end of its input
+    close(m_fd);
+    m_fd = -1;
+
+    int status = 0;
+    if (terminate) {
+        kill(m_pid, SIGTERM);
+
+        for (int waited = 0; waited < KILL_DELAY; waited += 50) {
+            pid_t pid = waitpid(m_pid, &status, WNOHANG);
+            if (pid == m_pid || (pid < 0 && errno != EINTR)) {
+                BW_DEBUG_DBG("Gnuplot session %d terminated with status %d", m_pid, status);
+                m_pid = -1;
+                return status;
+            }
+            usleep(50 * 1000);
+        }
+
+        BW_ERROR_WARNING("Gnuplot session %d doesn't terminate, killing it", m_pid);
+        kill(m_pid, SIGKILL);
+    }
+
+    while (waitpid(m_pid, &status, 0) < 0 && errno == EINTR)
+        ;
+    BW_DEBUG_DBG("Gnuplot session %d terminated with status %d", m_pid, status);
+    m_pid = -1;
+
+    return status;
+}
+
+bool GnuplotSession::communicate(const std::string &script, int timeout, std::string &output)
+{
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point deadline = Clock::now() + std::chrono::seconds(timeout);
+    std::string marker = std::string(DONE_MARKER) + "\n";
+    size_t written = 0;
+
+    while (true) {
+        int remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - Clock::now()).count();
+        if (remaining <= 0)
+            throw common::ApplicationError("Gnuplot didn't finish within " + bw::str(timeout) + " s");
+
+        struct pollfd pfd = { m_fd, POLLIN, 0 };
+        if (written < script.size())
+            pfd.events |= POLLOUT;
+
+        int ret = poll(&pfd, 1, remaining);
+        if (ret < 0) {
+            if (errno == EINTR)
+                continue;
+            throw common::SystemError("Unable to wait for gnuplot", errno);
+        }
+
+        if (pfd.revents & POLLOUT) {
+            ssize_t nbytes = send(m_fd, script.data() + written, script.size() - written,
+                                  MSG_NOSIGNAL | MSG_DONTWAIT);
+            if (nbytes > 0)
+                written += nbytes;
+            else if (errno == EPIPE || errno == ECONNRESET)
+                written = script.size();    // read the error message up to the end
+            else if (errno != EAGAIN && errno != EINTR)
+                throw common::SystemError("Unable to write to gnuplot", errno);
+        }
+
+        if (pfd.revents & (POLLIN | POLLHUP | POLLERR)) {
+            char buffer[BUFSIZ];
+            ssize_t nbytes = recv(m_fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+            // unread commands make the socket report a reset instead of end-of-file
+            if (nbytes == 0 || (nbytes < 0 && errno == ECONNRESET))
+                return false;
+            else if (nbytes < 0 && errno != EAGAIN && errno != EINTR)
+                throw common::SystemError("Unable to read from gnuplot", errno);
+            else if (nbytes > 0)
+                output.append(buffer, nbytes);
+
+            if (output.size() >= marker.size() &&
+                    output.compare(output.size() - marker.size(), marker.size(), marker) == 0) {
+                output.erase(output.size() - marker.size());
+                return true;
+            }
+        }
+    }
+}
+
+void GnuplotSession::logOutput(const std::string &output, bool failed)
+{
+    std::vector<std::string> lines = bw::stringsplit(output, "\n");
+    std::vector<std::string>::const_iterator lineIter;
+    for (lineIter = lines.begin(); lineIter != lines.end(); ++lineIter) {
+        std::string stripped = bw::strip(*lineIter);
+        if (stripped.empty() || stripped == "^")
+            continue;
+
+        if (failed)
+            BW_ERROR_WARNING("Error output of gnuplot: %s", lineIter->c_str());
+        else
+            BW_DEBUG_DBG("Output of gnuplot: %s", lineIter->c_str());
+    }
+}
+
+/* }}} */
+
+} // end namespace reportgen
+} // end namespace vetero
@@ -0,0 +1,144 @@
+/* {{{
+ * (c) 2022, Bernhard Walle <bernhard@bwalle.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>. }}}
+ */
+#ifndef VETERO_REPORTGEN_GNUPLOTSESSION_H_
+#define VETERO_REPORTGEN_GNUPLOTSESSION_H_
+
+#include <string>
+
+#include <sys/types.h>
+
+#include <libbw/noncopyable.h>
+
+#include "common/error.h"
+
+namespace vetero {
+namespace reportgen {
+
+/* GnuplotSession {{{ */
+
+/**
+ * \class GnuplotSession
+ * \brief A gnuplot process that is reused for many diagrams
+ *
+ * The process is started with the first execute() call and runs until the session is
+ * destroyed. Its standard input, standard output and standard error are connected to one end
+ * of a socket pair, so the session can write commands and read gnuplot's messages at the same
+ * time without temporary files.
+ *
+ * Each execute() call starts with <tt>reset</tt>, so no settings leak from one diagram to the
+ * next, and ends with closing the output and printing a marker. Reading up to the marker tells
+ * that gnuplot has finished the diagram. Since gnuplot terminates on errors when it doesn't
+ * run interactively, end-of-file before the marker means that the diagram failed; the next
+ * execute() starts a new process then.
+ *
+ * A session must only be used by one thread at a time, threadInstance() returns one session
+ * per thread.
+ *
+ * \author Bernhard Walle <bernhard@bwalle.de>
+ * \ingroup report
+ */
+class GnuplotSession : private bw::Noncopyable {
+
+    public:
+        /**
+         * \brief Constructor
+         *
+         * Doesn't start the process yet.
+         */
+        GnuplotSession();
+
+        /**
+         * \brief Destructor
+         *
+         * Terminates the gnuplot process.
+         */
+        ~GnuplotSession();
+
+    public:
+        /**
+         * \brief Returns the session of the current thread
+         *
+         * The session is destroyed when the thread terminates.
+         *
+         * \return the session
+         */
+        static GnuplotSession &threadInstance();
+
+        /**
+         * \brief Executes gnuplot commands and waits until they have been processed
+         *
+         * \param[in] commands the commands, each terminated by a newline
+         * \param[in] timeout the time in seconds gnuplot may take for the commands
+         * \exception common::ApplicationError if gnuplot cannot be started, failed to execute
+         *            the commands or didn't finish in time
+         */
+        void execute(const std::string &commands, int timeout=60);
+
+        /**
+         * \brief Checks if the gnuplot process is running
+         *
+         * \return \c true if the process has been started and didn't fail
+         */
+        bool running() const;
+
+    protected:
+        /**
+         * \brief Starts the gnuplot process
+         *
+         * \exception common::SystemError if the process cannot be started
+         */
+        void start();
+
+        /**
+         * \brief Terminates the gnuplot process
+         *
+         * \param[in] terminate \c true if gnuplot may not react to the end of its input, it's
+         *            sent \c SIGTERM then and \c SIGKILL if it's still running after a short time
+         * \return the exit status as returned by waitpid()
+         */
+        int stop(bool terminate=false);
+
+        /**
+         * \brief Writes \p script and reads the output up to the completion marker
+         *
+         * \param[in] script the commands including the marker command
+         * \param[in] timeout the timeout in seconds
+         * \param[out] output everything gnuplot printed before the marker
+         * \return \c true if the marker has been read, \c false if gnuplot terminated before
+         * \exception common::ApplicationError on timeout or I/O errors
+         */
+        bool communicate(const std::string &script, int timeout, std::string &output);
+
+        /**
+         * \brief Logs the messages gnuplot printed
+         *
+         * \param[in] output the output
+         * \param[in] failed \c true if the messages belong to a failed diagram
+         */
+        void logOutput(const std::string &output, bool failed);
+
+    private:
+        pid_t m_pid;
+        int m_fd;
+};
+
+/* }}} */
+
+} // end namespace reportgen
+} // end namespace vetero
+
+#endif // VETERO_REPORTGEN_GNUPLOTSESSION_H_
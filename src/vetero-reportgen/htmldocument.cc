@@ -15,12 +15,14 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>. }}}
  */
 
-#include <fstream>
-
 #include <libbw/stringutil.h>
+#include <libbw/log/errorlog.h>
 
+#include "common/outputfile.h"
+#include "common/stagetimer.h"
 #include "common/utils.h"
 #include "common/translation.h"
+#include "chart.h"
 #include "htmldocument.h"
 #include "config.h"
 
@@ -32,6 +34,7 @@ namespace reportgen {
 HtmlDocument::HtmlDocument(const VeteroReportgen *reportgen)
     : m_reportgen(reportgen)
     , m_displayTitle(true)
+    , m_haveCharts(false)
     , m_autoReload(-1)
 {}
 
@@ -131,6 +134,19 @@ void HtmlDocument::img(const std::string &filename)
     m_bodyStream << "<img src=\"" << filename << "\" />";
 }
 
+void HtmlDocument::chart(const std::string &filename)
+{
+    if (m_reportgen->configuration().reportChartRenderer() != "client") {
+        img(filename);
+        return;
+    }
+
+    // same size as the SVG diagrams
+    m_bodyStream << "<canvas class=\"vetero-chart\" width=\"1000\" height=\"400\" "
+                 << "data-feed=\"" << Chart::dataFeedName(filename) << "\"></canvas>";
+    m_haveCharts = true;
+}
+
 void HtmlDocument::addTopLink()
 {
     m_bodyStream << "<a href=\"#top\">^</a>";
@@ -147,14 +163,22 @@ std::string HtmlDocument::replaceHtml(const std::string &text)
     return ret;
 }
 
-bool HtmlDocument::write(const std::string &filename)
+std::string HtmlDocument::body() const
 {
-    std::ofstream htmlFile(filename.c_str());
+    return m_bodyStream.str();
+}
 
-    if (!htmlFile.is_open())
+bool HtmlDocument::write(const std::string &filename)
+{
+    try {
+        common::StageTimer timer(common::StageTimes::Write);
+        common::OutputFile htmlFile(filename);
+        write(htmlFile.stream());
+        htmlFile.commit();
+    } catch (const common::ApplicationError &err) {
+        BW_ERROR_ERR("%s", err.what());
         return false;
-
-    write(htmlFile);
+    }
 
     return true;
 }
@@ -175,6 +199,8 @@ void HtmlDocument::write(std::ostream &os)
     os << "<meta http-equiv='content-type' content='text/html; charset=utf-8' />";
     if (m_autoReload > 0)
        os << "<meta http-equiv='refresh' content='" << (m_autoReload*60) << "' />";
+    if (m_haveCharts)
+       os << "<script type='text/javascript' src='/vetero-chart.js' defer='defer'></script>";
     os << "</head>" << std::endl;
 
     // body start
@@ -188,11 +188,31 @@ class HtmlDocument
          */
         void img(const std::string &filename);
 
+        /**
+         * \brief Inserts a diagram
+         *
+         * With the <tt>"client"</tt> chart renderer, the browser draws the diagram from the
+         * data feed (see ChartFeed) into a <tt>&lt;canvas&gt;</tt> with
+         * <tt>vetero-chart.js</tt>. Otherwise the SVG file is inserted like with img().
+         *
+         * \param[in] filename the name of the SVG file of the diagram
+         */
+        void chart(const std::string &filename);
+
         /**
          * \brief Adds a link to the top location
          */
         void addTopLink();
 
+        /**
+         * \brief Returns the body that has been added so far
+         *
+         * Used to generate fragments that are inserted into other documents with operator<<().
+         *
+         * \return the HTML
+         */
+        std::string body() const;
+
         /**
          * \brief Output operator
          *
@@ -288,6 +308,7 @@ class HtmlDocument
         std::stringstream m_bodyStream;
         std::vector<Section> m_sections;
         bool m_displayTitle;
+        bool m_haveCharts;
         int m_autoReload;
 };
 
@@ -17,10 +17,15 @@
 
 #include <iostream>
 #include <cstdlib>
+#include <fstream>
+#include <sstream>
 
+#include <libbw/fileutils.h>
 #include <libbw/stringutil.h>
 #include <libbw/log/debug.h>
+#include <libbw/log/errorlog.h>
 
+#include "common/outputfile.h"
 #include "common/utils.h"
 #include "common/translation.h"
 #include "calendar.h"
@@ -50,6 +55,15 @@ void IndexGenerator::generateReports()
     html << "</a>\n";
 
     try {
+        // generated by the ClimateReportGenerator once veterod has computed the normals
+        if (!m_dbAccess.readMiscEntry(common::DbAccess::ClimateNormalsDate).empty()) {
+            html.addSectionAsLink(_("Climate"), _("Climate"), "climate",
+                                  nameProvider().climateDirLink());
+            html << "<p><a href='" << nameProvider().climateDirLink() << "'>"
+                 << _("Normals, percentiles and records of all years") << "</a></p>\n";
+            html.addTopLink();
+        }
+
         std::vector<std::string> dataYears = m_dbAccess.dataYears();
 
         std::vector<std::string>::const_reverse_iterator it;
@@ -57,7 +71,7 @@ void IndexGenerator::generateReports()
             const std::string &year = *it;
             html.addSectionAsLink(year, year, year, nameProvider().yearlyDirLink(year));
 
-            generateYear(html, bw::from_str<int>(year));
+            html << yearFragment(bw::from_str<int>(year));
             html.addTopLink();
         }
     } catch (const common::DatabaseError &err) {
@@ -69,6 +83,46 @@ void IndexGenerator::generateReports()
         throw common::ApplicationError("Unable to write " + indexHtml);
 }
 
+std::string IndexGenerator::yearFragment(int year)
+{
+    std::string cacheDir = reportgen()->configuration().reportDirectory() + "/.cache";
+    std::string cacheFile = cacheDir + "/index-" + bw::str(year) + ".html";
+
+    // the calendar only depends on the days with data
+    std::string report = "index:" + bw::str(year);
+    std::vector<std::string> days = reportgen()->validDataCache().dataDaysInYear(year);
+    std::string fingerprint = bw::str(days.begin(), days.end());
+
+    if (upToDate(report, fingerprint, cacheFile)) {
+        std::ifstream input(cacheFile.c_str());
+        std::ostringstream fragment;
+        if (input.is_open() && fragment << input.rdbuf()) {
+            BW_DEBUG_TRACE("Index: Using cached year %d", year);
+            return fragment.str();
+        }
+    }
+
+    HtmlDocument html(reportgen());
+    generateYear(html, year);
+    std::string fragment = html.body();
+
+    try {
+        bw::FileUtils::mkdir(cacheDir, true);
+
+        common::OutputFile output(cacheFile);
+        output.excludeFromChangedFiles();
+        output.write(fragment);
+        output.commit();
+        markGenerated(report, fingerprint);
+    } catch (const bw::Error &err) {
+        BW_ERROR_WARNING("Unable to cache the index of %d: %s", year, err.what());
+    } catch (const common::ApplicationError &err) {
+        BW_ERROR_WARNING("Unable to cache the index of %d: %s", year, err.what());
+    }
+
+    return fragment;
+}
+
 void IndexGenerator::generateYear(HtmlDocument &html, int year)
 {
     BW_DEBUG_TRACE("Index: Generate year %d", year);
@@ -28,7 +28,9 @@ namespace reportgen {
 /**
  * \brief Generates the index page
  *
- * This page contains calendars with links to the weather data.
+ * This page contains calendars with links to the weather data. The calendar of each year is
+ * cached in <tt>.cache/index-<i>year</i>.html</tt> in the report directory and only generated
+ * again if the days with data in that year have changed.
  *
  * \author Bernhard Walle <bernhard@bwalle.de>
  * \ingroup report
@@ -51,6 +53,14 @@ class IndexGenerator: public ReportGenerator
         virtual void generateReports();
 
     protected:
+        /**
+         * \brief Returns the calendar of a year from the cache or generates it
+         *
+         * \param[in] year the year
+         * \return the HTML
+         */
+        std::string yearFragment(int year);
+
         /**
          * \brief Generates the HTML for a given year
          *
@@ -16,6 +16,7 @@
  */
 
 #include <cassert>
+#include <cmath>
 
 #include <libbw/stringutil.h>
 #include <libbw/log/debug.h>
@@ -26,7 +27,7 @@
 #include "common/dbaccess.h"
 #include "monthreportgenerator.h"
 #include "calendar.h"
-#include "gnuplot.h"
+#include "chart.h"
 #include "htmldocument.h"
 
 namespace vetero {
@@ -45,9 +46,17 @@ void MonthReportGenerator::generateReports()
             common::DbAccess dbAccess(&reportgen()->database());
             std::vector<std::string> dates = dbAccess.dataMonths();
 
+            // each report gets its own generator so that they can run in parallel
+            VeteroReportgen *reportgen = this->reportgen();
+            TaskGroup reports;
             std::vector<std::string>::const_iterator it;
-            for (it = dates.begin(); it != dates.end(); ++it)
-                generateOneReport(*it);
+            for (it = dates.begin(); it != dates.end(); ++it) {
+                std::string date = *it;
+                reportgen->threadPool().run(reports, [reportgen, date]() {
+                    MonthReportGenerator(reportgen, date).generateReports();
+                });
+            }
+            reportgen->threadPool().wait(reports);
         } else
             generateOneReport(m_monthString);
     } catch (const common::DatabaseError &err) {
@@ -69,21 +78,44 @@ void MonthReportGenerator::generateOneReport(const std::string &date)
     int month = bw::from_str<int>(m_monthString.substr(5, 2));
     m_month = bw::Datetime(year, month, 1, 0, 0, 0, false);
 
+    m_firstDayStr = m_month.strftime("%Y-%m-01");
+    m_lastDayStr = m_month.strftime("%Y-%m-") + bw::str(Calendar::daysPerMonth(m_month));
+
+    bw::Datetime lastMonth(m_month);
+    lastMonth.addDays(-1);
+    bw::Datetime nextMonth(m_month);
+    nextMonth.addDays(31);
+
+    const ValidDataCache &validDataCache = reportgen()->validDataCache();
+    std::string report = "month:" + m_monthString;
+    std::string fingerprint = dataFingerprint(m_firstDayStr, m_lastDayStr,
+                                              validDataCache.dataInMonth(lastMonth),
+                                              validDataCache.dataInMonth(nextMonth));
+    if (upToDate(report, fingerprint, nameProvider().monthlyIndex(m_month))) {
+        BW_DEBUG_DBG("Month report for %s is up to date", m_monthString.c_str());
+        return;
+    }
+
     try {
         bw::FileUtils::mkdir(nameProvider().monthlyDir(m_month), true);
     } catch (const bw::Error &err) {
         throw common::ApplicationError(err.what());
     }
 
-    m_firstDayStr = m_month.strftime("%Y-%m-01");
-    m_lastDayStr = m_month.strftime("%Y-%m-") + bw::str(Calendar::daysPerMonth(m_month));
+    // the diagrams are independent of each other
+    ThreadPool &threadPool = reportgen()->threadPool();
+    TaskGroup diagrams;
 
-    createTemperatureDiagram();
+    threadPool.run(diagrams, [this]() { createTemperatureDiagram(); });
     if (haveWindData())
-        createWindDiagram();
+        threadPool.run(diagrams, [this]() { createWindDiagram(); });
     if (haveRainData())
-        createRainDiagram();
+        threadPool.run(diagrams, [this]() { createRainDiagram(); });
+
+    threadPool.wait(diagrams);
+
     createHtml();
+    markGenerated(report, fingerprint);
 }
 
 void MonthReportGenerator::createTemperatureDiagram()
@@ -96,26 +128,18 @@ void MonthReportGenerator::createTemperatureDiagram()
         m_firstDayStr.c_str(), m_lastDayStr.c_str()
     );
 
-    Gnuplot plot(reportgen()->configuration());
-    plot.setWorkingDirectory(reportgen()->configuration().reportDirectory());
-    plot.setOutputFile(nameProvider().monthlyDiagram(m_month, "temperature"));
-    plot << "set xlabel '" << _("Day") << "'\n";
-    plot << "set ylabel '" << _("Temperature [°C]") << "'\n";
-    plot << "set grid\n";
-    plot << "set xdata time\n";
-    plot << "set format x '%Y-%m-%d'\n";
-    plot << "set timefmt '%Y-%m-%d'\n";
-    plot << "set xrange ['" << m_firstDayStr << "' : '" << m_lastDayStr << "']\n";
-    plot << "set mxtics 0\n";
-    plot << "set xtics format \"%2d\\n%a\"\n";
-    plot << "set xtics 86400\n";
-    plot << "plot '" << Gnuplot::PLACEHOLDER
-         << "' using 1:2 with lines title 'Min' linecolor rgb '#0022FF' lw 2, "
-         << "'" << Gnuplot::PLACEHOLDER
-         << "' using 1:3 with lines title 'Max' linecolor rgb '#FF0000' lw 2, "
-         << "'" << Gnuplot::PLACEHOLDER
-         << "' using 1:4 with lines title 'Avg' linecolor rgb '#555555' lw 2\n";
-    plot.plot(result.data);
+    Chart chart(reportgen()->configuration());
+    chart.setOutputFile(nameProvider().monthlyDiagram(m_month, "temperature"));
+    chart.setXLabel(_("Day"));
+    chart.setTimeAxis("%Y-%m-%d");
+    chart.setXRange(m_firstDayStr, m_lastDayStr);
+    chart.setXTicInterval(86400, "%2d\n%a");
+    chart.setYLabel(_("Temperature [°C]"));
+    chart.setGrid(Chart::GridX | Chart::GridY);
+    chart.addSeries(2, Chart::Lines, "#0022FF", 2, "Min");
+    chart.addSeries(3, Chart::Lines, "#FF0000", 2, "Max");
+    chart.addSeries(4, Chart::Lines, "#555555", 2, "Avg");
+    chart.plot(result.data);
 }
 
 void MonthReportGenerator::createWindDiagram()
@@ -140,28 +164,19 @@ void MonthReportGenerator::createWindDiagram()
         max = maxResult.data.front().front();
     bool haveGust = !maxResult.data.front()[1].empty();
 
-    WeatherGnuplot plot(reportgen()->configuration());
-    plot.setWorkingDirectory(reportgen()->configuration().reportDirectory());
-    plot.setOutputFile(nameProvider().monthlyDiagram(m_month, "wind"));
-    plot << "set xlabel '" << _("Day") <<"'\n";
-    plot << "set grid\n";
-    plot << "set xdata time\n";
-    plot << "set format x '%Y-%m-%d'\n";
-    plot << "set timefmt '%Y-%m-%d'\n";
-    plot << "set xrange ['" << m_firstDayStr << "' : '" << m_lastDayStr << "']\n";
-    plot << "set mxtics 0\n";
-    plot << "set xtics format \"%2d\\n%a\"\n";
-    plot << "set xtics 86400\n";
-    plot.addWindY();
-    plot << "set yrange [0 : " << max << "]\n";
-    plot << "plot '" << Gnuplot::PLACEHOLDER << "' using 1:2 with impulses notitle "
-            "linecolor rgb '#3C8EFF' lw 4";
+    WeatherChart chart(reportgen()->configuration());
+    chart.setOutputFile(nameProvider().monthlyDiagram(m_month, "wind"));
+    chart.setXLabel(_("Day"));
+    chart.setTimeAxis("%Y-%m-%d");
+    chart.setXRange(m_firstDayStr, m_lastDayStr);
+    chart.setXTicInterval(86400, "%2d\n%a");
+    chart.addWindY();
+    chart.setYRange(0, max.empty() ? NAN : bw::from_str<double>(max));
+    chart.addSeries(2, Chart::Impulses, "#3C8EFF", 4);
     if (haveGust)
-        plot << ", '" << Gnuplot::PLACEHOLDER << "' using 1:3 with points title 'Böen' "
-            "pt 9 ps 1 linecolor rgb '#180076' lw 2";
-    plot << "\n";
+        chart.addSeries(3, Chart::Points, "#180076", 2, "Böen", Chart::Triangle, 1);
 
-    plot.plot(result.data, haveGust ? 2 : 1);
+    chart.plot(result.data);
 }
 
 void MonthReportGenerator::createRainDiagram()
@@ -181,26 +196,18 @@ void MonthReportGenerator::createRainDiagram()
         result.data[i].at(2) = bw::str(sum);
     }
 
-    Gnuplot plot(reportgen()->configuration());
-    plot.setWorkingDirectory(reportgen()->configuration().reportDirectory());
-    plot.setOutputFile(nameProvider().monthlyDiagram(m_month, "rain"));
-    plot << "set xlabel '" << _("Day") << "'\n";
-    plot << "set ylabel '" << _("Rain [l/m²]") << "'\n";
-    plot << "set grid\n";
-    plot << "set xdata time\n";
-    plot << "set format x '%Y-%m-%d'\n";
-    plot << "set timefmt '%Y-%m-%d'\n";
-    plot << "set xrange ['" << m_firstDayStr << "' : '" << m_lastDayStr << "']\n";
-    plot << "set mxtics 0\n";
-    plot << "set xtics format \"%2d\\n%a\"\n";
-    plot << "set xtics 86400\n";
-    plot << "set style fill solid 1.0 border\n";
-    plot << "plot '" << Gnuplot::PLACEHOLDER
-         << "' using 1:3 with boxes notitle linecolor rgb '#ADD0FF' lw 1, "
-         << " '" << Gnuplot::PLACEHOLDER
-         << "' using 1:2 with impulses notitle linecolor rgb '#0000FF' lw 4\n";
-
-    plot.plot(result.data);
+    Chart chart(reportgen()->configuration());
+    chart.setOutputFile(nameProvider().monthlyDiagram(m_month, "rain"));
+    chart.setXLabel(_("Day"));
+    chart.setTimeAxis("%Y-%m-%d");
+    chart.setXRange(m_firstDayStr, m_lastDayStr);
+    chart.setXTicInterval(86400, "%2d\n%a");
+    chart.setYLabel(_("Rain [l/m²]"));
+    chart.setGrid(Chart::GridX | Chart::GridY);
+    chart.addSeries(3, Chart::Boxes, "#ADD0FF", 1);
+    chart.addSeries(2, Chart::Impulses, "#0000FF", 4);
+
+    chart.plot(result.data);
 }
 
 void MonthReportGenerator::createHtml()
@@ -237,18 +244,18 @@ void MonthReportGenerator::createHtml()
     );
 
     html.addSection(_("Temperature profile"), _("Temperature"), "temperature");
-    html.img(nameProvider().monthlyDiagramLink(m_month, "temperature"));
+    html.chart(nameProvider().monthlyDiagramLink(m_month, "temperature"));
     html.addTopLink();
 
     if (haveWindData()) {
         html.addSection(_("Wind speed"), _("Wind"), "wind");
-        html.img(nameProvider().monthlyDiagramLink(m_month, "wind"));
+        html.chart(nameProvider().monthlyDiagramLink(m_month, "wind"));
         html.addTopLink();
     }
 
     if (haveRainData()) {
         html.addSection(_("Rain"), _("Rain"), "rain");
-        html.img(nameProvider().monthlyDiagramLink(m_month, "rain"));
+        html.chart(nameProvider().monthlyDiagramLink(m_month, "rain"));
         html.addTopLink();
     }
 
@@ -271,8 +278,10 @@ void MonthReportGenerator::createTable(HtmlDocument &html)
         { "°C",    1, true },               // temp_avg
         { "°C",    1, true },               // temp_min
         { "°C",    1, true },               // temp_avg
+        { "°C",    1, true },               // temp_median
         { "km/h",  1, haveWindData() },     // wind_max
         { "Bft",   0, haveWindData() },     // wind_max_beaufort
+        { "km/h",  1, haveWindData() },     // wind_p95
         { "km/h",  1, haveWindGust() },     // wind_gust_max
         { "Bft",   0, haveWindGust() },     // wind_gust_max_beaufort
         { "l/m²",  1, haveRainData() },     // rain
@@ -280,36 +289,39 @@ void MonthReportGenerator::createTable(HtmlDocument &html)
     };
 
     common::Database::Result result = reportgen()->database().executeSqlQuery(
-        "SELECT strftime('%%s', date), "
-        "       temp_avg, "
-        "       temp_min, "
-        "       temp_max, "
-        "       wind_max, "
-        "       wind_bft_max, "
-        "       wind_gust_max, "
-        "       wind_gust_bft_max, "
-        "       rain, "
-        "       rain "
-        "FROM   day_statistics_float "
-        "WHERE  date BETWEEN date(?, 'localtime') AND date(?, 'localtime')"
-        "       AND temp_min != temp_max",
+        "SELECT strftime('%%s', f.date), "
+        "       f.temp_avg, "
+        "       f.temp_min, "
+        "       f.temp_max, "
+        "       round(VETERO_QUANTILE(s.temp_sketch, 0.5)/100.0, 1), "
+        "       f.wind_max, "
+        "       f.wind_bft_max, "
+        "       round(VETERO_QUANTILE(s.wind_sketch, 0.95)/100.0, 1), "
+        "       f.wind_gust_max, "
+        "       f.wind_gust_bft_max, "
+        "       f.rain, "
+        "       f.rain "
+        "FROM   day_statistics_float f "
+        "JOIN   day_statistics s ON s.date = f.date "
+        "WHERE  f.date BETWEEN date(?, 'localtime') AND date(?, 'localtime')"
+        "       AND f.temp_min != f.temp_max",
         m_firstDayStr.c_str(), m_lastDayStr.c_str()
     );
 
     // accumulate the rain
     double sum = 0.0;
     for (int i = 0; i < result.data.size(); ++i) {
-        sum += bw::from_str<double>( result.data[i].at(9) );
-        result.data[i].at(9) = bw::str(sum);
+        sum += bw::from_str<double>( result.data[i].at(11) );
+        result.data[i].at(11) = bw::str(sum);
     }
 
     html << "<table border='0' bgcolor='#000000' cellspacing='1' cellpadding='0' >\n"
          << "<tr bgcolor='#FFFFFF'>\n"
          << "  <th style='padding: 5px' colspan=\"2\"><b></b></th>\n"
-         << "  <th style='padding: 5px' colspan=\"3\"><b>" << _("temperature") << "</b></th>\n";
+         << "  <th style='padding: 5px' colspan=\"4\"><b>" << _("temperature") << "</b></th>\n";
 
     if (haveWindData())
-        html << "  <th style='padding: 5px' colspan=\"2\"><b>" << _("wind") << "</b></th>\n";
+        html << "  <th style='padding: 5px' colspan=\"3\"><b>" << _("wind") << "</b></th>\n";
 
     if (haveWindGust())
         html << "  <th style='padding: 5px' colspan=\"2\"><b>" << _("wind gust") << "</b></th>\n";
@@ -322,10 +334,12 @@ void MonthReportGenerator::createTable(HtmlDocument &html)
          << "  <th style='padding: 5px' colspan=\"2\"><b>" << _("date") << "</b></th>\n"
          << "  <th style='padding: 5px'><b>⌀</b></th>\n"
          << "  <th style='padding: 5px'><b>min</b></th>\n"
-         << "  <th style='padding: 5px'><b>max</b></th>\n";
+         << "  <th style='padding: 5px'><b>max</b></th>\n"
+         << "  <th style='padding: 5px'><b>" << _("median") << "</b></th>\n";
 
     if (haveWindData())
-        html << "  <th style='padding: 5px' colspan=\"2\"><b>max</b></th>\n";
+        html << "  <th style='padding: 5px' colspan=\"2\"><b>max</b></th>\n"
+             << "  <th style='padding: 5px'><b>P95</b></th>\n";
 
     if (haveWindGust())
         html << "  <th style='padding: 5px' colspan=\"2\"><b>max</b></th>\n";
@@ -124,6 +124,34 @@ std::string NameProvider::yearlyDiagramLink(const bw::Datetime &date, const std:
     return bw::FileUtils::join(date.strftime("/%Y"), type + SVG_EXTENSION);
 }
 
+std::string NameProvider::climateDir() const
+{
+    return bw::FileUtils::join(
+        m_reportgen.configuration().reportDirectory(),
+        "climate"
+                );
+}
+
+std::string NameProvider::climateDirLink() const
+{
+    return "/climate/";
+}
+
+std::string NameProvider::climateIndex() const
+{
+    return bw::FileUtils::join(climateDir(), INDEX_HTML);
+}
+
+std::string NameProvider::climateDiagram(const std::string &type) const
+{
+    return bw::FileUtils::join(climateDir(), type + SVG_EXTENSION);
+}
+
+std::string NameProvider::climateDiagramLink(const std::string &type) const
+{
+    return bw::FileUtils::join("/climate", type + SVG_EXTENSION);
+}
+
 std::string NameProvider::indexDir() const
 {
     return m_reportgen.configuration().reportDirectory();
@@ -213,6 +213,43 @@ class NameProvider
          */
         std::string yearlyDiagramLink(const bw::Datetime &date, const std::string &type) const;
 
+        /**
+         * \brief Returns the directory where the climate diagrams and index page are
+         *
+         * \return a full path to a directory (it's not checked if the directories exist)
+         */
+        std::string climateDir() const;
+
+        /**
+         * \brief Returns the link to the climate directory
+         *
+         * \return a link relative to the document root, including a trailing <tt>"/"</tt>
+         */
+        std::string climateDirLink() const;
+
+        /**
+         * \brief Returns the full path name for the index page for the climate report
+         *
+         * \return a full path (it's not checked if the directories exist)
+         */
+        std::string climateIndex() const;
+
+        /**
+         * \brief Returns the full path name for a diagram of the climate report
+         *
+         * \param[in] type the type of the diagram, e.g. <tt>"temperature"</tt>
+         * \return a full path (it's not checked if the directories exist)
+         */
+        std::string climateDiagram(const std::string &type) const;
+
+        /**
+         * \brief Returns the link to a diagram of the climate report
+         *
+         * \param[in] type the type of the diagram, e.g. <tt>"temperature"</tt>
+         * \return a link relative to the document root
+         */
+        std::string climateDiagramLink(const std::string &type) const;
+
         /**
          * \brief Returns the directory in which the index page resides
          *
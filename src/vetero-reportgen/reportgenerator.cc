@@ -15,6 +15,9 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>. }}}
  */
 
+#include <unistd.h>
+
+#include "common/dbaccess.h"
 #include "reportgenerator.h"
 
 namespace vetero {
@@ -42,5 +45,30 @@ const NameProvider &ReportGenerator::nameProvider() const
     return m_nameProvider;
 }
 
+std::string ReportGenerator::dataFingerprint(const std::string &firstDay, const std::string &lastDay,
+                                             bool previous, bool next) const
+{
+    common::DbAccess dbAccess(&m_reportgen->database());
+
+    // the navigation links change when the next day, month or year starts
+    return dbAccess.dataFingerprint(firstDay, lastDay) +
+           (previous ? "<" : "") + (next ? ">" : "");
+}
+
+bool ReportGenerator::upToDate(const std::string &report, const std::string &fingerprint,
+                               const std::string &page) const
+{
+    if (m_reportgen->force())
+        return false;
+
+    return access(page.c_str(), F_OK) == 0 &&
+           m_reportgen->watermarks().upToDate(report, fingerprint);
+}
+
+void ReportGenerator::markGenerated(const std::string &report, const std::string &fingerprint)
+{
+    m_reportgen->watermarks().update(report, fingerprint);
+}
+
 } // end namespace reportgen
 } // end namespace vetero
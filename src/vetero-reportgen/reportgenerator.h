@@ -70,6 +70,41 @@ class ReportGenerator
          */
         const NameProvider &nameProvider() const;
 
+        /**
+         * \brief Returns the fingerprint of the input data of a report
+         *
+         * \param[in] firstDay the first day of the report (<tt>YYYY-MM-DD</tt>)
+         * \param[in] lastDay the last day of the report (<tt>YYYY-MM-DD</tt>)
+         * \param[in] previous \c true if the report links to a previous report
+         * \param[in] next \c true if the report links to a next report
+         * \return the fingerprint for upToDate() and markGenerated()
+         * \exception common::DatabaseError if the database cannot be queried
+         */
+        std::string dataFingerprint(const std::string &firstDay, const std::string &lastDay,
+                                    bool previous, bool next) const;
+
+        /**
+         * \brief Checks if a report can be skipped
+         *
+         * That's the case if the report has been generated from the same data before and its
+         * HTML page still exists, unless <tt>--force</tt> has been specified.
+         *
+         * \param[in] report the name of the report like <tt>"day:2012-04-01"</tt>
+         * \param[in] fingerprint the result of dataFingerprint()
+         * \param[in] page the HTML page of the report
+         * \return \c true if the report doesn't need to be generated
+         */
+        bool upToDate(const std::string &report, const std::string &fingerprint,
+                      const std::string &page) const;
+
+        /**
+         * \brief Records that a report has been generated successfully
+         *
+         * \param[in] report the name of the report like <tt>"day:2012-04-01"</tt>
+         * \param[in] fingerprint the result of dataFingerprint()
+         */
+        void markGenerated(const std::string &report, const std::string &fingerprint);
+
     public:
         /**
          * \brief Does the work.
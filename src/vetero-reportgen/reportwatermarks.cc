@@ -0,0 +1,135 @@
+/* {{{
+ * (c) 2022, Bernhard Walle <bernhard@bwalle.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>. }}}
+ */
+#include <cerrno>
+#include <fstream>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <libbw/log/debug.h>
+
+#include "common/lockfile.h"
+#include "common/outputfile.h"
+#include "common/utils.h"
+#include "reportwatermarks.h"
+
+namespace vetero {
+namespace reportgen {
+
+/* ReportWatermarks {{{ */
+
+namespace {
+
+uint64_t hash(const std::string &str)
+{
+    return common::fnv1a_hash(str.data(), str.size());
+}
+
+} // anonymous namespace
+
+ReportWatermarks::ReportWatermarks(const std::string &filename, const std::string &environment)
+    : m_filename(filename)
+    , m_environment(hash(environment))
+{
+    load();
+}
+
+bool ReportWatermarks::upToDate(const std::string &report, const std::string &fingerprint) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    std::map<std::string, uint64_t>::const_iterator it = m_watermarks.find(report);
+    return it != m_watermarks.end() && it->second == hash(fingerprint);
+}
+
+void ReportWatermarks::update(const std::string &report, const std::string &fingerprint)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_watermarks[report] = hash(fingerprint);
+    m_updated.insert(report);
+}
+
+void ReportWatermarks::save()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_updated.empty())
+        return;
+
+    // other vetero-reportgen processes (report_workers) save their watermarks as well,
+    // so merge ours into the current file while holding the lock
+    std::string lockFilename = m_filename + ".lock";
+    int fd = open(lockFilename.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0)
+        throw common::SystemError("Unable to create '" + lockFilename + "'", errno);
+    ::close(fd);
+
+    common::LockFile fileLock(lockFilename);
+    if (!fileLock.lockExclusive())
+        throw common::ApplicationError("Unable to lock the watermarks: " + fileLock.error());
+
+    std::map<std::string, uint64_t> watermarks = read();
+    for (std::set<std::string>::const_iterator it = m_updated.begin(); it != m_updated.end(); ++it)
+        watermarks[*it] = m_watermarks[*it];
+
+    common::OutputFile file(m_filename);
+    file.excludeFromChangedFiles();
+
+    std::ostream &os = file.stream();
+    os << std::hex << "environment " << m_environment << "\n";
+    std::map<std::string, uint64_t>::const_iterator it;
+    for (it = watermarks.begin(); it != watermarks.end(); ++it)
+        os << it->first << " " << it->second << "\n";
+
+    file.commit();
+    m_watermarks.swap(watermarks);
+    m_updated.clear();
+}
+
+void ReportWatermarks::load()
+{
+    m_watermarks = read();
+    BW_DEBUG_DBG("Read %zu report watermarks from '%s'", m_watermarks.size(), m_filename.c_str());
+}
+
+std::map<std::string, uint64_t> ReportWatermarks::read() const
+{
+    std::map<std::string, uint64_t> watermarks;
+
+    std::ifstream is(m_filename.c_str());
+    if (!is.is_open())
+        return watermarks;
+
+    std::string key;
+    uint64_t value;
+    is >> std::hex;
+    if (!(is >> key >> value) || key != "environment" || value != m_environment) {
+        BW_DEBUG_INFO("Version or configuration changed, all reports are outdated");
+        return watermarks;
+    }
+
+    while (is >> key >> value)
+        watermarks[key] = value;
+
+    return watermarks;
+}
+
+/* }}} */
+
+} // end namespace reportgen
+} // end namespace vetero
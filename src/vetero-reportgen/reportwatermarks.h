@@ -0,0 +1,119 @@
+/* {{{
+ * (c) 2022, Bernhard Walle <bernhard@bwalle.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>. }}}
+ */
+#ifndef VETERO_REPORTGEN_REPORTWATERMARKS_H_
+#define VETERO_REPORTGEN_REPORTWATERMARKS_H_
+
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <stdint.h>
+
+#include "common/error.h"
+
+namespace vetero {
+namespace reportgen {
+
+/* ReportWatermarks {{{ */
+
+/**
+ * \class ReportWatermarks
+ * \brief Remembers from which data each report has been generated
+ *
+ * For each report (<tt>"day:2012-04-01"</tt>, <tt>"month:2012-04"</tt>, ...) the hash of a
+ * fingerprint of its input data is stored in a hidden file in the report directory. A report
+ * whose fingerprint hasn't changed since the last run doesn't need to be generated again.
+ *
+ * All watermarks are tied to an environment string (the vetero version and the configuration).
+ * If that changes, all reports are considered outdated.
+ *
+ * The methods are thread-safe. Several processes may use the same file, save() merges the
+ * watermarks of all of them.
+ *
+ * \author Bernhard Walle <bernhard@bwalle.de>
+ * \ingroup report
+ */
+class ReportWatermarks
+{
+    public:
+        /**
+         * \brief Loads the watermarks
+         *
+         * A missing or unreadable file is no error, all reports are outdated then.
+         *
+         * \param[in] filename the file that stores the watermarks
+         * \param[in] environment everything besides the data that influences the reports
+         */
+        ReportWatermarks(const std::string &filename, const std::string &environment);
+
+    public:
+        /**
+         * \brief Checks if a report has been generated from the given data
+         *
+         * \param[in] report the name of the report
+         * \param[in] fingerprint the fingerprint of the current input data
+         * \return \c true if the report is up to date
+         */
+        bool upToDate(const std::string &report, const std::string &fingerprint) const;
+
+        /**
+         * \brief Records that a report has been generated
+         *
+         * \param[in] report the name of the report
+         * \param[in] fingerprint the fingerprint of the input data
+         */
+        void update(const std::string &report, const std::string &fingerprint);
+
+        /**
+         * \brief Writes the watermarks if they have been modified
+         *
+         * The watermarks updated since the last save() are merged into the file under an
+         * exclusive lock, so the updates of other processes don't get lost. Afterwards, the
+         * object knows the watermarks of the other processes as well.
+         *
+         * \exception common::ApplicationError if the file cannot be written
+         */
+        void save();
+
+    protected:
+        /**
+         * \brief Reads the file
+         */
+        void load();
+
+        /**
+         * \brief Reads the watermarks of the file
+         *
+         * \return the watermarks, empty if the file doesn't exist or belongs to another
+         *         environment
+         */
+        std::map<std::string, uint64_t> read() const;
+
+    private:
+        std::string m_filename;
+        uint64_t m_environment;
+        std::map<std::string, uint64_t> m_watermarks;
+        std::set<std::string> m_updated;
+        mutable std::mutex m_mutex;
+};
+
+/* }}} */
+
+} // end namespace reportgen
+} // end namespace vetero
+
+#endif // VETERO_REPORTGEN_REPORTWATERMARKS_H_
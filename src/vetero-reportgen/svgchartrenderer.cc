@@ -0,0 +1,557 @@
+/* {{{
+ * (c) 2022, Bernhard Walle <bernhard@bwalle.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>. }}}
+ */
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include <libbw/stringutil.h>
+#include <libbw/log/debug.h>
+
+#include "common/outputfile.h"
+#include "svgchartrenderer.h"
+
+namespace vetero {
+namespace reportgen {
+
+/* SvgChartRenderer {{{ */
+
+namespace {
+
+const char *FONT = "font-family=\"Arial\" font-size=\"12\"";
+const int LINE_HEIGHT = 14;
+const double TIC_LENGTH = 6.0;
+const char *BORDER_COLOR = "#000000";
+const char *GRID_COLOR = "#a0a0a0";
+
+// formats a coordinate, one decimal is more than enough for the screen
+std::string coord(double value)
+{
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.1f", value);
+    return buffer;
+}
+
+std::string escape(const std::string &text)
+{
+    std::string result;
+    result.reserve(text.size());
+    for (size_t i = 0; i < text.size(); ++i) {
+        switch (text[i]) {
+            case '&':   result += "&amp;";  break;
+            case '<':   result += "&lt;";   break;
+            case '>':   result += "&gt;";   break;
+            case '"':   result += "&quot;"; break;
+            default:    result += text[i];  break;
+        }
+    }
+    return result;
+}
+
+// 1, 2 or 5 times a power of ten so that about 'count' tics fit into 'range'
+double niceStep(double range, int count)
+{
+    double raw = range / count;
+    double magnitude = std::pow(10.0, std::floor(std::log10(raw)));
+    double normalized = raw / magnitude;
+
+    if (normalized <= 1.0)
+        return magnitude;
+    else if (normalized <= 2.0)
+        return 2.0 * magnitude;
+    else if (normalized <= 5.0)
+        return 5.0 * magnitude;
+    else
+        return 10.0 * magnitude;
+}
+
+std::string formatNumber(double value, double step)
+{
+    int decimals = std::max(0, -static_cast<int>(std::floor(std::log10(step) + 1e-9)));
+    if (std::fabs(value) < step / 2.0)
+        value = 0.0;
+
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.*f", decimals, value);
+    return buffer;
+}
+
+// equidistant tics between min and max
+std::vector<Chart::Tic> linearTics(double min, double max, double step)
+{
+    std::vector<Chart::Tic> tics;
+    for (double pos = std::ceil(min / step - 1e-9) * step; pos <= max + step * 1e-9; pos += step) {
+        Chart::Tic tic = { pos, formatNumber(pos, step) };
+        tics.push_back(tic);
+    }
+    return tics;
+}
+
+} // anonymous namespace
+
+SvgChartRenderer::SvgChartRenderer(int width, int height)
+    : m_width(width)
+    , m_height(height)
+    , m_left(80.0)
+    , m_right(width - 80.0)
+    , m_top(20.0)
+    , m_bottom(height - 60.0)
+    , m_out(NULL)
+{}
+
+void SvgChartRenderer::render(const Chart &chart, const Chart::StringStringVector &data)
+{
+    BW_DEBUG_DBG("Writing chart '%s'", chart.outputFile().c_str());
+
+    common::OutputFile file(chart.outputFile(), chart.configuration().reportSvgCompression());
+    write(file.stream(), chart, data);
+    file.commit();
+}
+
+std::string SvgChartRenderer::svg(const Chart &chart, const Chart::StringStringVector &data)
+{
+    std::ostringstream stream;
+    write(stream, chart, data);
+    return stream.str();
+}
+
+void SvgChartRenderer::write(std::ostream &out, const Chart &chart,
+                             const Chart::StringStringVector &data)
+{
+    const std::vector<Chart::Series> &series = chart.series();
+    std::vector< std::vector<Point> > points = layout(chart, data);
+
+    m_out = &out;
+    *m_out << "<?xml version=\"1.0\" encoding=\"utf-8\" standalone=\"no\"?>\n"
+           << "<svg width=\"" << m_width << "\" height=\"" << m_height << "\" "
+           << "viewBox=\"0 0 " << m_width << " " << m_height << "\" "
+           << "xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\">\n"
+           << "<defs><clipPath id=\"plotarea\"><rect x=\"" << coord(m_left) << "\" y=\""
+           << coord(m_top) << "\" width=\"" << coord(m_right - m_left) << "\" height=\""
+           << coord(m_bottom - m_top) << "\"/></clipPath></defs>\n"
+           << "<rect width=\"100%\" height=\"100%\" fill=\"#ffffff\"/>\n";
+
+    // grid
+
+    *m_out << "<g stroke=\"" << GRID_COLOR << "\" stroke-width=\"0.5\" stroke-dasharray=\"2,4\">\n";
+    if (chart.grid() & Chart::GridX) {
+        for (size_t i = 0; i < m_xAxis.tics.size(); ++i) {
+            std::string x = coord(mapX(m_xAxis.tics[i].position));
+            *m_out << "<path d=\"M" << x << "," << coord(m_bottom) << " V" << coord(m_top) << "\"/>\n";
+        }
+    }
+    const std::vector<Chart::Tic> &gridYTics = (chart.grid() & Chart::GridY2)
+        ? chart.y2Tics() : m_yAxis.tics;
+    if (chart.grid() & (Chart::GridY | Chart::GridY2)) {
+        for (size_t i = 0; i < gridYTics.size(); ++i) {
+            double pos = gridYTics[i].position;
+            if (pos < m_yAxis.min || pos > m_yAxis.max)
+                continue;
+            *m_out << "<path d=\"M" << coord(m_left) << "," << coord(mapY(pos))
+                   << " H" << coord(m_right) << "\"/>\n";
+        }
+    }
+    *m_out << "</g>\n";
+
+    // data
+
+    *m_out << "<g clip-path=\"url(#plotarea)\">\n";
+    for (size_t i = 0; i < series.size(); ++i)
+        drawSeries(series[i], points[i], chart.boxWidth());
+    *m_out << "</g>\n";
+
+    // border and tics
+
+    *m_out << "<g fill=\"none\" stroke=\"" << BORDER_COLOR << "\" stroke-width=\"1\">\n"
+           << "<rect x=\"" << coord(m_left) << "\" y=\"" << coord(m_top) << "\" width=\""
+           << coord(m_right - m_left) << "\" height=\"" << coord(m_bottom - m_top) << "\"/>\n";
+    for (size_t i = 0; i < m_xAxis.tics.size(); ++i) {
+        std::string x = coord(mapX(m_xAxis.tics[i].position));
+        *m_out << "<path d=\"M" << x << "," << coord(m_bottom) << " v" << coord(-TIC_LENGTH)
+               << " M" << x << "," << coord(m_top) << " v" << coord(TIC_LENGTH) << "\"/>\n";
+    }
+    bool mirrorYTics = chart.y2Tics().empty();
+    for (size_t i = 0; i < m_yAxis.tics.size(); ++i) {
+        std::string y = coord(mapY(m_yAxis.tics[i].position));
+        *m_out << "<path d=\"M" << coord(m_left) << "," << y << " h" << coord(TIC_LENGTH);
+        if (mirrorYTics)
+            *m_out << " M" << coord(m_right) << "," << y << " h" << coord(-TIC_LENGTH);
+        *m_out << "\"/>\n";
+    }
+    for (size_t i = 0; i < chart.y2Tics().size(); ++i) {
+        double pos = chart.y2Tics()[i].position;
+        if (pos < m_yAxis.min || pos > m_yAxis.max)
+            continue;
+        *m_out << "<path d=\"M" << coord(m_right) << "," << coord(mapY(pos))
+               << " h" << coord(-TIC_LENGTH) << "\"/>\n";
+    }
+    *m_out << "</g>\n";
+
+    // labels
+
+    *m_out << "<g " << FONT << " fill=\"#000000\">\n";
+    for (size_t i = 0; i < m_xAxis.tics.size(); ++i)
+        drawText(mapX(m_xAxis.tics[i].position), m_bottom + LINE_HEIGHT + 4, "middle",
+                 m_xAxis.tics[i].label);
+    for (size_t i = 0; i < m_yAxis.tics.size(); ++i)
+        drawText(m_left - 8, mapY(m_yAxis.tics[i].position) + 4, "end", m_yAxis.tics[i].label);
+    for (size_t i = 0; i < chart.y2Tics().size(); ++i) {
+        double pos = chart.y2Tics()[i].position;
+        if (pos < m_yAxis.min || pos > m_yAxis.max)
+            continue;
+        drawText(m_right + 8, mapY(pos) + 4, "start", chart.y2Tics()[i].label);
+    }
+
+    if (!chart.xLabel().empty())
+        drawText((m_left + m_right) / 2, m_height - 8, "middle", chart.xLabel());
+    if (!chart.yLabel().empty())
+        drawText(24, (m_top + m_bottom) / 2, "middle", chart.yLabel(), -90);
+    if (!chart.y2Label().empty())
+        drawText(m_width - 24, (m_top + m_bottom) / 2, "middle", chart.y2Label(), 90);
+
+    drawKey(chart);
+    *m_out << "</g>\n"
+           << "</svg>\n";
+    m_out = NULL;
+}
+
+std::vector< std::vector<SvgChartRenderer::Point> >
+SvgChartRenderer::layout(const Chart &chart, const Chart::StringStringVector &data)
+{
+    std::vector< std::vector<Point> > points;
+    for (size_t i = 0; i < chart.series().size(); ++i)
+        points.push_back(seriesPoints(chart, chart.series()[i], data));
+
+    m_xAxis = xAxis(chart, data);
+    m_yAxis = yAxis(chart, points);
+
+    return points;
+}
+
+const SvgChartRenderer::Axis &SvgChartRenderer::currentXAxis() const
+{
+    return m_xAxis;
+}
+
+const SvgChartRenderer::Axis &SvgChartRenderer::currentYAxis() const
+{
+    return m_yAxis;
+}
+
+SvgChartRenderer::Axis SvgChartRenderer::xAxis(const Chart &chart,
+                                               const Chart::StringStringVector &data) const
+{
+    Axis axis = { NAN, NAN, std::vector<Chart::Tic>() };
+
+    bool minOk = false, maxOk = false;
+    if (!chart.xMin().empty())
+        axis.min = chart.parseX(chart.xMin(), minOk);
+    if (!chart.xMax().empty())
+        axis.max = chart.parseX(chart.xMax(), maxOk);
+
+    if (!minOk || !maxOk) {
+        double min = NAN, max = NAN;
+        for (size_t i = 0; i < data.size(); ++i) {
+            bool ok;
+            double x = data[i].empty() ? 0.0 : chart.parseX(data[i][0], ok);
+            if (data[i].empty() || !ok)
+                continue;
+            min = std::isnan(min) ? x : std::min(min, x);
+            max = std::isnan(max) ? x : std::max(max, x);
+        }
+        if (!minOk)
+            axis.min = std::isnan(min) ? 0.0 : min;
+        if (!maxOk)
+            axis.max = std::isnan(max) ? 1.0 : max;
+    }
+    if (axis.max <= axis.min)
+        axis.max = axis.min + 1.0;
+
+    if (!chart.xTics().empty()) {
+        for (size_t i = 0; i < chart.xTics().size(); ++i) {
+            const Chart::Tic &tic = chart.xTics()[i];
+            if (tic.position >= axis.min && tic.position <= axis.max)
+                axis.tics.push_back(tic);
+        }
+    } else if (chart.xTicInterval() > 0) {
+        double step = chart.xTicInterval();
+        for (double pos = std::ceil(axis.min / step - 1e-9) * step;
+                pos <= axis.max + step * 1e-9; pos += step) {
+            Chart::Tic tic = { pos, std::string() };
+            if (chart.timeAxis())
+                tic.label = Chart::formatTime(pos, chart.xTicFormat());
+            else {
+                char buffer[64];
+                std::snprintf(buffer, sizeof(buffer), chart.xTicFormat().c_str(), pos);
+                tic.label = buffer;
+            }
+            axis.tics.push_back(tic);
+        }
+    } else {
+        double step = niceStep(axis.max - axis.min, 10);
+        axis.tics = linearTics(axis.min, axis.max, step);
+        if (chart.timeAxis()) {
+            for (size_t i = 0; i < axis.tics.size(); ++i)
+                axis.tics[i].label = Chart::formatTime(axis.tics[i].position, chart.timeFormat());
+        }
+    }
+
+    return axis;
+}
+
+SvgChartRenderer::Axis SvgChartRenderer::yAxis(const Chart &chart,
+                                               const std::vector< std::vector<Point> > &points) const
+{
+    double min = NAN, max = NAN;
+    for (size_t i = 0; i < points.size(); ++i) {
+        Chart::Style style = chart.series()[i].style;
+        if (style == Chart::Boxes || style == Chart::Impulses) {
+            min = std::isnan(min) ? 0.0 : std::min(min, 0.0);
+            max = std::isnan(max) ? 0.0 : std::max(max, 0.0);
+        }
+        for (size_t j = 0; j < points[i].size(); ++j) {
+            const Point &point = points[i][j];
+            if (!point.valid || point.x < m_xAxis.min || point.x > m_xAxis.max)
+                continue;
+            min = std::isnan(min) ? point.y : std::min(min, point.y);
+            max = std::isnan(max) ? point.y : std::max(max, point.y);
+        }
+    }
+
+    // fixed ends win over the data
+    if (!std::isnan(chart.yMin()))
+        min = chart.yMin();
+    if (!std::isnan(chart.yMax()))
+        max = chart.yMax();
+    if (std::isnan(min))
+        min = 0.0;
+    if (std::isnan(max) || max <= min)
+        max = min + 1.0;
+
+    double step = niceStep(max - min, 8);
+    if (std::isnan(chart.yMin()))
+        min = std::floor(min / step + 1e-9) * step;
+    if (std::isnan(chart.yMax()))
+        max = std::ceil(max / step - 1e-9) * step;
+
+    Axis axis = { min, max, linearTics(min, max, step) };
+    return axis;
+}
+
+std::vector<SvgChartRenderer::Point> SvgChartRenderer::seriesPoints(
+        const Chart &chart, const Chart::Series &series, const Chart::StringStringVector &data) const
+{
+    std::vector<Point> points;
+    points.reserve(data.size());
+
+    size_t column = series.column - 1;
+    for (size_t i = 0; i < data.size(); ++i) {
+        const Chart::StringVector &row = data[i];
+        Point point = { 0.0, 0.0, false };
+
+        if (!row.empty() && column < row.size() && !row[column].empty()) {
+            bool xOk;
+            point.x = chart.parseX(row[0], xOk);
+
+            char *end;
+            point.y = std::strtod(row[column].c_str(), &end);
+            point.valid = xOk && *end == '\0' && std::isfinite(point.y);
+        }
+        points.push_back(point);
+    }
+
+    return points;
+}
+
+void SvgChartRenderer::drawSeries(const Chart::Series &series, const std::vector<Point> &points,
+                                  double boxWidth)
+{
+    double base = mapY(std::min(std::max(0.0, m_yAxis.min), m_yAxis.max));
+    std::string lineWidth = coord(series.lineWidth);
+
+    switch (series.style) {
+        case Chart::Lines:
+        case Chart::LinesPoints: {
+            *m_out << "<path fill=\"none\" stroke=\"" << series.color << "\" stroke-width=\""
+                   << lineWidth << "\" stroke-linejoin=\"round\" d=\"";
+            bool connected = false;
+            for (size_t i = 0; i < points.size(); ++i) {
+                if (!points[i].valid) {
+                    connected = false;
+                    continue;
+                }
+                *m_out << (connected ? "L" : "M") << coord(mapX(points[i].x)) << ","
+                       << coord(mapY(points[i].y)) << " ";
+                connected = true;
+            }
+            *m_out << "\"/>\n";
+
+            if (series.style == Chart::LinesPoints) {
+                for (size_t i = 0; i < points.size(); ++i)
+                    if (points[i].valid)
+                        drawMarker(series, mapX(points[i].x), mapY(points[i].y));
+            }
+            break;
+        }
+
+        case Chart::Points:
+            for (size_t i = 0; i < points.size(); ++i)
+                if (points[i].valid)
+                    drawMarker(series, mapX(points[i].x), mapY(points[i].y));
+            break;
+
+        case Chart::Boxes: {
+            *m_out << "<g fill=\"" << series.color << "\" stroke=\"" << series.color
+                   << "\" stroke-width=\"" << lineWidth << "\">\n";
+            for (size_t i = 0; i < points.size(); ++i) {
+                if (!points[i].valid)
+                    continue;
+
+                // like Gnuplot, boxes touch their neighbours if no width is set
+                double width = boxWidth;
+                if (width <= 0) {
+                    double left = NAN, right = NAN;
+                    for (size_t j = i; j-- > 0; )
+                        if (points[j].valid) {
+                            left = points[i].x - points[j].x;
+                            break;
+                        }
+                    for (size_t j = i + 1; j < points.size(); ++j)
+                        if (points[j].valid) {
+                            right = points[j].x - points[i].x;
+                            break;
+                        }
+                    width = std::isnan(left) ? right : std::isnan(right) ? left : (left + right) / 2;
+                    if (std::isnan(width))
+                        width = (m_xAxis.max - m_xAxis.min) / 20;
+                }
+
+                double x1 = mapX(points[i].x - width / 2);
+                double x2 = mapX(points[i].x + width / 2);
+                double y = mapY(points[i].y);
+                *m_out << "<rect x=\"" << coord(x1) << "\" y=\"" << coord(std::min(y, base))
+                       << "\" width=\"" << coord(x2 - x1) << "\" height=\""
+                       << coord(std::fabs(base - y)) << "\"/>\n";
+            }
+            *m_out << "</g>\n";
+            break;
+        }
+
+        case Chart::Impulses:
+            *m_out << "<path stroke=\"" << series.color << "\" stroke-width=\"" << lineWidth
+                   << "\" d=\"";
+            for (size_t i = 0; i < points.size(); ++i) {
+                if (!points[i].valid)
+                    continue;
+                *m_out << "M" << coord(mapX(points[i].x)) << "," << coord(base)
+                       << " V" << coord(mapY(points[i].y)) << " ";
+            }
+            *m_out << "\"/>\n";
+            break;
+    }
+}
+
+void SvgChartRenderer::drawMarker(const Chart::Series &series, double x, double y)
+{
+    double size = 4.0 * series.pointSize;
+
+    if (series.pointType == Chart::Triangle) {
+        *m_out << "<path fill=\"" << series.color << "\" d=\"M" << coord(x) << ","
+               << coord(y - size) << " L" << coord(x + size) << "," << coord(y + size * 0.7)
+               << " L" << coord(x - size) << "," << coord(y + size * 0.7) << " Z\"/>\n";
+    } else {
+        *m_out << "<circle fill=\"" << series.color << "\" cx=\"" << coord(x) << "\" cy=\""
+               << coord(y) << "\" r=\"" << coord(size * 0.75) << "\"/>\n";
+    }
+}
+
+void SvgChartRenderer::drawText(double x, double y, const char *anchor, const std::string &text,
+                                int rotate)
+{
+    std::vector<std::string> lines = bw::stringsplit(text, "\n");
+
+    *m_out << "<text x=\"" << coord(x) << "\" y=\"" << coord(y) << "\" text-anchor=\""
+           << anchor << "\"";
+    if (rotate != 0)
+        *m_out << " transform=\"rotate(" << rotate << " " << coord(x) << " " << coord(y) << ")\"";
+    *m_out << ">";
+
+    if (lines.size() <= 1)
+        *m_out << escape(text);
+    else {
+        for (size_t i = 0; i < lines.size(); ++i)
+            *m_out << "<tspan x=\"" << coord(x) << "\" dy=\"" << (i == 0 ? 0 : LINE_HEIGHT)
+                   << "\">" << escape(lines[i]) << "</tspan>";
+    }
+    *m_out << "</text>\n";
+}
+
+void SvgChartRenderer::drawKey(const Chart &chart)
+{
+    // at the top right of the plot area like Gnuplot's default key
+    double y = m_top + LINE_HEIGHT;
+    double sampleLeft = m_right - 60;
+    double sampleRight = m_right - 12;
+
+    for (size_t i = 0; i < chart.series().size(); ++i) {
+        const Chart::Series &series = chart.series()[i];
+        if (series.title.empty())
+            continue;
+
+        drawText(sampleLeft - 8, y, "end", series.title);
+
+        double middle = y - 4;
+        switch (series.style) {
+            case Chart::Lines:
+            case Chart::LinesPoints:
+            case Chart::Impulses:
+                *m_out << "<path stroke=\"" << series.color << "\" stroke-width=\""
+                       << coord(series.lineWidth) << "\" d=\"M" << coord(sampleLeft) << ","
+                       << coord(middle) << " H" << coord(sampleRight) << "\"/>\n";
+                if (series.style == Chart::LinesPoints)
+                    drawMarker(series, (sampleLeft + sampleRight) / 2, middle);
+                break;
+
+            case Chart::Points:
+                drawMarker(series, (sampleLeft + sampleRight) / 2, middle);
+                break;
+
+            case Chart::Boxes:
+                *m_out << "<rect fill=\"" << series.color << "\" x=\"" << coord(sampleLeft)
+                       << "\" y=\"" << coord(middle - 4) << "\" width=\""
+                       << coord(sampleRight - sampleLeft) << "\" height=\"8\"/>\n";
+                break;
+        }
+
+        y += LINE_HEIGHT;
+    }
+}
+
+double SvgChartRenderer::mapX(double x) const
+{
+    return m_left + (x - m_xAxis.min) / (m_xAxis.max - m_xAxis.min) * (m_right - m_left);
+}
+
+double SvgChartRenderer::mapY(double y) const
+{
+    return m_bottom - (y - m_yAxis.min) / (m_yAxis.max - m_yAxis.min) * (m_bottom - m_top);
+}
+
+/* }}} */
+
+} // end namespace reportgen
+} // end namespace vetero
@@ -0,0 +1,226 @@
+/* {{{
+ * (c) 2022, Bernhard Walle <bernhard@bwalle.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>. }}}
+ */
+#ifndef VETERO_REPORTGEN_SVGCHARTRENDERER_H_
+#define VETERO_REPORTGEN_SVGCHARTRENDERER_H_
+
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "common/error.h"
+#include "chart.h"
+
+namespace vetero {
+namespace reportgen {
+
+/* SvgChartRenderer {{{ */
+
+/**
+ * \class SvgChartRenderer
+ * \brief Draws a Chart as SVG without external programs
+ *
+ * Produces diagrams that look like the ones Gnuplot's SVG terminal creates with the settings
+ * vetero used before (1000x400 pixels, Arial), but runs in-process: there's no Gnuplot process
+ * per diagram and the SVG is only compressed and written if it changed, see common::OutputFile.
+ *
+ * Missing values (empty strings or values that are no numbers) interrupt lines. Values outside
+ * of the y range are clipped.
+ *
+ * \author Bernhard Walle <bernhard@bwalle.de>
+ * \ingroup report
+ */
+class SvgChartRenderer
+{
+    public:
+        /**
+         * \brief C'tor
+         *
+         * \param[in] width the width of the diagram in pixels
+         * \param[in] height the height of the diagram in pixels
+         */
+        SvgChartRenderer(int width=1000, int height=400);
+
+    public:
+        /**
+         * \brief Draws \p chart and writes it compressed to the output file of \p chart
+         *
+         * \param[in] chart the description of the diagram
+         * \param[in] data the data with the x values in the first column
+         * \exception common::ApplicationError if the file cannot be written, the old file
+         *            is kept then
+         */
+        void render(const Chart &chart, const Chart::StringStringVector &data);
+
+        /**
+         * \brief Draws \p chart
+         *
+         * \param[in] chart the description of the diagram
+         * \param[in] data the data with the x values in the first column
+         * \return the SVG document
+         */
+        std::string svg(const Chart &chart, const Chart::StringStringVector &data);
+
+        /**
+         * \brief Draws \p chart to \p out
+         *
+         * \param[out] out the stream the SVG document is written to
+         * \param[in] chart the description of the diagram
+         * \param[in] data the data with the x values in the first column
+         */
+        void write(std::ostream &out, const Chart &chart, const Chart::StringStringVector &data);
+
+    protected:
+        /**
+         * \brief Range and tics of an axis
+         */
+        struct Axis {
+            double min;                     ///< minimum in axis units
+            double max;                     ///< maximum in axis units
+            std::vector<Chart::Tic> tics;   ///< the tics inside of the range
+        };
+
+        /**
+         * \brief A value of a series, \c valid is \c false for missing values
+         */
+        struct Point {
+            double x;
+            double y;
+            bool valid;
+        };
+
+        /**
+         * \brief Extracts the values of all series and computes both axes
+         *
+         * \param[in] chart the description of the diagram
+         * \param[in] data the data
+         * \return the values of the series in the order of Chart::series()
+         */
+        std::vector< std::vector<Point> > layout(const Chart &chart,
+                                                 const Chart::StringStringVector &data);
+
+        /**
+         * \brief Returns the x axis computed by the last layout()
+         *
+         * \return the axis
+         */
+        const Axis &currentXAxis() const;
+
+        /**
+         * \brief Returns the y axis computed by the last layout()
+         *
+         * \return the axis
+         */
+        const Axis &currentYAxis() const;
+
+        /**
+         * \brief Computes the x axis
+         *
+         * \param[in] chart the description of the diagram
+         * \param[in] data the data
+         * \return the axis
+         */
+        Axis xAxis(const Chart &chart, const Chart::StringStringVector &data) const;
+
+        /**
+         * \brief Computes the y axis
+         *
+         * Autoscaled ends are extended to the next tic like Gnuplot does.
+         *
+         * \param[in] chart the description of the diagram
+         * \param[in] points the values of all series
+         * \return the axis
+         */
+        Axis yAxis(const Chart &chart, const std::vector< std::vector<Point> > &points) const;
+
+        /**
+         * \brief Extracts the values of a series
+         *
+         * \param[in] chart the description of the diagram
+         * \param[in] series the series
+         * \param[in] data the data
+         * \return the values in the order of the data
+         */
+        std::vector<Point> seriesPoints(const Chart &chart, const Chart::Series &series,
+                                        const Chart::StringStringVector &data) const;
+
+        /**
+         * \brief Draws a series
+         *
+         * \param[in] series the series
+         * \param[in] points the values of the series
+         * \param[in] boxWidth the width of boxes, 0 for automatic
+         */
+        void drawSeries(const Chart::Series &series, const std::vector<Point> &points,
+                        double boxWidth);
+
+        /**
+         * \brief Draws a point marker
+         *
+         * \param[in] series the series that defines the shape, size and color
+         * \param[in] x the x coordinate in pixels
+         * \param[in] y the y coordinate in pixels
+         */
+        void drawMarker(const Chart::Series &series, double x, double y);
+
+        /**
+         * \brief Draws a text that may span multiple lines
+         *
+         * \param[in] x the x coordinate in pixels
+         * \param[in] y the y coordinate of the baseline of the first line in pixels
+         * \param[in] anchor the SVG text-anchor
+         * \param[in] text the text
+         * \param[in] rotate the rotation in degrees around (\p x, \p y)
+         */
+        void drawText(double x, double y, const char *anchor, const std::string &text,
+                      int rotate=0);
+
+        /**
+         * \brief Draws the key with the titles of the series
+         *
+         * \param[in] chart the description of the diagram
+         */
+        void drawKey(const Chart &chart);
+
+        /**
+         * \brief Converts an x value to pixels
+         */
+        double mapX(double x) const;
+
+        /**
+         * \brief Converts an y value to pixels
+         */
+        double mapY(double y) const;
+
+    private:
+        int m_width;
+        int m_height;
+        double m_left;
+        double m_right;
+        double m_top;
+        double m_bottom;
+        Axis m_xAxis;
+        Axis m_yAxis;
+        std::ostream *m_out;
+};
+
+/* }}} */
+
+} // end namespace reportgen
+} // end namespace vetero
+
+#endif // VETERO_REPORTGEN_SVGCHARTRENDERER_H_
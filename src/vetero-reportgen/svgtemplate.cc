@@ -0,0 +1,136 @@
+/* {{{
+ * (c) 2022, Bernhard Walle <bernhard@bwalle.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>. }}}
+ */
+#include <cerrno>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+
+#include <sys/stat.h>
+
+#include <libbw/log/debug.h>
+
+#include "svgtemplate.h"
+
+namespace vetero {
+namespace reportgen {
+
+/* SvgTemplate {{{ */
+
+namespace {
+
+// Marks a slot while parsing. Placeholders are printable, so they never match a marker.
+const char SLOT_BEGIN = '\001';
+const char SLOT_END = '\002';
+
+std::mutex cacheMutex;
+std::map<std::string, std::shared_ptr<const SvgTemplate> > cache;
+
+} // anonymous namespace
+
+SvgTemplate::SvgTemplate(const std::string &text, const std::vector<std::string> &placeholders)
+    : m_literalSize(0)
+    , m_placeholders(placeholders)
+    , m_mtime(0)
+{
+    std::string current;
+
+    std::string::size_type lineStart = 0;
+    while (lineStart < text.size()) {
+        std::string::size_type lineEnd = text.find('\n', lineStart);
+        lineEnd = lineEnd == std::string::npos ? text.size() : lineEnd + 1;
+        std::string line = text.substr(lineStart, lineEnd - lineStart);
+        lineStart = lineEnd;
+
+        for (size_t slot = 0; slot < placeholders.size(); ++slot) {
+            std::string::size_type pos = line.find(placeholders[slot]);
+            if (pos != std::string::npos)
+                line.replace(pos, placeholders[slot].size(),
+                             std::string(1, SLOT_BEGIN) + std::to_string(slot) + SLOT_END);
+        }
+
+        // split the line at the markers
+        std::string::size_type pos = 0, begin;
+        while ((begin = line.find(SLOT_BEGIN, pos)) != std::string::npos) {
+            std::string::size_type end = line.find(SLOT_END, begin);
+            current += line.substr(pos, begin - pos);
+            m_literalSize += current.size();
+            m_literals.push_back(current);
+            current.clear();
+            m_slots.push_back(std::stoul(line.substr(begin + 1, end - begin - 1)));
+            pos = end + 1;
+        }
+        current += line.substr(pos);
+    }
+
+    m_literalSize += current.size();
+    m_literals.push_back(current);
+}
+
+std::shared_ptr<const SvgTemplate> SvgTemplate::cached(const std::string &filename,
+                                                       const std::vector<std::string> &placeholders)
+{
+    struct stat st;
+    if (stat(filename.c_str(), &st) != 0)
+        throw common::SystemError("Unable to access template '" + filename + "'", errno);
+
+    std::lock_guard<std::mutex> lock(cacheMutex);
+
+    std::shared_ptr<const SvgTemplate> &entry = cache[filename];
+    if (entry && entry->m_mtime == st.st_mtime && entry->m_placeholders == placeholders)
+        return entry;
+
+    std::ifstream input(filename.c_str());
+    if (!input.is_open())
+        throw common::ApplicationError("Unable to open template '" + filename + "'");
+    std::ostringstream contents;
+    contents << input.rdbuf();
+
+    std::shared_ptr<SvgTemplate> parsed = std::make_shared<SvgTemplate>(contents.str(), placeholders);
+    parsed->m_mtime = st.st_mtime;
+    BW_DEBUG_DBG("Parsed template '%s': %zu slots", filename.c_str(), parsed->slots());
+
+    entry = parsed;
+    return entry;
+}
+
+std::string SvgTemplate::render(const std::vector<std::string> &values) const
+{
+    size_t size = m_literalSize;
+    for (size_t i = 0; i < m_slots.size(); ++i)
+        size += values.at(m_slots[i]).size();
+
+    std::string result;
+    result.reserve(size);
+    for (size_t i = 0; i < m_slots.size(); ++i) {
+        result += m_literals[i];
+        result += values[m_slots[i]];
+    }
+    result += m_literals.back();
+
+    return result;
+}
+
+size_t SvgTemplate::slots() const
+{
+    return m_slots.size();
+}
+
+/* }}} */
+
+} // end namespace reportgen
+} // end namespace vetero
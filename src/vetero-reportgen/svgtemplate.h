@@ -0,0 +1,105 @@
+/* {{{
+ * (c) 2022, Bernhard Walle <bernhard@bwalle.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>. }}}
+ */
+#ifndef VETERO_REPORTGEN_SVGTEMPLATE_H_
+#define VETERO_REPORTGEN_SVGTEMPLATE_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+
+#include "common/error.h"
+
+namespace vetero {
+namespace reportgen {
+
+/* SvgTemplate {{{ */
+
+/**
+ * \class SvgTemplate
+ * \brief A text template that is parsed once and filled many times
+ *
+ * The template contains placeholders like <tt>TT.T</tt> that are replaced by values. Like in
+ * the original line-based substitution, each placeholder is replaced at its first occurrence in
+ * each line, and the placeholders are searched in the given order, so <tt>WDD</tt> has to be
+ * listed before <tt>WD</tt>.
+ *
+ * Parsing splits the template into literal text and slots. Rendering just concatenates them
+ * into one preallocated buffer. cached() keeps the parsed template in memory as long as the
+ * file doesn't change, which helps the report worker that runs for the lifetime of veterod.
+ *
+ * \author Bernhard Walle <bernhard@bwalle.de>
+ * \ingroup report
+ */
+class SvgTemplate
+{
+    public:
+        /**
+         * \brief Parses a template
+         *
+         * \param[in] text the contents of the template
+         * \param[in] placeholders the placeholders, the index in this list is the slot number
+         */
+        SvgTemplate(const std::string &text, const std::vector<std::string> &placeholders);
+
+        /**
+         * \brief Returns the parsed template file
+         *
+         * Parses the file only if it hasn't been parsed before with the same placeholders or
+         * if it has been modified since then. Thread-safe.
+         *
+         * \param[in] filename the template file
+         * \param[in] placeholders the placeholders, see SvgTemplate()
+         * \return the template
+         * \exception common::ApplicationError if the file cannot be read
+         */
+        static std::shared_ptr<const SvgTemplate> cached(const std::string &filename,
+                                                         const std::vector<std::string> &placeholders);
+
+    public:
+        /**
+         * \brief Fills the template
+         *
+         * \param[in] values the value for each placeholder
+         * \return the result
+         */
+        std::string render(const std::vector<std::string> &values) const;
+
+        /**
+         * \brief Returns the number of slots
+         *
+         * \return the number of placeholder occurrences that have been found
+         */
+        size_t slots() const;
+
+    private:
+        // m_literals has one element more than m_slots, they alternate
+        std::vector<std::string> m_literals;
+        std::vector<size_t> m_slots;
+        size_t m_literalSize;
+
+        std::vector<std::string> m_placeholders;
+        time_t m_mtime;
+};
+
+/* }}} */
+
+} // end namespace reportgen
+} // end namespace vetero
+
+#endif // VETERO_REPORTGEN_SVGTEMPLATE_H_
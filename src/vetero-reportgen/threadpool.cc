@@ -0,0 +1,148 @@
+/* {{{
+ * (c) 2022, Bernhard Walle <bernhard@bwalle.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>. }}}
+ */
+#include "threadpool.h"
+
+namespace vetero {
+namespace reportgen {
+
+/* TaskGroup {{{ */
+
+TaskGroup::TaskGroup()
+    : m_pending(0)
+{}
+
+/* }}} */
+/* ThreadPool {{{ */
+
+ThreadPool::ThreadPool(int concurrency, const Task &threadInit, const Task &threadExit)
+    : m_threadInit(threadInit)
+    , m_threadExit(threadExit)
+    , m_quit(false)
+{
+    // the thread that waits is the last worker
+    for (int i = 1; i < concurrency; ++i)
+        m_threads.push_back(std::thread(&ThreadPool::threadMain, this));
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+    m_cond.notify_all();
+
+    for (size_t i = 0; i < m_threads.size(); ++i)
+        m_threads[i].join();
+}
+
+void ThreadPool::run(TaskGroup &group, const Task &task)
+{
+    if (m_threads.empty()) {
+        group.m_pending++;
+        execute(group, task, common::StageTimes::current());
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        group.m_pending++;
+        QueuedTask queued = { &group, task, common::StageTimes::current() };
+        m_queue.push_back(queued);
+    }
+    m_cond.notify_all();
+}
+
+void ThreadPool::wait(TaskGroup &group)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while (group.m_pending > 0) {
+        std::deque<QueuedTask>::iterator it = m_queue.begin();
+        while (it != m_queue.end() && it->group != &group)
+            ++it;
+
+        if (it == m_queue.end()) {
+            m_cond.wait(lock);
+            continue;
+        }
+
+        QueuedTask queued = *it;
+        m_queue.erase(it);
+
+        lock.unlock();
+        execute(group, queued.task, queued.times);
+        lock.lock();
+    }
+
+    if (group.m_exception) {
+        std::exception_ptr exception = group.m_exception;
+        group.m_exception = std::exception_ptr();
+        std::rethrow_exception(exception);
+    }
+}
+
+void ThreadPool::threadMain()
+{
+    if (m_threadInit)
+        m_threadInit();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        if (m_queue.empty()) {
+            if (m_quit)
+                break;
+            m_cond.wait(lock);
+            continue;
+        }
+
+        QueuedTask queued = m_queue.front();
+        m_queue.pop_front();
+
+        lock.unlock();
+        execute(*queued.group, queued.task, queued.times);
+        lock.lock();
+    }
+    lock.unlock();
+
+    if (m_threadExit)
+        m_threadExit();
+}
+
+void ThreadPool::execute(TaskGroup &group, const Task &task, common::StageTimes *times)
+{
+    std::exception_ptr exception;
+    try {
+        common::StageTimes::Scope scope(times);
+        task();
+    } catch (...) {
+        exception = std::current_exception();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (exception && !group.m_exception)
+            group.m_exception = exception;
+        group.m_pending--;
+    }
+    m_cond.notify_all();
+}
+
+/* }}} */
+
+} // end namespace reportgen
+} // end namespace vetero
@@ -0,0 +1,159 @@
+/* {{{
+ * (c) 2022, Bernhard Walle <bernhard@bwalle.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>. }}}
+ */
+#ifndef VETERO_REPORTGEN_THREADPOOL_H_
+#define VETERO_REPORTGEN_THREADPOOL_H_
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <libbw/noncopyable.h>
+
+#include "common/stagetimer.h"
+
+namespace vetero {
+namespace reportgen {
+
+/* TaskGroup {{{ */
+
+/**
+ * \class TaskGroup
+ * \brief Set of tasks that are waited for together
+ *
+ * See ThreadPool::run() and ThreadPool::wait().
+ *
+ * \author Bernhard Walle <bernhard@bwalle.de>
+ * \ingroup report
+ */
+class TaskGroup : private bw::Noncopyable {
+
+    friend class ThreadPool;
+
+    public:
+        /**
+         * \brief Constructor
+         */
+        TaskGroup();
+
+    private:
+        int m_pending;
+        std::exception_ptr m_exception;
+};
+
+/* }}} */
+/* ThreadPool {{{ */
+
+/**
+ * \class ThreadPool
+ * \brief Fixed number of threads that run report generation tasks
+ *
+ * Tasks are added to a TaskGroup with run() and ThreadPool::wait() blocks until all tasks of
+ * the group have finished. While waiting, the calling thread runs the queued tasks of its own
+ * group, so generators can split their work into tasks from within a task.
+ *
+ * With a concurrency of 1 no thread is started and run() executes the task immediately.
+ *
+ * A task runs with the common::StageTimes that was current when it was queued, so the stages
+ * of a job are collected no matter which thread runs its tasks.
+ *
+ * \author Bernhard Walle <bernhard@bwalle.de>
+ * \ingroup report
+ */
+class ThreadPool : private bw::Noncopyable {
+
+    public:
+        typedef std::function<void ()> Task;
+
+        /**
+         * \brief Starts the threads
+         *
+         * \param[in] concurrency the number of tasks that run concurrently including the
+         *            thread that calls wait()
+         * \param[in] threadInit called in each new thread before the first task is executed
+         * \param[in] threadExit called in each thread before it terminates
+         */
+        ThreadPool(int concurrency, const Task &threadInit=Task(), const Task &threadExit=Task());
+
+        /**
+         * \brief Destructor
+         *
+         * Waits for the threads to terminate. Queued tasks are still executed.
+         */
+        ~ThreadPool();
+
+    public:
+        /**
+         * \brief Queues a task
+         *
+         * \param[in] group the group the task belongs to
+         * \param[in] task the task
+         */
+        void run(TaskGroup &group, const Task &task);
+
+        /**
+         * \brief Waits until all tasks of \p group have finished
+         *
+         * If a task has thrown an exception, the first exception is re-thrown after all
+         * tasks of the group have finished.
+         *
+         * \param[in] group the group
+         */
+        void wait(TaskGroup &group);
+
+    protected:
+        /**
+         * \brief Main function of the threads
+         */
+        void threadMain();
+
+        /**
+         * \brief Runs a task and updates its group
+         *
+         * Must be called without holding the mutex.
+         *
+         * \param[in] group the group of the task
+         * \param[in] task the task
+         * \param[in] times the stage times of the task, may be \c NULL
+         */
+        void execute(TaskGroup &group, const Task &task, common::StageTimes *times);
+
+    private:
+        struct QueuedTask {
+            TaskGroup *group;
+            Task task;
+            common::StageTimes *times;
+        };
+
+        std::mutex m_mutex;
+        std::condition_variable m_cond;
+        std::deque<QueuedTask> m_queue;
+        std::vector<std::thread> m_threads;
+        Task m_threadInit;
+        Task m_threadExit;
+        bool m_quit;
+};
+
+/* }}} */
+
+} // end namespace reportgen
+} // end namespace vetero
+
+#endif // VETERO_REPORTGEN_THREADPOOL_H_
@@ -17,6 +17,8 @@
 
 #include <algorithm>
 
+#include <libbw/stringutil.h>
+
 #include "common/utils.h"
 #include "validdatacache.h"
 
@@ -52,5 +54,34 @@ bool ValidDataCache::dataInYear(const bw::Datetime &year) const
     return std::binary_search(m_dataYears.begin(), m_dataYears.end(), yearStr);
 }
 
+std::vector<std::string> ValidDataCache::dataDaysInYear(int year) const
+{
+    // "YYYY" sorts before all days of the year and "YYYY-:" after them
+    std::string yearStr = bw::str(year);
+    std::vector<std::string>::const_iterator begin, end;
+    begin = std::lower_bound(m_dataDays.begin(), m_dataDays.end(), yearStr);
+    end = std::lower_bound(begin, m_dataDays.end(), yearStr + "-:");
+
+    return std::vector<std::string>(begin, end);
+}
+
+void ValidDataCache::update()
+{
+    std::vector<std::string> newDays =
+        m_dbAccess.dataDaysAfter(m_dataDays.empty() ? std::string() : m_dataDays.back());
+
+    for (size_t i = 0; i < newDays.size(); ++i) {
+        const std::string &day = newDays[i];
+        std::string month = day.substr(0, 7);
+        std::string year = day.substr(0, 4);
+
+        m_dataDays.push_back(day);
+        if (m_dataMonths.empty() || m_dataMonths.back() != month)
+            m_dataMonths.push_back(month);
+        if (m_dataYears.empty() || m_dataYears.back() != year)
+            m_dataYears.push_back(year);
+    }
+}
+
 } // namespace reportgen
 } // namespace vetero
@@ -78,6 +78,24 @@ class ValidDataCache
          */
         bool dataInYear(const bw::Datetime &year) const;
 
+        /**
+         * \brief Returns the days with data in the given year
+         *
+         * \param[in] year the year
+         * \return the days (<tt>YYYY-MM-DD</tt>), sorted
+         */
+        std::vector<std::string> dataDaysInYear(int year) const;
+
+        /**
+         * \brief Adds the days that have been inserted since the last update
+         *
+         * Weather data is only appended, so only the days after the last known day need
+         * to be queried. Used by long-running processes to keep the cache valid.
+         *
+         * \exception common::DatabaseError if the database cannot be queried
+         */
+        void update();
+
     private:
         common::DbAccess &m_dbAccess;
         std::vector<std::string> m_dataMonths;
@@ -15,38 +15,87 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>. }}}
  */
 
+#include <chrono>
 #include <iostream>
+#include <fstream>
 #include <cerrno>
 #include <clocale>
+#include <cstdio>
+#include <cstring>
 
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include <libbw/datetime.h>
 #include <libbw/optionparser.h>
 #include <libbw/stringutil.h>
 #include <libbw/log/errorlog.h>
+#include <libbw/log/debug.h>
+
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
 
 #include "common/translation.h"
 #include "common/dbaccess.h"
+#include "common/outputfile.h"
 #include "config.h"
 #include "vetero_reportgen.h"
 #include "dayreportgenerator.h"
 #include "currentreportgenerator.h"
 #include "monthreportgenerator.h"
 #include "yearreportgenerator.h"
+#include "climatereportgenerator.h"
 #include "indexgenerator.h"
 
 namespace vetero {
 namespace reportgen {
 
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+double millisecondsSince(const Clock::time_point &start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+} // anonymous namespace
+
+/* Worker connections {{{ */
+
+namespace {
+
+// The connection of the calling ThreadPool thread, see VeteroReportgen::bindWorkerDatabase()
+thread_local WorkerConnection *workerConnection = NULL;
+
+} // anonymous namespace
+
+/* }}} */
+
 VeteroReportgen::VeteroReportgen()
     : VeteroApplication("vetero-reportgen")
     , m_noConfigFatal(false)
     , m_upload(false)
+    , m_daemon(false)
+    , m_force(false)
+    , m_concurrency(1)
+    , m_nextWorkerConnection(0)
 {}
 
 vetero::common::Sqlite3Database &VeteroReportgen::database()
 {
+    if (workerConnection && workerConnection->readSession)
+        return workerConnection->database;
+
     return m_database;
 }
 
+ThreadPool &VeteroReportgen::threadPool()
+{
+    return *m_threadPool;
+}
+
 vetero::common::Configuration &VeteroReportgen::configuration()
 {
     return *m_configuration;
@@ -57,11 +106,36 @@ const vetero::common::Configuration &VeteroReportgen::configuration() const
     return *m_configuration;
 }
 
+std::string VeteroReportgen::findShareFile(const std::string &name) const
+{
+    const std::string candidates[] = {
+        "share/" + name,
+        INSTALL_PREFIX "/share/" + name
+    };
+
+    for (size_t i = 0; i < sizeof(candidates)/sizeof(candidates[0]); i++) {
+        if (access(candidates[i].c_str(), R_OK) == 0)
+            return candidates[i];
+    }
+
+    return std::string();
+}
+
 const ValidDataCache &VeteroReportgen::validDataCache() const
 {
     return *m_validDataCache;
 }
 
+ReportWatermarks &VeteroReportgen::watermarks()
+{
+    return *m_watermarks;
+}
+
+bool VeteroReportgen::force() const
+{
+    return m_force;
+}
+
 void VeteroReportgen::readConfiguration()
 {
     m_configuration.reset(new common::Configuration(m_configfile));
@@ -84,6 +158,7 @@ void VeteroReportgen::openDatabase()
 
     m_dbAccess.reset(new common::DbAccess(&m_database));
     try {
+        m_readSession.reset(new common::ReadSession(m_database));
         m_validDataCache.reset(new ValidDataCache(*m_dbAccess));
     } catch (const vetero::common::DatabaseError &err) {
         throw common::ApplicationError("Unable to init DB: " + std::string(err.what()) );
@@ -112,6 +187,16 @@ bool VeteroReportgen::parseCommandLine(int argc, char *argv[])
                                  "Use the provided configuration file instead of the default.");
     configurationGroup.addOption("upload", 'u', bw::OT_FLAG,
                                  "Upload the reports after the generation step.");
+    configurationGroup.addOption("jobs", 'j', bw::OT_INTEGER,
+                                 "Generate up to N reports and diagrams in parallel (default: 1).");
+    configurationGroup.addOption("force", 'f', bw::OT_FLAG,
+                                 "Generate all reports, even if their data hasn't changed.");
+    configurationGroup.addOption("daemon", 'W', bw::OT_FLAG,
+                                 "Run as report worker of veterod: read the jobs from the socket "
+                                 "on stdin instead of the command line.");
+    configurationGroup.addOption("stats", 'S', bw::OT_STRING,
+                                 "Append the time spent in each stage of the jobs as JSON line "
+                                 "to FILE.");
 
     bw::OptionParser op;
     op.addOptions(generalGroup);
@@ -125,7 +210,7 @@ bool VeteroReportgen::parseCommandLine(int argc, char *argv[])
     // evaluate options
     if (op.getValue("help").getFlag()) {
         op.printHelp(std::cerr, "vetero-reportgen " GIT_VERSION
-                     " <current|day|month|year> [<date>|<month>|<year>]");
+                     " <current|day|month|year|climate> [<date>|<month>|<year>]");
         return false;
     } else if (op.getValue("version").getFlag()) {
         std::cerr << "veterod " << GIT_VERSION << std::endl;
@@ -154,6 +239,17 @@ bool VeteroReportgen::parseCommandLine(int argc, char *argv[])
     }
     if (op.getValue("upload"))
         m_upload = op.getValue("upload").getFlag();
+    if (op.getValue("jobs")) {
+        m_concurrency = op.getValue("jobs").getInteger();
+        if (m_concurrency < 1)
+            throw common::ApplicationError("The number of jobs must be at least 1.");
+    }
+    if (op.getValue("daemon"))
+        m_daemon = op.getValue("daemon").getFlag();
+    if (op.getValue("force"))
+        m_force = op.getValue("force").getFlag();
+    if (op.getValue("stats"))
+        m_statsFile = op.getValue("stats").getString();
 
     m_jobs = op.getArgs();
     return true;
@@ -165,21 +261,208 @@ void VeteroReportgen::uploadReports()
     if (command.empty())
         return;
 
+    // files written by requests without upload are uploaded with the next one
+    std::vector<std::string> changedFiles = common::OutputFile::takeChangedFiles();
+    m_changedFiles.insert(changedFiles.begin(), changedFiles.end());
+    if (m_changedFiles.empty()) {
+        BW_DEBUG_INFO("No report has changed, skipping the upload");
+        return;
+    }
+
     common::LockFile lock(m_configuration->reportDirectory());
     if (!lock.lockExclusive()) {
         BW_ERROR_ERR("Unable to retrieve lock: %s", lock.error().c_str());
         return;
     }
 
-    int ret = std::system(command.c_str());
+    std::string manifest;
+    try {
+        manifest = writeManifest();
+    } catch (const common::ApplicationError &err) {
+        BW_ERROR_ERR("Unable to upload reports: %s", err.what());
+        return;
+    }
+
+    BW_DEBUG_INFO("Uploading %zu changed files", m_changedFiles.size());
+    setenv("VETERO_CHANGED_FILES", manifest.c_str(), 1);
+    int ret;
+    {
+        common::StageTimer timer(common::StageTimes::Upload);
+        ret = std::system(command.c_str());
+    }
+    unsetenv("VETERO_CHANGED_FILES");
+    unlink(manifest.c_str());
+
     if (ret != 0)
         BW_ERROR_ERR("Unable to upload reports: Unable to execute '%s': Exit code %d",
                      command.c_str(), WEXITSTATUS(ret));
+    else
+        m_changedFiles.clear();
+}
+
+std::string VeteroReportgen::writeManifest() const
+{
+    const char *tmpdir = getenv("TMPDIR");
+    std::string filename = std::string(tmpdir ? tmpdir : "/tmp") + "/vetero-changed.XXXXXX";
+
+    std::vector<char> name(filename.begin(), filename.end());
+    name.push_back('\0');
+    int fd = mkostemp(&name[0], O_CLOEXEC);
+    if (fd < 0)
+        throw common::SystemError("Unable to create the list of changed files", errno);
+    filename = &name[0];
+
+    std::FILE *fp = fdopen(fd, "w");
+    if (!fp) {
+        int err = errno;
+        close(fd);
+        unlink(filename.c_str());
+        throw common::SystemError("Unable to open '" + filename + "'", err);
+    }
+
+    // relative to the report directory like the files on the web server
+    std::string reportDir = m_configuration->reportDirectory() + "/";
+    for (std::set<std::string>::const_iterator it = m_changedFiles.begin();
+            it != m_changedFiles.end(); ++it) {
+        const std::string &file = *it;
+        if (bw::startsWith(file, reportDir))
+            std::fprintf(fp, "%s\n", file.substr(reportDir.size()).c_str());
+        else
+            std::fprintf(fp, "%s\n", file.c_str());
+    }
+
+    if (std::fclose(fp) != 0) {
+        int err = errno;
+        unlink(filename.c_str());
+        throw common::SystemError("Unable to write '" + filename + "'", err);
+    }
+
+    return filename;
+}
+
+void VeteroReportgen::setConfigfile(const std::string &configfile)
+{
+    m_configfile = configfile;
+    m_noConfigFatal = true;
+}
+
+void VeteroReportgen::setForce(bool force)
+{
+    m_force = force;
+}
+
+void VeteroReportgen::setConcurrency(int concurrency)
+{
+    m_concurrency = concurrency;
+}
+
+void VeteroReportgen::initWatermarks()
+{
+    // a new version or configuration may change the look of all reports
+    m_watermarks.reset(new ReportWatermarks(m_configuration->reportDirectory() + "/.watermarks",
+                                            std::string(GIT_VERSION) + "\n" +
+                                            m_configuration->str()));
 }
 
 void VeteroReportgen::exec()
 {
-    for (std::vector<std::string>::const_iterator it = m_jobs.begin(); it != m_jobs.end(); ++it) {
+    initWatermarks();
+
+    if (m_daemon)
+        execDaemon();
+    else
+        runJobs(m_jobs, m_upload);
+}
+
+void VeteroReportgen::execDaemon()
+{
+    // keep the socket away from gnuplot and the upload command
+    int fd = fcntl(STDIN_FILENO, F_DUPFD_CLOEXEC, 3);
+    if (fd < 0)
+        throw common::SystemError("Unable to duplicate the job socket", errno);
+
+    int nullFd = open("/dev/null", O_RDONLY);
+    if (nullFd < 0 || dup2(nullFd, STDIN_FILENO) < 0)
+        throw common::SystemError("Unable to redirect stdin to /dev/null", errno);
+    close(nullFd);
+
+    std::FILE *in = fdopen(fd, "r");
+    if (!in)
+        throw common::SystemError("Unable to open the job socket", errno);
+
+    BW_DEBUG_INFO("Report worker started, waiting for jobs");
+
+    char *line = NULL;
+    size_t lineSize = 0;
+    while (getline(&line, &lineSize, in) > 0) {
+        std::vector<std::string> words = bw::stringsplit(bw::strip(line), " ");
+        if (words.empty() || (words[0] != "generate" && words[0] != "upload")) {
+            BW_ERROR_ERR("Invalid request: '%s'", bw::strip(line).c_str());
+            continue;
+        }
+
+        try {
+            m_readSession.reset(new common::ReadSession(m_database));
+            m_validDataCache->update();
+        } catch (const vetero::common::DatabaseError &err) {
+            BW_ERROR_ERR("Unable to update the valid data cache: %s", err.what());
+        }
+
+        runJobs(std::vector<std::string>(words.begin() + 1, words.end()), words[0] == "upload");
+
+        static const char done[] = "done\n";
+        if (send(fd, done, sizeof(done) - 1, MSG_NOSIGNAL) < 0) {
+            BW_ERROR_ERR("Unable to acknowledge request: %s", std::strerror(errno));
+            break;
+        }
+    }
+
+    std::free(line);
+    std::fclose(in);
+    BW_DEBUG_INFO("Job socket closed, terminating report worker");
+}
+
+void VeteroReportgen::startJobs()
+{
+    if (!m_threadPool) {
+        openWorkerDatabases();
+        m_threadPool.reset(new ThreadPool(m_concurrency,
+                                          [this]() { bindWorkerDatabase(); },
+                                          []() { workerConnection = NULL; }));
+    }
+    beginWorkerSessions();
+
+    if (m_configuration->reportChartRenderer() == "client") {
+        try {
+            installChartScript();
+        } catch (const common::ApplicationError &err) {
+            BW_ERROR_ERR("%s", err.what());
+        }
+    }
+}
+
+void VeteroReportgen::finishJobs()
+{
+    endWorkerSessions();
+
+    try {
+        m_watermarks->save();
+    } catch (const common::ApplicationError &err) {
+        BW_ERROR_ERR("Unable to save the report watermarks: %s", err.what());
+    }
+}
+
+void VeteroReportgen::runJobs(const std::vector<std::string> &jobs, bool upload)
+{
+    Clock::time_point start = Clock::now();
+    m_jobStats.clear();
+
+    startJobs();
+
+    TaskGroup group;
+    bool indexNeeded = false;
+
+    for (std::vector<std::string>::const_iterator it = jobs.begin(); it != jobs.end(); ++it) {
         const std::string &currentJob = *it;
 
         std::vector<std::string> jobSplit = bw::stringsplit(currentJob, ":");
@@ -197,54 +480,222 @@ void VeteroReportgen::exec()
 
         if (jobName == "current" || jobName == "all") {
             jobsExecuted++;
-            try {
-                jobsExecuted++;
+            runGenerator(group, currentJob, [this]() {
                 CurrentReportGenerator(this).generateReports();
-            } catch (const common::ApplicationError &err) {
-                BW_ERROR_ERR("Error when executing job '%s': %s", currentJob.c_str(), err.what());
-            }
+            });
         }
 
         if (jobName == "day" || jobName == "all") {
             jobsExecuted++;
-            try {
-                jobsExecuted++;
+            runGenerator(group, currentJob, [this, jobArgument]() {
                 DayReportGenerator(this, jobArgument).generateReports();
-            } catch (const common::ApplicationError &err) {
-                BW_ERROR_ERR("Error when executing job '%s': %s", currentJob.c_str(), err.what());
-            }
+            });
         }
 
         if (jobName == "month" || jobName == "all") {
             jobsExecuted++;
-            try {
+            indexNeeded = true;
+            runGenerator(group, currentJob, [this, jobArgument]() {
                 MonthReportGenerator(this, jobArgument).generateReports();
-            } catch (const common::ApplicationError &err) {
-                BW_ERROR_ERR("Error when executing job '%s': %s", currentJob.c_str(), err.what());
-            }
-
-            try {
-                IndexGenerator(this).generateReports();
-            } catch (const common::ApplicationError &err) {
-                BW_ERROR_ERR("Error when executing job '%s': %s", currentJob.c_str(), err.what());
-            }
+            });
         }
 
         if (jobName == "year" || jobName == "all") {
             jobsExecuted++;
-            try {
+            runGenerator(group, currentJob, [this, jobArgument]() {
                 YearReportGenerator(this, jobArgument).generateReports();
-            } catch (const common::ApplicationError &err) {
-                BW_ERROR_ERR("Error when executing job '%s': %s", currentJob.c_str(), err.what());
-            }
+            });
+        }
+
+        if (jobName == "climate" || jobName == "all") {
+            jobsExecuted++;
+            runGenerator(group, currentJob, [this]() {
+                ClimateReportGenerator(this).generateReports();
+            });
         }
 
         if (jobsExecuted == 0)
             BW_ERROR_ERR("Invalid job: '%s'", jobName.c_str());
     }
 
-    if (m_upload)
+    m_threadPool->wait(group);
+
+    // the index links all months, so generate it only once after all month reports
+    if (indexNeeded) {
+        JobStats &stats = addJobStats("index");
+        common::StageTimes::Scope scope(&stats.times);
+        Clock::time_point indexStart = Clock::now();
+        try {
+            IndexGenerator(this).generateReports();
+        } catch (const common::ApplicationError &err) {
+            BW_ERROR_ERR("Error when generating the index: %s", err.what());
+        }
+        stats.milliseconds = millisecondsSince(indexStart);
+    }
+
+    finishJobs();
+
+    // don't keep the snapshot during the upload
+    m_readSession.reset();
+
+    if (upload) {
+        JobStats &stats = addJobStats("upload");
+        common::StageTimes::Scope scope(&stats.times);
+        Clock::time_point uploadStart = Clock::now();
         uploadReports();
+        stats.milliseconds = millisecondsSince(uploadStart);
+    }
+
+    writeStats(millisecondsSince(start));
+}
+
+VeteroReportgen::JobStats &VeteroReportgen::addJobStats(const std::string &job)
+{
+    m_jobStats.push_back(std::unique_ptr<JobStats>(new JobStats));
+    m_jobStats.back()->job = job;
+    m_jobStats.back()->milliseconds = 0.0;
+
+    return *m_jobStats.back();
+}
+
+void VeteroReportgen::writeStats(double milliseconds)
+{
+    namespace json = rapidjson;
+
+    json::StringBuffer s;
+    json::Writer<json::StringBuffer> writer(s);
+
+    writer.StartObject();
+    writer.Key("date");
+    writer.String(bw::Datetime::now().strftime("%Y-%m-%d %H:%M:%S").c_str());
+    writer.Key("duration_ms");
+    writer.Double(milliseconds);
+
+    // the stages of parallel tasks add up, so they may exceed the duration of the job
+    writer.Key("jobs");
+    writer.StartArray();
+    for (size_t i = 0; i < m_jobStats.size(); ++i) {
+        const JobStats &stats = *m_jobStats[i];
+
+        writer.StartObject();
+        writer.Key("job");
+        writer.String(stats.job.c_str());
+        writer.Key("duration_ms");
+        writer.Double(stats.milliseconds);
+        for (int stage = 0; stage < common::StageTimes::StageCount; ++stage) {
+            common::StageTimes::Stage st = static_cast<common::StageTimes::Stage>(stage);
+            writer.Key((std::string(common::StageTimes::stageName(st)) + "_ms").c_str());
+            writer.Double(stats.times.milliseconds(st));
+        }
+        writer.EndObject();
+    }
+    writer.EndArray();
+    writer.EndObject();
+
+    BW_DEBUG_INFO("Report timings: %s", s.GetString());
+
+    std::string statsFile = m_statsFile.empty() ? m_configuration->reportStatsFile() : m_statsFile;
+    if (statsFile.empty())
+        return;
+
+    std::ofstream out(statsFile.c_str(), std::ios::app);
+    out << s.GetString() << std::endl;
+    if (!out)
+        BW_ERROR_WARNING("Unable to append the report timings to '%s'", statsFile.c_str());
+}
+
+void VeteroReportgen::installChartScript()
+{
+    std::string script = findShareFile("vetero-chart.js");
+    if (script.empty())
+        throw common::ApplicationError("Unable to find vetero-chart.js");
+
+    std::ifstream in(script.c_str());
+    if (!in)
+        throw common::ApplicationError("Unable to open '" + script + "'");
+
+    common::OutputFile output(m_configuration->reportDirectory() + "/vetero-chart.js");
+    output.stream() << in.rdbuf();
+    output.commit();
+}
+
+void VeteroReportgen::runGenerator(TaskGroup &group, const std::string &job,
+                                   const std::function<void ()> &generate)
+{
+    JobStats *stats = &addJobStats(job);
+
+    m_threadPool->run(group, [job, generate, stats]() {
+        common::StageTimes::Scope scope(&stats->times);
+        Clock::time_point start = Clock::now();
+        try {
+            generate();
+        } catch (const common::ApplicationError &err) {
+            BW_ERROR_ERR("Error when executing job '%s': %s", job.c_str(), err.what());
+        }
+        stats->milliseconds = millisecondsSince(start);
+    });
+}
+
+void VeteroReportgen::openWorkerDatabases()
+{
+    // the thread that waits for the tasks is the last worker, it reads with the main connection
+    int threads = m_concurrency - 1;
+    if (threads < 1)
+        return;
+
+    try {
+        if (!m_database.sharedSnapshots()) {
+            BW_DEBUG_INFO("Snapshots can't be shared, all threads read with the main connection");
+            return;
+        }
+    } catch (const common::DatabaseError &err) {
+        BW_ERROR_ERR("Unable to query the DB: %s", err.what());
+        return;
+    }
+
+    for (int i = 0; i < threads; ++i) {
+        try {
+            std::unique_ptr<WorkerConnection> connection(new WorkerConnection);
+            connection->database.open(m_configuration->databasePath(),
+                                      common::Sqlite3Database::FLAG_READONLY);
+            m_workerConnections.push_back(std::move(connection));
+        } catch (const common::DatabaseError &err) {
+            BW_ERROR_ERR("Unable to open DB for worker thread, sharing the main connection: %s",
+                         err.what());
+        }
+    }
+}
+
+void VeteroReportgen::bindWorkerDatabase()
+{
+    std::lock_guard<std::mutex> lock(m_workerMutex);
+
+    if (m_nextWorkerConnection < m_workerConnections.size())
+        workerConnection = m_workerConnections[m_nextWorkerConnection++].get();
+}
+
+void VeteroReportgen::beginWorkerSessions()
+{
+    // the threads are idle, so the connections can be used from this thread
+    for (size_t i = 0; i < m_workerConnections.size(); ++i) {
+        WorkerConnection &connection = *m_workerConnections[i];
+        try {
+            if (m_readSession)
+                connection.readSession.reset(new common::ReadSession(connection.database,
+                                                                     *m_readSession));
+            else
+                connection.readSession.reset(new common::ReadSession(connection.database));
+        } catch (const common::DatabaseError &err) {
+            BW_ERROR_WARNING("Unable to share the snapshot with a worker thread, "
+                             "it reads with the main connection: %s", err.what());
+        }
+    }
+}
+
+void VeteroReportgen::endWorkerSessions()
+{
+    for (size_t i = 0; i < m_workerConnections.size(); ++i)
+        m_workerConnections[i]->readSession.reset();
 }
 
 } // end namespace reportgen
@@ -17,18 +17,36 @@
 #ifndef VETERO_REPORTGEN_VETERO_REPORTGEN_H_
 #define VETERO_REPORTGEN_VETERO_REPORTGEN_H_
 
+#include <functional>
+#include <mutex>
+#include <set>
 #include <string>
 #include <memory>
+#include <vector>
 
 #include "common/error.h"
 #include "common/configuration.h"
 #include "common/database.h"
+#include "common/stagetimer.h"
 #include "common/veteroapplication.h"
 #include "validdatacache.h"
+#include "threadpool.h"
+#include "reportwatermarks.h"
 
 namespace vetero {
 namespace reportgen {
 
+/**
+ * \brief Database connection of a thread of the ThreadPool
+ *
+ * The connection only is used while the read session is active, i.e. it reads the same
+ * snapshot as the main connection.
+ */
+struct WorkerConnection {
+    common::Sqlite3Database database;                   ///< the read-only connection
+    std::unique_ptr<common::ReadSession> readSession;   ///< the session of the current run
+};
+
 /**
  * \class VeteroReportgen
  * \brief Report generation class
@@ -50,10 +68,22 @@ class VeteroReportgen : public common::VeteroApplication
         /**
          * \brief Returns a reference to the DB access object.
          *
-         * \return the DB access object.
+         * Each thread of the thread pool has its own read-only connection that reads the same
+         * snapshot as the main connection, if the database supports it.
+         *
+         * \return the DB access object of the calling thread.
          */
         vetero::common::Sqlite3Database &database();
 
+        /**
+         * \brief Returns the thread pool for the report generation
+         *
+         * Only valid while jobs are running.
+         *
+         * \return the thread pool
+         */
+        ThreadPool &threadPool();
+
         /**
          * \brief Returns a reference to the configuration object
          *
@@ -68,6 +98,31 @@ class VeteroReportgen : public common::VeteroApplication
          */
         const ValidDataCache &validDataCache() const;
 
+        /**
+         * \brief Returns the watermarks of the reports
+         *
+         * \return a reference to the object
+         */
+        ReportWatermarks &watermarks();
+
+        /**
+         * \brief Checks if reports should be generated even if their data hasn't changed
+         *
+         * \return \c true if <tt>--force</tt> has been specified
+         */
+        bool force() const;
+
+        /**
+         * \brief Finds a file installed in the <tt>share</tt> directory
+         *
+         * Looks in <tt>share/</tt> of the working directory first so that the program can be
+         * run from the source tree.
+         *
+         * \param[in] name the name of the file like <tt>"current_weather.svg"</tt>
+         * \return the path to the file or an empty string if it could not be found
+         */
+        std::string findShareFile(const std::string &name) const;
+
         /**
          * \brief Returns a reference to the configuration object
          *
@@ -104,7 +159,8 @@ class VeteroReportgen : public common::VeteroApplication
          * \brief Opens the database connection
          *
          * Opens the database as specified on the command line. If it doesn't exist, the database
-         * will be created.
+         * will be created. All reports of one run read from the same snapshot of the database,
+         * see common::ReadSession.
          *
          * \exception common::ApplicationError if it's not possible to create the database.
          */
@@ -113,27 +169,196 @@ class VeteroReportgen : public common::VeteroApplication
         /**
          * \brief Main loop of the application
          *
-         * This is the main part of the application.
+         * This is the main part of the application. Runs the jobs from the command line or,
+         * in daemon mode, the jobs received from veterod.
          */
         void exec();
 
     protected:
+        /**
+         * \brief Sets the configuration file like <tt>--configfile</tt>
+         *
+         * \param[in] configfile the path of the configuration file, readConfiguration() fails
+         *            if it cannot be read
+         */
+        void setConfigfile(const std::string &configfile);
+
+        /**
+         * \brief Sets the flag of <tt>--force</tt>
+         *
+         * \param[in] force \c true if reports should be generated even if their data hasn't changed
+         */
+        void setForce(bool force);
+
+        /**
+         * \brief Sets the number of reports and diagrams generated in parallel like <tt>--jobs</tt>
+         *
+         * \param[in] concurrency the number of threads, at least 1
+         */
+        void setConcurrency(int concurrency);
+
+        /**
+         * \brief Loads the watermarks of the report directory
+         *
+         * A new version or configuration invalidates all watermarks.
+         */
+        void initWatermarks();
+
+        /**
+         * \brief Prepares running generators
+         *
+         * Starts the thread pool with the first call, begins the read sessions of the worker
+         * connections and installs the chart script if needed. The generators may be run
+         * until finishJobs() is called.
+         */
+        void startJobs();
+
+        /**
+         * \brief Ends the read sessions of the worker connections and saves the watermarks
+         *
+         * The thread pool and its connections are kept for the next request in daemon mode.
+         */
+        void finishJobs();
+
+        /**
+         * \brief Runs a list of report jobs
+         *
+         * \param[in] jobs the job descriptions like <tt>"day:2012-04-01"</tt>
+         * \param[in] upload \c true if the reports should be uploaded afterwards
+         */
+        void runJobs(const std::vector<std::string> &jobs, bool upload);
+
+        /**
+         * \brief Report worker loop
+         *
+         * Reads one request per line from the socket on standard input. A request is either
+         * <tt>"generate <job>..."</tt> or <tt>"upload <job>..."</tt>. After the jobs have been
+         * processed, <tt>"done"</tt> is sent back. The configuration, the translation,
+         * the ValidDataCache and the thread pool with its connections stay loaded between the
+         * requests. Returns when the socket is
+         * closed by veterod.
+         *
+         * \exception common::SystemError if the socket cannot be set up
+         */
+        void execDaemon();
+
+        /**
+         * \brief Copies the script that draws the charts from the data feeds to the report directory
+         *
+         * Only needed if the <tt>report_chart_renderer</tt> is <tt>"client"</tt>.
+         *
+         * \exception common::ApplicationError if the script cannot be found or copied
+         */
+        void installChartScript();
+
+        /**
+         * \brief Timings of a job
+         */
+        struct JobStats {
+            std::string job;                ///< the job description
+            common::StageTimes times;       ///< the time spent in each stage
+            double milliseconds;            ///< the wall clock time of the job
+        };
+
+        /**
+         * \brief Creates the timings of a job, they're written by writeStats()
+         *
+         * \param[in] job the job description
+         * \return the timings, owned by the VeteroReportgen object
+         */
+        JobStats &addJobStats(const std::string &job);
+
+        /**
+         * \brief Writes the timings of all jobs of the last run
+         *
+         * The timings are written as one JSON line to the debug log and appended to the
+         * file of <tt>--stats</tt> or <tt>report_stats_file</tt> if set.
+         *
+         * \param[in] milliseconds the wall clock time of the run
+         */
+        void writeStats(double milliseconds);
+
+        /**
+         * \brief Runs a generator in the thread pool and logs its errors
+         *
+         * The stages of the generator are collected in the timings of \p job.
+         *
+         * \param[in] group the task group
+         * \param[in] job the job description for the error message
+         * \param[in] generate function that runs the generator
+         */
+        void runGenerator(TaskGroup &group, const std::string &job,
+                          const std::function<void ()> &generate);
+
+        /**
+         * \brief Opens a database connection for each thread of the thread pool
+         *
+         * The waiting thread runs tasks as well, it reads with the main connection.
+         * The connections are only opened if they can read the snapshot of the main connection,
+         * see common::Database::sharedSnapshots(). Otherwise all threads read with the main
+         * connection.
+         */
+        void openWorkerDatabases();
+
+        /**
+         * \brief Assigns one of the worker connections to the calling thread pool thread
+         */
+        void bindWorkerDatabase();
+
+        /**
+         * \brief Starts the read sessions of the worker connections on the main snapshot
+         *
+         * A worker connection whose session cannot be started isn't used in this run.
+         */
+        void beginWorkerSessions();
+
+        /**
+         * \brief Ends the read sessions of the worker connections
+         */
+        void endWorkerSessions();
+
         /**
          * \brief Performs the upload of reports
+         *
+         * Runs the <tt>report_upload_command</tt> if reports have changed since the last
+         * successful upload. The environment variable <tt>VETERO_CHANGED_FILES</tt> contains
+         * the name of a file that lists the changed files relative to the report directory,
+         * one per line. If the command fails, the files are listed again the next time.
          */
         void uploadReports();
 
+        /**
+         * \brief Writes the changed files to a temporary file
+         *
+         * \return the name of the file, the caller has to remove it
+         * \exception common::SystemError if the file cannot be written
+         */
+        std::string writeManifest() const;
+
     private:
         common::Sqlite3Database m_database;
+        std::unique_ptr<common::ReadSession> m_readSession;
         std::unique_ptr<common::DbAccess> m_dbAccess;
         std::unique_ptr<ValidDataCache> m_validDataCache;
+        std::unique_ptr<ReportWatermarks> m_watermarks;
         std::vector<std::string> m_jobs;
 
         std::string m_configfile;
         bool m_noConfigFatal;
         std::unique_ptr<vetero::common::Configuration> m_configuration;
 
+        std::set<std::string> m_changedFiles;
+        std::vector< std::unique_ptr<JobStats> > m_jobStats;
+        std::string m_statsFile;
+
         bool m_upload;
+        bool m_daemon;
+        bool m_force;
+        int m_concurrency;
+        std::vector< std::unique_ptr<WorkerConnection> > m_workerConnections;
+        size_t m_nextWorkerConnection;
+        std::mutex m_workerMutex;
+        std::unique_ptr<ThreadPool> m_threadPool;
 };
 
 } // end namespace reportgen
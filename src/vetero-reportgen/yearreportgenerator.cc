@@ -24,7 +24,7 @@
 #include "common/translation.h"
 #include "common/utils.h"
 #include "yearreportgenerator.h"
-#include "gnuplot.h"
+#include "chart.h"
 #include "calendar.h"
 
 namespace vetero {
@@ -34,7 +34,8 @@ YearReportGenerator::YearReportGenerator(VeteroReportgen    *reportGenerator,
                                          const std::string  &year)
     : ReportGenerator(reportGenerator),
       m_yearString(year),
-      m_haveRain(-1)
+      m_haveRain(-1),
+      m_haveWind(-1)
 {}
 
 void YearReportGenerator::generateReports()
@@ -44,9 +45,17 @@ void YearReportGenerator::generateReports()
             common::DbAccess dbAccess(&reportgen()->database());
             std::vector<std::string> dates = dbAccess.dataYears();
 
+            // each report gets its own generator so that they can run in parallel
+            VeteroReportgen *reportgen = this->reportgen();
+            TaskGroup reports;
             std::vector<std::string>::const_iterator it;
-            for (it = dates.begin(); it != dates.end(); ++it)
-                generateOneReport(*it);
+            for (it = dates.begin(); it != dates.end(); ++it) {
+                std::string date = *it;
+                reportgen->threadPool().run(reports, [reportgen, date]() {
+                    YearReportGenerator(reportgen, date).generateReports();
+                });
+            }
+            reportgen->threadPool().wait(reports);
         }
         else
             generateOneReport(m_yearString);
@@ -68,19 +77,42 @@ void YearReportGenerator::generateOneReport(const std::string &date)
     int year = bw::from_str<int>(m_yearString);
     m_year = bw::Datetime(year, bw::Datetime::January, 1, 0, 0, 0, false);
 
+    m_firstDayStr = m_year.strftime("%Y-01-01");
+    m_lastDayStr = m_year.strftime("%Y-12-31");
+
+    bw::Datetime lastYear(m_year);
+    lastYear.addDays(-1);
+    bw::Datetime nextYear(m_year);
+    nextYear.addDays(366);
+
+    const ValidDataCache &validDataCache = reportgen()->validDataCache();
+    std::string report = "year:" + m_yearString;
+    std::string fingerprint = dataFingerprint(m_firstDayStr, m_lastDayStr,
+                                              validDataCache.dataInYear(lastYear),
+                                              validDataCache.dataInYear(nextYear));
+    if (upToDate(report, fingerprint, nameProvider().yearlyIndex(m_year))) {
+        BW_DEBUG_DBG("Year report for %s is up to date", m_yearString.c_str());
+        return;
+    }
+
     try {
         bw::FileUtils::mkdir(nameProvider().yearlyDir(m_year), true);
     } catch (const bw::Error &err) {
         throw common::ApplicationError(err.what());
     }
 
-    m_firstDayStr = m_year.strftime("%Y-01-01");
-    m_lastDayStr = m_year.strftime("%Y-12-31");
+    // the diagrams are independent of each other
+    ThreadPool &threadPool = reportgen()->threadPool();
+    TaskGroup diagrams;
 
-    createTemperatureDiagram();
+    threadPool.run(diagrams, [this]() { createTemperatureDiagram(); });
     if (haveRainData())
-        createRainDiagram();
+        threadPool.run(diagrams, [this]() { createRainDiagram(); });
+
+    threadPool.wait(diagrams);
+
     createHtml();
+    markGenerated(report, fingerprint);
 }
 
 void YearReportGenerator::createTemperatureDiagram()
@@ -93,22 +125,17 @@ void YearReportGenerator::createTemperatureDiagram()
         m_firstDayStr.c_str(), m_lastDayStr.c_str()
     );
 
-    Gnuplot plot(reportgen()->configuration());
-    plot.setWorkingDirectory(reportgen()->configuration().reportDirectory());
-    plot.setOutputFile(nameProvider().yearlyDiagram(m_year, "temperature"));
-    plot << "set xlabel '" << _("Month") << "'\n";
-    plot << "set ylabel '" << _("Temperature [°C]") << "'\n";
-    plot << "set grid\n";
-    plot << "set xrange [0.5:12.5]\n";
-    plot << "set mxtics 0\n";
-    plot << "set xtics " << buildxticksMonths() << "\n";
-    plot << "plot '" << Gnuplot::PLACEHOLDER
-         << "' using 1:2 with linespoints title 'Min' linecolor rgb '#0022FF' lw 2 pt 7 ps 1, "
-         << "'" << Gnuplot::PLACEHOLDER
-         << "' using 1:3 with linespoints title 'Max' linecolor rgb '#FF0000' lw 2 pt 7 ps 1, "
-         << "'" << Gnuplot::PLACEHOLDER
-         << "' using 1:4 with linespoints title 'Avg' linecolor rgb '#555555' lw 2 pt 7 ps 1\n";
-    plot.plot(result.data);
+    Chart chart(reportgen()->configuration());
+    chart.setOutputFile(nameProvider().yearlyDiagram(m_year, "temperature"));
+    chart.setXLabel(_("Month"));
+    chart.setYLabel(_("Temperature [°C]"));
+    chart.setGrid(Chart::GridX | Chart::GridY);
+    chart.setXRange("0.5", "12.5");
+    chart.setXTics(buildxticksMonths());
+    chart.addSeries(2, Chart::LinesPoints, "#0022FF", 2, "Min", Chart::Circle, 1);
+    chart.addSeries(3, Chart::LinesPoints, "#FF0000", 2, "Max", Chart::Circle, 1);
+    chart.addSeries(4, Chart::LinesPoints, "#555555", 2, "Avg", Chart::Circle, 1);
+    chart.plot(result.data);
 }
 
 void YearReportGenerator::createRainDiagram()
@@ -122,21 +149,17 @@ void YearReportGenerator::createRainDiagram()
         m_firstDayStr.c_str(), m_lastDayStr.c_str()
     );
 
-    Gnuplot plot(reportgen()->configuration());
-    plot.setWorkingDirectory(reportgen()->configuration().reportDirectory());
-    plot.setOutputFile(nameProvider().yearlyDiagram(m_year, "rain"));
-    plot << "set xlabel '" << _("Month") << "'\n";
-    plot << "set ylabel '" << _("Rain [l/m²]") << "'\n";
-    plot << "set grid\n";
-    plot << "set xrange [0.5:12.5]\n";
-    plot << "set mxtics 0\n";
-    plot << "set xtics " << buildxticksMonths() << "\n";
-    plot << "set boxwidth 0.8\n";
-    plot << "set style fill solid 1.0 border\n";
-    plot << "plot '" << Gnuplot::PLACEHOLDER
-         << "' using 1:2 with boxes notitle linecolor rgb '#ADD0FF' lw 1\n";
-
-    plot.plot(result.data);
+    Chart chart(reportgen()->configuration());
+    chart.setOutputFile(nameProvider().yearlyDiagram(m_year, "rain"));
+    chart.setXLabel(_("Month"));
+    chart.setYLabel(_("Rain [l/m²]"));
+    chart.setGrid(Chart::GridX | Chart::GridY);
+    chart.setXRange("0.5", "12.5");
+    chart.setXTics(buildxticksMonths());
+    chart.setBoxWidth(0.8);
+    chart.addSeries(2, Chart::Boxes, "#ADD0FF", 1);
+
+    chart.plot(result.data);
 }
 
 void YearReportGenerator::createHtml()
@@ -170,12 +193,12 @@ void YearReportGenerator::createHtml()
     html.setUpNavigation("", "");
 
     html.addSection(_("Temperature profile"), _("Temperature"), "temperature");
-    html.img(nameProvider().yearlyDiagramLink(m_year, "temperature"));
+    html.chart(nameProvider().yearlyDiagramLink(m_year, "temperature"));
     html.addTopLink();
 
     if (haveRainData()) {
         html.addSection(_("Rain"), _("Rain"), "rain");
-        html.img(nameProvider().yearlyDiagramLink(m_year, "rain"));
+        html.chart(nameProvider().yearlyDiagramLink(m_year, "rain"));
         html.addTopLink();
     }
 
@@ -199,25 +222,36 @@ void YearReportGenerator::createTable(HtmlDocument &html)
         { "°C",    1, true },               // temp_avg
         { "°C",    1, true },               // temp_min
         { "°C",    1, true },               // temp_avg
+        { "°C",    1, true },               // temp_median
+        { "km/h",  1, haveWindData() },     // wind_median
+        { "km/h",  1, haveWindData() },     // wind_p95
         { "l/m²",  1, haveRainData() },     // rain
     };
 
+    // the percentiles of the months are merged from the sketches of their days
     common::Database::Result result = reportgen()->database().executeSqlQuery(
-        "SELECT month || '-1', "
-        "       temp_avg, "
-        "       temp_min, "
-        "       temp_max, "
-        "       rain "
-        "FROM   month_statistics_float "
-        "WHERE  month BETWEEN strftime('%%Y-%%m', ?, 'localtime') AND strftime('%%Y-%%m', ?, 'localtime')"
-        "       AND temp_min != temp_max",
+        "SELECT f.month || '-1', "
+        "       f.temp_avg, "
+        "       f.temp_min, "
+        "       f.temp_max, "
+        "       round(VETERO_QUANTILE(s.temp_sketch, 0.5)/100.0, 1), "
+        "       round(VETERO_QUANTILE(s.wind_sketch, 0.5)/100.0, 1), "
+        "       round(VETERO_QUANTILE(s.wind_sketch, 0.95)/100.0, 1), "
+        "       f.rain "
+        "FROM   month_statistics_float f "
+        "JOIN   month_statistics s ON s.month = f.month "
+        "WHERE  f.month BETWEEN strftime('%%Y-%%m', ?, 'localtime') AND strftime('%%Y-%%m', ?, 'localtime')"
+        "       AND f.temp_min != f.temp_max",
         m_firstDayStr.c_str(), m_lastDayStr.c_str()
     );
 
     html << "<table border='0' bgcolor='#000000' cellspacing='1' cellpadding='0' >\n"
          << "<tr bgcolor='#FFFFFF'>\n"
          << "  <th style='padding: 5px'><b></b></th>\n"
-         << "  <th style='padding: 5px' colspan=\"3\"><b>" << _("temperature") << "</b></th>\n";
+         << "  <th style='padding: 5px' colspan=\"4\"><b>" << _("temperature") << "</b></th>\n";
+
+    if (haveWindData())
+        html << "  <th style='padding: 5px' colspan=\"2\"><b>" << _("wind") << "</b></th>\n";
 
     if (haveRainData())
         html << "  <th style='padding: 5px'><b></b></th>\n";
@@ -227,7 +261,12 @@ void YearReportGenerator::createTable(HtmlDocument &html)
          << "  <th style='padding: 5px'><b>" << _("date") << "</b></th>\n"
          << "  <th style='padding: 5px'><b>⌀</b></th>\n"
          << "  <th style='padding: 5px'><b>min</b></th>\n"
-         << "  <th style='padding: 5px'><b>max</b></th>\n";
+         << "  <th style='padding: 5px'><b>max</b></th>\n"
+         << "  <th style='padding: 5px'><b>" << _("median") << "</b></th>\n";
+
+    if (haveWindData())
+        html << "  <th style='padding: 5px'><b>" << _("median") << "</b></th>\n"
+             << "  <th style='padding: 5px'><b>P95</b></th>\n";
 
     if (haveRainData())
         html << "  <th style='padding: 5px'><b>" << _("rain") << "</b></th>\n";
@@ -255,7 +294,9 @@ void YearReportGenerator::createTable(HtmlDocument &html)
                 if (!desc->active)
                     continue;
 
-                if (desc->precision > 0) {
+                if (value.empty())
+                    value = "--";
+                else if (desc->precision > 0) {
                     double numericValue = bw::from_str<double>(value, std::locale::classic());
                     value = common::str_printf_l("%.*lf", localeStr.c_str(), desc->precision,
                                                  numericValue);
@@ -290,22 +331,37 @@ bool YearReportGenerator::haveRainData() const
     return m_haveRain;
 }
 
-std::string YearReportGenerator::buildxticksMonths() const
+bool YearReportGenerator::haveWindData() const
+{
+    if (m_haveWind == -1) {
+        common::Database::Result result = reportgen()->database().executeSqlQuery(
+            "SELECT   count(*) "
+            "FROM     month_statistics "
+            "WHERE    month BETWEEN strftime('%%Y-%%m', ?, 'localtime') AND strftime('%%Y-%%m', ?, 'localtime')"
+            "         AND wind_sketch IS NOT NULL",
+            m_firstDayStr.c_str(), m_lastDayStr.c_str()
+        );
+
+        m_haveWind = (bw::from_str<int>(result.data.front().front()) > 0);
+    }
+
+    return m_haveWind;
+}
+
+std::vector<Chart::Tic> YearReportGenerator::buildxticksMonths() const
 {
-    std::ostringstream xticsStream;
-    xticsStream << "(";
+    std::vector<Chart::Tic> tics;
     for (int month = bw::Datetime::January; month <= bw::Datetime::December; month++) {
-        xticsStream << "'" << Calendar::monthAbbreviation(month) << "' " << month;
-        if (month != bw::Datetime::December)
-            xticsStream << ", ";
+        Chart::Tic tic = { static_cast<double>(month), Calendar::monthAbbreviation(month) };
+        tics.push_back(tic);
     }
-    xticsStream << ")";
-    return xticsStream.str();
+    return tics;
 }
 
 void YearReportGenerator::reset()
 {
     m_haveRain = -1;
+    m_haveWind = -1;
 }
 
 
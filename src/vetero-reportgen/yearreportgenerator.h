@@ -21,6 +21,7 @@
 #include <libbw/datetime.h>
 
 #include "reportgenerator.h"
+#include "chart.h"
 #include "htmldocument.h"
 
 namespace vetero {
@@ -61,8 +62,9 @@ class YearReportGenerator : public ReportGenerator
         void createHtml();
         void createTable(HtmlDocument &html);
         bool haveRainData() const;
+        bool haveWindData() const;
 
-        std::string buildxticksMonths() const;
+        std::vector<Chart::Tic> buildxticksMonths() const;
 
         void reset();
 
@@ -75,6 +77,7 @@ class YearReportGenerator : public ReportGenerator
 
         // 0=false, 1=true, -1=not set
         mutable int m_haveRain;
+        mutable int m_haveWind;
 };
 
 } // end namespace reportgen
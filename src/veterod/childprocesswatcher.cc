@@ -67,6 +67,25 @@ void ChildProcessWatcher::addChild(pid_t pid)
         throw common::ApplicationError("Unable to unblock SIGCHLD");
 }
 
+bool ChildProcessWatcher::running(pid_t pid)
+{
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGCHLD);
+
+    int err = sigprocmask(SIG_BLOCK, &set, NULL);
+    if (err < 0)
+        throw common::ApplicationError("Unable to block SIGCHLD");
+
+    bool ret = m_children.find(pid) != m_children.end();
+
+    err = sigprocmask(SIG_UNBLOCK, &set, NULL);
+    if (err < 0)
+        throw common::ApplicationError("Unable to unblock SIGCHLD");
+
+    return ret;
+}
+
 bool ChildProcessWatcher::wait(pid_t pid)
 {
     int status;
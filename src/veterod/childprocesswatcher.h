@@ -69,6 +69,14 @@ class ChildProcessWatcher {
          */
         void addChild(pid_t pid);
 
+        /**
+         * \brief Checks if a monitored child is still running
+         *
+         * \param[in] pid the PID of the child process
+         * \return \c true if the child has been added with addChild() and has not terminated yet
+         */
+        bool running(pid_t pid);
+
         /**
          * \brief Calls waitpid() on all monitored chilren.
          *
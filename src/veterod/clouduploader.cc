@@ -21,7 +21,6 @@
 #include <libbw/log/debug.h>
 #include <libbw/log/errorlog.h>
 
-#include <common/httprequest.h>
 #include "clouduploader.h"
 
 namespace vetero::daemon {
@@ -37,12 +36,19 @@ public:
     WeatherUndergroundUploader(const common::Configuration &config) {
         m_stationId = config.cloudStationId();
         m_stationKey = config.cloudStationPassword();
+        m_baseUrl = config.cloudUrl();
+        if (m_baseUrl.empty())
+            m_baseUrl = "http://weatherstation.wunderground.com/weatherstation/updateweatherstation.php";
     }
 
 public:
-    void upload(const common::CurrentWeather &weather) override {
+    std::string name() const override {
+        return "WU station ID " + m_stationId;
+    }
+
+    std::string url(const common::CurrentWeather &weather) const override {
         std::ostringstream url;
-        url << "http://weatherstation.wunderground.com/weatherstation/updateweatherstation.php?"
+        url << m_baseUrl << "?"
             << "ID=" << m_stationId << "&"
             << "PASSWORD=" << m_stationKey << "&"
             << "tempf=" << std::setprecision(2) << weather.temperatureRealF() << "&";
@@ -71,17 +77,13 @@ public:
 
         BW_DEBUG_DBG("WU URL: %s", url.str().c_str());
 
-        common::HttpRequest req(url.str());
-        try {
-            req.perform();
-        } catch (const common::HttpError &err) {
-            BW_ERROR_WARNING("Unable to update WU station ID %s: %s", m_stationId.c_str(), err.what());
-        }
+        return url.str();
     }
 
 private:
     std::string m_stationId;
     std::string m_stationKey;
+    std::string m_baseUrl;
 
 };
 
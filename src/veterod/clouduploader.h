@@ -26,7 +26,8 @@ namespace vetero::daemon {
 /**
  * \brief Interface for a cloud uploader
  *
- * This class cannot be instantiated, use CloudUploader::create().
+ * This class cannot be instantiated, use CloudUploader::create(). An uploader only describes
+ * the request, CloudUploadQueue sends it.
  *
  * \author Bernhard Walle <bernhard@bwalle.de>
  */
@@ -40,11 +41,19 @@ public:
 
 public:
     /**
-     * \brief Uploads the current weather data to the cloud
+     * \brief Returns the name of the service for the log
      *
-     * @param weather
+     * \return the name like <tt>"WU station ID XYZ"</tt>
      */
-    virtual void upload(const common::CurrentWeather &weather) = 0;
+    virtual std::string name() const = 0;
+
+    /**
+     * \brief Returns the URL that uploads the current weather data to the cloud
+     *
+     * \param[in] weather the current weather
+     * \return the URL for an HTTP GET request
+     */
+    virtual std::string url(const common::CurrentWeather &weather) const = 0;
 
 public:
     static CloudUploader *create(const std::string &type, const common::Configuration &config);
@@ -0,0 +1,158 @@
+/* {{{
+ * (c) 2022, Bernhard Walle <bernhard@bwalle.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>. }}}
+ */
+
+#include <algorithm>
+#include <chrono>
+
+#include <libbw/log/debug.h>
+#include <libbw/log/errorlog.h>
+
+#include "clouduploadqueue.h"
+
+namespace vetero::daemon {
+
+const int CloudUploadQueue::MaxAttempts;
+const int CloudUploadQueue::InitialBackoff;
+const int CloudUploadQueue::Timeout;
+
+CloudUploadQueue::CloudUploadQueue(std::unique_ptr<CloudUploader> uploader)
+    : m_uploader(std::move(uploader))
+{
+    m_request.setTimeout(Timeout);
+    m_thread = std::thread(&CloudUploadQueue::run, this);
+}
+
+CloudUploadQueue::~CloudUploadQueue()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+    m_cond.notify_one();
+    m_thread.join();
+}
+
+void CloudUploadQueue::upload(const common::CurrentWeather &weather)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_pending)
+            BW_DEBUG_DBG("%s: dropping data of %s that hasn't been uploaded yet",
+                         m_uploader->name().c_str(), m_weather.timestamp().strftime("%Y-%m-%d %H:%M").c_str());
+        m_weather = weather;
+        m_pending = true;
+
+        Clock::time_point now = Clock::now();
+        if (m_received != Clock::time_point())
+            m_samplingInterval = now - m_received;
+        m_received = now;
+    }
+    m_cond.notify_one();
+}
+
+void CloudUploadQueue::run()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    auto wakeup = [this]() { return m_quit || m_pending; };
+
+    while (true) {
+        m_cond.wait(lock, wakeup);
+        if (m_quit)
+            break;
+
+        common::CurrentWeather weather = m_weather;
+        Clock::time_point received = m_received;
+        m_pending = false;
+
+        for (int attempt = 1; ; ++attempt) {
+            lock.unlock();
+            bool done = send(weather, attempt);
+            lock.lock();
+
+            if (done || m_quit)
+                break;
+
+            // newer data replaces the data that could not be uploaded
+            if (m_pending) {
+                BW_DEBUG_DBG("%s: newer data arrived, not retrying", m_uploader->name().c_str());
+                break;
+            }
+
+            if (attempt >= MaxAttempts) {
+                BW_DEBUG_INFO("%s: giving up after %d attempts", m_uploader->name().c_str(),
+                              attempt);
+                break;
+            }
+
+            // the data is sent without its timestamp, so it must not arrive too late
+            std::chrono::seconds backoff(InitialBackoff << (attempt - 1));
+            if (m_samplingInterval != Clock::duration::zero() &&
+                    Clock::now() + backoff - received >= m_samplingInterval) {
+                BW_DEBUG_INFO("%s: data would be older than the sampling interval, not retrying",
+                              m_uploader->name().c_str());
+                break;
+            }
+
+            BW_DEBUG_DBG("%s: retrying in %ld s", m_uploader->name().c_str(),
+                         long(backoff.count()));
+            if (m_cond.wait_for(lock, backoff, wakeup) && !m_quit) {
+                BW_DEBUG_DBG("%s: newer data arrived, not retrying", m_uploader->name().c_str());
+                break;
+            }
+            if (m_quit)
+                break;
+        }
+    }
+}
+
+bool CloudUploadQueue::send(const common::CurrentWeather &weather, int attempt)
+{
+    const std::string name = m_uploader->name();
+    m_request.setUrl(m_uploader->url(weather));
+
+    std::string error;
+    bool retry = true;
+    try {
+        long status = m_request.perform();
+        if (status >= 200 && status < 300) {
+            if (m_failing)
+                BW_DEBUG_INFO("%s: upload works again", name.c_str());
+            m_failing = false;
+            return true;
+        }
+
+        // the service rejects the data, sending it again doesn't help
+        if (status >= 400 && status < 500 && status != 408 && status != 429)
+            retry = false;
+        error = "HTTP status " + std::to_string(status);
+    } catch (const common::HttpError &err) {
+        error = err.what();
+    }
+
+    // log only the first error of a series, the service may be unreachable for hours
+    if (!m_failing || !retry)
+        BW_ERROR_WARNING("Unable to upload to %s (attempt %d/%d): %s", name.c_str(),
+                         attempt, MaxAttempts, error.c_str());
+    else
+        BW_DEBUG_DBG("Unable to upload to %s (attempt %d/%d): %s", name.c_str(),
+                     attempt, MaxAttempts, error.c_str());
+    m_failing = true;
+
+    return !retry;
+}
+
+} // vetero::daemon
@@ -0,0 +1,121 @@
+/* {{{
+ * (c) 2022, Bernhard Walle <bernhard@bwalle.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>. }}}
+ */
+#ifndef VETERO_CLOUDUPLOADQUEUE_H_
+#define VETERO_CLOUDUPLOADQUEUE_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include <common/dataset.h>
+#include <common/httprequest.h>
+#include "clouduploader.h"
+
+namespace vetero::daemon {
+
+/**
+ * \brief Uploads the current weather to the cloud in a background thread
+ *
+ * upload() only stores the data, a thread of its own sends it. The thread keeps one
+ * common::HttpRequest for all uploads, so the connection and the DNS lookup are reused.
+ *
+ * Only the newest data is uploaded: if upload() is called again before the previous data has
+ * been sent, the previous data is dropped. A failed upload is retried up to MaxAttempts times
+ * with an exponential backoff starting at InitialBackoff seconds, unless newer data arrives
+ * in the meantime or the data would be older than the sampling interval, i.e. the time between
+ * the last two calls of upload(). The services stamp the data with the time of the request.
+ * An answer with a 4xx status code is not retried.
+ *
+ * \author Bernhard Walle <bernhard@bwalle.de>
+ */
+class CloudUploadQueue
+{
+    typedef std::chrono::steady_clock Clock;
+
+public:
+    /// Number of attempts to upload the same data
+    static const int MaxAttempts = 5;
+
+    /// Seconds before the first retry, doubled for each further retry
+    static const int InitialBackoff = 5;
+
+    /// Maximum time of a request in seconds
+    static const int Timeout = 20;
+
+public:
+    /**
+     * \brief Starts the thread
+     *
+     * \param[in] uploader the service
+     */
+    CloudUploadQueue(std::unique_ptr<CloudUploader> uploader);
+
+    /**
+     * \brief Stops the thread
+     *
+     * Waits for the request that is running at the moment, pending data is dropped.
+     */
+    ~CloudUploadQueue();
+
+    CloudUploadQueue(const CloudUploadQueue &) = delete;
+    CloudUploadQueue &operator=(const CloudUploadQueue &) = delete;
+
+public:
+    /**
+     * \brief Uploads the current weather data to the cloud
+     *
+     * Returns immediately.
+     *
+     * \param[in] weather the current weather
+     */
+    void upload(const common::CurrentWeather &weather);
+
+protected:
+    /**
+     * \brief Thread function
+     */
+    void run();
+
+    /**
+     * \brief Sends the data once
+     *
+     * \param[in] weather the current weather
+     * \param[in] attempt the number of the attempt, starting at 1
+     * \return \c true if the upload is done, \c false if it should be retried
+     */
+    bool send(const common::CurrentWeather &weather, int attempt);
+
+private:
+    std::unique_ptr<CloudUploader> m_uploader;
+    common::HttpRequest m_request;
+    bool m_failing = false;
+
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    common::CurrentWeather m_weather;
+    Clock::time_point m_received;
+    Clock::duration m_samplingInterval = Clock::duration::zero();
+    bool m_pending = false;
+    bool m_quit = false;
+    std::thread m_thread;
+};
+
+} // vetero::daemon
+
+#endif // VETERO_CLOUDUPLOADQUEUE_H_
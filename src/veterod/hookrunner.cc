@@ -0,0 +1,322 @@
+/* {{{
+ * (c) 2022, Bernhard Walle <bernhard@bwalle.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>. }}}
+ */
+
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <spawn.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <libbw/log/errorlog.h>
+#include <libbw/log/debug.h>
+
+#include "hookrunner.h"
+
+extern char **environ;
+
+namespace vetero {
+namespace daemon {
+
+/* HookRunner {{{ */
+
+namespace {
+
+double seconds(std::chrono::steady_clock::duration duration)
+{
+    return std::chrono::duration<double>(duration).count();
+}
+
+// the environment of veterod with the variables of the hook replacing existing ones
+std::vector<std::string> hookEnvironment(const std::vector<std::string> &environment)
+{
+    std::vector<std::string> result;
+
+    for (char **var = environ; var && *var; ++var) {
+        const char *equals = std::strchr(*var, '=');
+        size_t nameLength = equals ? equals - *var + 1 : std::strlen(*var);
+
+        bool replaced = false;
+        for (std::vector<std::string>::const_iterator it = environment.begin();
+                it != environment.end() && !replaced; ++it)
+            replaced = it->compare(0, nameLength, *var, nameLength) == 0;
+
+        if (!replaced)
+            result.push_back(*var);
+    }
+
+    result.insert(result.end(), environment.begin(), environment.end());
+    return result;
+}
+
+} // anonymous namespace
+
+const int HookRunner::KillDelay;
+const int HookRunner::PollInterval;
+
+HookRunner::HookRunner(size_t maxRunning)
+    : m_maxRunning(maxRunning)
+    , m_quit(false)
+{
+    if (pipe2(m_wakeupPipe, O_CLOEXEC | O_NONBLOCK) < 0)
+        throw common::SystemError("Unable to create pipe", errno);
+
+    m_thread = std::thread(&HookRunner::run, this);
+}
+
+HookRunner::~HookRunner()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+    wakeup();
+    m_thread.join();
+
+    close(m_wakeupPipe[0]);
+    close(m_wakeupPipe[1]);
+}
+
+bool HookRunner::start(const std::string &name, const std::string &command, int timeout,
+                       const std::string &input, const std::vector<std::string> &environment)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    std::map<std::string, Hook>::const_iterator running = m_hooks.find(name);
+    if (running != m_hooks.end()) {
+        BW_ERROR_WARNING("Hook '%s' (PID %ld) still running after %.1f s, skipping it",
+                         name.c_str(), long(running->second.pid),
+                         seconds(Clock::now() - running->second.started));
+        return false;
+    }
+
+    if (m_hooks.size() >= m_maxRunning) {
+        BW_ERROR_WARNING("%zu hooks running, skipping hook '%s'", m_hooks.size(), name.c_str());
+        return false;
+    }
+
+    // a socket instead of a pipe so that MSG_NOSIGNAL avoids SIGPIPE
+    int sockets[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sockets) < 0)
+        throw common::SystemError("Unable to create socket for hook '" + name + "'", errno);
+
+    std::vector<std::string> env = hookEnvironment(environment);
+    std::vector<char *> envp;
+    for (std::vector<std::string>::iterator it = env.begin(); it != env.end(); ++it)
+        envp.push_back(&(*it)[0]);
+    envp.push_back(NULL);
+
+    const char *argv[] = { "/bin/sh", "-c", command.c_str(), NULL };
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, sockets[1], STDIN_FILENO);
+
+    // the threads of veterod block some signals, the hook shouldn't inherit that
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+    sigset_t signals;
+    sigemptyset(&signals);
+    posix_spawnattr_setsigmask(&attr, &signals);
+    sigfillset(&signals);
+    posix_spawnattr_setsigdefault(&attr, &signals);
+    posix_spawnattr_setpgroup(&attr, 0);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF |
+                                    POSIX_SPAWN_SETPGROUP);
+
+    pid_t pid;
+    int err = posix_spawn(&pid, argv[0], &actions, &attr,
+                          const_cast<char **>(argv), &envp[0]);
+
+    posix_spawnattr_destroy(&attr);
+    posix_spawn_file_actions_destroy(&actions);
+    close(sockets[1]);
+
+    if (err != 0) {
+        close(sockets[0]);
+        throw common::SystemError("Unable to start hook '" + name + "'", err);
+    }
+
+    if (fcntl(sockets[0], F_SETFL, O_NONBLOCK) < 0)
+        BW_ERROR_WARNING("Unable to make the input of hook '%s' non-blocking: %s",
+                         name.c_str(), std::strerror(errno));
+
+    Hook &hook = m_hooks[name];
+    hook.pid = pid;
+    hook.fd = sockets[0];
+    hook.input = input;
+    hook.written = 0;
+    hook.started = Clock::now();
+    hook.deadline = hook.started + std::chrono::seconds(timeout);
+    hook.terminated = false;
+    hook.unlimited = timeout <= 0;
+
+    BW_DEBUG_DBG("Hook '%s' started with PID %ld", name.c_str(), long(pid));
+
+    writeInput(hook);
+    wakeup();
+
+    return true;
+}
+
+size_t HookRunner::running() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_hooks.size();
+}
+
+void HookRunner::run()
+{
+    while (true) {
+        std::vector<struct pollfd> fds;
+        int timeout;
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            check();
+            if (m_quit && m_hooks.empty())
+                break;
+
+            struct pollfd pfd = { m_wakeupPipe[0], POLLIN, 0 };
+            fds.push_back(pfd);
+            for (std::map<std::string, Hook>::const_iterator it = m_hooks.begin();
+                    it != m_hooks.end(); ++it) {
+                if (it->second.fd < 0)
+                    continue;
+                pfd.fd = it->second.fd;
+                pfd.events = POLLOUT;
+                fds.push_back(pfd);
+            }
+
+            // there's no file descriptor for the termination of a process
+            timeout = m_hooks.empty() ? -1 : PollInterval;
+        }
+
+        int ret = poll(&fds[0], fds.size(), timeout);
+        if (ret < 0 && errno != EINTR)
+            BW_ERROR_ERR("Unable to call poll(): %s", std::strerror(errno));
+
+        char buffer[64];
+        while (read(m_wakeupPipe[0], buffer, sizeof(buffer)) > 0)
+            ;
+
+        if (ret <= 0)
+            continue;
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (std::map<std::string, Hook>::iterator it = m_hooks.begin(); it != m_hooks.end(); ++it)
+            for (size_t i = 1; i < fds.size(); ++i)
+                if (fds[i].fd == it->second.fd && fds[i].revents != 0)
+                    writeInput(it->second);
+    }
+}
+
+void HookRunner::check()
+{
+    Clock::time_point now = Clock::now();
+
+    std::map<std::string, Hook>::iterator it = m_hooks.begin();
+    while (it != m_hooks.end()) {
+        const std::string &name = it->first;
+        Hook &hook = it->second;
+
+        int status;
+        pid_t pid = waitpid(hook.pid, &status, WNOHANG);
+        if (pid == hook.pid || pid < 0) {
+            double duration = seconds(now - hook.started);
+            if (pid < 0)
+                BW_ERROR_ERR("Unable to call waitpid() for hook '%s': %s",
+                             name.c_str(), std::strerror(errno));
+            else if (WIFSIGNALED(status))
+                BW_ERROR_ERR("Hook '%s' terminated with signal %d (%s) after %.1f s",
+                             name.c_str(), WTERMSIG(status), strsignal(WTERMSIG(status)), duration);
+            else if (WEXITSTATUS(status) != 0)
+                BW_ERROR_ERR("Hook '%s' terminated with exit status %d after %.1f s",
+                             name.c_str(), WEXITSTATUS(status), duration);
+            else
+                BW_DEBUG_DBG("Hook '%s' finished after %.1f s", name.c_str(), duration);
+
+            if (hook.fd >= 0)
+                close(hook.fd);
+            m_hooks.erase(it++);
+            continue;
+        }
+
+        // on shutdown, the hooks are terminated like on a timeout
+        if (m_quit && hook.unlimited) {
+            hook.unlimited = false;
+            hook.deadline = now;
+        } else if (m_quit && !hook.terminated)
+            hook.deadline = std::min(hook.deadline, now);
+
+        if (!hook.unlimited && now >= hook.deadline) {
+            int signo = hook.terminated ? SIGKILL : SIGTERM;
+            if (!m_quit)
+                BW_ERROR_WARNING("Hook '%s' (PID %ld) still running after %.1f s, sending %s",
+                                 name.c_str(), long(hook.pid), seconds(now - hook.started),
+                                 strsignal(signo));
+            if (kill(-hook.pid, signo) < 0 && errno != ESRCH)
+                BW_ERROR_ERR("Unable to terminate hook '%s': %s", name.c_str(),
+                             std::strerror(errno));
+
+            hook.terminated = true;
+            hook.deadline = now + std::chrono::seconds(KillDelay);
+        }
+
+        ++it;
+    }
+}
+
+void HookRunner::writeInput(Hook &hook)
+{
+    if (hook.fd < 0)
+        return;
+
+    while (hook.written < hook.input.size()) {
+        ssize_t len = send(hook.fd, hook.input.data() + hook.written,
+                           hook.input.size() - hook.written, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (len < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                return;
+            // the hook doesn't read its input, that's fine
+            break;
+        }
+        hook.written += len;
+    }
+
+    close(hook.fd);
+    hook.fd = -1;
+}
+
+void HookRunner::wakeup()
+{
+    char c = 0;
+    if (write(m_wakeupPipe[1], &c, 1) < 0 && errno != EAGAIN)
+        BW_ERROR_WARNING("Unable to wake up the hook runner: %s", std::strerror(errno));
+}
+
+/* }}} */
+
+} // end namespace daemon
+} // end namespace vetero
@@ -0,0 +1,166 @@
+/* {{{
+ * (c) 2022, Bernhard Walle <bernhard@bwalle.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>. }}}
+ */
+#ifndef VETERO_VETEROD_HOOKRUNNER_H_
+#define VETERO_VETEROD_HOOKRUNNER_H_
+
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/types.h>
+
+#include <libbw/noncopyable.h>
+
+#include "common/error.h"
+
+namespace vetero {
+namespace daemon {
+
+/* HookRunner {{{ */
+
+/**
+ * \class HookRunner
+ * \brief Runs hooks like the update postscript without blocking the caller
+ *
+ * A hook is a shell command that is started with posix_spawn() and gets its data as JSON on
+ * standard input. The additional environment variables are only set for the hook, not for
+ * veterod. A thread of its own feeds the input, reaps the processes and enforces the timeouts:
+ * a hook that is still running after its timeout gets \c SIGTERM, KillDelay seconds later
+ * \c SIGKILL. The signals are sent to the process group of the hook, so commands started by the
+ * shell are terminated as well.
+ *
+ * A hook is skipped if the previous run of the same hook is still running or if MaxRunning
+ * hooks are running already. Since hooks run for each sample, the next sample runs them again
+ * anyway.
+ *
+ * \author Bernhard Walle <bernhard@bwalle.de>
+ * \ingroup daemon
+ */
+class HookRunner : private bw::Noncopyable {
+
+    public:
+        /// Seconds between \c SIGTERM and \c SIGKILL
+        static const int KillDelay = 5;
+
+        /// Milliseconds between the checks if a hook has terminated
+        static const int PollInterval = 100;
+
+    public:
+        /**
+         * \brief Constructor
+         *
+         * Starts the thread.
+         *
+         * \param[in] maxRunning the maximum number of hooks that run at the same time
+         * \exception common::SystemError if the thread cannot be set up
+         */
+        HookRunner(size_t maxRunning);
+
+        /**
+         * \brief Destructor
+         *
+         * Terminates the hooks that are still running and waits for them.
+         */
+        ~HookRunner();
+
+    public:
+        /**
+         * \brief Starts a hook
+         *
+         * Returns immediately.
+         *
+         * \param[in] name the name of the hook for the log and the skip check
+         * \param[in] command the command, run with <tt>/bin/sh -c</tt>
+         * \param[in] timeout the maximum run time in seconds, 0 for no limit
+         * \param[in] input the data written to the standard input of the hook
+         * \param[in] environment variables like <tt>"NAME=value"</tt> that are added to the
+         *            environment of veterod for the hook
+         * \return \c true if the hook has been started, \c false if it has been skipped
+         * \exception common::SystemError if the hook cannot be started
+         */
+        bool start(const std::string &name, const std::string &command, int timeout,
+                   const std::string &input, const std::vector<std::string> &environment);
+
+        /**
+         * \brief Returns the number of running hooks
+         *
+         * \return the number of hooks started by start() that have not terminated yet
+         */
+        size_t running() const;
+
+    protected:
+        typedef std::chrono::steady_clock Clock;
+
+        /**
+         * \brief State of a running hook
+         */
+        struct Hook {
+            pid_t pid;                      ///< the PID of the shell
+            int fd;                         ///< standard input of the hook, -1 if closed
+            std::string input;              ///< the data for the standard input
+            size_t written;                 ///< bytes of \c input that have been written
+            Clock::time_point started;      ///< the start time
+            Clock::time_point deadline;     ///< when the next signal is sent
+            bool terminated;                ///< \c true if \c SIGTERM has been sent
+            bool unlimited;                 ///< \c true if the hook has no timeout
+        };
+
+        /**
+         * \brief Thread function
+         */
+        void run();
+
+        /**
+         * \brief Reaps terminated hooks and sends the signals of the timeouts
+         *
+         * The caller must hold the mutex.
+         */
+        void check();
+
+        /**
+         * \brief Writes the input of a hook
+         *
+         * Closes the standard input if everything has been written or if the hook doesn't
+         * read it. The caller must hold the mutex.
+         *
+         * \param[in] hook the hook
+         */
+        void writeInput(Hook &hook);
+
+        /**
+         * \brief Wakes up the thread
+         */
+        void wakeup();
+
+    private:
+        size_t m_maxRunning;
+        int m_wakeupPipe[2];
+        mutable std::mutex m_mutex;
+        std::map<std::string, Hook> m_hooks;
+        bool m_quit;
+        std::thread m_thread;
+};
+
+/* }}} */
+
+} // end namespace daemon
+} // end namespace vetero
+
+#endif // VETERO_VETEROD_HOOKRUNNER_H_
@@ -0,0 +1,327 @@
+/* {{{
+ * (c) 2022, Bernhard Walle <bernhard@bwalle.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>. }}}
+ */
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <libbw/stringutil.h>
+#include <libbw/log/debug.h>
+#include <libbw/log/errorlog.h>
+
+#include "common/utils.h"
+#include "liveapi.h"
+
+namespace vetero {
+namespace daemon {
+
+/* LiveApi {{{ */
+
+const size_t LiveApi::MaxRequestSize;
+const size_t LiveApi::MaxClients;
+const int LiveApi::ClientTimeout;
+
+LiveApi::LiveApi(const LiveCache &cache)
+    : m_cache(cache)
+    , m_quit(false)
+{
+    if (pipe2(m_wakeupPipe, O_CLOEXEC | O_NONBLOCK) < 0)
+        throw common::SystemError("Unable to create pipe", errno);
+}
+
+LiveApi::~LiveApi()
+{
+    if (m_thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_quit = true;
+        }
+        wakeup();
+        m_thread.join();
+    }
+
+    for (std::map<int, Client>::const_iterator it = m_clients.begin(); it != m_clients.end(); ++it)
+        close(it->first);
+    for (size_t i = 0; i < m_listenFds.size(); ++i)
+        close(m_listenFds[i]);
+    if (!m_socketPath.empty())
+        unlink(m_socketPath.c_str());
+
+    close(m_wakeupPipe[0]);
+    close(m_wakeupPipe[1]);
+}
+
+void LiveApi::listenUnix(const std::string &path)
+{
+    int fd = common::listen_unix(path);
+
+    m_listenFds.push_back(fd);
+    m_socketPath = path;
+    BW_DEBUG_INFO("Live API listening on '%s'", path.c_str());
+}
+
+void LiveApi::listenTcp(int port)
+{
+    // IPv6 socket that accepts IPv4 connections as well, IPv4 only as fallback
+    struct sockaddr_in6 address6;
+    std::memset(&address6, 0, sizeof(address6));
+    address6.sin6_family = AF_INET6;
+    address6.sin6_addr = in6addr_any;
+    address6.sin6_port = htons(port);
+
+    struct sockaddr_in address4;
+    std::memset(&address4, 0, sizeof(address4));
+    address4.sin_family = AF_INET;
+    address4.sin_addr.s_addr = htonl(INADDR_ANY);
+    address4.sin_port = htons(port);
+
+    int fd = socket(AF_INET6, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    struct sockaddr *address = reinterpret_cast<struct sockaddr *>(&address6);
+    socklen_t addressLength = sizeof(address6);
+    if (fd < 0) {
+        fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        address = reinterpret_cast<struct sockaddr *>(&address4);
+        addressLength = sizeof(address4);
+    }
+    if (fd < 0)
+        throw common::SystemError("Unable to create socket", errno);
+
+    int on = 1, off = 0;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    if (address->sa_family == AF_INET6)
+        setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &off, sizeof(off));
+
+    if (bind(fd, address, addressLength) < 0 || listen(fd, SOMAXCONN) < 0) {
+        int err = errno;
+        close(fd);
+        throw common::SystemError("Unable to listen on port " + bw::str(port), err);
+    }
+
+    m_listenFds.push_back(fd);
+    BW_DEBUG_INFO("Live API listening on port %d", port);
+}
+
+void LiveApi::start()
+{
+    m_thread = std::thread(&LiveApi::run, this);
+}
+
+void LiveApi::run()
+{
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_quit)
+                break;
+        }
+
+        std::vector<struct pollfd> fds;
+        struct pollfd pfd = { m_wakeupPipe[0], POLLIN, 0 };
+        fds.push_back(pfd);
+        for (size_t i = 0; i < m_listenFds.size(); ++i) {
+            pfd.fd = m_listenFds[i];
+            fds.push_back(pfd);
+        }
+        for (std::map<int, Client>::const_iterator it = m_clients.begin(); it != m_clients.end(); ++it) {
+            pfd.fd = it->first;
+            pfd.events = it->second.output.empty() ? POLLIN : POLLOUT;
+            fds.push_back(pfd);
+        }
+
+        int ret = poll(&fds[0], fds.size(), 1000);
+        if (ret < 0 && errno != EINTR)
+            BW_ERROR_ERR("Unable to call poll(): %s", std::strerror(errno));
+
+        char buffer[64];
+        while (read(m_wakeupPipe[0], buffer, sizeof(buffer)) > 0)
+            ;
+
+        Clock::time_point timeout = Clock::now() - std::chrono::seconds(ClientTimeout);
+        for (size_t i = 1; i < fds.size(); ++i) {
+            if (i <= m_listenFds.size()) {
+                if (fds[i].revents & POLLIN)
+                    acceptClient(fds[i].fd);
+                continue;
+            }
+
+            std::map<int, Client>::iterator it = m_clients.find(fds[i].fd);
+            if (it == m_clients.end())
+                continue;
+
+            bool keep = true;
+            if (fds[i].revents & (POLLERR | POLLNVAL))
+                keep = false;
+            else if (fds[i].revents & POLLOUT)
+                keep = writeResponse(it->first, it->second);
+            else if (fds[i].revents & (POLLIN | POLLHUP))
+                keep = readRequest(it->first, it->second);
+            else if (it->second.connected < timeout)
+                keep = false;
+
+            if (!keep) {
+                close(it->first);
+                m_clients.erase(it);
+            }
+        }
+    }
+}
+
+void LiveApi::acceptClient(int listenFd)
+{
+    int fd = accept4(listenFd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR && errno != ECONNABORTED)
+            BW_ERROR_WARNING("Live API: unable to accept connection: %s", std::strerror(errno));
+        return;
+    }
+
+    if (m_clients.size() >= MaxClients) {
+        BW_DEBUG_DBG("Live API: too many clients, closing connection");
+        close(fd);
+        return;
+    }
+
+    Client &client = m_clients[fd];
+    client.outputOffset = 0;
+    client.connected = Clock::now();
+}
+
+bool LiveApi::readRequest(int fd, Client &client)
+{
+    char buffer[1024];
+    ssize_t len = recv(fd, buffer, sizeof(buffer), 0);
+    if (len < 0)
+        return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+    else if (len == 0)
+        return false;
+
+    client.input.append(buffer, len);
+
+    size_t end = client.input.find("\r\n\r\n");
+    if (end == std::string::npos)
+        end = client.input.find("\n\n");
+
+    if (end != std::string::npos)
+        client.output = response(client.input.substr(0, end));
+    else if (client.input.size() > MaxRequestSize)
+        client.output = httpResponse(431, "{\"error\":\"request too large\"}");
+    else
+        return true;
+
+    // the response is usually sent completely right now
+    return writeResponse(fd, client);
+}
+
+bool LiveApi::writeResponse(int fd, Client &client)
+{
+    while (client.outputOffset < client.output.size()) {
+        ssize_t len = send(fd, client.output.data() + client.outputOffset,
+                           client.output.size() - client.outputOffset, MSG_NOSIGNAL);
+        if (len < 0)
+            return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+        client.outputOffset += len;
+    }
+
+    return false;
+}
+
+std::string LiveApi::response(const std::string &request) const
+{
+    std::string requestLine = request.substr(0, request.find_first_of("\r\n"));
+    size_t firstSpace = requestLine.find(' ');
+    size_t lastSpace = requestLine.rfind(' ');
+    if (firstSpace == std::string::npos || firstSpace == lastSpace ||
+            !bw::startsWith(requestLine.substr(lastSpace + 1), "HTTP/"))
+        return httpResponse(400, "{\"error\":\"bad request\"}");
+    if (requestLine.compare(0, firstSpace, "GET") != 0)
+        return httpResponse(405, "{\"error\":\"only GET is supported\"}");
+
+    std::string path = requestLine.substr(firstSpace + 1, lastSpace - firstSpace - 1);
+    std::string query;
+    size_t questionMark = path.find('?');
+    if (questionMark != std::string::npos) {
+        query = path.substr(questionMark + 1);
+        path.erase(questionMark);
+    }
+
+    if (path == "/current")
+        return httpResponse(200, m_cache.currentJson());
+    else if (path == "/samples")
+        return httpResponse(200, m_cache.samplesJson(std::strtoul(queryValue(query, "count").c_str(), NULL, 10)));
+    else if (path == "/days")
+        return httpResponse(200, m_cache.daysJson(queryValue(query, "from"), queryValue(query, "to")));
+    else if (path == "/months")
+        return httpResponse(200, m_cache.monthsJson(queryValue(query, "from"), queryValue(query, "to")));
+
+    return httpResponse(404, "{\"error\":\"not found\"}");
+}
+
+std::string LiveApi::httpResponse(int status, const std::string &body)
+{
+    const char *text;
+    switch (status) {
+        case 200: text = "OK"; break;
+        case 400: text = "Bad Request"; break;
+        case 404: text = "Not Found"; break;
+        case 405: text = "Method Not Allowed"; break;
+        case 431: text = "Request Header Fields Too Large"; break;
+        default:  text = "Internal Server Error"; break;
+    }
+
+    return "HTTP/1.0 " + bw::str(status) + " " + text + "\r\n"
+           "Content-Type: application/json\r\n"
+           "Content-Length: " + bw::str(body.size() + 1) + "\r\n"
+           "Cache-Control: no-cache\r\n"
+           "Connection: close\r\n"
+           "\r\n" + body + "\n";
+}
+
+std::string LiveApi::queryValue(const std::string &query, const std::string &name)
+{
+    size_t begin = 0;
+    while (begin < query.size()) {
+        size_t end = query.find('&', begin);
+        if (end == std::string::npos)
+            end = query.size();
+
+        std::string parameter = query.substr(begin, end - begin);
+        if (bw::startsWith(parameter, name + "="))
+            return parameter.substr(name.size() + 1);
+
+        begin = end + 1;
+    }
+
+    return std::string();
+}
+
+void LiveApi::wakeup()
+{
+    char c = 0;
+    if (write(m_wakeupPipe[1], &c, 1) < 0 && errno != EAGAIN)
+        BW_ERROR_WARNING("Unable to wake up the live API: %s", std::strerror(errno));
+}
+
+/* }}} */
+
+} // end namespace daemon
+} // end namespace vetero
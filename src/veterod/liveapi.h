@@ -0,0 +1,208 @@
+/* {{{
+ * (c) 2022, Bernhard Walle <bernhard@bwalle.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>. }}}
+ */
+#ifndef VETERO_VETEROD_LIVEAPI_H_
+#define VETERO_VETEROD_LIVEAPI_H_
+
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <libbw/noncopyable.h>
+
+#include "common/error.h"
+#include "livecache.h"
+
+namespace vetero {
+namespace daemon {
+
+/* LiveApi {{{ */
+
+/**
+ * \class LiveApi
+ * \brief Serves the LiveCache as JSON via HTTP
+ *
+ * Listens on a Unix domain socket (<tt>api_socket</tt>) and/or a TCP port (<tt>api_port</tt>)
+ * and answers in a thread of its own, so neither slow clients nor frequent polling delay the
+ * ingest loop. The answers come from the LiveCache, the database is never read.
+ *
+ * Each connection serves one <tt>GET</tt> request:
+ *
+ *  - <tt>/current</tt>: the current weather
+ *  - <tt>/samples?count=N</tt>: the last \c N samples (default: all samples in the cache)
+ *  - <tt>/days?from=YYYY-MM-DD&to=YYYY-MM-DD</tt>: the statistics of the days
+ *  - <tt>/months?from=YYYY-MM&to=YYYY-MM</tt>: the statistics of the months
+ *
+ * Missing \c from or \c to parameters select all days or months from the beginning or up to
+ * the end. For example:
+ *
+ * \code
+ * curl --unix-socket /run/vetero/api.sock 'http://localhost/days?from=2022-04-01'
+ * \endcode
+ *
+ * \author Bernhard Walle <bernhard@bwalle.de>
+ * \ingroup daemon
+ */
+class LiveApi : private bw::Noncopyable {
+
+    public:
+        /// Maximum size of a request in bytes
+        static const size_t MaxRequestSize = 4096;
+
+        /// Maximum number of clients served at the same time
+        static const size_t MaxClients = 64;
+
+        /// Seconds after which a client that didn't complete its request is disconnected
+        static const int ClientTimeout = 10;
+
+    public:
+        /**
+         * \brief Constructor
+         *
+         * Doesn't listen yet.
+         *
+         * \param[in] cache the data that is served, must live longer than the LiveApi
+         * \exception common::SystemError if the wakeup pipe cannot be created
+         */
+        LiveApi(const LiveCache &cache);
+
+        /**
+         * \brief Destructor
+         *
+         * Stops the thread, closes all connections and removes the Unix domain socket.
+         */
+        ~LiveApi();
+
+    public:
+        /**
+         * \brief Listens on a Unix domain socket
+         *
+         * An existing socket file is replaced.
+         *
+         * \param[in] path the path of the socket
+         * \exception common::SystemError if the socket cannot be created
+         */
+        void listenUnix(const std::string &path);
+
+        /**
+         * \brief Listens on a TCP port on all addresses
+         *
+         * \param[in] port the port
+         * \exception common::SystemError if the socket cannot be created
+         */
+        void listenTcp(int port);
+
+        /**
+         * \brief Starts the thread that serves the requests
+         *
+         * Must be called after listenUnix() and listenTcp().
+         */
+        void start();
+
+    protected:
+        typedef std::chrono::steady_clock Clock;
+
+        /**
+         * \brief State of a connection
+         */
+        struct Client {
+            std::string input;              ///< the request received so far
+            std::string output;             ///< the response, empty while reading the request
+            size_t outputOffset;            ///< bytes of \c output already sent
+            Clock::time_point connected;    ///< time of the connect
+        };
+
+        /**
+         * \brief Thread function
+         */
+        void run();
+
+        /**
+         * \brief Accepts a connection
+         *
+         * \param[in] listenFd the listening socket
+         */
+        void acceptClient(int listenFd);
+
+        /**
+         * \brief Reads from a client and creates the response once the request is complete
+         *
+         * \param[in] fd the socket of the client
+         * \param[in] client the client
+         * \return \c false if the connection has to be closed
+         */
+        bool readRequest(int fd, Client &client);
+
+        /**
+         * \brief Sends the response
+         *
+         * \param[in] fd the socket of the client
+         * \param[in] client the client
+         * \return \c false if the connection has to be closed, also when the response is complete
+         */
+        bool writeResponse(int fd, Client &client);
+
+        /**
+         * \brief Creates the response of a request
+         *
+         * \param[in] request the request line and the headers
+         * \return the HTTP response
+         */
+        std::string response(const std::string &request) const;
+
+        /**
+         * \brief Formats an HTTP response
+         *
+         * \param[in] status the status code
+         * \param[in] body the JSON body
+         * \return the HTTP response including the headers
+         */
+        static std::string httpResponse(int status, const std::string &body);
+
+        /**
+         * \brief Returns a parameter of a query string
+         *
+         * \param[in] query the query like <tt>"from=2022-04-01&to=2022-04-30"</tt>
+         * \param[in] name the name of the parameter
+         * \return the value, empty if the parameter doesn't exist
+         */
+        static std::string queryValue(const std::string &query, const std::string &name);
+
+        /**
+         * \brief Wakes up the thread
+         */
+        void wakeup();
+
+    private:
+        const LiveCache &m_cache;
+        std::vector<int> m_listenFds;
+        std::string m_socketPath;
+        std::map<int, Client> m_clients;
+        int m_wakeupPipe[2];
+        std::mutex m_mutex;
+        bool m_quit;
+        std::thread m_thread;
+};
+
+/* }}} */
+
+} // end namespace daemon
+} // end namespace vetero
+
+#endif // VETERO_VETEROD_LIVEAPI_H_
@@ -0,0 +1,381 @@
+/* {{{
+ * (c) 2022, Bernhard Walle <bernhard@bwalle.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>. }}}
+ */
+
+#include <algorithm>
+
+#include <libbw/stringutil.h>
+#include <libbw/log/debug.h>
+
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+
+#include "common/weather.h"
+#include "livecache.h"
+
+namespace vetero {
+namespace daemon {
+
+/* LiveCache {{{ */
+
+namespace {
+
+// the columns of the weatherdata table in the order of LiveCache::sampleJson()
+const struct {
+    const char *name;
+    double divisor;
+} sampleColumns[] = {
+    { "temp",            100.0 },
+    { "humid",           100.0 },
+    { "dewpoint",        100.0 },
+    { "wind",            100.0 },
+    { "wind_gust",       100.0 },
+    { "wind_dir",        1.0 },
+    { "solar_radiation", 10.0 },
+    { "uv_index",        1.0 },
+    { "rain",            1000.0 },
+    { "pressure",        100.0 },
+};
+
+const size_t sampleColumnCount = sizeof(sampleColumns) / sizeof(sampleColumns[0]);
+
+} // anonymous namespace
+
+LiveCache::LiveCache(size_t capacity)
+    : m_samples(std::max<size_t>(capacity, 1))
+    , m_sampleHead(0)
+    , m_sampleCount(0)
+    , m_current("null")
+{}
+
+void LiveCache::load(common::DbAccess &dbAccess)
+{
+    std::string columns;
+    for (size_t i = 0; i < sampleColumnCount; ++i)
+        columns += std::string(", ") + sampleColumns[i].name;
+
+    common::Database::Result samples = dbAccess.database().executeSqlQuery(
+        ("SELECT   timestamp" + columns + " "
+         "FROM     weatherdata "
+         "ORDER BY timestamp DESC "
+         "LIMIT    %d").c_str(), static_cast<int>(m_samples.size())
+    );
+
+    common::Database::Result days = dbAccess.database().executeSqlQuery(
+        "SELECT   * "
+        "FROM     day_statistics_float "
+        "ORDER BY date"
+    );
+
+    common::Database::Result months = dbAccess.database().executeSqlQuery(
+        "SELECT   * "
+        "FROM     month_statistics_float "
+        "ORDER BY month"
+    );
+
+    common::CurrentWeather current = dbAccess.queryCurrentWeather();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_sampleHead = m_sampleCount = 0;
+    for (size_t i = samples.data.size(); i-- > 0; ) {
+        const std::vector<std::string> &row = samples.data[i];
+        pushSample(sampleJson(row.at(0), std::vector<std::string>(row.begin() + 1, row.end())));
+    }
+
+    m_days.clear();
+    for (size_t i = 0; i < days.data.size(); ++i)
+        m_days[days.data[i].at(0)] = rowJson(days, i);
+
+    m_months.clear();
+    for (size_t i = 0; i < months.data.size(); ++i)
+        m_months[months.data[i].at(0)] = rowJson(months, i);
+
+    if (!samples.data.empty())
+        m_current = currentWeatherJson(current);
+
+    BW_DEBUG_INFO("Live cache loaded: %zu samples, %zu days, %zu months",
+                  m_sampleCount, m_days.size(), m_months.size());
+}
+
+void LiveCache::addSample(const common::Dataset &dataset, int rainValue)
+{
+    std::string json = sampleJson(dataset, rainValue);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    pushSample(json);
+}
+
+void LiveCache::setCurrentWeather(const common::CurrentWeather &weather)
+{
+    std::string json = currentWeatherJson(weather);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_current.swap(json);
+}
+
+void LiveCache::updateDay(common::DbAccess &dbAccess, const std::string &date)
+{
+    common::Database::Result result = dbAccess.database().executeSqlQuery(
+        "SELECT   * "
+        "FROM     day_statistics_float "
+        "WHERE    date = ?", date.c_str()
+    );
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (result.data.empty())
+        m_days.erase(date);
+    else
+        m_days[date] = rowJson(result, 0);
+}
+
+void LiveCache::updateMonth(common::DbAccess &dbAccess, const std::string &month)
+{
+    common::Database::Result result = dbAccess.database().executeSqlQuery(
+        "SELECT   * "
+        "FROM     month_statistics_float "
+        "WHERE    month = ?", month.c_str()
+    );
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (result.data.empty())
+        m_months.erase(month);
+    else
+        m_months[month] = rowJson(result, 0);
+}
+
+std::string LiveCache::currentJson() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_current;
+}
+
+std::string LiveCache::samplesJson(size_t count) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (count == 0 || count > m_sampleCount)
+        count = m_sampleCount;
+
+    std::string json("[");
+    for (size_t i = 0; i < count; ++i) {
+        // the oldest of the requested samples first
+        size_t index = (m_sampleHead + m_samples.size() - count + i) % m_samples.size();
+        if (i > 0)
+            json += ',';
+        json += m_samples[index];
+    }
+    json += ']';
+
+    return json;
+}
+
+std::string LiveCache::daysJson(const std::string &from, const std::string &to) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return rangeJson(m_days, from, to);
+}
+
+std::string LiveCache::monthsJson(const std::string &from, const std::string &to) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return rangeJson(m_months, from, to);
+}
+
+std::string LiveCache::sampleJson(const common::Dataset &dataset, int rainValue)
+{
+    common::SensorType type = dataset.sensorType();
+    std::vector<std::string> values(sampleColumnCount);
+
+    values[0] = bw::str(dataset.temperature());
+    if (type.hasHumidity()) {
+        values[1] = bw::str(dataset.humidity());
+        values[2] = bw::str(common::weather::dewpoint(dataset.temperature(), dataset.humidity()));
+    }
+    if (type.hasWindSpeed())
+        values[3] = bw::str(dataset.windSpeed());
+    if (type.hasWindGust())
+        values[4] = bw::str(dataset.windGust());
+    if (type.hasWindDirection())
+        values[5] = bw::str(dataset.windDirection());
+    if (type.hasSolarRadiation()) {
+        values[6] = bw::str(dataset.solarRadiation());
+        values[7] = bw::str(dataset.uvIndex());
+    }
+    if (type.hasRain())
+        values[8] = bw::str(rainValue);
+    if (type.hasPressure())
+        values[9] = bw::str(dataset.pressure());
+
+    return sampleJson(dataset.timestamp().str(), values);
+}
+
+std::string LiveCache::currentWeatherJson(const common::CurrentWeather &weather)
+{
+    namespace json = rapidjson;
+
+    json::StringBuffer s;
+    json::Writer<json::StringBuffer> writer(s);
+
+    writer.StartObject();
+
+    writer.Key("last_update");
+    writer.String(weather.timestamp().strftime("%Y-%m-%d %H:%M").c_str());
+
+    writer.Key("temperature");
+    writer.Double(weather.temperatureReal());
+    writer.Key("temperature_min");
+    writer.Double(weather.minTemperatureReal());
+    writer.Key("temperature_max");
+    writer.Double(weather.maxTemperatureReal());
+
+    if (weather.hasHumidity()) {
+        writer.Key("dewpoint");
+        writer.Double(weather.dewpointReal());
+        writer.Key("humidity");
+        writer.Double(weather.humidityReal());
+    }
+
+    if (weather.hasWindSpeed()) {
+        writer.Key("wind_speed");
+        writer.Double(weather.windSpeedReal());
+        writer.Key("wind_beaufort");
+        writer.Int(weather.windBeaufort());
+        writer.Key("wind_speed_max");
+        writer.Double(weather.maxWindSpeedReal());
+    }
+
+    if (weather.hasWindGust()) {
+        writer.Key("wind_gust");
+        writer.Double(weather.windGustReal());
+        writer.Key("wind_gust_max");
+        writer.Double(weather.maxWindGustReal());
+    }
+
+    if (weather.hasWindDirection()) {
+        writer.Key("wind_direction");
+        writer.Uint(weather.windDirection());
+        writer.Key("wind_direction_str");
+        writer.String(weather.windDirectionStr().c_str());
+    }
+
+    if (weather.hasSolarRadiation()) {
+        writer.Key("solar_radiation");
+        writer.Double(weather.solarRadiationReal());
+        writer.Key("uv_index");
+        writer.Int(weather.uvIndex());
+    }
+
+    if (weather.hasRain()) {
+        writer.Key("rain");
+        writer.Double(weather.rainReal());
+    }
+
+    if (weather.hasPressure()) {
+        writer.Key("pressure");
+        writer.Double(weather.pressureReal());
+    }
+
+    writer.EndObject();
+
+    return s.GetString();
+}
+
+std::string LiveCache::updateJson(const common::Dataset &dataset, int rainValue,
+                                  const common::CurrentWeather &weather)
+{
+    return "{\"sample\":" + sampleJson(dataset, rainValue) +
+           ",\"current\":" + currentWeatherJson(weather) + "}";
+}
+
+std::string LiveCache::sampleJson(const std::string &timestamp,
+                                  const std::vector<std::string> &values)
+{
+    namespace json = rapidjson;
+
+    json::StringBuffer s;
+    json::Writer<json::StringBuffer> writer(s);
+
+    writer.StartObject();
+    writer.Key("timestamp");
+    writer.String(timestamp.c_str());
+
+    for (size_t i = 0; i < sampleColumnCount && i < values.size(); ++i) {
+        if (values[i].empty())
+            continue;
+        writer.Key(sampleColumns[i].name);
+        writer.Double(bw::from_str<double>(values[i]) / sampleColumns[i].divisor);
+    }
+
+    writer.EndObject();
+
+    return s.GetString();
+}
+
+std::string LiveCache::rowJson(const common::Database::Result &result, size_t row)
+{
+    namespace json = rapidjson;
+
+    const std::vector<std::string> &data = result.data.at(row);
+
+    json::StringBuffer s;
+    json::Writer<json::StringBuffer> writer(s);
+
+    writer.StartObject();
+    for (size_t i = 0; i < data.size() && i < result.columnNames.size(); ++i) {
+        writer.Key(result.columnNames[i].c_str());
+        if (i == 0)
+            writer.String(data[i].c_str());
+        else if (data[i].empty())
+            writer.Null();
+        else
+            writer.Double(bw::from_str<double>(data[i]));
+    }
+    writer.EndObject();
+
+    return s.GetString();
+}
+
+std::string LiveCache::rangeJson(const std::map<std::string, std::string> &rows,
+                                 const std::string &from, const std::string &to)
+{
+    std::string json("[");
+
+    std::map<std::string, std::string>::const_iterator it = rows.lower_bound(from);
+    for (bool first = true; it != rows.end(); ++it, first = false) {
+        if (!to.empty() && it->first > to)
+            break;
+        if (!first)
+            json += ',';
+        json += it->second;
+    }
+    json += ']';
+
+    return json;
+}
+
+void LiveCache::pushSample(const std::string &json)
+{
+    m_samples[m_sampleHead] = json;
+    m_sampleHead = (m_sampleHead + 1) % m_samples.size();
+    if (m_sampleCount < m_samples.size())
+        m_sampleCount++;
+}
+
+/* }}} */
+
+} // end namespace daemon
+} // end namespace vetero
@@ -0,0 +1,237 @@
+/* {{{
+ * (c) 2022, Bernhard Walle <bernhard@bwalle.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>. }}}
+ */
+#ifndef VETERO_VETEROD_LIVECACHE_H_
+#define VETERO_VETEROD_LIVECACHE_H_
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <libbw/noncopyable.h>
+
+#include "common/database.h"
+#include "common/dataset.h"
+#include "common/dbaccess.h"
+
+namespace vetero {
+namespace daemon {
+
+/* LiveCache {{{ */
+
+/**
+ * \class LiveCache
+ * \brief The latest weather data as JSON, kept in memory for the LiveApi
+ *
+ * The ingest loop of veterod adds each sample and updates the current weather and the
+ * statistics of the day and month it has just written to the database. The values are
+ * converted to JSON at that time, so a request only copies strings and never reads the
+ * database.
+ *
+ * The last samples are kept in a ring buffer. The day and month statistics are loaded
+ * completely by load() and use the column names of the <tt>day_statistics_float</tt> and
+ * <tt>month_statistics_float</tt> views, the samples the ones of <tt>weatherdata_float</tt>.
+ *
+ * All functions are thread-safe.
+ *
+ * \author Bernhard Walle <bernhard@bwalle.de>
+ * \ingroup daemon
+ */
+class LiveCache : private bw::Noncopyable {
+
+    public:
+        /**
+         * \brief Constructor
+         *
+         * \param[in] capacity the number of samples kept in the ring buffer
+         */
+        LiveCache(size_t capacity);
+
+    public:
+        /**
+         * \brief Fills the cache from the database
+         *
+         * Called once at startup, afterwards the cache is updated incrementally.
+         *
+         * \param[in] dbAccess the database
+         * \exception common::DatabaseError if the database cannot be read
+         */
+        void load(common::DbAccess &dbAccess);
+
+        /**
+         * \brief Adds a sample that has been inserted in the database
+         *
+         * The oldest sample is dropped if the ring buffer is full.
+         *
+         * \param[in] dataset the sample
+         * \param[in] rainValue the rain since the previous sample as computed by
+         *            common::DbAccess::insertDataset()
+         */
+        void addSample(const common::Dataset &dataset, int rainValue);
+
+        /**
+         * \brief Replaces the current weather
+         *
+         * \param[in] weather the current weather
+         */
+        void setCurrentWeather(const common::CurrentWeather &weather);
+
+        /**
+         * \brief Reloads the statistics of one day after they have been updated
+         *
+         * \param[in] dbAccess the database
+         * \param[in] date the day like <tt>"2022-04-01"</tt>
+         * \exception common::DatabaseError if the database cannot be read
+         */
+        void updateDay(common::DbAccess &dbAccess, const std::string &date);
+
+        /**
+         * \brief Reloads the statistics of one month after they have been updated
+         *
+         * \param[in] dbAccess the database
+         * \param[in] month the month like <tt>"2022-04"</tt>
+         * \exception common::DatabaseError if the database cannot be read
+         */
+        void updateMonth(common::DbAccess &dbAccess, const std::string &month);
+
+        /**
+         * \brief Returns the current weather
+         *
+         * \return a JSON object, <tt>"null"</tt> if there's no data yet
+         */
+        std::string currentJson() const;
+
+        /**
+         * \brief Returns the latest samples
+         *
+         * \param[in] count the maximum number of samples, 0 for all samples in the cache
+         * \return a JSON array of objects, the oldest sample first
+         */
+        std::string samplesJson(size_t count) const;
+
+        /**
+         * \brief Returns the statistics of a range of days
+         *
+         * \param[in] from the first day like <tt>"2022-04-01"</tt>, empty for the first day
+         *            with data
+         * \param[in] to the last day (inclusive), empty for the last day with data
+         * \return a JSON array of objects
+         */
+        std::string daysJson(const std::string &from, const std::string &to) const;
+
+        /**
+         * \brief Returns the statistics of a range of months
+         *
+         * \param[in] from the first month like <tt>"2022-04"</tt>, empty for the first month
+         *            with data
+         * \param[in] to the last month (inclusive), empty for the last month with data
+         * \return a JSON array of objects
+         */
+        std::string monthsJson(const std::string &from, const std::string &to) const;
+
+    public:
+        /**
+         * \brief Converts a sample to JSON
+         *
+         * \param[in] dataset the sample
+         * \param[in] rainValue the rain since the previous sample, see addSample()
+         * \return the JSON object
+         */
+        static std::string sampleJson(const common::Dataset &dataset, int rainValue);
+
+        /**
+         * \brief Converts the current weather to JSON
+         *
+         * Uses the same names as <tt>current_weather.json</tt> of the reports.
+         *
+         * \param[in] weather the current weather
+         * \return the JSON object
+         */
+        static std::string currentWeatherJson(const common::CurrentWeather &weather);
+
+        /**
+         * \brief Converts a sample and the current weather derived from it to JSON
+         *
+         * This is the message of the live feed and the input of the update postscript.
+         *
+         * \param[in] dataset the sample
+         * \param[in] rainValue the rain since the previous sample, see addSample()
+         * \param[in] weather the current weather including \p dataset
+         * \return the JSON object <tt>{"sample":{...},"current":{...}}</tt>
+         */
+        static std::string updateJson(const common::Dataset &dataset, int rainValue,
+                                      const common::CurrentWeather &weather);
+
+    protected:
+        /**
+         * \brief Converts a sample to JSON
+         *
+         * \param[in] timestamp the time like <tt>"2022-04-01 12:00:00"</tt>
+         * \param[in] values the raw integer values in the order of the <tt>weatherdata</tt>
+         *            columns of the sample, empty strings for missing values
+         * \return the JSON object
+         */
+        static std::string sampleJson(const std::string &timestamp,
+                                      const std::vector<std::string> &values);
+
+        /**
+         * \brief Converts a row of a statistics view to JSON
+         *
+         * The first column is the key, the other columns are numbers or \c null.
+         *
+         * \param[in] result the query result
+         * \param[in] row the index of the row
+         * \return the JSON object
+         */
+        static std::string rowJson(const common::Database::Result &result, size_t row);
+
+        /**
+         * \brief Joins the objects of a range of keys to a JSON array
+         *
+         * \param[in] rows the JSON objects by key
+         * \param[in] from the first key, empty for the first key
+         * \param[in] to the last key (inclusive), empty for the last key
+         * \return the JSON array
+         */
+        static std::string rangeJson(const std::map<std::string, std::string> &rows,
+                                     const std::string &from, const std::string &to);
+
+        /**
+         * \brief Appends a sample to the ring buffer
+         *
+         * The caller must hold the mutex.
+         *
+         * \param[in] json the sample as JSON
+         */
+        void pushSample(const std::string &json);
+
+    private:
+        mutable std::mutex m_mutex;
+        std::vector<std::string> m_samples;
+        size_t m_sampleHead;
+        size_t m_sampleCount;
+        std::string m_current;
+        std::map<std::string, std::string> m_days;
+        std::map<std::string, std::string> m_months;
+};
+
+/* }}} */
+
+} // end namespace daemon
+} // end namespace vetero
+
+#endif // VETERO_VETEROD_LIVECACHE_H_
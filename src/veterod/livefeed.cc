@@ -0,0 +1,236 @@
+/* {{{
+ * (c) 2022, Bernhard Walle <bernhard@bwalle.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>. }}}
+ */
+
+#include <cerrno>
+#include <cstring>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <libbw/log/debug.h>
+#include <libbw/log/errorlog.h>
+
+#include "common/utils.h"
+#include "livecache.h"
+#include "livefeed.h"
+
+namespace vetero {
+namespace daemon {
+
+/* LiveFeed {{{ */
+
+const size_t LiveFeed::MaxBufferSize;
+const size_t LiveFeed::MaxSubscribers;
+
+LiveFeed::LiveFeed(const std::string &path)
+    : m_path(path)
+    , m_listenFd(-1)
+    , m_quit(false)
+{
+    if (pipe2(m_wakeupPipe, O_CLOEXEC | O_NONBLOCK) < 0)
+        throw common::SystemError("Unable to create pipe", errno);
+
+    try {
+        m_listenFd = common::listen_unix(path);
+    } catch (...) {
+        close(m_wakeupPipe[0]);
+        close(m_wakeupPipe[1]);
+        throw;
+    }
+
+    BW_DEBUG_INFO("Live feed listening on '%s'", path.c_str());
+    m_thread = std::thread(&LiveFeed::run, this);
+}
+
+LiveFeed::~LiveFeed()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+    wakeup();
+    m_thread.join();
+
+    for (std::map<int, Subscriber>::const_iterator it = m_subscribers.begin();
+            it != m_subscribers.end(); ++it)
+        close(it->first);
+    close(m_listenFd);
+    unlink(m_path.c_str());
+
+    close(m_wakeupPipe[0]);
+    close(m_wakeupPipe[1]);
+}
+
+void LiveFeed::publish(const common::Dataset &dataset, int rainValue,
+                       const common::CurrentWeather &weather)
+{
+    publishMessage(LiveCache::updateJson(dataset, rainValue, weather) + "\n");
+}
+
+void LiveFeed::publish(const common::CurrentWeather &weather)
+{
+    publishMessage("{\"current\":" + LiveCache::currentWeatherJson(weather) + "}\n");
+}
+
+void LiveFeed::publishMessage(const std::string &message)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        m_lastMessage = message;
+        for (std::map<int, Subscriber>::iterator it = m_subscribers.begin();
+                it != m_subscribers.end(); ++it) {
+            Subscriber &subscriber = it->second;
+            if (subscriber.buffer.size() + message.size() > MaxBufferSize) {
+                if (subscriber.dropped++ == 0)
+                    BW_ERROR_WARNING("Live feed subscriber %d doesn't read, dropping messages",
+                                     it->first);
+                continue;
+            }
+            subscriber.buffer += message;
+        }
+    }
+
+    wakeup();
+}
+
+void LiveFeed::run()
+{
+    while (true) {
+        std::vector<struct pollfd> fds;
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_quit)
+                break;
+
+            struct pollfd pfd = { m_wakeupPipe[0], POLLIN, 0 };
+            fds.push_back(pfd);
+            pfd.fd = m_listenFd;
+            fds.push_back(pfd);
+            for (std::map<int, Subscriber>::const_iterator it = m_subscribers.begin();
+                    it != m_subscribers.end(); ++it) {
+                // POLLIN detects the disconnect of the subscriber
+                pfd.fd = it->first;
+                pfd.events = it->second.buffer.empty() ? POLLIN : POLLIN | POLLOUT;
+                fds.push_back(pfd);
+            }
+        }
+
+        int ret = poll(&fds[0], fds.size(), -1);
+        if (ret < 0 && errno != EINTR)
+            BW_ERROR_ERR("Unable to call poll(): %s", std::strerror(errno));
+
+        char buffer[64];
+        while (read(m_wakeupPipe[0], buffer, sizeof(buffer)) > 0)
+            ;
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (fds[1].revents & POLLIN)
+            acceptSubscriber();
+
+        // new messages may have been published in the meantime, so try to send to everybody
+        std::map<int, Subscriber>::iterator it = m_subscribers.begin();
+        while (it != m_subscribers.end()) {
+            bool connected = true;
+
+            for (size_t i = 2; i < fds.size(); ++i) {
+                if (fds[i].fd != it->first || !(fds[i].revents & (POLLIN | POLLHUP | POLLERR)))
+                    continue;
+
+                // subscribers don't send anything, so readable means disconnected
+                char discard[256];
+                ssize_t len = recv(it->first, discard, sizeof(discard), MSG_DONTWAIT);
+                if (len == 0 || (len < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+                    connected = false;
+            }
+
+            if (connected)
+                connected = flush(it->first, it->second);
+
+            if (!connected) {
+                BW_DEBUG_DBG("Live feed subscriber %d disconnected", it->first);
+                close(it->first);
+                m_subscribers.erase(it++);
+            } else
+                ++it;
+        }
+    }
+}
+
+void LiveFeed::acceptSubscriber()
+{
+    int fd = accept4(m_listenFd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR && errno != ECONNABORTED)
+            BW_ERROR_WARNING("Live feed: unable to accept connection: %s", std::strerror(errno));
+        return;
+    }
+
+    if (m_subscribers.size() >= MaxSubscribers) {
+        BW_ERROR_WARNING("Live feed: too many subscribers, closing connection");
+        close(fd);
+        return;
+    }
+
+    Subscriber &subscriber = m_subscribers[fd];
+    subscriber.buffer = m_lastMessage;
+    subscriber.dropped = 0;
+    BW_DEBUG_DBG("Live feed subscriber %d connected", fd);
+}
+
+bool LiveFeed::flush(int fd, Subscriber &subscriber)
+{
+    size_t sent = 0;
+    while (sent < subscriber.buffer.size()) {
+        ssize_t len = send(fd, subscriber.buffer.data() + sent, subscriber.buffer.size() - sent,
+                           MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (len < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                return false;
+            break;
+        }
+        sent += len;
+    }
+    subscriber.buffer.erase(0, sent);
+
+    if (subscriber.buffer.empty() && subscriber.dropped > 0) {
+        BW_DEBUG_INFO("Live feed subscriber %d reads again, %zu messages dropped",
+                      fd, subscriber.dropped);
+        subscriber.dropped = 0;
+    }
+
+    return true;
+}
+
+void LiveFeed::wakeup()
+{
+    char c = 0;
+    if (write(m_wakeupPipe[1], &c, 1) < 0 && errno != EAGAIN)
+        BW_ERROR_WARNING("Unable to wake up the live feed: %s", std::strerror(errno));
+}
+
+/* }}} */
+
+} // end namespace daemon
+} // end namespace vetero
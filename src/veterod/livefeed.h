@@ -0,0 +1,166 @@
+/* {{{
+ * (c) 2022, Bernhard Walle <bernhard@bwalle.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>. }}}
+ */
+#ifndef VETERO_VETEROD_LIVEFEED_H_
+#define VETERO_VETEROD_LIVEFEED_H_
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <libbw/noncopyable.h>
+
+#include "common/dataset.h"
+#include "common/error.h"
+
+namespace vetero {
+namespace daemon {
+
+/* LiveFeed {{{ */
+
+/**
+ * \class LiveFeed
+ * \brief Pushes each sample to the subscribers of a Unix domain socket
+ *
+ * Local programs like vetero-displayd connect to <tt>feed_socket</tt> and receive one JSON
+ * object per line for each sample that veterod has stored:
+ *
+ * \code
+ * {"sample":{"timestamp":"2022-04-01 12:00:00","temp":12.3,...},"current":{"temperature":12.3,...}}
+ * \endcode
+ *
+ * \c sample uses the names of the <tt>weatherdata_float</tt> view, \c current the ones of
+ * <tt>current_weather.json</tt>, see LiveCache. A new subscriber gets the last message
+ * immediately, the message sent at startup has no \c sample.
+ *
+ * publish() only appends to the buffer of each subscriber, the data is sent by a thread of its
+ * own. The buffers are bounded: if a subscriber doesn't read, further messages are dropped for
+ * that subscriber, so a slow subscriber never delays the ingest loop and never gets a
+ * truncated line.
+ *
+ * \author Bernhard Walle <bernhard@bwalle.de>
+ * \ingroup daemon
+ */
+class LiveFeed : private bw::Noncopyable {
+
+    public:
+        /// Maximum number of unsent bytes per subscriber
+        static const size_t MaxBufferSize = 65536;
+
+        /// Maximum number of subscribers
+        static const size_t MaxSubscribers = 32;
+
+    public:
+        /**
+         * \brief Constructor
+         *
+         * Listens on \p path and starts the thread.
+         *
+         * \param[in] path the path of the socket, an existing socket is replaced
+         * \exception common::SystemError if the socket cannot be created
+         */
+        LiveFeed(const std::string &path);
+
+        /**
+         * \brief Destructor
+         *
+         * Stops the thread, disconnects all subscribers and removes the socket.
+         */
+        ~LiveFeed();
+
+    public:
+        /**
+         * \brief Sends a sample and the current weather to all subscribers
+         *
+         * \param[in] dataset the sample
+         * \param[in] rainValue the rain since the previous sample as computed by
+         *            common::DbAccess::insertDataset()
+         * \param[in] weather the current weather including \p dataset
+         */
+        void publish(const common::Dataset &dataset, int rainValue,
+                     const common::CurrentWeather &weather);
+
+        /**
+         * \brief Sends the current weather to all subscribers
+         *
+         * Used at startup so that subscribers have data before the first sample arrives.
+         *
+         * \param[in] weather the current weather
+         */
+        void publish(const common::CurrentWeather &weather);
+
+    protected:
+        /**
+         * \brief State of a subscriber
+         */
+        struct Subscriber {
+            std::string buffer;             ///< data not sent yet
+            size_t dropped;                 ///< messages dropped since the last successful one
+        };
+
+        /**
+         * \brief Appends a message to the buffers of all subscribers
+         *
+         * \param[in] message the line including the newline
+         */
+        void publishMessage(const std::string &message);
+
+        /**
+         * \brief Thread function
+         */
+        void run();
+
+        /**
+         * \brief Accepts a subscriber
+         *
+         * The caller must hold the mutex.
+         */
+        void acceptSubscriber();
+
+        /**
+         * \brief Sends the buffer of a subscriber
+         *
+         * The caller must hold the mutex.
+         *
+         * \param[in] fd the socket of the subscriber
+         * \param[in] subscriber the subscriber
+         * \return \c false if the subscriber has disconnected
+         */
+        bool flush(int fd, Subscriber &subscriber);
+
+        /**
+         * \brief Wakes up the thread
+         */
+        void wakeup();
+
+    private:
+        std::string m_path;
+        int m_listenFd;
+        int m_wakeupPipe[2];
+        std::mutex m_mutex;
+        std::map<int, Subscriber> m_subscribers;
+        std::string m_lastMessage;
+        bool m_quit;
+        std::thread m_thread;
+};
+
+/* }}} */
+
+} // end namespace daemon
+} // end namespace vetero
+
+#endif // VETERO_VETEROD_LIVEFEED_H_
@@ -0,0 +1,252 @@
+/* {{{
+ * (c) 2022, Bernhard Walle <bernhard@bwalle.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>. }}}
+ */
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include <libbw/log/errorlog.h>
+#include <libbw/log/debug.h>
+
+#include "reportscheduler.h"
+
+namespace vetero {
+namespace daemon {
+
+/* ReportScheduler {{{ */
+
+namespace {
+
+// fraction of the sampling interval that triggers the warning
+const double CycleWarningRatio = 0.8;
+
+double seconds(std::chrono::steady_clock::duration duration)
+{
+    return std::chrono::duration<double>(duration).count();
+}
+
+} // anonymous namespace
+
+ReportScheduler::ReportScheduler(const std::string &configfile, const std::string &errorLogfile,
+                                 int maxWorkers)
+    : m_pendingUpload(false)
+    , m_samplingInterval(Clock::duration::zero())
+    , m_cycleWarning(false)
+    , m_quit(false)
+{
+    if (pipe2(m_wakeupPipe, O_CLOEXEC | O_NONBLOCK) < 0)
+        throw common::SystemError("Unable to create pipe", errno);
+
+    for (int i = 0; i < maxWorkers; ++i)
+        m_workers.push_back(std::unique_ptr<ReportWorker>(new ReportWorker(configfile, errorLogfile)));
+    m_batches.resize(m_workers.size());
+
+    m_thread = std::thread(&ReportScheduler::run, this);
+}
+
+ReportScheduler::~ReportScheduler()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+    wakeup();
+    m_thread.join();
+
+    close(m_wakeupPipe[0]);
+    close(m_wakeupPipe[1]);
+}
+
+void ReportScheduler::schedule(const std::vector<std::string> &jobs, bool upload)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        Clock::time_point now = Clock::now();
+        if (m_lastSchedule != Clock::time_point())
+            m_samplingInterval = now - m_lastSchedule;
+        m_lastSchedule = now;
+
+        for (std::vector<std::string>::const_iterator it = jobs.begin(); it != jobs.end(); ++it)
+            m_pendingJobs.insert(std::make_pair(*it, now));
+        m_pendingUpload |= upload;
+
+        BW_DEBUG_DBG("Report queue: %zu job(s) pending", m_pendingJobs.size());
+    }
+
+    wakeup();
+}
+
+void ReportScheduler::run()
+{
+    // SIGCHLD is blocked in all other threads, see Veterod::installSignalhandlers()
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGCHLD);
+    pthread_sigmask(SIG_UNBLOCK, &set, NULL);
+
+    while (true) {
+        std::vector<struct pollfd> fds;
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_quit)
+                break;
+
+            collect();
+            dispatch();
+
+            struct pollfd pfd = { m_wakeupPipe[0], POLLIN, 0 };
+            fds.push_back(pfd);
+            for (size_t i = 0; i < m_workers.size(); ++i) {
+                if (m_workers[i]->fd() < 0)
+                    continue;
+                pfd.fd = m_workers[i]->fd();
+                fds.push_back(pfd);
+            }
+        }
+
+        int ret = poll(&fds[0], fds.size(), -1);
+        if (ret < 0 && errno != EINTR)
+            BW_ERROR_ERR("Unable to call poll(): %s", std::strerror(errno));
+
+        char buffer[64];
+        while (read(m_wakeupPipe[0], buffer, sizeof(buffer)) > 0)
+            ;
+    }
+
+    // closes the sockets, which terminates the workers
+    m_workers.clear();
+}
+
+void ReportScheduler::collect()
+{
+    for (size_t i = 0; i < m_workers.size(); ++i) {
+        Batch &batch = m_batches[i];
+        if (batch.jobs.empty())
+            continue;
+
+        ReportWorker &worker = *m_workers[i];
+        int finished = worker.collectFinished();
+
+        if (finished > 0) {
+            Clock::time_point now = Clock::now();
+            Clock::time_point queued = batch.started;
+            for (std::map<std::string, Clock::time_point>::const_iterator it = batch.jobs.begin();
+                    it != batch.jobs.end(); ++it)
+                queued = std::min(queued, it->second);
+
+            BW_DEBUG_INFO("Report batch of %zu job(s) finished on worker %zu after %.1f s "
+                          "(%.1f s since queued), %zu job(s) pending",
+                          batch.jobs.size(), i, seconds(now - batch.started), seconds(now - queued),
+                          m_pendingJobs.size());
+            checkCycleTime(now - queued);
+            batch.jobs.clear();
+        } else if (worker.pending() == 0) {
+            // the worker terminated, run the jobs again
+            BW_ERROR_WARNING("Report worker %zu lost %zu job(s), scheduling them again",
+                             i, batch.jobs.size());
+            m_pendingJobs.insert(batch.jobs.begin(), batch.jobs.end());
+            m_pendingUpload |= batch.upload;
+            batch.jobs.clear();
+        }
+    }
+}
+
+void ReportScheduler::dispatch()
+{
+    for (size_t i = 0; i < m_workers.size() && !m_pendingJobs.empty(); ++i) {
+        Batch &batch = m_batches[i];
+        if (!batch.jobs.empty())
+            continue;
+
+        // jobs that are still running elsewhere stay in the queue
+        std::vector<std::string> jobs;
+        std::map<std::string, Clock::time_point>::iterator it = m_pendingJobs.begin();
+        while (it != m_pendingJobs.end()) {
+            if (running(it->first)) {
+                ++it;
+                continue;
+            }
+            jobs.push_back(it->first);
+            batch.jobs.insert(*it);
+            m_pendingJobs.erase(it++);
+        }
+
+        if (jobs.empty())
+            break;
+
+        batch.started = Clock::now();
+        batch.upload = m_pendingUpload;
+        m_pendingUpload = false;
+
+        try {
+            m_workers[i]->submit(jobs, batch.upload);
+            BW_DEBUG_INFO("Report batch of %zu job(s) started on worker %zu, %zu job(s) pending",
+                          jobs.size(), i, m_pendingJobs.size());
+        } catch (const common::ApplicationError &err) {
+            BW_ERROR_ERR("Unable to start reports: %s", err.what());
+            m_pendingJobs.insert(batch.jobs.begin(), batch.jobs.end());
+            m_pendingUpload |= batch.upload;
+            batch.jobs.clear();
+            break;
+        }
+    }
+}
+
+void ReportScheduler::checkCycleTime(Clock::duration latency)
+{
+    if (m_samplingInterval <= Clock::duration::zero())
+        return;
+
+    double ratio = seconds(latency) / seconds(m_samplingInterval);
+    if (ratio >= CycleWarningRatio && !m_cycleWarning) {
+        BW_ERROR_WARNING("Reports took %.1f s, that's %.0f%% of the sampling interval of %.1f s",
+                         seconds(latency), ratio * 100, seconds(m_samplingInterval));
+        m_cycleWarning = true;
+    } else if (ratio < CycleWarningRatio/2 && m_cycleWarning) {
+        BW_DEBUG_INFO("Reports take %.1f s again, %.0f%% of the sampling interval",
+                      seconds(latency), ratio * 100);
+        m_cycleWarning = false;
+    }
+}
+
+bool ReportScheduler::running(const std::string &job) const
+{
+    for (size_t i = 0; i < m_batches.size(); ++i)
+        if (m_batches[i].jobs.find(job) != m_batches[i].jobs.end())
+            return true;
+
+    return false;
+}
+
+void ReportScheduler::wakeup()
+{
+    char c = 0;
+    if (write(m_wakeupPipe[1], &c, 1) < 0 && errno != EAGAIN)
+        BW_ERROR_WARNING("Unable to wake up report scheduler: %s", std::strerror(errno));
+}
+
+/* }}} */
+
+} // end namespace daemon
+} // end namespace vetero
@@ -0,0 +1,163 @@
+/* {{{
+ * (c) 2022, Bernhard Walle <bernhard@bwalle.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>. }}}
+ */
+#ifndef VETERO_VETEROD_REPORTSCHEDULER_H_
+#define VETERO_VETEROD_REPORTSCHEDULER_H_
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <libbw/noncopyable.h>
+
+#include "common/error.h"
+#include "reportworker.h"
+
+namespace vetero {
+namespace daemon {
+
+/* ReportScheduler {{{ */
+
+/**
+ * \class ReportScheduler
+ * \brief Queue for report jobs in front of the report workers
+ *
+ * Jobs are collected in a set of pending jobs, so a job that is scheduled again before it
+ * has been started runs only once. At most \p maxWorkers ReportWorker processes generate
+ * reports at the same time, and a job is never started while the same job is still running
+ * on another worker. That way a slow run doesn't lead to concurrent runs that write the
+ * same files.
+ *
+ * The workers are driven by a background thread that also logs the queue depth and the
+ * latency of each batch in the debug log. veterod schedules jobs once per sample, so the
+ * time between two calls of schedule() is the sampling interval. If the reports of a sample
+ * take more than 80 % of it, a warning is logged: the reports are going to lag behind.
+ * Details about the slow stages are written by vetero-reportgen, see <tt>report_stats_file</tt>.
+ *
+ * \author Bernhard Walle <bernhard@bwalle.de>
+ * \ingroup daemon
+ */
+class ReportScheduler : private bw::Noncopyable {
+
+    public:
+        /**
+         * \brief Constructor
+         *
+         * Starts the scheduler thread. The worker processes are started on demand.
+         *
+         * \param[in] configfile the configuration file passed to vetero-reportgen, may be empty
+         * \param[in] errorLogfile the error log passed to vetero-reportgen
+         * \param[in] maxWorkers the maximum number of concurrent vetero-reportgen processes
+         * \exception common::SystemError if the wakeup pipe cannot be created
+         */
+        ReportScheduler(const std::string &configfile, const std::string &errorLogfile,
+                        int maxWorkers);
+
+        /**
+         * \brief Destructor
+         *
+         * Stops the scheduler thread and terminates the workers. Pending jobs are dropped.
+         */
+        ~ReportScheduler();
+
+    public:
+        /**
+         * \brief Adds jobs to the queue
+         *
+         * Returns immediately.
+         *
+         * \param[in] jobs the jobs like <tt>"day:2012-04-01"</tt>
+         * \param[in] upload \c true if the reports should be uploaded after the jobs have run
+         */
+        void schedule(const std::vector<std::string> &jobs, bool upload);
+
+    protected:
+        typedef std::chrono::steady_clock Clock;
+
+        /**
+         * \brief Jobs that are currently processed by a worker
+         */
+        struct Batch {
+            std::map<std::string, Clock::time_point> jobs;  ///< jobs with their enqueue time
+            Clock::time_point started;                      ///< time the batch was sent
+            bool upload;                                    ///< upload afterwards
+        };
+
+        /**
+         * \brief Main function of the scheduler thread
+         */
+        void run();
+
+        /**
+         * \brief Processes the acknowledgements of the workers
+         *
+         * Must be called with the mutex held.
+         */
+        void collect();
+
+        /**
+         * \brief Starts pending jobs on idle workers
+         *
+         * Must be called with the mutex held.
+         */
+        void dispatch();
+
+        /**
+         * \brief Warns if the reports take too long compared to the sampling interval
+         *
+         * Must be called with the mutex held.
+         *
+         * \param[in] latency the time from queueing the first job of a batch until it finished
+         */
+        void checkCycleTime(Clock::duration latency);
+
+        /**
+         * \brief Checks if \p job is currently processed by a worker
+         *
+         * \param[in] job the job description
+         * \return \c true if the job is running, \c false otherwise
+         */
+        bool running(const std::string &job) const;
+
+        /**
+         * \brief Wakes up the scheduler thread
+         */
+        void wakeup();
+
+    private:
+        std::mutex m_mutex;
+        std::map<std::string, Clock::time_point> m_pendingJobs;
+        bool m_pendingUpload;
+        std::vector< std::unique_ptr<ReportWorker> > m_workers;
+        std::vector<Batch> m_batches;
+        Clock::time_point m_lastSchedule;
+        Clock::duration m_samplingInterval;
+        bool m_cycleWarning;
+        int m_wakeupPipe[2];
+        bool m_quit;
+        std::thread m_thread;
+};
+
+/* }}} */
+
+} // end namespace daemon
+} // end namespace vetero
+
+#endif // VETERO_VETEROD_REPORTSCHEDULER_H_
@@ -0,0 +1,172 @@
+/* {{{
+ * (c) 2022, Bernhard Walle <bernhard@bwalle.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>. }}}
+ */
+#include <cerrno>
+#include <cstring>
+
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include <libbw/stringutil.h>
+#include <libbw/log/errorlog.h>
+#include <libbw/log/debug.h>
+
+#include "common/utils.h"
+#include "childprocesswatcher.h"
+#include "reportworker.h"
+
+namespace vetero {
+namespace daemon {
+
+/* ReportWorker {{{ */
+
+ReportWorker::ReportWorker(const std::string &configfile, const std::string &errorLogfile)
+    : m_configfile(configfile)
+    , m_errorLogfile(errorLogfile)
+    , m_pid(0)
+    , m_fd(-1)
+    , m_pending(0)
+{}
+
+ReportWorker::~ReportWorker()
+{
+    closeSocket();
+}
+
+void ReportWorker::submit(const std::vector<std::string> &jobs, bool upload)
+{
+    ensureRunning();
+
+    std::string request = upload ? "upload" : "generate";
+    for (std::vector<std::string>::const_iterator it = jobs.begin(); it != jobs.end(); ++it)
+        request += " " + *it;
+    request += "\n";
+
+    size_t written = 0;
+    while (written < request.size()) {
+        ssize_t ret = send(m_fd, request.c_str() + written, request.size() - written, MSG_NOSIGNAL);
+        if (ret < 0) {
+            if (errno == EINTR)
+                continue;
+            int err = errno;
+            closeSocket();
+            throw common::SystemError("Unable to send jobs to vetero-reportgen", err);
+        }
+        written += ret;
+    }
+
+    m_pending++;
+}
+
+int ReportWorker::collectFinished()
+{
+    if (m_fd < 0)
+        return 0;
+
+    char buffer[128];
+    ssize_t ret;
+    while ((ret = recv(m_fd, buffer, sizeof(buffer), MSG_DONTWAIT)) > 0)
+        m_readBuffer.append(buffer, ret);
+
+    if (ret == 0) {
+        BW_ERROR_WARNING("vetero-reportgen closed the connection");
+        closeSocket();
+    } else if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+        BW_ERROR_WARNING("Unable to read from vetero-reportgen: %s", std::strerror(errno));
+
+    int finished = 0;
+    std::string::size_type newline;
+    while ((newline = m_readBuffer.find('\n')) != std::string::npos) {
+        std::string answer = m_readBuffer.substr(0, newline);
+        m_readBuffer.erase(0, newline + 1);
+
+        if (answer == "done")
+            finished++;
+        else
+            BW_ERROR_WARNING("Unknown answer from vetero-reportgen: '%s'", answer.c_str());
+    }
+
+    if (finished > m_pending)
+        finished = m_pending;
+    m_pending -= finished;
+
+    return finished;
+}
+
+int ReportWorker::pending() const
+{
+    return m_pending;
+}
+
+int ReportWorker::fd() const
+{
+    return m_fd;
+}
+
+void ReportWorker::ensureRunning()
+{
+    if (m_fd >= 0 && ChildProcessWatcher::instance()->running(m_pid))
+        return;
+
+    if (m_fd >= 0) {
+        BW_ERROR_WARNING("vetero-reportgen (PID %ld) terminated, restarting it", long(m_pid));
+        closeSocket();
+    }
+
+    int sockets[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sockets) < 0)
+        throw common::SystemError("Unable to create socket for vetero-reportgen", errno);
+
+    std::vector<std::string> args;
+    if (!m_configfile.empty()) {
+        args.push_back("--configfile");
+        args.push_back(m_configfile);
+    }
+    args.push_back("--error-logfile");
+    args.push_back(m_errorLogfile);
+    args.push_back("--daemon");
+
+    try {
+        m_pid = common::start_background("vetero-reportgen", args, sockets[1]);
+    } catch (const common::ApplicationError &err) {
+        close(sockets[0]);
+        close(sockets[1]);
+        throw;
+    }
+    close(sockets[1]);
+
+    m_fd = sockets[0];
+    m_pending = 0;
+    m_readBuffer.clear();
+
+    BW_DEBUG_DBG("'vetero-reportgen --daemon' started with PID %ld", long(m_pid));
+    ChildProcessWatcher::instance()->addChild(m_pid);
+}
+
+void ReportWorker::closeSocket()
+{
+    if (m_fd < 0)
+        return;
+
+    close(m_fd);
+    m_fd = -1;
+    m_pending = 0;
+}
+
+/* }}} */
+
+} // end namespace daemon
+} // end namespace vetero
@@ -0,0 +1,136 @@
+/* {{{
+ * (c) 2022, Bernhard Walle <bernhard@bwalle.de>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>. }}}
+ */
+#ifndef VETERO_VETEROD_REPORTWORKER_H_
+#define VETERO_VETEROD_REPORTWORKER_H_
+
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+
+#include <libbw/noncopyable.h>
+
+#include "common/error.h"
+
+namespace vetero {
+namespace daemon {
+
+/* ReportWorker {{{ */
+
+/**
+ * \class ReportWorker
+ * \brief Persistent vetero-reportgen process
+ *
+ * Instead of starting vetero-reportgen for each dataset, one <tt>vetero-reportgen
+ * --daemon</tt> process is kept running. It keeps the configuration, the translations and
+ * the database caches loaded between the runs. The jobs are sent as one line over a Unix
+ * domain socket and each request is acknowledged with <tt>"done"</tt> after the reports have
+ * been generated.
+ *
+ * If the worker terminates, it's started again with the next request.
+ *
+ * \author Bernhard Walle <bernhard@bwalle.de>
+ * \ingroup daemon
+ */
+class ReportWorker : private bw::Noncopyable {
+
+    public:
+        /**
+         * \brief Constructor
+         *
+         * Doesn't start the process yet.
+         *
+         * \param[in] configfile the configuration file passed to vetero-reportgen, may be empty
+         * \param[in] errorLogfile the error log passed to vetero-reportgen
+         */
+        ReportWorker(const std::string &configfile, const std::string &errorLogfile);
+
+        /**
+         * \brief Destructor
+         *
+         * Closes the socket which terminates the worker.
+         */
+        ~ReportWorker();
+
+    public:
+        /**
+         * \brief Sends jobs to the worker
+         *
+         * Starts the worker if it's not running. The function doesn't wait until the jobs
+         * have been processed.
+         *
+         * \param[in] jobs the jobs like <tt>"day:2012-04-01"</tt>
+         * \param[in] upload \c true if the reports should be uploaded afterwards
+         * \exception common::ApplicationError if the worker cannot be started
+         * \exception common::SystemError if the request cannot be sent
+         */
+        void submit(const std::vector<std::string> &jobs, bool upload);
+
+        /**
+         * \brief Reads the acknowledgements that arrived so far
+         *
+         * Doesn't block.
+         *
+         * \return the number of requests that have been finished since the last call
+         */
+        int collectFinished();
+
+        /**
+         * \brief Returns the number of requests that have not been acknowledged yet
+         *
+         * \return the number of outstanding requests
+         */
+        int pending() const;
+
+        /**
+         * \brief Returns the socket to the worker
+         *
+         * Can be used to wait for acknowledgements with poll(). Is -1 if the worker has not
+         * been started.
+         *
+         * \return the file descriptor
+         */
+        int fd() const;
+
+    protected:
+        /**
+         * \brief Starts the worker if it isn't running
+         *
+         * \exception common::ApplicationError if the worker cannot be started
+         */
+        void ensureRunning();
+
+        /**
+         * \brief Closes the socket
+         */
+        void closeSocket();
+
+    private:
+        std::string m_configfile;
+        std::string m_errorLogfile;
+        pid_t m_pid;
+        int m_fd;
+        int m_pending;
+        std::string m_readBuffer;
+};
+
+/* }}} */
+
+} // end namespace daemon
+} // end namespace vetero
+
+#endif // VETERO_VETEROD_REPORTWORKER_H_
@@ -20,6 +20,7 @@
 #include <csignal>
 #include <fstream>
 
+#include <pthread.h>
 #include <sys/wait.h>
 #include <unistd.h>
 
@@ -34,7 +35,6 @@
 #include "veterod.h"
 #include "config.h"
 #include "datareader.h"
-#include "childprocesswatcher.h"
 
 namespace vetero {
 namespace daemon {
@@ -150,6 +150,17 @@ void Veterod::installSignalhandlers()
     if (ret == SIG_ERR)
         throw common::SystemError("Unable to install signal handler", errno);
 
+    // The report workers are children of the ReportScheduler thread, so SIGCHLD must be
+    // handled there. ChildProcessWatcher blocks the signal in the current thread to protect
+    // its state, which only works if no other thread can run the handler. Blocking it before
+    // any thread is created lets all threads inherit the mask, the scheduler unblocks it.
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGCHLD);
+    int err = pthread_sigmask(SIG_BLOCK, &set, NULL);
+    if (err != 0)
+        throw common::SystemError("Unable to block SIGCHLD", err);
+
     atexit(quit_display_daemon);
 }
 
@@ -166,7 +177,8 @@ void Veterod::openDatabase()
     bool initNeeded = access(dbPath.c_str(), F_OK) != 0;
 
     try {
-        m_database.open(dbPath, 0);
+        // WAL lets vetero-reportgen read a consistent snapshot without blocking the inserts
+        m_database.open(dbPath, vetero::common::Sqlite3Database::FLAG_WAL);
     } catch (const vetero::common::DatabaseError &err) {
         throw common::ApplicationError("Unable to open DB: " + std::string(err.what()) );
     }
@@ -177,7 +189,15 @@ void Veterod::openDatabase()
         if (initNeeded) {
             BW_DEBUG_INFO("Database doesn't exist, creating tables...");
             dbAccess.initTables();
-        }
+        } else if (dbAccess.upgradeSchema())
+            BW_DEBUG_INFO("Database schema upgraded to revision %d",
+                          vetero::common::DbAccess::CurrentSchemaRevision);
+
+        // add the days that were completed while veterod wasn't running, databases from
+        // before the climate normals have the statistics already and get all normals
+        bw::Datetime yesterday = bw::Datetime::now();
+        yesterday.addDays(-1);
+        dbAccess.updateClimateNormals(yesterday.strftime("%Y-%m-%d"));
     } catch (const vetero::common::DatabaseError &err) {
         throw common::ApplicationError("Unable to init DB: " + std::string(err.what()) );
     }
@@ -211,33 +231,66 @@ void Veterod::updateReports(const std::vector<std::string> &jobs, bool upload)
 
     BW_DEBUG_INFO("Updating weather reports (%s)", bw::str(jobs.begin(), jobs.end()).c_str());
 
-    std::vector<std::string> args;
-    if (!m_configfile.empty()) {
-        args.push_back("--configfile");
-        args.push_back(m_configfile);
+    try {
+        if (!m_reportScheduler)
+            m_reportScheduler.reset(new ReportScheduler(m_configfile, m_errorLogfile,
+                                                         m_configuration->reportWorkers()));
+        m_reportScheduler->schedule(jobs, upload);
+    } catch (const common::ApplicationError &err) {
+        BW_ERROR_ERR("updateReports: %s", err.what());
     }
-    args.push_back("--error-logfile");
-    args.push_back(m_errorLogfile);
+}
 
-    if (upload)
-        args.push_back("--upload");
+void Veterod::startLiveApi(common::DbAccess &dbAccess)
+{
+    if (m_configuration->apiSocket().empty() && m_configuration->apiPort() <= 0) {
+        BW_DEBUG_INFO("'api_socket' and 'api_port' not set. Live API disabled.");
+        return;
+    }
 
-    args.insert(args.end(), jobs.begin(), jobs.end());
+    try {
+        std::unique_ptr<LiveCache> cache(new LiveCache(m_configuration->apiSamples()));
+        cache->load(dbAccess);
+
+        std::unique_ptr<LiveApi> api(new LiveApi(*cache));
+        if (!m_configuration->apiSocket().empty())
+            api->listenUnix(m_configuration->apiSocket());
+        if (m_configuration->apiPort() > 0)
+            api->listenTcp(m_configuration->apiPort());
+        api->start();
+
+        m_liveCache = std::move(cache);
+        m_liveApi = std::move(api);
+    } catch (const common::ApplicationError &err) {
+        BW_ERROR_ERR("Unable to start the live API: %s", err.what());
+    }
+}
+
+void Veterod::startLiveFeed()
+{
+    if (m_configuration->feedSocket().empty()) {
+        BW_DEBUG_INFO("'feed_socket' not set. Live feed disabled.");
+        return;
+    }
 
-    pid_t childpid = 0;
     try {
-        childpid = common::start_background("vetero-reportgen", args);
-        BW_DEBUG_DBG("'vetero-reportgen' started with PID %ld", long(childpid));
-        ChildProcessWatcher::instance()->addChild(childpid);
+        m_liveFeed.reset(new LiveFeed(m_configuration->feedSocket()));
     } catch (const common::ApplicationError &err) {
-        BW_ERROR_ERR("updateReports: %s", err.what());
+        BW_ERROR_ERR("Unable to start the live feed: %s", err.what());
     }
 }
 
+void Veterod::publishLiveFeed(const common::Dataset &dataset, int rainValue,
+                              const common::CurrentWeather &weather)
+{
+    if (m_liveFeed)
+        m_liveFeed->publish(dataset, rainValue, weather);
+}
+
 void Veterod::uploadCloudData(const common::CurrentWeather &weather)
 {
-    if (m_cloudUploader)
-        m_cloudUploader->upload(weather);
+    if (m_cloudUploadQueue)
+        m_cloudUploadQueue->upload(weather);
 }
 
 void Veterod::notifyDisplay()
@@ -259,6 +312,10 @@ void Veterod::notifyDisplay()
         return;
     }
 
+    // the display daemon is a subscriber of the live feed then
+    if (m_liveFeed)
+        return;
+
     err = kill(s_displayPid, SIGUSR1);
     if (err < 0) {
         BW_ERROR_ERR("Unable to send SIGUSR1 to %d: %s", s_displayPid, strerror(errno));
@@ -266,43 +323,46 @@ void Veterod::notifyDisplay()
     }
 }
 
-void Veterod::updateEnvironment(const vetero::common::Dataset &dataset, int rainValue)
+std::vector<std::string> Veterod::postscriptEnvironment(const vetero::common::Dataset &dataset,
+                                                       int rainValue)
 {
+    std::vector<std::string> environment;
+
     if (!getenv("VETERO_DB"))
-        setenv("VETERO_DB", m_configuration->databasePath().c_str(), true);
+        environment.push_back("VETERO_DB=" + m_configuration->databasePath());
 
     if (dataset.sensorType().hasTemperature())
-        setenv("VETERO_CURRENT_TEMPERATURE", bw::str(dataset.temperature()/100.0).c_str(), true);
-    else
-        unsetenv("VETERO_CURRENT_TEMPERATURE");
+        environment.push_back("VETERO_CURRENT_TEMPERATURE=" + bw::str(dataset.temperature()/100.0));
 
     if (dataset.sensorType().hasHumidity())
-        setenv("VETERO_CURRENT_HUMIDITY", bw::str(dataset.humidity()/100.0).c_str(), true);
-    else
-        unsetenv("VETERO_CURRENT_HUMIDITY");
+        environment.push_back("VETERO_CURRENT_HUMIDITY=" + bw::str(dataset.humidity()/100.0));
 
     if (dataset.sensorType().hasRain())
-        setenv("VETERO_CURRENT_RAIN", bw::str(rainValue/1000.0).c_str(), true);
-    else
-        unsetenv("VETERO_CURRENT_RAIN");
+        environment.push_back("VETERO_CURRENT_RAIN=" + bw::str(rainValue/1000.0));
 
     if (dataset.sensorType().hasWindSpeed())
-        setenv("VETERO_CURRENT_WIND", bw::str(dataset.windSpeed()/100.0).c_str(), true);
-    else
-        unsetenv("VETERO_CURRENT_WIND");
+        environment.push_back("VETERO_CURRENT_WIND=" + bw::str(dataset.windSpeed()/100.0));
+
+    return environment;
 }
 
-void Veterod::runPostscript(const vetero::common::Dataset &dataset, int rainValue)
+void Veterod::runPostscript(const vetero::common::Dataset &dataset, int rainValue,
+                            const common::CurrentWeather &weather)
 {
     std::string script = m_configuration->updatePostscript();
 
     if (script.empty())
         return;
 
-    updateEnvironment(dataset, rainValue);
-    int rc = system(script.c_str());
-    if (rc != 0)
-        BW_ERROR_ERR("Unable to run '%s': %d", script.c_str(), WEXITSTATUS(rc));
+    try {
+        if (!m_hookRunner)
+            m_hookRunner.reset(new HookRunner(m_configuration->hooksMaxRunning()));
+        m_hookRunner->start("update_postscript", script, m_configuration->updatePostscriptTimeout(),
+                            LiveCache::updateJson(dataset, rainValue, weather) + "\n",
+                            postscriptEnvironment(dataset, rainValue));
+    } catch (const common::ApplicationError &err) {
+        BW_ERROR_ERR("Unable to run '%s': %s", script.c_str(), err.what());
+    }
 }
 
 void Veterod::createPidfile()
@@ -346,9 +406,10 @@ void Veterod::exec()
     }
 
     if (!m_configuration->cloudType().empty()) {
-        CloudUploader *uploader = CloudUploader::create(m_configuration->cloudType(), *m_configuration);
+        std::unique_ptr<CloudUploader> uploader(CloudUploader::create(m_configuration->cloudType(),
+                                                                      *m_configuration));
         if (uploader)
-            m_cloudUploader.reset(uploader);
+            m_cloudUploadQueue.reset(new CloudUploadQueue(std::move(uploader)));
         else
             BW_ERROR_WARNING("Cloud type '%s' not supported", m_configuration->cloudType().c_str());
     }
@@ -361,11 +422,26 @@ void Veterod::exec()
         return;
     }
 
+    startLiveFeed();
     startDisplay();
     openDatabase();
     common::DbAccess dbAccess(&m_database);
+    startLiveApi(dbAccess);
+    if (m_liveFeed) {
+        try {
+            m_liveFeed->publish(dbAccess.queryCurrentWeather());
+        } catch (const common::DatabaseError &err) {
+            BW_ERROR_WARNING("Unable to read the current weather for the live feed: %s",
+                             err.what());
+        }
+    }
     // don't assume we need to regenerate everything on startup
     bw::Datetime lastInserted = bw::Datetime::now();
+    // the climate normals may have been updated on startup, see openDatabase()
+    bool climatePending = true;
+    // data migrations of a schema upgrade run in small batches between the samples
+    const int migrationBatchesPerDataset = 4;
+    bool migrationPending = true;
 
     while (true) {
         try {
@@ -381,15 +457,26 @@ void Veterod::exec()
             }
 
             dbAccess.insertDataset(dataset, rainValue);
-            runPostscript(dataset, rainValue);
-
             dbAccess.updateDayStatistics(dataset.timestamp().strftime("%Y-%m-%d"));
+
+            common::CurrentWeather currentWeather = dbAccess.queryCurrentWeather();
+            runPostscript(dataset, rainValue, currentWeather);
+            publishLiveFeed(dataset, rainValue, currentWeather);
             notifyDisplay();
-            uploadCloudData( dbAccess.queryCurrentWeather() );
+            if (m_liveCache) {
+                m_liveCache->addSample(dataset, rainValue);
+                m_liveCache->setCurrentWeather(currentWeather);
+                m_liveCache->updateDay(dbAccess, dataset.timestamp().strftime("%Y-%m-%d"));
+            }
+            uploadCloudData(currentWeather);
 
             std::vector<std::string> jobs;
             jobs.push_back("current");
             jobs.push_back("day:" + dataset.timestamp().dateStr());
+            if (climatePending) {
+                jobs.push_back("climate");
+                climatePending = false;
+            }
             if (dataset.timestamp().day() != lastInserted.day()) {
 
                 bw::Datetime timestamp(dataset.timestamp());
@@ -403,6 +490,13 @@ void Veterod::exec()
                 dbAccess.updateMonthStatistics(timestamp.strftime("%Y-%m"));
                 if (timestamp.month() != lastDay.month())
                     dbAccess.updateMonthStatistics(lastDay.strftime("%Y-%m"));
+                dbAccess.updateClimateNormals(lastDay.strftime("%Y-%m-%d"));
+
+                if (m_liveCache) {
+                    m_liveCache->updateMonth(dbAccess, timestamp.strftime("%Y-%m"));
+                    if (timestamp.month() != lastDay.month())
+                        m_liveCache->updateMonth(dbAccess, lastDay.strftime("%Y-%m"));
+                }
 
                 //
                 // update reports
@@ -420,10 +514,15 @@ void Veterod::exec()
                 jobs.push_back("year:" + lastDay.strftime("%Y"));
                 if ( (timestamp.month() == bw::Datetime::January) && (timestamp.day() == 1) )
                     jobs.push_back("year:" + timestamp.strftime("%Y"));
+
+                jobs.push_back("climate");
             }
             updateReports(jobs, true);
 
             lastInserted = dataset.timestamp();
+
+            if (migrationPending)
+                migrationPending = !dbAccess.continueMigration(migrationBatchesPerDataset);
         } catch (const common::ApplicationError &err) {
             BW_ERROR_ERR("%s", err.what());
         }
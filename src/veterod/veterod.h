@@ -23,8 +23,13 @@
 #include "common/configuration.h"
 #include "common/database.h"
 #include "common/veteroapplication.h"
-#include "clouduploader.h"
+#include "clouduploadqueue.h"
 #include "datareader.h"
+#include "hookrunner.h"
+#include "liveapi.h"
+#include "livecache.h"
+#include "livefeed.h"
+#include "reportscheduler.h"
 
 namespace vetero {
 namespace daemon {
@@ -64,6 +69,8 @@ class Veterod : public common::VeteroApplication
         /**
          * \brief Installs the termination signal handlers
          *
+         * Also blocks SIGCHLD, so it must be called before any thread is started.
+         *
          * \exception common::ApplicationError if registering the signal handlers failed.
          */
         void installSignalhandlers();
@@ -128,29 +135,72 @@ class Veterod : public common::VeteroApplication
 
         /**
          * \brief Notifies the display daemon about new data.
+         *
+         * Only checks if the display daemon is still running when the live feed is active
+         * since it gets the data from there.
          */
         void notifyDisplay();
 
+        /**
+         * \brief Starts the live feed, if configured
+         *
+         * Listens on <tt>feed_socket</tt>. Errors are logged, veterod continues without the
+         * feed then.
+         */
+        void startLiveFeed();
+
+        /**
+         * \brief Sends a sample to the subscribers of the live feed, if it's active
+         *
+         * \param[in] dataset the sample
+         * \param[in] rainValue the rain since the previous sample
+         * \param[in] weather the current weather
+         */
+        void publishLiveFeed(const common::Dataset &dataset, int rainValue,
+                             const common::CurrentWeather &weather);
+
+        /**
+         * \brief Starts the live API, if configured
+         *
+         * Fills the LiveCache from the database and listens on <tt>api_socket</tt> and
+         * <tt>api_port</tt>. Errors are logged, veterod continues without the API then.
+         *
+         * \param[in] dbAccess the database
+         */
+        void startLiveApi(common::DbAccess &dbAccess);
+
         /**
          * \brief Uploads the current data to the cloud service, if configured
          *
+         * Returns immediately, see CloudUploadQueue.
+         *
          * \param[in] weather the current weather
          */
         void uploadCloudData(const common::CurrentWeather &weather);
 
         /**
-         * \brief Sets some weather values in the process environment
+         * \brief Returns some weather values as environment variables for the postscript
          *
-         * This environment can be used the vetero postscript.
+         * \param[in] dataset the sample
+         * \param[in] rainValue the rain since the previous sample
+         * \return the variables like <tt>"VETERO_CURRENT_TEMPERATURE=12.3"</tt>
          */
-        void updateEnvironment(const vetero::common::Dataset &dataset,
+        std::vector<std::string> postscriptEnvironment(const vetero::common::Dataset &dataset,
                 int rainValue);
 
         /**
-         * \brief Executes the postscript, if there's any
+         * \brief Starts the postscript, if there's any
+         *
+         * Doesn't wait for the postscript, see HookRunner. The script gets the sample and the
+         * current weather as JSON on standard input, see LiveCache::updateJson(), and some
+         * values in environment variables, see postscriptEnvironment().
+         *
+         * \param[in] dataset the sample
+         * \param[in] rainValue the rain since the previous sample
+         * \param[in] weather the current weather
          */
         void runPostscript(const vetero::common::Dataset &dataset,
-                int rainValue);
+                int rainValue, const common::CurrentWeather &weather);
 
         void execSingleTest(DataReader &reader);
 
@@ -162,7 +212,12 @@ class Veterod : public common::VeteroApplication
         bool m_noConfigFatal = false;
         vetero::common::Sqlite3Database m_database;
         std::unique_ptr<vetero::common::Configuration> m_configuration;
-        std::unique_ptr<CloudUploader> m_cloudUploader;
+        std::unique_ptr<CloudUploadQueue> m_cloudUploadQueue;
+        std::unique_ptr<ReportScheduler> m_reportScheduler;
+        std::unique_ptr<HookRunner> m_hookRunner;
+        std::unique_ptr<LiveCache> m_liveCache;
+        std::unique_ptr<LiveApi> m_liveApi;
+        std::unique_ptr<LiveFeed> m_liveFeed;
 };
 
 /* }}} */